@@ -0,0 +1,184 @@
+//-----------------------------------------------------------------------------
+//
+//	CacheConvert.cpp
+//
+//	ozw-cacheconvert: convert between a zwcfg XML file and its binary cache
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "Defs.h"
+#include "ConfigCache.h"
+#include "tinyxml.h"
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+// <WriteFile>
+// Write a whole file
+//-----------------------------------------------------------------------------
+static bool WriteFile
+(
+	char const* _filename,
+	string const& _contents
+)
+{
+	FILE* file = fopen( _filename, "wb" );
+	if( file == NULL )
+	{
+		return false;
+	}
+	bool ok = ( fwrite( _contents.data(), 1, _contents.size(), file ) == _contents.size() );
+	return ( fclose( file ) == 0 ) && ok;
+}
+
+//-----------------------------------------------------------------------------
+// <ToCache>
+// Make a binary cache from an XML file.  The cache matches the XML file, so
+// the library will use it.
+//-----------------------------------------------------------------------------
+static int ToCache
+(
+	char const* _xmlFilename,
+	char const* _cacheFilename
+)
+{
+	string xml;
+	if( !ConfigCache::ReadFile( _xmlFilename, &xml ) )
+	{
+		fprintf( stderr, "Cannot read %s\n", _xmlFilename );
+		return 1;
+	}
+
+	TiXmlDocument doc;
+	if( !doc.LoadFile( _xmlFilename, TIXML_ENCODING_UTF8 ) )
+	{
+		fprintf( stderr, "%s: %s (line %d)\n", _xmlFilename, doc.ErrorDesc(), doc.ErrorRow() );
+		return 1;
+	}
+
+	string cache;
+	ConfigCache::Encode( doc, (uint32)xml.size(), ConfigCache::Hash( xml.data(), xml.size() ), &cache );
+	if( !WriteFile( _cacheFilename, cache ) )
+	{
+		fprintf( stderr, "Cannot write %s\n", _cacheFilename );
+		return 1;
+	}
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// <ToXml>
+// Write out the XML held in a binary cache
+//-----------------------------------------------------------------------------
+static int ToXml
+(
+	char const* _cacheFilename,
+	char const* _xmlFilename
+)
+{
+	string cache;
+	if( !ConfigCache::ReadFile( _cacheFilename, &cache ) )
+	{
+		fprintf( stderr, "Cannot read %s\n", _cacheFilename );
+		return 1;
+	}
+
+	TiXmlDocument doc;
+	uint32 sourceSize;
+	uint32 sourceHash;
+	if( !ConfigCache::Decode( cache.data(), cache.size(), &doc, &sourceSize, &sourceHash ) )
+	{
+		fprintf( stderr, "%s is not a binary cache, or was made by a different version of OpenZWave\n", _cacheFilename );
+		return 1;
+	}
+
+	if( !doc.SaveFile( _xmlFilename ) )
+	{
+		fprintf( stderr, "Cannot write %s\n", _xmlFilename );
+		return 1;
+	}
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// <Check>
+// Report whether a binary cache matches an XML file
+//-----------------------------------------------------------------------------
+static int Check
+(
+	char const* _xmlFilename,
+	char const* _cacheFilename
+)
+{
+	string xml;
+	string cache;
+	if( !ConfigCache::ReadFile( _xmlFilename, &xml ) )
+	{
+		fprintf( stderr, "Cannot read %s\n", _xmlFilename );
+		return 1;
+	}
+	if( !ConfigCache::ReadFile( _cacheFilename, &cache ) )
+	{
+		fprintf( stderr, "Cannot read %s\n", _cacheFilename );
+		return 1;
+	}
+
+	TiXmlDocument doc;
+	uint32 sourceSize;
+	uint32 sourceHash;
+	if( !ConfigCache::Decode( cache.data(), cache.size(), &doc, &sourceSize, &sourceHash ) )
+	{
+		printf( "%s cannot be read by this version of OpenZWave\n", _cacheFilename );
+		return 2;
+	}
+	if( ( sourceSize != xml.size() ) || ( sourceHash != ConfigCache::Hash( xml.data(), xml.size() ) ) )
+	{
+		printf( "%s is out of date\n", _cacheFilename );
+		return 2;
+	}
+	printf( "%s is up to date (%u bytes, XML %u bytes)\n", _cacheFilename, (uint32)cache.size(), (uint32)xml.size() );
+	return 0;
+}
+
+int main( int argc, char* argv[] )
+{
+	if( argc != 4 || ( strcmp( argv[1], "tocache" ) && strcmp( argv[1], "toxml" ) && strcmp( argv[1], "check" ) ) )
+	{
+		fprintf( stderr, "Usage: %s tocache <zwcfg xml file> <cache file>\n", argv[0] );
+		fprintf( stderr, "       %s toxml <cache file> <zwcfg xml file>\n", argv[0] );
+		fprintf( stderr, "       %s check <zwcfg xml file> <cache file>\n", argv[0] );
+		fprintf( stderr, "Converts between an OpenZWave network configuration file and the binary cache\n" );
+		fprintf( stderr, "written when the ConfigCache option is set.\n" );
+		return 1;
+	}
+
+	if( !strcmp( argv[1], "tocache" ) )
+	{
+		return ToCache( argv[2], argv[3] );
+	}
+	if( !strcmp( argv[1], "toxml" ) )
+	{
+		return ToXml( argv[2], argv[3] );
+	}
+	return Check( argv[2], argv[3] );
+}
@@ -0,0 +1,86 @@
+//-----------------------------------------------------------------------------
+//
+//	DeviceDb.cpp
+//
+//	ozw-devicedb: compile the config folder into a device database
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "Defs.h"
+#include "DeviceDatabase.h"
+#include "platform/FileOps.h"
+
+using namespace OpenZWave;
+
+int main( int argc, char* argv[] )
+{
+	if( argc < 2 || argc > 3 )
+	{
+		fprintf( stderr, "Usage: %s <config folder> [database file]\n", argv[0] );
+		fprintf( stderr, "Compiles manufacturer_specific.xml and the device configuration files into a\n" );
+		fprintf( stderr, "device database.  The database is written to devices.bin in the config folder\n" );
+		fprintf( stderr, "unless another file is given.\n" );
+		return 1;
+	}
+
+	string configPath = argv[1];
+	if( configPath.size() > 0 && configPath[configPath.size()-1] != '/' )
+	{
+		configPath += "/";
+	}
+	string filename = ( argc == 3 ) ? string( argv[2] ) : configPath + "devices.bin";
+
+	string database;
+	vector<string> warnings;
+	bool ok = DeviceDatabase::Build( configPath, &database, &warnings );
+	for( vector<string>::iterator it = warnings.begin(); it != warnings.end(); ++it )
+	{
+		fprintf( stderr, "%s\n", it->c_str() );
+	}
+	if( !ok )
+	{
+		return 1;
+	}
+
+	FileOps::Create();
+	if( !FileOps::FileWriteAtomic( filename, database ) )
+	{
+		fprintf( stderr, "Cannot write %s\n", filename.c_str() );
+		FileOps::Destroy();
+		return 1;
+	}
+
+	// Check the library can read what was written
+	DeviceDatabase* check = DeviceDatabase::Open( filename );
+	if( check == NULL )
+	{
+		fprintf( stderr, "%s was written but cannot be read back\n", filename.c_str() );
+		FileOps::Destroy();
+		return 1;
+	}
+	delete check;
+	FileOps::Destroy();
+
+	printf( "Wrote %s (%u bytes)\n", filename.c_str(), (uint32)database.size() );
+	return 0;
+}
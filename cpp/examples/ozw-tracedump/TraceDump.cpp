@@ -0,0 +1,463 @@
+//-----------------------------------------------------------------------------
+//
+//	TraceDump.cpp
+//
+//	ozw-tracedump: convert an OpenZWave binary trace back into text log lines
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "Defs.h"
+#include "platform/Trace.h"
+
+using namespace OpenZWave;
+
+// Same names as LogLevelString in the library
+static char const* c_levelNames[] =
+{
+	"Invalid",
+	"None",
+	"Always",
+	"Fatal",
+	"Error",
+	"Warning",
+	"Alert",
+	"Info",
+	"Detail",
+	"Debug",
+	"StreamDetail",
+	"Internal"
+};
+
+static char const c_traceSignature[] = "OZWTRACE";
+
+//-----------------------------------------------------------------------------
+// <Reader>
+// Pulls little-endian values out of a record payload
+//-----------------------------------------------------------------------------
+class Reader
+{
+public:
+	Reader( uint8 const* _data, uint32 _length ): m_data( _data ), m_end( _data + _length ){}
+
+	bool Has( uint32 _size )const{ return( (uint32)( m_end - m_data ) >= _size ); }
+	uint32 Remaining()const{ return (uint32)( m_end - m_data ); }
+	uint8 const* Data()const{ return m_data; }
+
+	uint64 Get( uint32 _size )
+	{
+		uint64 value = 0;
+		for( uint32 i=0; i<_size; ++i )
+		{
+			value |= ( (uint64)m_data[i] ) << ( i * 8 );
+		}
+		m_data += _size;
+		return value;
+	}
+
+	string GetString()
+	{
+		uint32 length = (uint32)Get( 2 );
+		if( !Has( length ) )
+		{
+			length = Remaining();
+		}
+		string str( (char const*)m_data, length );
+		m_data += length;
+		return str;
+	}
+
+private:
+	uint8 const* m_data;
+	uint8 const* m_end;
+};
+
+//-----------------------------------------------------------------------------
+// <WritePrefix>
+// Write the timestamp, level and node the way LogImpl does
+//-----------------------------------------------------------------------------
+static void WritePrefix
+(
+	uint64 _time,
+	uint8 _level,
+	uint8 _nodeId
+)
+{
+	time_t seconds = (time_t)( _time / 1000 );
+	struct tm* tm = localtime( &seconds );
+	printf( "%04d-%02d-%02d %02d:%02d:%02d.%03d ",
+			tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+			tm->tm_hour, tm->tm_min, tm->tm_sec, (int)( _time % 1000 ) );
+
+	if( _level < ( sizeof(c_levelNames) / sizeof(c_levelNames[0]) ) )
+	{
+		printf( "%s, ", c_levelNames[_level] );
+	}
+	else
+	{
+		printf( "Unknown, " );
+	}
+
+	if( _nodeId == 255 )
+	{
+		printf( "contrlr, " );
+	}
+	else if( _nodeId != 0 )
+	{
+		printf( "Node%03d, ", _nodeId );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <FormatMessage>
+// Rebuild the text of a message from its format and the stored arguments.
+// This walks the format in the same way as Trace::PackArgs.
+//-----------------------------------------------------------------------------
+static string FormatMessage
+(
+	string const& _format,
+	Reader& _args
+)
+{
+	string out;
+	char const* f = _format.c_str();
+	while( *f )
+	{
+		if( *f != '%' )
+		{
+			out += *f++;
+			continue;
+		}
+
+		char const* start = f++;
+		if( *f == '%' )
+		{
+			out += '%';
+			++f;
+			continue;
+		}
+
+		// Rebuild the conversion with any '*' replaced by its stored value
+		string spec = "%";
+		while( *f && strchr( "-+ #0'", *f ) )
+		{
+			spec += *f++;
+		}
+		for( int part=0; part<2; ++part )
+		{
+			if( *f == '*' )
+			{
+				char num[16];
+				snprintf( num, sizeof(num), "%d", _args.Has( 4 ) ? (int32)_args.Get( 4 ) : 0 );
+				spec += num;
+				++f;
+			}
+			while( ( *f >= '0' ) && ( *f <= '9' ) )
+			{
+				spec += *f++;
+			}
+			if( ( part == 0 ) && ( *f == '.' ) )
+			{
+				spec += *f++;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		bool isLong = false;
+		bool isSize = false;
+		while( *f && strchr( "hlLqjzt", *f ) )
+		{
+			if( ( *f == 'l' ) || ( *f == 'q' ) || ( *f == 'j' ) )
+			{
+				isLong = true;
+			}
+			else if( ( *f == 'z' ) || ( *f == 't' ) )
+			{
+				isSize = true;
+			}
+			else if( *f == 'h' )
+			{
+				// Keep the narrowing that h and hh imply
+				spec += *f;
+			}
+			++f;
+		}
+
+		if( *f == 0 )
+		{
+			out.append( start );
+			break;
+		}
+
+		char conv = *f++;
+		char buf[2048];
+		buf[0] = 0;
+		switch( conv )
+		{
+			case 'd':
+			case 'i':
+			case 'c':
+			case 'u':
+			case 'o':
+			case 'x':
+			case 'X':
+			{
+				if( isLong || isSize )
+				{
+					if( !_args.Has( 8 ) )
+					{
+						out += "<?>";
+						continue;
+					}
+					spec += "ll";
+					spec += conv;
+					snprintf( buf, sizeof(buf), spec.c_str(), (long long)_args.Get( 8 ) );
+				}
+				else
+				{
+					if( !_args.Has( 4 ) )
+					{
+						out += "<?>";
+						continue;
+					}
+					spec += conv;
+					snprintf( buf, sizeof(buf), spec.c_str(), (int)(int32)_args.Get( 4 ) );
+				}
+				break;
+			}
+			case 'e':
+			case 'E':
+			case 'f':
+			case 'F':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A':
+			{
+				if( !_args.Has( 8 ) )
+				{
+					out += "<?>";
+					continue;
+				}
+				uint64 bits = _args.Get( 8 );
+				double value;
+				memcpy( &value, &bits, sizeof(value) );
+				spec += conv;
+				snprintf( buf, sizeof(buf), spec.c_str(), value );
+				break;
+			}
+			case 's':
+			{
+				if( !_args.Has( 2 ) )
+				{
+					out += "<?>";
+					continue;
+				}
+				string value = _args.GetString();
+				spec += conv;
+				snprintf( buf, sizeof(buf), spec.c_str(), value.c_str() );
+				break;
+			}
+			case 'p':
+			{
+				if( !_args.Has( 8 ) )
+				{
+					out += "<?>";
+					continue;
+				}
+				snprintf( buf, sizeof(buf), "0x%llx", (unsigned long long)_args.Get( 8 ) );
+				break;
+			}
+			case 'n':
+			{
+				break;
+			}
+			default:
+			{
+				// Not a conversion we know.  Show it as written.
+				out.append( start, f - start );
+				continue;
+			}
+		}
+		out += buf;
+	}
+	return out;
+}
+
+//-----------------------------------------------------------------------------
+// <main>
+// Decode each trace file named on the command line (or stdin) to stdout
+//-----------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	if( ( argc > 1 ) && ( !strcmp( argv[1], "-h" ) || !strcmp( argv[1], "--help" ) ) )
+	{
+		fprintf( stderr, "Usage: %s [trace file...]\n", argv[0] );
+		fprintf( stderr, "Writes the contents of OpenZWave binary trace files as text log lines.\n" );
+		return 0;
+	}
+
+	int result = 0;
+	int fileCount = ( argc > 1 ) ? argc - 1 : 1;
+	for( int fileIndex=0; fileIndex<fileCount; ++fileIndex )
+	{
+		char const* filename = ( argc > 1 ) ? argv[fileIndex+1] : NULL;
+		FILE* file = filename ? fopen( filename, "rb" ) : stdin;
+		if( file == NULL )
+		{
+			fprintf( stderr, "Cannot open %s\n", filename );
+			result = 1;
+			continue;
+		}
+
+		vector<string> formats;
+		bool haveHeader = false;
+		uint8 payload[0x10000];
+		while( true )
+		{
+			uint8 header[3];
+			if( fread( header, 1, 1, file ) != 1 )
+			{
+				break;
+			}
+
+			if( header[0] == (uint8)c_traceSignature[0] )
+			{
+				// Start of a session
+				uint8 signature[sizeof(c_traceSignature)];
+				signature[0] = header[0];
+				if( ( fread( &signature[1], 1, sizeof(signature) - 1, file ) != sizeof(signature) - 1 )
+					|| memcmp( signature, c_traceSignature, sizeof(c_traceSignature) - 1 ) )
+				{
+					fprintf( stderr, "%s: not a trace file\n", filename ? filename : "stdin" );
+					result = 1;
+					break;
+				}
+				if( signature[sizeof(signature) - 1] != Trace::Version )
+				{
+					fprintf( stderr, "%s: unsupported trace version %d\n", filename ? filename : "stdin", signature[sizeof(signature) - 1] );
+					result = 1;
+					break;
+				}
+				formats.clear();
+				haveHeader = true;
+				continue;
+			}
+
+			if( !haveHeader || ( fread( &header[1], 1, 2, file ) != 2 ) )
+			{
+				fprintf( stderr, "%s: corrupt trace\n", filename ? filename : "stdin" );
+				result = 1;
+				break;
+			}
+
+			uint32 length = header[1] | ( ( (uint32)header[2] ) << 8 );
+			if( fread( payload, 1, length, file ) != length )
+			{
+				// A trace cut short by a crash or power loss
+				fprintf( stderr, "%s: truncated record at end of trace\n", filename ? filename : "stdin" );
+				break;
+			}
+
+			Reader reader( payload, length );
+			switch( header[0] )
+			{
+				case Trace::TraceRecord_Format:
+				{
+					if( !reader.Has( 2 ) )
+					{
+						break;
+					}
+					uint16 formatId = (uint16)reader.Get( 2 );
+					if( formats.size() <= formatId )
+					{
+						formats.resize( formatId + 1 );
+					}
+					formats[formatId] = string( (char const*)reader.Data(), reader.Remaining() );
+					break;
+				}
+				case Trace::TraceRecord_Message:
+				{
+					if( !reader.Has( 12 ) )
+					{
+						break;
+					}
+					uint64 timeMs = reader.Get( 8 );
+					uint8 nodeId = (uint8)reader.Get( 1 );
+					uint8 level = (uint8)reader.Get( 1 );
+					uint16 formatId = (uint16)reader.Get( 2 );
+
+					WritePrefix( timeMs, level, nodeId );
+					if( formatId == 0xffff )
+					{
+						printf( "%s\n", reader.GetString().c_str() );
+					}
+					else if( formatId < formats.size() )
+					{
+						printf( "%s\n", FormatMessage( formats[formatId], reader ).c_str() );
+					}
+					else
+					{
+						printf( "<unknown format %d>\n", formatId );
+					}
+					break;
+				}
+				case Trace::TraceRecord_Frame:
+				{
+					if( !reader.Has( 10 ) )
+					{
+						break;
+					}
+					uint64 timeMs = reader.Get( 8 );
+					uint8 nodeId = (uint8)reader.Get( 1 );
+					uint8 direction = (uint8)reader.Get( 1 );
+
+					WritePrefix( timeMs, LogLevel_Detail, nodeId );
+					printf( ( direction == Trace::TraceDirection_Sent ) ? "  Sent: " : "  Received: " );
+					for( uint32 i=0; i<reader.Remaining(); ++i )
+					{
+						printf( i ? ", 0x%.2x" : "0x%.2x", reader.Data()[i] );
+					}
+					printf( "\n" );
+					break;
+				}
+				default:
+				{
+					// Newer record type.  The length lets us step over it.
+					break;
+				}
+			}
+		}
+
+		if( file != stdin )
+		{
+			fclose( file );
+		}
+	}
+
+	return result;
+}
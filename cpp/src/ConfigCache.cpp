@@ -0,0 +1,458 @@
+//-----------------------------------------------------------------------------
+//
+//	ConfigCache.cpp
+//
+//	Compact binary copy of the zwcfg XML file, for a faster start
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include "ConfigCache.h"
+#include "tinyxml.h"
+
+using namespace OpenZWave;
+
+// Elements nested deeper than this mean the cache is damaged
+static uint32 const c_maxDepth = 64;
+
+//-----------------------------------------------------------------------------
+//	Writer
+//	Builds the string table and the encoded tree
+//-----------------------------------------------------------------------------
+class ConfigCache::Writer
+{
+public:
+	void PutByte( uint8 const _byte ){ m_tree += (char)_byte; }
+
+	void PutVarInt( uint32 _value )
+	{
+		while( _value >= 0x80 )
+		{
+			m_tree += (char)( ( _value & 0x7f ) | 0x80 );
+			_value >>= 7;
+		}
+		m_tree += (char)_value;
+	}
+
+	void PutString( char const* _str )
+	{
+		map<string,uint32>::iterator it = m_stringIndex.find( _str );
+		if( it == m_stringIndex.end() )
+		{
+			it = m_stringIndex.insert( pair<string,uint32>( _str, (uint32)m_strings.size() ) ).first;
+			m_strings.push_back( &it->first );
+		}
+		PutVarInt( it->second );
+	}
+
+	map<string,uint32>		m_stringIndex;
+	vector<string const*>	m_strings;			// In index order
+	string					m_tree;
+};
+
+//-----------------------------------------------------------------------------
+//	Reader
+//	Bounds checked reads from the cache
+//-----------------------------------------------------------------------------
+class ConfigCache::Reader
+{
+public:
+	Reader( uint8 const* _data, size_t const _size ): m_pos( _data ), m_end( _data + _size ), m_ok( true ){}
+
+	uint8 GetByte()
+	{
+		if( m_pos >= m_end )
+		{
+			m_ok = false;
+			return 0;
+		}
+		return *m_pos++;
+	}
+
+	uint16 GetUInt16()
+	{
+		uint16 value = GetByte();
+		value |= (uint16)GetByte() << 8;
+		return value;
+	}
+
+	uint32 GetUInt32()
+	{
+		uint32 value = GetUInt16();
+		value |= (uint32)GetUInt16() << 16;
+		return value;
+	}
+
+	uint32 GetVarInt()
+	{
+		uint32 value = 0;
+		for( uint32 shift = 0; shift < 35; shift += 7 )
+		{
+			uint8 byte = GetByte();
+			value |= (uint32)( byte & 0x7f ) << shift;
+			if( !( byte & 0x80 ) )
+			{
+				return value;
+			}
+		}
+		m_ok = false;
+		return 0;
+	}
+
+	char const* GetString()
+	{
+		uint32 index = GetVarInt();
+		if( index >= m_strings.size() )
+		{
+			m_ok = false;
+			return "";
+		}
+		return m_strings[index].c_str();
+	}
+
+	bool ReadStrings()
+	{
+		uint32 count = GetVarInt();
+		if( !m_ok || count > (uint32)( m_end - m_pos ) )
+		{
+			// Every string takes at least one byte
+			return false;
+		}
+		m_strings.resize( count );
+		for( uint32 i=0; i<count; ++i )
+		{
+			uint32 length = GetVarInt();
+			if( !m_ok || length > (uint32)( m_end - m_pos ) )
+			{
+				return false;
+			}
+			m_strings[i].assign( (char const*)m_pos, length );
+			m_pos += length;
+		}
+		return true;
+	}
+
+	uint8 const*	m_pos;
+	uint8 const*	m_end;
+	bool			m_ok;
+	vector<string>	m_strings;
+};
+
+//-----------------------------------------------------------------------------
+//	<ConfigCache::Hash>
+//	32 bit FNV-1a hash of the XML file
+//-----------------------------------------------------------------------------
+uint32 ConfigCache::Hash
+(
+	char const* _data,
+	size_t const _size
+)
+{
+	uint32 hash = 2166136261u;
+	for( size_t i=0; i<_size; ++i )
+	{
+		hash ^= (uint8)_data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigCache::Encode>
+//	Encode an XML document
+//-----------------------------------------------------------------------------
+void ConfigCache::Encode
+(
+	TiXmlDocument const& _doc,
+	uint32 const _sourceSize,
+	uint32 const _sourceHash,
+	string* _cache
+)
+{
+	Writer writer;
+	uint32 count = 0;
+	for( TiXmlNode const* child = _doc.FirstChild(); child != NULL; child = child->NextSibling() )
+	{
+		++count;
+	}
+	writer.PutVarInt( count );
+	for( TiXmlNode const* child = _doc.FirstChild(); child != NULL; child = child->NextSibling() )
+	{
+		EncodeNode( writer, child );
+	}
+
+	// The string table can only be written once the tree has been encoded
+	_cache->clear();
+	_cache->reserve( writer.m_tree.size() + writer.m_stringIndex.size() * 8 + 32 );
+	_cache->append( "OZWC", 4 );
+
+	Writer header;
+	header.PutByte( (uint8)( c_formatVersion & 0xff ) );
+	header.PutByte( (uint8)( c_formatVersion >> 8 ) );
+	header.PutByte( 0 );
+	header.PutByte( 0 );
+	for( int32 i=0; i<32; i+=8 )
+	{
+		header.PutByte( (uint8)( _sourceSize >> i ) );
+	}
+	for( int32 i=0; i<32; i+=8 )
+	{
+		header.PutByte( (uint8)( _sourceHash >> i ) );
+	}
+	header.PutVarInt( (uint32)writer.m_strings.size() );
+	_cache->append( header.m_tree );
+
+	for( vector<string const*>::iterator it = writer.m_strings.begin(); it != writer.m_strings.end(); ++it )
+	{
+		Writer length;
+		length.PutVarInt( (uint32)(*it)->size() );
+		_cache->append( length.m_tree );
+		_cache->append( **it );
+	}
+
+	_cache->append( writer.m_tree );
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigCache::EncodeNode>
+//	Encode a node and its children
+//-----------------------------------------------------------------------------
+void ConfigCache::EncodeNode
+(
+	Writer& _writer,
+	TiXmlNode const* _node
+)
+{
+	switch( _node->Type() )
+	{
+		case TiXmlNode::ELEMENT:
+		{
+			TiXmlElement const* element = _node->ToElement();
+			_writer.PutByte( NodeKind_Element );
+			_writer.PutString( element->Value() );
+
+			uint32 count = 0;
+			for( TiXmlAttribute const* attribute = element->FirstAttribute(); attribute != NULL; attribute = attribute->Next() )
+			{
+				++count;
+			}
+			_writer.PutVarInt( count );
+			for( TiXmlAttribute const* attribute = element->FirstAttribute(); attribute != NULL; attribute = attribute->Next() )
+			{
+				_writer.PutString( attribute->Name() );
+				_writer.PutString( attribute->Value() );
+			}
+
+			count = 0;
+			for( TiXmlNode const* child = element->FirstChild(); child != NULL; child = child->NextSibling() )
+			{
+				++count;
+			}
+			_writer.PutVarInt( count );
+			for( TiXmlNode const* child = element->FirstChild(); child != NULL; child = child->NextSibling() )
+			{
+				EncodeNode( _writer, child );
+			}
+			break;
+		}
+		case TiXmlNode::TEXT:
+		{
+			_writer.PutByte( _node->ToText()->CDATA() ? NodeKind_CData : NodeKind_Text );
+			_writer.PutString( _node->Value() );
+			break;
+		}
+		case TiXmlNode::COMMENT:
+		{
+			_writer.PutByte( NodeKind_Comment );
+			_writer.PutString( _node->Value() );
+			break;
+		}
+		case TiXmlNode::DECLARATION:
+		{
+			TiXmlDeclaration const* decl = _node->ToDeclaration();
+			_writer.PutByte( NodeKind_Declaration );
+			_writer.PutString( decl->Version() );
+			_writer.PutString( decl->Encoding() );
+			_writer.PutString( decl->Standalone() );
+			break;
+		}
+		default:
+		{
+			// Unknown nodes carry nothing OpenZWave reads, so they are stored
+			// as an empty comment, which is dropped again when decoding.
+			_writer.PutByte( NodeKind_Comment );
+			_writer.PutString( "" );
+			break;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigCache::Decode>
+//	Rebuild an XML document from a cache
+//-----------------------------------------------------------------------------
+bool ConfigCache::Decode
+(
+	char const* _data,
+	size_t const _size,
+	TiXmlDocument* _doc,
+	uint32* _sourceSize,
+	uint32* _sourceHash
+)
+{
+	if( _size < 16 || memcmp( _data, "OZWC", 4 ) )
+	{
+		return false;
+	}
+
+	Reader reader( (uint8 const*)_data + 4, _size - 4 );
+	if( reader.GetUInt16() != c_formatVersion )
+	{
+		return false;
+	}
+	reader.GetUInt16();
+	*_sourceSize = reader.GetUInt32();
+	*_sourceHash = reader.GetUInt32();
+
+	if( !reader.ReadStrings() )
+	{
+		return false;
+	}
+
+	_doc->Clear();
+	uint32 count = reader.GetVarInt();
+	for( uint32 i=0; i<count && reader.m_ok; ++i )
+	{
+		if( !DecodeNode( reader, _doc, 0 ) )
+		{
+			return false;
+		}
+	}
+	return reader.m_ok;
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigCache::DecodeNode>
+//	Rebuild a node and its children
+//-----------------------------------------------------------------------------
+bool ConfigCache::DecodeNode
+(
+	Reader& _reader,
+	TiXmlNode* _parent,
+	uint32 const _depth
+)
+{
+	if( _depth > c_maxDepth )
+	{
+		return false;
+	}
+
+	uint8 kind = _reader.GetByte();
+	switch( kind )
+	{
+		case NodeKind_Element:
+		{
+			TiXmlElement* element = new TiXmlElement( _reader.GetString() );
+			_parent->LinkEndChild( element );
+
+			uint32 count = _reader.GetVarInt();
+			for( uint32 i=0; i<count && _reader.m_ok; ++i )
+			{
+				char const* name = _reader.GetString();
+				element->SetAttribute( name, _reader.GetString() );
+			}
+
+			count = _reader.GetVarInt();
+			for( uint32 i=0; i<count && _reader.m_ok; ++i )
+			{
+				if( !DecodeNode( _reader, element, _depth+1 ) )
+				{
+					return false;
+				}
+			}
+			break;
+		}
+		case NodeKind_Text:
+		case NodeKind_CData:
+		{
+			TiXmlText* text = new TiXmlText( _reader.GetString() );
+			text->SetCDATA( kind == NodeKind_CData );
+			_parent->LinkEndChild( text );
+			break;
+		}
+		case NodeKind_Comment:
+		{
+			char const* value = _reader.GetString();
+			if( value[0] != 0 )
+			{
+				TiXmlComment* comment = new TiXmlComment();
+				comment->SetValue( value );
+				_parent->LinkEndChild( comment );
+			}
+			break;
+		}
+		case NodeKind_Declaration:
+		{
+			char const* version = _reader.GetString();
+			char const* encoding = _reader.GetString();
+			char const* standalone = _reader.GetString();
+			_parent->LinkEndChild( new TiXmlDeclaration( version, encoding, standalone ) );
+			break;
+		}
+		default:
+		{
+			return false;
+		}
+	}
+	return _reader.m_ok;
+}
+
+//-----------------------------------------------------------------------------
+//	<ConfigCache::ReadFile>
+//	Read a whole file into memory
+//-----------------------------------------------------------------------------
+bool ConfigCache::ReadFile
+(
+	string const& _filename,
+	string* _contents
+)
+{
+	FILE* fp = fopen( _filename.c_str(), "rb" );
+	if( fp == NULL )
+	{
+		return false;
+	}
+
+	bool ok = false;
+	if( fseek( fp, 0, SEEK_END ) == 0 )
+	{
+		long size = ftell( fp );
+		if( size >= 0 && fseek( fp, 0, SEEK_SET ) == 0 )
+		{
+			_contents->resize( (size_t)size );
+			ok = ( size == 0 ) || ( fread( &(*_contents)[0], 1, (size_t)size, fp ) == (size_t)size );
+		}
+	}
+	fclose( fp );
+	return ok;
+}
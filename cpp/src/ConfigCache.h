@@ -0,0 +1,128 @@
+//-----------------------------------------------------------------------------
+//
+//	ConfigCache.h
+//
+//	Compact binary copy of the zwcfg XML file, for a faster start
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _ConfigCache_H
+#define _ConfigCache_H
+
+#include <string>
+#include "Defs.h"
+
+class TiXmlDocument;
+class TiXmlNode;
+
+namespace OpenZWave
+{
+	/** \brief Compact binary copy of the zwcfg XML file.
+	 *
+	 * Parsing the XML text is most of the time taken to load the network
+	 * configuration of a large network.  The cache holds the same document tree
+	 * in binary form, with every element name, attribute and text stored once in
+	 * a string table, so the tree can be rebuilt without parsing any text.  Nodes,
+	 * command classes, values and groups are then read from the tree exactly as
+	 * they are from the XML file.
+	 *
+	 * The XML file is always the master copy.  The cache records the size and
+	 * hash of the XML it was made from, and is ignored when they do not match,
+	 * for instance after the XML file has been edited by hand.
+	 *
+	 * All values are little-endian.  Counts, lengths and string indices are
+	 * stored as variable length integers, seven bits to a byte, low bits first.
+	 *
+	 * \code
+	 * Header:
+	 *   char[4]    'O','Z','W','C'
+	 *   uint16     format version (c_formatVersion)
+	 *   uint16     reserved, zero
+	 *   uint32     size of the XML file
+	 *   uint32     hash of the XML file
+	 * String table:
+	 *   varint     number of strings
+	 *   varint, byte[]  length and bytes of each string
+	 * Document:
+	 *   varint     number of top level nodes, followed by the nodes
+	 * Node:
+	 *   uint8      NodeKind
+	 *   Element:     varint name, varint attribute count, (varint name, varint value)...,
+	 *                varint child count, followed by the child nodes
+	 *   Text, CData, Comment:  varint text
+	 *   Declaration: varint version, varint encoding, varint standalone
+	 * \endcode
+	 */
+	class ConfigCache
+	{
+	public:
+		/**
+		 * Hash used to tie a cache to the XML file it was made from.
+		 */
+		static uint32 Hash( char const* _data, size_t const _size );
+
+		/**
+		 * Encode an XML document.
+		 * \param _doc the document to encode.
+		 * \param _sourceSize size of the XML file the document was read from.
+		 * \param _sourceHash hash of the XML file the document was read from.
+		 * \param _cache receives the encoded cache.
+		 */
+		static void Encode( TiXmlDocument const& _doc, uint32 const _sourceSize, uint32 const _sourceHash, string* _cache );
+
+		/**
+		 * Rebuild an XML document from a cache.
+		 * \param _data the cache contents.
+		 * \param _size the cache size.
+		 * \param _doc receives the document.
+		 * \param _sourceSize receives the size of the XML file the cache was made from.
+		 * \param _sourceHash receives the hash of the XML file the cache was made from.
+		 * \return false if the cache is not in a format this version understands, or is damaged.
+		 */
+		static bool Decode( char const* _data, size_t const _size, TiXmlDocument* _doc, uint32* _sourceSize, uint32* _sourceHash );
+
+		/**
+		 * Read a whole file into memory.
+		 * \return false if the file could not be read.
+		 */
+		static bool ReadFile( string const& _filename, string* _contents );
+
+		static uint16 const c_formatVersion = 1;
+
+	private:
+		enum NodeKind
+		{
+			NodeKind_Element = 1,
+			NodeKind_Text,
+			NodeKind_CData,
+			NodeKind_Comment,
+			NodeKind_Declaration
+		};
+
+		class Reader;
+		class Writer;
+
+		static void EncodeNode( Writer& _writer, TiXmlNode const* _node );
+		static bool DecodeNode( Reader& _reader, TiXmlNode* _parent, uint32 const _depth );
+	};
+
+} // namespace OpenZWave
+
+#endif //_ConfigCache_H
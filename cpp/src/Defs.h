@@ -201,6 +201,8 @@ namespace OpenZWave
 #define MAX_MAX_TRIES		7	// Don't exceed this retry limit
 #define ACK_TIMEOUT	1000		// How long to wait for an ACK
 #define BYTE_TIMEOUT	150
+#define FRAME_LENGTH_TIMEOUT	50	// How long to wait for the length byte after a SOF
+#define FRAME_BODY_TIMEOUT	500	// How long to wait for the rest of a frame once its length is known
 #define RETRY_TIMEOUT	40000		// Retry send after 40 seconds
 
 #define SOF												0x01
@@ -0,0 +1,497 @@
+//-----------------------------------------------------------------------------
+//
+//	DeviceDatabase.cpp
+//
+//	Precompiled copy of the product list and device configuration files
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include "DeviceDatabase.h"
+#include "ConfigCache.h"
+#include "tinyxml.h"
+#include "platform/FileOps.h"
+
+using namespace OpenZWave;
+
+static uint32 const c_headerSize = 36;
+static uint32 const c_manufacturerSize = 8;
+static uint32 const c_productSize = 16;
+static uint32 const c_fileSize = 20;
+static uint32 const c_noString = 0xffffffff;
+
+static uint16 GetUInt16( uint8 const* _p ){ return (uint16)( _p[0] | ( _p[1] << 8 ) ); }
+static uint32 GetUInt32( uint8 const* _p ){ return (uint32)_p[0] | ( (uint32)_p[1] << 8 ) | ( (uint32)_p[2] << 16 ) | ( (uint32)_p[3] << 24 ); }
+
+static void PutUInt16( string* _s, uint16 const _value )
+{
+	*_s += (char)( _value & 0xff );
+	*_s += (char)( _value >> 8 );
+}
+
+static void PutUInt32( string* _s, uint32 const _value )
+{
+	PutUInt16( _s, (uint16)( _value & 0xffff ) );
+	PutUInt16( _s, (uint16)( _value >> 16 ) );
+}
+
+static uint64 GetProductKey( uint16 const _manufacturerId, uint16 const _productType, uint16 const _productId )
+{
+	return ( (uint64)_manufacturerId << 32 ) | ( (uint64)_productType << 16 ) | (uint64)_productId;
+}
+
+static uint32 AddString( string* _strings, map<string,uint32>* _offsets, string const& _str )
+{
+	map<string,uint32>::iterator it = _offsets->find( _str );
+	if( it != _offsets->end() )
+	{
+		return it->second;
+	}
+	uint32 offset = (uint32)_strings->size();
+	_strings->append( _str.c_str(), _str.size() + 1 );
+	(*_offsets)[_str] = offset;
+	return offset;
+}
+
+//-----------------------------------------------------------------------------
+//	<DeviceDatabase::Open>
+//	Map a device database into memory
+//-----------------------------------------------------------------------------
+DeviceDatabase* DeviceDatabase::Open
+(
+	string const& _filename
+)
+{
+	size_t size = 0;
+	uint8 const* data = (uint8 const*)FileOps::FileMap( _filename, &size );
+	if( data == NULL )
+	{
+		return NULL;
+	}
+
+	if( size < c_headerSize || memcmp( data, "OZWD", 4 ) || GetUInt16( data+4 ) != c_formatVersion )
+	{
+		FileOps::FileUnmap( data, size );
+		return NULL;
+	}
+
+	// Check that the tables and the string area lie within the file
+	uint64 manufacturerCount = GetUInt32( data+16 );
+	uint64 productCount = GetUInt32( data+20 );
+	uint64 fileCount = GetUInt32( data+24 );
+	uint64 stringsOffset = GetUInt32( data+28 );
+	uint64 stringsSize = GetUInt32( data+32 );
+	uint64 tablesEnd = c_headerSize + manufacturerCount * c_manufacturerSize + productCount * c_productSize + fileCount * c_fileSize;
+	if( tablesEnd > stringsOffset || stringsOffset + stringsSize > size || stringsSize == 0 || data[stringsOffset + stringsSize - 1] != 0 )
+	{
+		FileOps::FileUnmap( data, size );
+		return NULL;
+	}
+
+	return new DeviceDatabase( data, size );
+}
+
+//-----------------------------------------------------------------------------
+//	<DeviceDatabase::DeviceDatabase>
+//	Constructor
+//-----------------------------------------------------------------------------
+DeviceDatabase::DeviceDatabase
+(
+	uint8 const* _data,
+	size_t const _size
+):
+	m_data( _data ),
+	m_size( _size ),
+	m_manufacturerCount( GetUInt32( _data+16 ) ),
+	m_productCount( GetUInt32( _data+20 ) ),
+	m_fileCount( GetUInt32( _data+24 ) ),
+	m_strings( (char const*)_data + GetUInt32( _data+28 ) ),
+	m_stringsSize( GetUInt32( _data+32 ) )
+{
+	m_manufacturers = _data + c_headerSize;
+	m_products = m_manufacturers + m_manufacturerCount * c_manufacturerSize;
+	m_files = m_products + m_productCount * c_productSize;
+}
+
+//-----------------------------------------------------------------------------
+//	<DeviceDatabase::~DeviceDatabase>
+//	Destructor
+//-----------------------------------------------------------------------------
+DeviceDatabase::~DeviceDatabase
+(
+)
+{
+	FileOps::FileUnmap( m_data, m_size );
+}
+
+//-----------------------------------------------------------------------------
+//	<DeviceDatabase::GetString>
+//	Get a string from the string area.  The area ends in a nul, so every
+//	string in it is terminated.
+//-----------------------------------------------------------------------------
+char const* DeviceDatabase::GetString
+(
+	uint32 const _offset
+)const
+{
+	if( _offset >= m_stringsSize )
+	{
+		return NULL;
+	}
+	return m_strings + _offset;
+}
+
+//-----------------------------------------------------------------------------
+//	<DeviceDatabase::SourceMatches>
+//	Check that an XML file is the one a part of the database was made from
+//-----------------------------------------------------------------------------
+bool DeviceDatabase::SourceMatches
+(
+	string const& _sourceFilename,
+	uint32 const _size,
+	uint32 const _hash
+)
+{
+	string source;
+	if( !ConfigCache::ReadFile( _sourceFilename, &source ) )
+	{
+		// Only the database has been installed
+		return true;
+	}
+	return ( source.size() == _size ) && ( ConfigCache::Hash( source.data(), source.size() ) == _hash );
+}
+
+//-----------------------------------------------------------------------------
+//	<DeviceDatabase::IsProductTableCurrent>
+//	Check whether the product tables were made from the current
+//	manufacturer_specific.xml
+//-----------------------------------------------------------------------------
+bool DeviceDatabase::IsProductTableCurrent
+(
+	string const& _sourceFilename
+)const
+{
+	return SourceMatches( _sourceFilename, GetUInt32( m_data+8 ), GetUInt32( m_data+12 ) );
+}
+
+//-----------------------------------------------------------------------------
+//	<DeviceDatabase::GetManufacturerName>
+//	Binary search of the manufacturer table
+//-----------------------------------------------------------------------------
+bool DeviceDatabase::GetManufacturerName
+(
+	uint16 const _manufacturerId,
+	string* _name
+)const
+{
+	uint32 lo = 0;
+	uint32 hi = m_manufacturerCount;
+	while( lo < hi )
+	{
+		uint32 mid = lo + ( hi - lo ) / 2;
+		uint8 const* entry = m_manufacturers + mid * c_manufacturerSize;
+		uint16 id = GetUInt16( entry );
+		if( id < _manufacturerId )
+		{
+			lo = mid + 1;
+		}
+		else if( id > _manufacturerId )
+		{
+			hi = mid;
+		}
+		else
+		{
+			char const* name = GetString( GetUInt32( entry+4 ) );
+			if( name == NULL )
+			{
+				return false;
+			}
+			*_name = name;
+			return true;
+		}
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+//	<DeviceDatabase::GetProduct>
+//	Binary search of the product table
+//-----------------------------------------------------------------------------
+bool DeviceDatabase::GetProduct
+(
+	uint16 const _manufacturerId,
+	uint16 const _productType,
+	uint16 const _productId,
+	string* _name,
+	string* _configPath
+)const
+{
+	uint64 key = GetProductKey( _manufacturerId, _productType, _productId );
+	uint32 lo = 0;
+	uint32 hi = m_productCount;
+	while( lo < hi )
+	{
+		uint32 mid = lo + ( hi - lo ) / 2;
+		uint8 const* entry = m_products + mid * c_productSize;
+		uint64 entryKey = GetProductKey( GetUInt16( entry ), GetUInt16( entry+2 ), GetUInt16( entry+4 ) );
+		if( entryKey < key )
+		{
+			lo = mid + 1;
+		}
+		else if( entryKey > key )
+		{
+			hi = mid;
+		}
+		else
+		{
+			char const* name = GetString( GetUInt32( entry+8 ) );
+			if( name == NULL )
+			{
+				return false;
+			}
+			*_name = name;
+
+			uint32 configOffset = GetUInt32( entry+12 );
+			char const* configPath = ( configOffset == c_noString ) ? "" : GetString( configOffset );
+			*_configPath = configPath ? configPath : "";
+			return true;
+		}
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+//	<DeviceDatabase::GetDocument>
+//	Rebuild a device configuration document, if the database has a current
+//	copy of it
+//-----------------------------------------------------------------------------
+bool DeviceDatabase::GetDocument
+(
+	string const& _configXML,
+	string const& _sourceFilename,
+	TiXmlDocument* _doc
+)const
+{
+	uint32 lo = 0;
+	uint32 hi = m_fileCount;
+	while( lo < hi )
+	{
+		uint32 mid = lo + ( hi - lo ) / 2;
+		uint8 const* entry = m_files + mid * c_fileSize;
+		char const* path = GetString( GetUInt32( entry ) );
+		if( path == NULL )
+		{
+			return false;
+		}
+
+		int cmp = strcmp( path, _configXML.c_str() );
+		if( cmp < 0 )
+		{
+			lo = mid + 1;
+		}
+		else if( cmp > 0 )
+		{
+			hi = mid;
+		}
+		else
+		{
+			uint64 offset = GetUInt32( entry+4 );
+			uint64 size = GetUInt32( entry+8 );
+			if( offset + size > m_size )
+			{
+				return false;
+			}
+			if( !SourceMatches( _sourceFilename, GetUInt32( entry+12 ), GetUInt32( entry+16 ) ) )
+			{
+				return false;
+			}
+
+			uint32 sourceSize;
+			uint32 sourceHash;
+			if( !ConfigCache::Decode( (char const*)m_data + offset, (size_t)size, _doc, &sourceSize, &sourceHash ) )
+			{
+				_doc->Clear();
+				return false;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+//	<DeviceDatabase::Build>
+//	Compile a config folder into a device database
+//-----------------------------------------------------------------------------
+bool DeviceDatabase::Build
+(
+	string const& _configPath,
+	string* _database,
+	vector<string>* _warnings
+)
+{
+	char msg[512];
+	string filename = _configPath + "manufacturer_specific.xml";
+
+	string source;
+	TiXmlDocument doc;
+	if( !ConfigCache::ReadFile( filename, &source ) || !doc.LoadFile( filename.c_str(), TIXML_ENCODING_UTF8 ) )
+	{
+		snprintf( msg, sizeof(msg), "Unable to load %s", filename.c_str() );
+		_warnings->push_back( msg );
+		return false;
+	}
+
+	// Strings are stored once, at an offset into the string area
+	string strings;
+	map<string,uint32> stringOffsets;
+
+	// Read the tables in the same way as ManufacturerSpecific::LoadProductXML
+	map<uint16,uint32> manufacturers;
+	map<uint64,pair<uint32,uint32> > products;
+	map<string,bool> configFiles;
+	for( TiXmlElement const* manufacturerElement = doc.RootElement()->FirstChildElement(); manufacturerElement; manufacturerElement = manufacturerElement->NextSiblingElement() )
+	{
+		if( strcmp( manufacturerElement->Value(), "Manufacturer" ) )
+		{
+			continue;
+		}
+
+		char const* idStr = manufacturerElement->Attribute( "id" );
+		char const* nameStr = manufacturerElement->Attribute( "name" );
+		if( !idStr || !nameStr )
+		{
+			snprintf( msg, sizeof(msg), "manufacturer_specific.xml line %d: manufacturer without an id or name", manufacturerElement->Row() );
+			_warnings->push_back( msg );
+			continue;
+		}
+		uint16 manufacturerId = (uint16)strtol( idStr, NULL, 16 );
+		manufacturers[manufacturerId] = AddString( &strings, &stringOffsets, nameStr );
+
+		for( TiXmlElement const* productElement = manufacturerElement->FirstChildElement(); productElement; productElement = productElement->NextSiblingElement() )
+		{
+			if( strcmp( productElement->Value(), "Product" ) )
+			{
+				continue;
+			}
+
+			char const* typeStr = productElement->Attribute( "type" );
+			char const* productIdStr = productElement->Attribute( "id" );
+			char const* productNameStr = productElement->Attribute( "name" );
+			if( !typeStr || !productIdStr || !productNameStr )
+			{
+				snprintf( msg, sizeof(msg), "manufacturer_specific.xml line %d: product without a type, id or name", productElement->Row() );
+				_warnings->push_back( msg );
+				continue;
+			}
+
+			uint64 key = GetProductKey( manufacturerId, (uint16)strtol( typeStr, NULL, 16 ), (uint16)strtol( productIdStr, NULL, 16 ) );
+			if( products.find( key ) != products.end() )
+			{
+				// The library keeps the first of two products with the same ids
+				snprintf( msg, sizeof(msg), "manufacturer_specific.xml line %d: product name collision for %s", productElement->Row(), productNameStr );
+				_warnings->push_back( msg );
+				continue;
+			}
+
+			uint32 configOffset = c_noString;
+			if( char const* configStr = productElement->Attribute( "config" ) )
+			{
+				configOffset = AddString( &strings, &stringOffsets, configStr );
+				configFiles[configStr] = true;
+			}
+			products[key] = pair<uint32,uint32>( AddString( &strings, &stringOffsets, productNameStr ), configOffset );
+		}
+	}
+
+	// Encode each device configuration file once
+	vector<pair<uint32,string> > files;
+	for( map<string,bool>::iterator it = configFiles.begin(); it != configFiles.end(); ++it )
+	{
+		string configFilename = _configPath + it->first;
+		string configSource;
+		TiXmlDocument configDoc;
+		if( !ConfigCache::ReadFile( configFilename, &configSource ) || !configDoc.LoadFile( configFilename.c_str(), TIXML_ENCODING_UTF8 ) )
+		{
+			snprintf( msg, sizeof(msg), "Unable to load %s", configFilename.c_str() );
+			_warnings->push_back( msg );
+			continue;
+		}
+
+		string encoded;
+		ConfigCache::Encode( configDoc, (uint32)configSource.size(), ConfigCache::Hash( configSource.data(), configSource.size() ), &encoded );
+		files.push_back( pair<uint32,string>( AddString( &strings, &stringOffsets, it->first ), encoded ) );
+	}
+
+	// Lay out the file.  The map keeps the file table in path order.
+	uint32 stringsOffset = c_headerSize + (uint32)( manufacturers.size() * c_manufacturerSize + products.size() * c_productSize + files.size() * c_fileSize );
+	uint32 dataOffset = stringsOffset + (uint32)strings.size();
+
+	_database->clear();
+	_database->append( "OZWD", 4 );
+	PutUInt16( _database, c_formatVersion );
+	PutUInt16( _database, 0 );
+	PutUInt32( _database, (uint32)source.size() );
+	PutUInt32( _database, ConfigCache::Hash( source.data(), source.size() ) );
+	PutUInt32( _database, (uint32)manufacturers.size() );
+	PutUInt32( _database, (uint32)products.size() );
+	PutUInt32( _database, (uint32)files.size() );
+	PutUInt32( _database, stringsOffset );
+	PutUInt32( _database, (uint32)strings.size() );
+
+	for( map<uint16,uint32>::iterator it = manufacturers.begin(); it != manufacturers.end(); ++it )
+	{
+		PutUInt16( _database, it->first );
+		PutUInt16( _database, 0 );
+		PutUInt32( _database, it->second );
+	}
+
+	for( map<uint64,pair<uint32,uint32> >::iterator it = products.begin(); it != products.end(); ++it )
+	{
+		PutUInt16( _database, (uint16)( it->first >> 32 ) );
+		PutUInt16( _database, (uint16)( it->first >> 16 ) );
+		PutUInt16( _database, (uint16)it->first );
+		PutUInt16( _database, 0 );
+		PutUInt32( _database, it->second.first );
+		PutUInt32( _database, it->second.second );
+	}
+
+	uint32 offset = dataOffset;
+	for( vector<pair<uint32,string> >::iterator it = files.begin(); it != files.end(); ++it )
+	{
+		PutUInt32( _database, it->first );
+		PutUInt32( _database, offset );
+		PutUInt32( _database, (uint32)it->second.size() );
+
+		// Copy the source size and hash from the encoded document's header
+		_database->append( it->second, 8, 8 );
+		offset += (uint32)it->second.size();
+	}
+
+	_database->append( strings );
+	for( vector<pair<uint32,string> >::iterator it = files.begin(); it != files.end(); ++it )
+	{
+		_database->append( it->second );
+	}
+	return true;
+}
@@ -0,0 +1,142 @@
+//-----------------------------------------------------------------------------
+//
+//	DeviceDatabase.h
+//
+//	Precompiled copy of the product list and device configuration files
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _DeviceDatabase_H
+#define _DeviceDatabase_H
+
+#include <string>
+#include <vector>
+#include "Defs.h"
+
+class TiXmlDocument;
+
+namespace OpenZWave
+{
+	/** \brief Precompiled copy of manufacturer_specific.xml and the device configuration files.
+	 *
+	 * ozw-devicedb compiles the config folder into a single file, devices.bin.  It holds
+	 * the manufacturer and product tables from manufacturer_specific.xml, sorted so they can
+	 * be searched in place, and every device configuration file named in it, encoded by
+	 * ConfigCache.  The library maps the file into memory, so the pages are shared by every
+	 * process using the same config folder, and nothing is parsed to look up a product or
+	 * load a device's configuration.
+	 *
+	 * Each part records the size and hash of the XML file it was made from.  A part whose XML
+	 * file has since changed is ignored, and the XML file is read instead.  A part whose XML
+	 * file is missing is still used, so the database can be installed without the XML files.
+	 *
+	 * All values are little-endian.  Offsets are from the start of the file.
+	 *
+	 * \code
+	 * Header:
+	 *   char[4]    'O','Z','W','D'
+	 *   uint16     format version (c_formatVersion)
+	 *   uint16     reserved, zero
+	 *   uint32     size of manufacturer_specific.xml
+	 *   uint32     hash of manufacturer_specific.xml
+	 *   uint32     number of manufacturers
+	 *   uint32     number of products
+	 *   uint32     number of files
+	 *   uint32     offset of the string area
+	 *   uint32     size of the string area
+	 * Manufacturers, sorted by id:
+	 *   uint16     id
+	 *   uint16     reserved
+	 *   uint32     name, as an offset into the string area
+	 * Products, sorted by manufacturer id, type and id:
+	 *   uint16     manufacturer id, type, id
+	 *   uint16     reserved
+	 *   uint32     name, as an offset into the string area
+	 *   uint32     config path, as an offset into the string area, or 0xffffffff
+	 * Files, sorted by path:
+	 *   uint32     path, as an offset into the string area
+	 *   uint32     offset of the encoded document
+	 *   uint32     size of the encoded document
+	 *   uint32     size of the XML file
+	 *   uint32     hash of the XML file
+	 * String area:
+	 *   nul terminated strings
+	 * Encoded documents
+	 * \endcode
+	 */
+	class DeviceDatabase
+	{
+	public:
+		/**
+		 * Map a device database into memory.
+		 * \return the database, or NULL if the file is missing or is not a device database this version understands.
+		 */
+		static DeviceDatabase* Open( string const& _filename );
+		~DeviceDatabase();
+
+		/**
+		 * Check whether the product tables were made from the current manufacturer_specific.xml.
+		 */
+		bool IsProductTableCurrent( string const& _sourceFilename )const;
+
+		bool GetManufacturerName( uint16 const _manufacturerId, string* _name )const;
+		bool GetProduct( uint16 const _manufacturerId, uint16 const _productType, uint16 const _productId, string* _name, string* _configPath )const;
+
+		/**
+		 * Rebuild a device configuration document.
+		 * \param _configXML path of the file relative to the config folder, as it appears in manufacturer_specific.xml.
+		 * \param _sourceFilename full path of the XML file, to check that the copy is current.
+		 * \param _doc receives the document.
+		 * \return false if the database has no current copy of the file.
+		 */
+		bool GetDocument( string const& _configXML, string const& _sourceFilename, TiXmlDocument* _doc )const;
+
+		/**
+		 * Compile a config folder into a device database.
+		 * \param _configPath the config folder, ending in a path separator.
+		 * \param _database receives the database.
+		 * \param _warnings receives a line for each problem found.
+		 * \return false if manufacturer_specific.xml could not be read.
+		 */
+		static bool Build( string const& _configPath, string* _database, vector<string>* _warnings );
+
+		static uint16 const c_formatVersion = 1;
+
+	private:
+		DeviceDatabase( uint8 const* _data, size_t const _size );
+
+		char const* GetString( uint32 const _offset )const;
+		static bool SourceMatches( string const& _sourceFilename, uint32 const _size, uint32 const _hash );
+
+		uint8 const*	m_data;
+		size_t			m_size;
+		uint32			m_manufacturerCount;
+		uint32			m_productCount;
+		uint32			m_fileCount;
+		uint8 const*	m_manufacturers;
+		uint8 const*	m_products;
+		uint8 const*	m_files;
+		char const*		m_strings;
+		uint32			m_stringsSize;
+	};
+
+} // namespace OpenZWave
+
+#endif //_DeviceDatabase_H
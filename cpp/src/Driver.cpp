@@ -32,13 +32,17 @@
 #include "Msg.h"
 #include "Notification.h"
 #include "Scene.h"
+#include "ConfigCache.h"
+#include "DriverReactor.h"
 
 #include "platform/Event.h"
+#include "platform/FileOps.h"
 #include "platform/Mutex.h"
 #include "platform/SerialController.h"
 #include "platform/HidController.h"
 #include "platform/Thread.h"
 #include "platform/Log.h"
+#include "platform/Trace.h"
 #include "platform/TimeStamp.h"
 
 #include "command_classes/CommandClasses.h"
@@ -136,11 +140,26 @@ Driver::Driver
 		ControllerInterface const& _interface
 ):
 m_driverThread( new Thread( "driver" ) ),
+m_reactor( NULL ),
+m_retryTimeout( RETRY_TIMEOUT ),
+m_waitFrameTimeout( false ),
+m_waitDebounceTimeout( false ),
 m_exit( false ),
 m_init( false ),
 m_awakeNodesQueried( false ),
 m_allNodesQueried( false ),
 m_notifytransactions( false ),
+m_fastRestart( false ),
+m_configChanged( false ),
+m_configGeneration( 0 ),
+m_savedGeneration( 0 ),
+m_configMutex( new Mutex() ),
+m_saveMutex( new Mutex() ),
+m_saveThread( NULL ),
+m_saveEvent( NULL ),
+m_saveInterval( 0 ),
+m_configCache( false ),
+m_configCacheStale( false ),
 m_controllerInterfaceType( _interface ),
 m_controllerPath( _controllerPath ),
 m_controller( NULL ),
@@ -162,15 +181,34 @@ m_expectedCallbackId( 0 ),
 m_expectedReply( 0 ),
 m_expectedCommandClassId( 0 ),
 m_expectedNodeId( 0 ),
+m_frameExpected( 0 ),
 m_pollThread( new Thread( "poll" ) ),
 m_pollMutex( new Mutex() ),
+m_pollEvent( new Event() ),
 m_pollInterval( 0 ),
 m_bIntervalBetweenPolls( false ),				// if set to true (via SetPollInterval), the pollInterval will be interspersed between each poll (so a much smaller m_pollInterval like 100, 500, or 1,000 may be appropriate)
+m_pollPolicy( PollPolicy_Fixed ),
+m_pollLoadTarget( 50 ),
+m_pollQueueLimit( 10 ),
+m_pollLoad( 0 ),
+m_pollScale( 100 ),
+m_pollCnt( 0 ),
+m_pollSkipped( 0 ),
+m_pollRate( 0 ),
+m_pollRateCnt( 0 ),
+m_pollDraining( false ),
+m_pollDrainWarned( false ),
 m_currentControllerCommand( NULL ),
 m_SUCNodeId( 0 ),
 m_controllerResetEvent( NULL ),
+m_freeQueueItems( NULL ),
 m_sendMutex( new Mutex() ),
 m_currentMsg( NULL ),
+m_interviewLimit( 0 ),
+m_interviewCount( 0 ),
+m_lastQueryNodeId( 0 ),
+m_awakeNodesQueriedTime( 0 ),
+m_allNodesQueriedTime( 0 ),
 m_virtualNeighborsReceived( false ),
 m_notificationsEvent( new Event() ),
 m_SOFCnt( 0 ),
@@ -193,7 +231,13 @@ m_notidle( 0 ),
 m_nondelivery( 0 ),
 m_routedbusy( 0 ),
 m_broadcastReadCnt( 0 ),
-m_broadcastWriteCnt( 0 )
+m_broadcastWriteCnt( 0 ),
+m_coalesced( 0 ),
+m_debounced( 0 ),
+m_writeTime( 0 ),
+m_blockedSince( 0 ),
+m_queueLogInterval( 0 ),
+m_waitQueueLogTimeout( false )
 {
 	// set a timestamp to indicate when this driver started
 	TimeStamp m_startTime;
@@ -210,6 +254,15 @@ m_broadcastWriteCnt( 0 )
 	// Clear the virtual neighbors array
 	memset( m_virtualNeighbors, 0, NUM_NODE_BITFIELD_BYTES );
 
+	// Nothing has been written to the configuration file yet
+	for( int i=0; i<256; ++i )
+	{
+		m_nodeConfig[i].m_node = NULL;
+		m_nodeConfig[i].m_queryStage = 0;
+	}
+	memset( m_nodeConfigDirty, 0, sizeof(m_nodeConfigDirty) );
+	memset( m_interviewing, 0, sizeof(m_interviewing) );
+
 	if( ControllerInterface_Hid == _interface )
 	{
 		m_controller = new HidController();
@@ -221,8 +274,49 @@ m_broadcastWriteCnt( 0 )
 	m_controller->SetSignalThreshold( 1 );
 
 	Options::Get()->GetOptionAsBool( "NotifyTransactions", &m_notifytransactions );
+	Options::Get()->GetOptionAsInt( "RetryTimeout", &m_retryTimeout );
+	Options::Get()->GetOptionAsInt( "QueueStatisticsInterval", &m_queueLogInterval );
+	if( m_queueLogInterval > 0 )
+	{
+		m_queueLogTimeStamp.SetTime( m_queueLogInterval * 1000 );
+	}
+	m_currentMsgQueueSource = MsgQueue_Command;
 	Options::Get()->GetOptionAsInt( "PollInterval", &m_pollInterval );
 	Options::Get()->GetOptionAsBool( "IntervalBetweenPolls", &m_bIntervalBetweenPolls );
+
+	string pollPolicy;
+	if( Options::Get()->GetOptionAsString( "PollPolicy", &pollPolicy ) && ToLower( pollPolicy ) == "adaptive" )
+	{
+		m_pollPolicy = PollPolicy_Adaptive;
+	}
+	Options::Get()->GetOptionAsInt( "PollLoadTarget", &m_pollLoadTarget );
+	if( m_pollLoadTarget < 1 || m_pollLoadTarget > 100 )
+	{
+		Log::Write( LogLevel_Warning, "PollLoadTarget of %d is out of range, using 50", m_pollLoadTarget );
+		m_pollLoadTarget = 50;
+	}
+	Options::Get()->GetOptionAsInt( "PollQueueLimit", &m_pollQueueLimit );
+
+	int32 interviewLimit = 0;
+	Options::Get()->GetOptionAsInt( "InterviewConcurrency", &interviewLimit );
+	if( interviewLimit > 0 )
+	{
+		m_interviewLimit = (uint32)interviewLimit;
+	}
+
+	ReadDebounceOptions();
+	ReadFastRestartOptions();
+
+	// Background saving of the configuration only makes sense if it is saved at all
+	bool save = false;
+	Options::Get()->GetOptionAsBool( "SaveConfiguration", &save );
+	Options::Get()->GetOptionAsInt( "SaveConfigInterval", &m_saveInterval );
+	if( save && m_saveInterval > 0 )
+	{
+		m_saveThread = new Thread( "save" );
+		m_saveEvent = new Event();
+	}
+	Options::Get()->GetOptionAsBool( "ConfigCache", &m_configCache );
 }
 
 //-----------------------------------------------------------------------------
@@ -244,13 +338,21 @@ Driver::~Driver
 	// append final driver stats output to the log file
 	LogDriverStatistics();
 
+	// Stop any background save, so the final save below is the last one written
+	if( m_saveThread != NULL )
+	{
+		m_saveThread->Stop();
+		m_saveThread->Release();
+		m_saveEvent->Release();
+	}
+
 	// Save the driver config before deleting anything else
 	bool save;
 	if( Options::Get()->GetOptionAsBool( "SaveConfiguration", &save) )
 	{
 		if( save )
 		{
-			WriteConfig();
+			WriteConfig( true );
 			Scene::WriteXML( "zwscene.xml" );
 		}
 	}
@@ -260,8 +362,15 @@ Driver::~Driver
 	//certain memory won't be referenced out of order. --Greg Satz, April 2010
 	m_exit = true;
 
+	if( m_reactor != NULL )
+	{
+		// Stops the shared threads running this driver's poll schedule and loop
+		m_reactor->RemoveDriver( this );
+	}
+
 	m_pollThread->Stop();
 	m_pollThread->Release();
+	m_pollEvent->Release();
 
 	m_driverThread->Stop();
 	m_driverThread->Release();
@@ -297,22 +406,29 @@ Driver::~Driver
 	// Clear the send Queue
 	for( int32 i=0; i<MsgQueue_Count; ++i )
 	{
-		while( !m_msgQueue[i].empty() )
+		while( !m_msgQueue[i].Empty() )
 		{
-			MsgQueueItem const& item = m_msgQueue[i].front();
-			if( MsgQueueCmd_SendMsg == item.m_command )
+			MsgQueueItem* item = m_msgQueue[i].Front();
+			if( MsgQueueCmd_SendMsg == item->m_command )
 			{
-				delete item.m_msg;
+				delete item->m_msg;
 			}
-			else if( MsgQueueCmd_Controller == item.m_command )
+			else if( MsgQueueCmd_Controller == item->m_command )
 			{
-				delete item.m_cci;
+				delete item->m_cci;
 			}
-			m_msgQueue[i].pop_front();
+			RemoveQueueItem( (MsgQueue)i, item );
 		}
 
 		m_queueEvent[i]->Release();
 	}
+
+	for( vector<MsgQueueItem*>::iterator it = m_queueItemChunks.begin(); it != m_queueItemChunks.end(); ++it )
+	{
+		delete [] *it;
+	}
+	m_queueItemChunks.clear();
+	m_freeQueueItems = NULL;
 	/* Doing our Notification Call back here in the destructor is just asking for trouble
 	 * as there is a good chance that the application will do some sort of GetDriver() supported
 	 * method on the Manager Class, which by this time, most of the OZW Classes associated with the
@@ -333,7 +449,16 @@ Driver::~Driver
 	if (m_controllerReplication)
 		delete m_controllerReplication;
 
+	// Drop any value updates still held back by the debounce window
+	for( map<ValueID,DebouncedValue>::iterator it = m_debouncedValues.begin(); it != m_debouncedValues.end(); ++it )
+	{
+		delete it->second.m_pending;
+	}
+	m_debouncedValues.clear();
+
 	m_notificationsEvent->Release();
+	m_configMutex->Release();
+	m_saveMutex->Release();
 	m_nodeMutex->Release();
 
 }
@@ -344,8 +469,17 @@ Driver::~Driver
 //-----------------------------------------------------------------------------
 void Driver::Start
 (
+		DriverReactor* _reactor
 )
 {
+	if( _reactor != NULL )
+	{
+		// Communications are handled by the thread shared with the other drivers
+		m_reactor = _reactor;
+		m_reactor->AddDriver( this );
+		return;
+	}
+
 	// Start the thread that will handle communications with the Z-Wave network
 	m_driverThread->Start( Driver::DriverThreadEntryPoint, this );
 }
@@ -381,129 +515,249 @@ void Driver::DriverThreadProc
 	{
 		if( Init( attempts ) )
 		{
-			// Driver has been initialised
-			Wait* waitObjects[11];
-			waitObjects[0] = _exitEvent;				// Thread must exit.
-			waitObjects[1] = m_notificationsEvent;			// Notifications waiting to be sent.
-			waitObjects[2] = m_controller;				// Controller has received data.
-			waitObjects[3] = m_queueEvent[MsgQueue_Command];	// A controller command is in progress.
-			waitObjects[4] = m_queueEvent[MsgQueue_Security];	// Security Related Commands (As they have a timeout)
-			waitObjects[5] = m_queueEvent[MsgQueue_NoOp];		// Send device probes and diagnostics messages
-			waitObjects[6] = m_queueEvent[MsgQueue_Controller];	// A multi-part controller command is in progress
-			waitObjects[7] = m_queueEvent[MsgQueue_WakeUp];		// A node has woken. Pending messages should be sent.
-			waitObjects[8] = m_queueEvent[MsgQueue_Send];		// Ordinary requests to be sent.
-			waitObjects[9] = m_queueEvent[MsgQueue_Query];		// Node queries are pending.
-			waitObjects[10] = m_queueEvent[MsgQueue_Poll];		// Poll request is waiting.
-
-			TimeStamp retryTimeStamp;
-			int retryTimeout = RETRY_TIMEOUT;
-			Options::Get()->GetOptionAsInt( "RetryTimeout", &retryTimeout );
+			// Driver has been initialised.  The wait set registers its watchers once,
+			// so the loop below does not allocate or re-register on every iteration.
+			WaitSet waitSet;
+			AddWaitObjects( &waitSet, _exitEvent );
 
 			while( true )
 			{
 				Log::Write( LogLevel_StreamDetail, "      Top of DriverThreadProc loop." );
-				uint32 count = 11;
-				int32 timeout = Wait::Timeout_Infinite;
-
-				// If we're waiting for a message to complete, we can only
-				// handle incoming data, notifications and exit events.
-				if( m_waitingForAck || m_expectedCallbackId || m_expectedReply )
-				{
-					count = 3;
-					timeout = m_waitingForAck ? ACK_TIMEOUT : retryTimeStamp.TimeRemaining();
-					if( timeout < 0 )
-					{
-						timeout = 0;
-					}
-				}
-				else if( m_currentControllerCommand != NULL )
-				{
-					count = 7;
-				}
-				else
-				{
-					Log::QueueClear();							// clear the log queue when starting a new message
-				}
+				uint32 count;
+				int32 timeout = PrepareWait( &count );
 
 				// Wait for something to do
-				int32 res = Wait::Multiple( waitObjects, count, timeout );
-
-				switch( res )
+				int32 res = waitSet.Multiple( count, timeout );
+				if( res == 0 )
 				{
-					case -1:
-					{
-						// Wait has timed out - time to resend
-						if( m_currentMsg != NULL )
-						{
-							Notification* notification = new Notification( Notification::Type_Notification );
-							notification->SetHomeAndNodeIds( m_homeId, m_currentMsg->GetTargetNodeId() );
-							notification->SetNotification( Notification::Code_Timeout );
-							QueueNotification( notification );
-						}
-						if( WriteMsg( "Wait Timeout" ) )
-						{
-							retryTimeStamp.SetTime( retryTimeout );
-						}
-						break;
-					}
-					case 0:
-					{
-						// Exit has been signalled
-						return;
-					}
-					case 1:
-					{
-						// Notifications are waiting to be sent
-						NotifyWatchers();
-						break;
-					}
-					case 2:
-					{
-						// Data has been received
-						ReadMsg();
-						break;
-					}
-					default:
-					{
-						// All the other events are sending message queue items
-						if( WriteNextMsg( (MsgQueue)(res-3) ) )
-						{
-							retryTimeStamp.SetTime( retryTimeout );
-						}
-						break;
-					}
+					// Exit has been signalled
+					return;
 				}
+				HandleWait( res );
 			}
 		}
 
 		++attempts;
 
-		uint32 maxAttempts = 0;
-		Options::Get()->GetOptionAsInt("DriverMaxAttempts", (int32 *)&maxAttempts);
-		if( maxAttempts && (attempts >= maxAttempts) )
+		int32 retryDelay = InitFailed( attempts );
+		if( retryDelay < 0 )
 		{
-			Manager::Get()->Manager::SetDriverReady(this, false);
-			NotifyWatchers();
 			break;
 		}
 
-		if( attempts < 25 )
+		if( Wait::Single( _exitEvent, retryDelay ) == 0 )
+		{
+			// Exit signalled.
+			return;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::InitFailed>
+// Give up on the controller, or say when to try again
+//-----------------------------------------------------------------------------
+int32 Driver::InitFailed
+(
+		uint32 const _attempts
+)
+{
+	uint32 maxAttempts = 0;
+	Options::Get()->GetOptionAsInt("DriverMaxAttempts", (int32 *)&maxAttempts);
+	if( maxAttempts && (_attempts >= maxAttempts) )
+	{
+		Manager::Get()->Manager::SetDriverReady(this, false);
+		NotifyWatchers();
+		return -1;
+	}
+
+	// Retry every 5 seconds for the first two minutes, and every 30 seconds after that
+	return ( _attempts < 25 ) ? 5000 : 30000;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::AddWaitObjects>
+// Fill a wait set with the objects the driver loop waits on
+//-----------------------------------------------------------------------------
+void Driver::AddWaitObjects
+(
+		WaitSet* _waitSet,
+		Event* _exitEvent
+)
+{
+	_waitSet->Add( _exitEvent );				// Thread must exit.
+	_waitSet->Add( m_notificationsEvent );			// Notifications waiting to be sent.
+	_waitSet->Add( m_controller );				// Controller has received data.
+	_waitSet->Add( m_queueEvent[MsgQueue_Command] );		// A controller command is in progress.
+	_waitSet->Add( m_queueEvent[MsgQueue_Security] );		// Security Related Commands (As they have a timeout)
+	_waitSet->Add( m_queueEvent[MsgQueue_NoOp] );		// Send device probes and diagnostics messages
+	_waitSet->Add( m_queueEvent[MsgQueue_Controller] );	// A multi-part controller command is in progress
+	_waitSet->Add( m_queueEvent[MsgQueue_WakeUp] );		// A node has woken. Pending messages should be sent.
+	_waitSet->Add( m_queueEvent[MsgQueue_Send] );		// Ordinary requests to be sent.
+	_waitSet->Add( m_queueEvent[MsgQueue_Query] );		// Node queries are pending.
+	_waitSet->Add( m_queueEvent[MsgQueue_Poll] );		// Poll request is waiting.
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::PrepareWait>
+// Work out which objects the driver loop can act on, and for how long to wait
+//-----------------------------------------------------------------------------
+int32 Driver::PrepareWait
+(
+		uint32* _count
+)
+{
+	uint32 count = 11;
+	int32 timeout = Wait::Timeout_Infinite;
+
+	// If we're waiting for a message to complete, we can only
+	// handle incoming data, notifications and exit events.
+	if( m_waitingForAck || m_expectedCallbackId || m_expectedReply )
+	{
+		count = 3;
+		// Deadlines, so that waking up for anything else does not put them off
+		timeout = m_waitingForAck ? m_ackTimeStamp.TimeRemaining() : m_retryTimeStamp.TimeRemaining();
+		if( timeout < 0 )
+		{
+			timeout = 0;
+		}
+	}
+	else if( m_currentControllerCommand != NULL )
+	{
+		count = 7;
+	}
+	else
+	{
+		Log::QueueClear();							// clear the log queue when starting a new message
+	}
+
+	// If only part of a frame has arrived, don't wait longer than the frame timeout
+	m_waitFrameTimeout = false;
+	if( m_frameExpected )
+	{
+		int32 frameRemaining = m_frameTimeStamp.TimeRemaining();
+		if( frameRemaining < 0 )
+		{
+			frameRemaining = 0;
+		}
+		if( ( timeout == Wait::Timeout_Infinite ) || ( frameRemaining <= timeout ) )
 		{
-			// Retry every 5 seconds for the first two minutes
-			if( Wait::Single( _exitEvent, 5000 ) == 0 )
+			timeout = frameRemaining;
+			m_waitFrameTimeout = true;
+		}
+	}
+
+	// Wake up to send value updates held back by the debounce window
+	m_waitDebounceTimeout = false;
+	if( !m_debouncedValues.empty() )
+	{
+		int32 debounceRemaining = GetDebounceTimeout();
+		if( ( debounceRemaining != Wait::Timeout_Infinite ) && ( ( timeout == Wait::Timeout_Infinite ) || ( debounceRemaining < timeout ) ) )
+		{
+			timeout = debounceRemaining;
+			m_waitDebounceTimeout = true;
+			m_waitFrameTimeout = false;
+		}
+	}
+
+	// Wake up to write the queue statistics to the log.  The ACK, callback
+	// and reply timeouts above are deadlines, so this does not put them off.
+	m_waitQueueLogTimeout = false;
+	if( m_queueLogInterval > 0 )
+	{
+		int32 logRemaining = m_queueLogTimeStamp.TimeRemaining();
+		if( logRemaining < 0 )
+		{
+			logRemaining = 0;
+		}
+		if( ( timeout == Wait::Timeout_Infinite ) || ( logRemaining < timeout ) )
+		{
+			timeout = logRemaining;
+			m_waitQueueLogTimeout = true;
+			m_waitDebounceTimeout = false;
+			m_waitFrameTimeout = false;
+		}
+	}
+
+	*_count = count;
+	return timeout;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::HandleWait>
+// Act on the result of waiting on the objects from AddWaitObjects
+//-----------------------------------------------------------------------------
+void Driver::HandleWait
+(
+		int32 const _res
+)
+{
+	ChargeBlockedTime();
+
+	switch( _res )
+	{
+		case -1:
+		{
+			if( m_waitQueueLogTimeout )
 			{
-				// Exit signalled.
-				return;
+				LogQueueStatistics();
+				m_queueLogTimeStamp.SetTime( m_queueLogInterval * 1000 );
+				break;
 			}
+
+			if( m_waitDebounceTimeout )
+			{
+				// A debounce window has ended
+				FlushDebouncedNotifications();
+				break;
+			}
+
+			if( m_waitFrameTimeout )
+			{
+				// The rest of a partially received frame never arrived
+				AbortFrameRead();
+				break;
+			}
+
+			// Wait has timed out - time to resend
+			if( m_currentMsg != NULL )
+			{
+				Notification* notification = new Notification( Notification::Type_Notification );
+				notification->SetHomeAndNodeIds( m_homeId, m_currentMsg->GetTargetNodeId() );
+				notification->SetNotification( Notification::Code_Timeout );
+				QueueNotification( notification );
+			}
+			if( WriteMsg( "Wait Timeout" ) )
+			{
+				m_retryTimeStamp.SetTime( m_retryTimeout );
+			}
+			break;
 		}
-		else
+		case 0:
+		{
+			// Exit is handled by the caller
+			break;
+		}
+		case 1:
+		{
+			// Notifications are waiting to be sent
+			NotifyWatchers();
+			break;
+		}
+		case 2:
 		{
-			// Retry every 30 seconds after that
-			if( Wait::Single( _exitEvent, 30000 ) == 0 )
+			// Data has been received
+			ReadMsg();
+			break;
+		}
+		default:
+		{
+			// All the other events are sending message queue items
+			if( WriteNextMsg( (MsgQueue)(_res-3) ) )
 			{
-				// Exit signalled.
-				return;
+				m_retryTimeStamp.SetTime( m_retryTimeout );
 			}
+			break;
 		}
 	}
 }
@@ -520,6 +774,7 @@ bool Driver::Init
 {
 	m_nodeId = -1;
 	m_waitingForAck = false;
+	m_frameExpected = 0;
 
 	// Open the controller
 	Log::Write( LogLevel_Info, "  Opening controller %s", m_controllerPath.c_str() );
@@ -531,7 +786,18 @@ bool Driver::Init
 	}
 
 	// Controller opened successfully, so we need to start all the worker threads
-	m_pollThread->Start( Driver::PollThreadEntryPoint, this );
+	if( m_reactor != NULL )
+	{
+		m_reactor->StartPolling( this );
+	}
+	else
+	{
+		m_pollThread->Start( Driver::PollThreadEntryPoint, this );
+	}
+	if( m_saveThread != NULL )
+	{
+		m_saveThread->Start( Driver::SaveThreadEntryPoint, this );
+	}
 
 	// Send a NAK to the ZWave device
 	uint8 nak = NAK;
@@ -566,8 +832,8 @@ void Driver::RemoveQueues
 	// Clear the send Queue
 	for( int32 i=0; i<MsgQueue_Count; ++i )
 	{
-		list<MsgQueueItem>::iterator it = m_msgQueue[i].begin();
-		while( it != m_msgQueue[i].end() )
+		MsgQueueItem* it = m_msgQueue[i].Front();
+		while( it != NULL )
 		{
 			bool remove = false;
 			MsgQueueItem const& item = *it;
@@ -587,14 +853,14 @@ void Driver::RemoveQueues
 			}
 			if( remove )
 			{
-				it = m_msgQueue[i].erase( it );
+				it = RemoveQueueItem( (MsgQueue)i, it );
 			}
 			else
 			{
-				++it;
+				it = it->m_next;
 			}
 		}
-		if( m_msgQueue[i].empty() )
+		if( m_msgQueue[i].Empty() )
 		{
 			m_queueEvent[i]->Reset();
 		}
@@ -613,20 +879,50 @@ bool Driver::ReadConfig
 (
 )
 {
-	char str[32];
 	int32 intVal;
 
 	// Load the XML document that contains the driver configuration
-	string userPath;
-	Options::Get()->GetOptionAsString( "UserPath", &userPath );
-
-	snprintf( str, sizeof(str), "zwcfg_0x%08x.xml", m_homeId );
-	string filename =  userPath + string(str);
+	string filename = GetConfigFilename( "xml" );
 
 	TiXmlDocument doc;
-	if( !doc.LoadFile( filename.c_str(), TIXML_ENCODING_UTF8 ) )
+	bool loaded = false;
+	string xml;
+	if( m_configCache && ConfigCache::ReadFile( filename, &xml ) )
 	{
-		return false;
+		// Use the binary cache if it was made from this XML file
+		string cacheFilename = GetConfigFilename( "bin" );
+		string cache;
+		uint32 sourceSize;
+		uint32 sourceHash;
+		if( ConfigCache::ReadFile( cacheFilename, &cache ) && ConfigCache::Decode( cache.data(), cache.size(), &doc, &sourceSize, &sourceHash ) )
+		{
+			if( ( sourceSize == xml.size() ) && ( sourceHash == ConfigCache::Hash( xml.data(), xml.size() ) ) )
+			{
+				loaded = true;
+			}
+			else
+			{
+				Log::Write( LogLevel_Info, "%s is out of date, reading %s", cacheFilename.c_str(), filename.c_str() );
+				doc.Clear();
+			}
+		}
+		else
+		{
+			doc.Clear();
+		}
+	}
+
+	if( !loaded )
+	{
+		if( !doc.LoadFile( filename.c_str(), TIXML_ENCODING_UTF8 ) )
+		{
+			return false;
+		}
+		if( m_configCache && !xml.empty() )
+		{
+			// Make the next start faster
+			WriteConfigCache( doc, xml );
+		}
 	}
 
 	TiXmlElement const* driverElement = doc.RootElement();
@@ -693,7 +989,7 @@ bool Driver::ReadConfig
 	char const* cstr = driverElement->Attribute( "poll_interval_between" );
 	if( cstr )
 	{
-		m_bIntervalBetweenPolls = !strcmp( str, "true" );
+		m_bIntervalBetweenPolls = !strcmp( cstr, "true" );
 	}
 
 	// Read the nodes
@@ -745,67 +1041,276 @@ bool Driver::ReadConfig
 
 //-----------------------------------------------------------------------------
 // <Driver::WriteConfig>
-// Write ourselves to an XML document
+// Write ourselves to an XML document.  The binary cache is only brought up
+// to date when asked, at shutdown, as building it means parsing the whole
+// file again.  A cache left out of date by a crash is rebuilt at startup.
 //-----------------------------------------------------------------------------
 void Driver::WriteConfig
 (
+		bool const _updateCache
 )
 {
-	char str[32];
-
 	if (!m_homeId) {
 		Log::Write( LogLevel_Warning, "WARNING: Tried to write driver config with no home ID set");
 		return;
 	}
 
-	// Create a new XML document to contain the driver configuration
-	TiXmlDocument doc;
-	TiXmlDeclaration* decl = new TiXmlDeclaration( "1.0", "utf-8", "" );
-	TiXmlElement* driverElement = new TiXmlElement( "Driver" );
-	doc.LinkEndChild( decl );
-	doc.LinkEndChild( driverElement );
-
-	driverElement->SetAttribute( "xmlns", "http://code.google.com/p/open-zwave/" );
+	string contents;
+	uint32 generation;
+	if( GetConfigSnapshot( &contents, &generation, true ) )
+	{
+		if( SaveConfigSnapshot( contents, generation ) && _updateCache )
+		{
+			LockGuard LG(m_saveMutex);
+			if( m_configCache && m_configCacheStale )
+			{
+				TiXmlDocument doc;
+				doc.Parse( contents.c_str(), NULL, TIXML_ENCODING_UTF8 );
+				WriteConfigCache( doc, contents );
+				m_configCacheStale = false;
+			}
+		}
+	}
+}
 
-	snprintf( str, sizeof(str), "%d", c_configVersion );
-	driverElement->SetAttribute( "version", str );
+//-----------------------------------------------------------------------------
+// <Driver::SetNodeConfigDirty>
+// Note that a node's part of the configuration file needs writing again
+//-----------------------------------------------------------------------------
+void Driver::SetNodeConfigDirty
+(
+		uint8 const _nodeId
+)
+{
+	LockGuard LG(m_configMutex);
+	m_nodeConfigDirty[_nodeId] = true;
+	m_configChanged = true;
+}
 
-	snprintf( str, sizeof(str), "0x%.8x", m_homeId );
-	driverElement->SetAttribute( "home_id", str );
+//-----------------------------------------------------------------------------
+// <Driver::GetConfigSnapshot>
+// Build the text of the configuration file.  Only nodes that have changed
+// since the last snapshot are written out again, so the node mutex is held
+// for as short a time as possible.  Returns false if nothing has changed,
+// unless _force is set.
+//-----------------------------------------------------------------------------
+bool Driver::GetConfigSnapshot
+(
+		string* _contents,
+		uint32* _generation,
+		bool const _force
+)
+{
+	char str[512];
+	snprintf( str, sizeof(str),
+		"<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n"
+		"<Driver xmlns=\"http://code.google.com/p/open-zwave/\" version=\"%d\" home_id=\"0x%.8x\" node_id=\"%d\" api_capabilities=\"%d\" controller_capabilities=\"%d\" poll_interval=\"%d\" poll_interval_between=\"%s\">\n",
+		c_configVersion, m_homeId, m_nodeId, m_initCaps, m_controllerCaps, m_pollInterval, m_bIntervalBetweenPolls ? "true" : "false" );
+	string header = str;
 
-	snprintf( str, sizeof(str), "%d", m_nodeId );
-	driverElement->SetAttribute( "node_id", str );
+	LockGuard LG(m_nodeMutex);
 
-	snprintf( str, sizeof(str), "%d", m_initCaps );
-	driverElement->SetAttribute( "api_capabilities", str );
+	// Take the dirty flags.  A node that changes after this point will
+	// be written again by the next snapshot.
+	bool dirty[256];
+	bool changed;
+	{
+		LockGuard configLG(m_configMutex);
+		memcpy( dirty, m_nodeConfigDirty, sizeof(dirty) );
+		memset( m_nodeConfigDirty, 0, sizeof(m_nodeConfigDirty) );
+		changed = m_configChanged;
+		m_configChanged = false;
+	}
 
-	snprintf( str, sizeof(str), "%d", m_controllerCaps );
-	driverElement->SetAttribute( "controller_capabilities", str );
+	if( header != m_configHeader )
+	{
+		m_configHeader = header;
+		changed = true;
+	}
 
-	snprintf( str, sizeof(str), "%d", m_pollInterval );
-	driverElement->SetAttribute( "poll_interval", str );
+	size_t size = header.size();
+	for( int i=0; i<256; ++i )
+	{
+		NodeConfig& config = m_nodeConfig[i];
+		Node* node = m_nodes[i];
+		if( node == NULL )
+		{
+			if( config.m_node != NULL )
+			{
+				config.m_node = NULL;
+				config.m_xml.clear();
+				changed = true;
+			}
+			continue;
+		}
 
-	snprintf( str, sizeof(str), "%s", m_bIntervalBetweenPolls ? "true" : "false" );
-	driverElement->SetAttribute( "poll_interval_between", str );
+		if( dirty[i] || ( config.m_node != node ) || ( config.m_queryStage != (uint32)node->GetCurrentQueryStage() ) )
+		{
+			// Write the node into a Driver element, so the printer indents it
+			// as it would be in the file, then strip the Driver element off.
+			TiXmlElement driverElement( "Driver" );
+			node->WriteXML( &driverElement );
+			TiXmlPrinter printer;
+			driverElement.Accept( &printer );
+			string xml = printer.CStr();
+			size_t start = xml.find( '\n' ) + 1;
+			size_t end = xml.rfind( "</Driver>" );
+			config.m_xml = xml.substr( start, end-start );
+			config.m_node = node;
+			config.m_queryStage = (uint32)node->GetCurrentQueryStage();
+			changed = true;
+		}
+		size += config.m_xml.size();
+	}
 
+	if( !changed && !_force )
 	{
-		LockGuard LG(m_nodeMutex);
+		return false;
+	}
 
-		for( int i=0; i<256; ++i )
+	_contents->reserve( size + 16 );
+	*_contents = header;
+	for( int i=0; i<256; ++i )
+	{
+		if( m_nodeConfig[i].m_node != NULL )
 		{
-			if( m_nodes[i] )
-			{
-				m_nodes[i]->WriteXML( driverElement );
-			}
+			*_contents += m_nodeConfig[i].m_xml;
 		}
 	}
+	*_contents += "</Driver>\n";
+
+	LockGuard configLG(m_configMutex);
+	*_generation = ++m_configGeneration;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SaveConfigSnapshot>
+// Replace the configuration file with a snapshot, unless a newer snapshot
+// has already been written
+//-----------------------------------------------------------------------------
+bool Driver::SaveConfigSnapshot
+(
+		string const& _contents,
+		uint32 const _generation
+)
+{
+	LockGuard LG(m_saveMutex);
+	if( (int32)( _generation - m_savedGeneration ) <= 0 )
+	{
+		return true;
+	}
+
+	string filename = GetConfigFilename( "xml" );
+	if( !FileOps::FileWriteAtomic( filename, _contents ) )
+	{
+		Log::Write( LogLevel_Error, "Failed to save the network configuration to %s", filename.c_str() );
+
+		// Try again at the next background save
+		LockGuard configLG(m_configMutex);
+		m_configChanged = true;
+		return false;
+	}
+
+	m_savedGeneration = _generation;
+	m_configCacheStale = true;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetConfigFilename>
+// Path of the configuration file, or of its binary cache
+//-----------------------------------------------------------------------------
+string Driver::GetConfigFilename
+(
+		char const* _extension
+)
+{
 	string userPath;
 	Options::Get()->GetOptionAsString( "UserPath", &userPath );
 
-	snprintf( str, sizeof(str), "zwcfg_0x%08x.xml", m_homeId );
-	string filename =  userPath + string(str);
+	char str[32];
+	snprintf( str, sizeof(str), "zwcfg_0x%08x.%s", m_homeId, _extension );
+	return userPath + string(str);
+}
 
-	doc.SaveFile( filename.c_str() );
+//-----------------------------------------------------------------------------
+// <Driver::WriteConfigCache>
+// Save the binary cache of the configuration file, marked with the size and
+// hash of the XML it holds
+//-----------------------------------------------------------------------------
+void Driver::WriteConfigCache
+(
+		TiXmlDocument const& _doc,
+		string const& _xml
+)
+{
+	string cache;
+	ConfigCache::Encode( _doc, (uint32)_xml.size(), ConfigCache::Hash( _xml.data(), _xml.size() ), &cache );
+
+	string filename = GetConfigFilename( "bin" );
+	if( !FileOps::FileWriteAtomic( filename, cache ) )
+	{
+		Log::Write( LogLevel_Warning, "WARNING: Failed to save the network cache to %s", filename.c_str() );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SaveThreadEntryPoint>
+// Entry point of the thread for saving the configuration in the background
+//-----------------------------------------------------------------------------
+void Driver::SaveThreadEntryPoint
+(
+		Event* _exitEvent,
+		void* _context
+)
+{
+	Driver* driver = (Driver*)_context;
+	if( driver )
+	{
+		driver->SaveThreadProc( _exitEvent );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SaveThreadProc>
+// Save the configuration every m_saveInterval seconds if anything has
+// changed, or when asked to by m_saveEvent
+//-----------------------------------------------------------------------------
+void Driver::SaveThreadProc
+(
+		Event* _exitEvent
+)
+{
+	Wait* waitObjects[2];
+	waitObjects[0] = _exitEvent;
+	waitObjects[1] = m_saveEvent;
+
+	while( true )
+	{
+		int32 res = Wait::Multiple( waitObjects, 2, m_saveInterval * 1000 );
+		if( res == 0 )
+		{
+			// Exit has been signalled
+			return;
+		}
+		if( res == 1 )
+		{
+			m_saveEvent->Reset();
+		}
+
+		if( !m_homeId )
+		{
+			continue;
+		}
+
+		string contents;
+		uint32 generation;
+		if( GetConfigSnapshot( &contents, &generation, false ) && SaveConfigSnapshot( contents, generation ) )
+		{
+			Log::Write( LogLevel_Detail, "Saved the network configuration" );
+		}
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -914,8 +1419,7 @@ void Driver::SendQueryStageComplete
 		// Non-sleeping node
 		Log::Write( LogLevel_Detail, node->GetNodeId(), "Queuing (%s) Query Stage Complete (%s)", c_sendQueueNames[MsgQueue_Query], node->GetQueryStageName( _stage ).c_str() );
 		m_sendMutex->Lock();
-		m_msgQueue[MsgQueue_Query].push_back( item );
-		m_queueEvent[MsgQueue_Query]->Set();
+		QueueItem( MsgQueue_Query, item );
 		m_sendMutex->Unlock();
 
 	}
@@ -938,82 +1442,373 @@ void Driver::RetryQueryStageComplete
 
 	m_sendMutex->Lock();
 
-	for( list<MsgQueueItem>::iterator it = m_msgQueue[MsgQueue_Query].begin(); it != m_msgQueue[MsgQueue_Query].end(); ++it )
+	for( MsgQueueItem* it = m_msgQueue[MsgQueue_Query].Front(); it != NULL; it = it->m_next )
 	{
 		if( *it == item )
 		{
-			(*it).m_retry = true;
-			break;
+			it->m_retry = true;
+			break;
+		}
+	}
+	m_sendMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SendMsg>
+// Queue a message to be sent to the Z-Wave PC Interface
+//-----------------------------------------------------------------------------
+void Driver::SendMsg
+(
+		Msg* _msg,
+		MsgQueue const _queue
+)
+{
+	MsgQueueItem item;
+
+	item.m_command = MsgQueueCmd_SendMsg;
+	item.m_msg = _msg;
+	_msg->Finalize();
+	{
+		LockGuard LG(m_nodeMutex);
+		if( Node* node = GetNode(_msg->GetTargetNodeId()) )
+		{
+			// If the message is for a sleeping node, we queue it in the node itself.
+			if( !node->IsListeningDevice() )
+			{
+				if( WakeUp* wakeUp = static_cast<WakeUp*>( node->GetCommandClass( WakeUp::StaticGetCommandClassId() ) ) )
+				{
+					if( !wakeUp->IsAwake() )
+					{
+						Log::Write( LogLevel_Detail, "" );
+						// Handle saving multi-step controller commands
+						if( m_currentControllerCommand != NULL )
+						{
+							Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Queuing (%s) %s", c_sendQueueNames[MsgQueue_Controller], c_controllerCommandNames[m_currentControllerCommand->m_controllerCommand] );
+							delete _msg;
+							item.m_command = MsgQueueCmd_Controller;
+							item.m_cci = new ControllerCommandItem( *m_currentControllerCommand );
+							item.m_msg = NULL;
+							UpdateControllerState( ControllerState_Sleeping );
+						}
+						else if( Log::IsLevelEnabled( LogLevel_Detail ) )
+						{
+							Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Queuing (%s) %s", c_sendQueueNames[MsgQueue_WakeUp], _msg->GetAsString().c_str() );
+						}
+						wakeUp->QueueMsg( item );
+						return;
+					}
+				}
+			}
+
+			/* if the node Supports the Security Class - check if this message is meant to be encapsulated */
+			if ( Security* security = static_cast<Security *>( node->GetCommandClass(Security::StaticGetCommandClassId() ) ) )
+			{
+				CommandClass *cc = node->GetCommandClass(_msg->GetSendingCommandClass());
+				if ( (cc) && (cc->IsSecured()) )
+				{
+					Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Encrypting Message For Command Class %s", cc->GetCommandClassName().c_str());
+					security->SendMsg(_msg);
+					return;
+				}
+			}
+		}
+	}
+	m_sendMutex->Lock();
+	if( !CoalesceMsg( item, _queue ) )
+	{
+		// An identical request will be sent first
+		m_sendMutex->Unlock();
+		delete _msg;
+		return;
+	}
+	if( Log::IsLevelEnabled( LogLevel_Detail ) )
+	{
+		Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Queuing (%s) %s", c_sendQueueNames[_queue], _msg->GetAsString().c_str() );
+	}
+	QueueItem( _queue, item );
+	m_sendMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::CoalesceMsg>
+// Remove queued requests that a new one makes redundant.  Returns false if
+// the new request is itself redundant and should not be queued.  The caller
+// must hold m_sendMutex.
+//-----------------------------------------------------------------------------
+bool Driver::CoalesceMsg
+(
+		MsgQueueItem& _item,
+		MsgQueue const _queue
+)
+{
+	Msg* msg = _item.m_msg;
+	if( !IsCoalescedQueue( _queue ) || ( msg->GetBuffer()[3] != FUNC_ID_ZW_SEND_DATA ) )
+	{
+		return true;
+	}
+
+	_item.m_key = msg->GetQueueKey();
+
+	// A Get is answered by a report, so one copy in any queue is enough.  Other
+	// commands, such as a toggle or a scene activation, may not be repeated
+	// safely, so they are only replaced by a newer Set that was marked with
+	// SetSupersede for the same value.  That only happens in its own queue, so
+	// that it is still sent in the order the application asked for.  As with
+	// the wake-up queue, the old copy is removed and the new one goes to the
+	// back, so a Get that follows a Set still reads the new value.  Nothing is
+	// removed from the query queue, as the order of a node's interview depends
+	// on it.
+	bool isGet = ( msg->GetExpectedReply() == FUNC_ID_APPLICATION_COMMAND_HANDLER );
+	for( int32 i=MsgQueue_Send; i<=MsgQueue_Poll; ++i )
+	{
+		MsgQueue queue = (MsgQueue)i;
+		if( ( queue != _queue ) && !isGet )
+		{
+			continue;
+		}
+		if( ( queue == MsgQueue_Query ) && !isGet )
+		{
+			continue;
+		}
+
+		MsgQueueItem* it = m_msgQueue[i].FindKey( _item.m_key );
+		while( it != NULL )
+		{
+			Msg* queued = it->m_msg;
+			if( !( isGet && ( *queued == *msg ) ) && !msg->Supersedes( *queued ) )
+			{
+				it = m_msgQueue[i].FindKey( _item.m_key, it );
+				continue;
+			}
+
+			if( ( queue < _queue ) || ( ( queue == _queue ) && ( queue == MsgQueue_Query ) ) )
+			{
+				// The queued copy will be sent before this one would have been
+				Log::Write( LogLevel_Detail, msg->GetTargetNodeId(), "Dropping (%s) %s, the same request is already queued (%s)", c_sendQueueNames[_queue], msg->GetLogText().c_str(), c_sendQueueNames[queue] );
+				m_coalesced++;
+				m_queueStats[_queue].m_coalesced++;
+				return false;
+			}
+
+			if( queue == MsgQueue_Query )
+			{
+				it = m_msgQueue[i].FindKey( _item.m_key, it );
+				continue;
+			}
+
+			Log::Write( LogLevel_Detail, msg->GetTargetNodeId(), "Replacing (%s) %s with a newer request", c_sendQueueNames[queue], queued->GetLogText().c_str() );
+			delete queued;
+			MsgQueueItem* next = m_msgQueue[i].FindKey( _item.m_key, it );
+			RemoveQueueItem( queue, it );
+			it = next;
+			m_coalesced++;
+			m_queueStats[queue].m_coalesced++;
+		}
+
+		if( m_msgQueue[i].Empty() )
+		{
+			m_queueEvent[i]->Reset();
+		}
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::QueueItem>
+// Add an item to the back of a send queue.  The caller must hold m_sendMutex.
+//-----------------------------------------------------------------------------
+void Driver::QueueItem
+(
+		MsgQueue const _queue,
+		MsgQueueItem const& _item
+)
+{
+	MsgQueueItem* item = AllocQueueItem();
+	*item = _item;
+	item->m_queuedTime = GetElapsed();
+
+	// Only the requests that CoalesceMsg looks for need to be found by key
+	bool index = IsCoalescedQueue( _queue ) && ( MsgQueueCmd_SendMsg == item->m_command ) && ( item->m_msg->GetBuffer()[3] == FUNC_ID_ZW_SEND_DATA );
+	m_msgQueue[_queue].PushBack( item, index );
+	if( m_msgQueue[_queue].Size() > m_queueStats[_queue].m_maxDepth )
+	{
+		m_queueStats[_queue].m_maxDepth = m_msgQueue[_queue].Size();
+	}
+	m_queueEvent[_queue]->Set();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::RemoveQueueItem>
+// Take an item out of a send queue and recycle it.  The caller must hold
+// m_sendMutex, and is responsible for the item's message or command.
+//-----------------------------------------------------------------------------
+Driver::MsgQueueItem* Driver::RemoveQueueItem
+(
+		MsgQueue const _queue,
+		MsgQueueItem* _item
+)
+{
+	MsgQueueItem* next = m_msgQueue[_queue].Remove( _item );
+	FreeQueueItem( _item );
+	return next;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::AllocQueueItem>
+// Take an unused queue item from the pool.  The caller must hold m_sendMutex.
+//-----------------------------------------------------------------------------
+Driver::MsgQueueItem* Driver::AllocQueueItem
+(
+)
+{
+	if( m_freeQueueItems == NULL )
+	{
+		MsgQueueItem* chunk = new MsgQueueItem[QueueItemChunkSize];
+		m_queueItemChunks.push_back( chunk );
+		for( uint32 i=0; i<QueueItemChunkSize; ++i )
+		{
+			chunk[i].m_next = m_freeQueueItems;
+			m_freeQueueItems = &chunk[i];
+		}
+	}
+
+	MsgQueueItem* item = m_freeQueueItems;
+	m_freeQueueItems = item->m_next;
+	return item;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::FreeQueueItem>
+// Return a queue item to the pool.  The caller must hold m_sendMutex.
+//-----------------------------------------------------------------------------
+void Driver::FreeQueueItem
+(
+		MsgQueueItem* _item
+)
+{
+	*_item = MsgQueueItem();
+	_item->m_next = m_freeQueueItems;
+	m_freeQueueItems = _item;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::MsgQueueList::MsgQueueList>
+// Constructor
+//-----------------------------------------------------------------------------
+Driver::MsgQueueList::MsgQueueList
+(
+):
+	m_head( NULL ),
+	m_tail( NULL ),
+	m_size( 0 )
+{
+	memset( m_hash, 0, sizeof(m_hash) );
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::MsgQueueList::PushBack>
+// Link an item onto the back of the queue
+//-----------------------------------------------------------------------------
+void Driver::MsgQueueList::PushBack
+(
+		MsgQueueItem* _item,
+		bool const _index
+)
+{
+	_item->m_next = NULL;
+	_item->m_prev = m_tail;
+	if( m_tail != NULL )
+	{
+		m_tail->m_next = _item;
+	}
+	else
+	{
+		m_head = _item;
+	}
+	m_tail = _item;
+	++m_size;
+
+	_item->m_indexed = _index;
+	_item->m_hashNext = NULL;
+	if( _index )
+	{
+		// Items are added to the end of their bucket's chain, so
+		// FindKey returns them in the order they were queued
+		MsgQueueItem** link = &m_hash[_item->m_key % HashSize];
+		while( *link != NULL )
+		{
+			link = &(*link)->m_hashNext;
 		}
+		*link = _item;
 	}
-	m_sendMutex->Unlock();
 }
 
 //-----------------------------------------------------------------------------
-// <Driver::SendMsg>
-// Queue a message to be sent to the Z-Wave PC Interface
+// <Driver::MsgQueueList::Remove>
+// Unlink an item from the queue
 //-----------------------------------------------------------------------------
-void Driver::SendMsg
+Driver::MsgQueueItem* Driver::MsgQueueList::Remove
 (
-		Msg* _msg,
-		MsgQueue const _queue
+		MsgQueueItem* _item
 )
 {
-	MsgQueueItem item;
+	MsgQueueItem* next = _item->m_next;
+	if( _item->m_prev != NULL )
+	{
+		_item->m_prev->m_next = next;
+	}
+	else
+	{
+		m_head = next;
+	}
+	if( next != NULL )
+	{
+		next->m_prev = _item->m_prev;
+	}
+	else
+	{
+		m_tail = _item->m_prev;
+	}
+	--m_size;
 
-	item.m_command = MsgQueueCmd_SendMsg;
-	item.m_msg = _msg;
-	_msg->Finalize();
+	if( _item->m_indexed )
 	{
-		LockGuard LG(m_nodeMutex);
-		if( Node* node = GetNode(_msg->GetTargetNodeId()) )
+		MsgQueueItem** link = &m_hash[_item->m_key % HashSize];
+		while( *link != NULL )
 		{
-			// If the message is for a sleeping node, we queue it in the node itself.
-			if( !node->IsListeningDevice() )
-			{
-				if( WakeUp* wakeUp = static_cast<WakeUp*>( node->GetCommandClass( WakeUp::StaticGetCommandClassId() ) ) )
-				{
-					if( !wakeUp->IsAwake() )
-					{
-						Log::Write( LogLevel_Detail, "" );
-						// Handle saving multi-step controller commands
-						if( m_currentControllerCommand != NULL )
-						{
-							Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Queuing (%s) %s", c_sendQueueNames[MsgQueue_Controller], c_controllerCommandNames[m_currentControllerCommand->m_controllerCommand] );
-							delete _msg;
-							item.m_command = MsgQueueCmd_Controller;
-							item.m_cci = new ControllerCommandItem( *m_currentControllerCommand );
-							item.m_msg = NULL;
-							UpdateControllerState( ControllerState_Sleeping );
-						}
-						else
-						{
-							Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Queuing (%s) %s", c_sendQueueNames[MsgQueue_WakeUp], _msg->GetAsString().c_str() );
-						}
-						wakeUp->QueueMsg( item );
-						return;
-					}
-				}
-			}
-
-			/* if the node Supports the Security Class - check if this message is meant to be encapsulated */
-			if ( Security* security = static_cast<Security *>( node->GetCommandClass(Security::StaticGetCommandClassId() ) ) )
+			if( *link == _item )
 			{
-				CommandClass *cc = node->GetCommandClass(_msg->GetSendingCommandClass());
-				if ( (cc) && (cc->IsSecured()) )
-				{
-					Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Encrypting Message For Command Class %s", cc->GetCommandClassName().c_str());
-					security->SendMsg(_msg);
-					return;
-				}
+				*link = _item->m_hashNext;
+				break;
 			}
+			link = &(*link)->m_hashNext;
 		}
 	}
-	Log::Write( LogLevel_Detail, GetNodeNumber( _msg ), "Queuing (%s) %s", c_sendQueueNames[_queue], _msg->GetAsString().c_str() );
-	m_sendMutex->Lock();
-	m_msgQueue[_queue].push_back( item );
-	m_queueEvent[_queue]->Set();
-	m_sendMutex->Unlock();
+
+	_item->m_next = NULL;
+	_item->m_prev = NULL;
+	_item->m_hashNext = NULL;
+	_item->m_indexed = false;
+	return next;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::MsgQueueList::FindKey>
+// Find the first indexed item with a key, queued after _after if it is given
+//-----------------------------------------------------------------------------
+Driver::MsgQueueItem* Driver::MsgQueueList::FindKey
+(
+		uint32 const _key,
+		MsgQueueItem* _after
+)const
+{
+	MsgQueueItem* item = ( _after != NULL ) ? _after->m_hashNext : m_hash[_key % HashSize];
+	while( ( item != NULL ) && ( item->m_key != _key ) )
+	{
+		item = item->m_hashNext;
+	}
+	return item;
 }
 
 //-----------------------------------------------------------------------------
@@ -1027,16 +1822,19 @@ bool Driver::WriteNextMsg
 {
 
 	// There are messages to send, so get the one at the front of the queue
+	// (or, for node interviews, the one for the node whose turn it is)
 	m_sendMutex->Lock();
-	MsgQueueItem item = m_msgQueue[_queue].front();
+	MsgQueueItem* next = ( _queue == MsgQueue_Query ) ? NextQueryItem() : m_msgQueue[_queue].Front();
+	MsgQueueItem item = *next;
 
 	if( MsgQueueCmd_SendMsg == item.m_command )
 	{
 		// Send a message
 		m_currentMsg = item.m_msg;
 		m_currentMsgQueueSource = _queue;
-		m_msgQueue[_queue].pop_front();
-		if( m_msgQueue[_queue].empty() )
+		m_queueStats[_queue].m_waits.Record( GetElapsedSince( item.m_queuedTime ) );
+		RemoveQueueItem( _queue, next );
+		if( m_msgQueue[_queue].Empty() )
 		{
 			m_queueEvent[_queue]->Reset();
 		}
@@ -1049,8 +1847,9 @@ bool Driver::WriteNextMsg
 		// Move to the next query stage
 		m_currentMsg = NULL;
 		Node::QueryStage stage = item.m_queryStage;
-		m_msgQueue[_queue].pop_front();
-		if( m_msgQueue[_queue].empty() )
+		m_queueStats[_queue].m_waits.Record( GetElapsedSince( item.m_queuedTime ) );
+		RemoveQueueItem( _queue, next );
+		if( m_msgQueue[_queue].Empty() )
 		{
 			m_queueEvent[_queue]->Reset();
 		}
@@ -1078,8 +1877,8 @@ bool Driver::WriteNextMsg
 		if ( m_currentControllerCommand->m_controllerCommandDone )
 		{
 			m_sendMutex->Lock();
-			m_msgQueue[_queue].pop_front();
-			if( m_msgQueue[_queue].empty() )
+			RemoveQueueItem( _queue, m_msgQueue[_queue].Front() );
+			if( m_msgQueue[_queue].Empty() )
 			{
 				m_queueEvent[_queue]->Reset();
 			}
@@ -1156,6 +1955,7 @@ bool Driver::WriteMsg
 		}
 		RemoveCurrentMsg();
 		m_dropped++;
+		m_queueStats[m_currentMsgQueueSource].m_dropped++;
 		return false;
 	}
 
@@ -1171,24 +1971,33 @@ bool Driver::WriteMsg
 	m_expectedNodeId = m_currentMsg->GetTargetNodeId();
 	m_expectedReply = m_currentMsg->GetExpectedReply();
 	m_waitingForAck = true;
-	string attemptsstr = "";
+	m_ackTimeStamp.SetTime( ACK_TIMEOUT );
+	char attemptsstr[16] = "";
 	if( attempts > 1 )
 	{
-		char buf[15];
-		snprintf( buf, sizeof(buf), "Attempt %d, ", attempts );
-		attemptsstr = buf;
+		snprintf( attemptsstr, sizeof(attemptsstr), "Attempt %d, ", attempts );
 		m_retries++;
+		m_queueStats[m_currentMsgQueueSource].m_retried++;
 		if( node != NULL )
 		{
 			node->m_retries++;
 		}
 	}
+	else
+	{
+		m_queueStats[m_currentMsgQueueSource].m_sent++;
+	}
 
 	Log::Write( LogLevel_Detail, "" );
-	Log::Write( LogLevel_Info, nodeId, "Sending (%s) message (%sCallback ID=0x%.2x, Expected Reply=0x%.2x) - %s", c_sendQueueNames[m_currentMsgQueueSource], attemptsstr.c_str(), m_expectedCallbackId, m_expectedReply, m_currentMsg->GetAsString().c_str() );
+	if( Log::IsLevelEnabled( LogLevel_Info ) )
+	{
+		Log::Write( LogLevel_Info, nodeId, "Sending (%s) message (%sCallback ID=0x%.2x, Expected Reply=0x%.2x) - %s", c_sendQueueNames[m_currentMsgQueueSource], attemptsstr, m_expectedCallbackId, m_expectedReply, m_currentMsg->GetAsString().c_str() );
+	}
 
+	m_writeTime = GetElapsed();
 	m_controller->Write( m_currentMsg->GetBuffer(), m_currentMsg->GetLength() );
 	m_writeCnt++;
+	Trace::WriteFrame( Trace::TraceDirection_Sent, nodeId, m_currentMsg->GetBuffer(), m_currentMsg->GetLength() );
 
 	if( nodeId == 0xff )
 	{
@@ -1303,8 +2112,8 @@ bool Driver::MoveMessagesToWakeUpQueue
 					// Now the message queues
 					for( int i=0; i<MsgQueue_Count; ++i )
 					{
-						list<MsgQueueItem>::iterator it = m_msgQueue[i].begin();
-						while( it != m_msgQueue[i].end() )
+						MsgQueueItem* it = m_msgQueue[i].Front();
+						while( it != NULL )
 						{
 							bool remove = false;
 							MsgQueueItem const& item = *it;
@@ -1348,16 +2157,16 @@ bool Driver::MoveMessagesToWakeUpQueue
 
 							if( remove )
 							{
-								it = m_msgQueue[i].erase( it );
+								it = RemoveQueueItem( (MsgQueue)i, it );
 							}
 							else
 							{
-								++it;
+								it = it->m_next;
 							}
 						}
 
 						// If the queue is now empty, we need to clear its event
-						if( m_msgQueue[i].empty() )
+						if( m_msgQueue[i].Empty() )
 						{
 							m_queueEvent[i]->Reset();
 						}
@@ -1371,8 +2180,7 @@ bool Driver::MoveMessagesToWakeUpQueue
 						item.m_command = MsgQueueCmd_Controller;
 						item.m_cci = new ControllerCommandItem( *m_currentControllerCommand );
 						m_currentControllerCommand = item.m_cci;
-						m_msgQueue[MsgQueue_Controller].push_back( item );
-						m_queueEvent[MsgQueue_Controller]->Set();
+						QueueItem( MsgQueue_Controller, item );
 					}
 
 					m_sendMutex->Unlock();
@@ -1480,6 +2288,7 @@ void Driver::CheckCompletedNodeQueries
 		LG.Unlock();
 
 		Log::Write( LogLevel_Warning, "CheckCompletedNodeQueries all=%d, deadFound=%d sleepingOnly=%d", all, deadFound, sleepingOnly );
+		uint32 elapsed = (uint32)( -m_startTime.TimeRemaining() );
 		if( all )
 		{
 			if( deadFound )
@@ -1498,6 +2307,12 @@ void Driver::CheckCompletedNodeQueries
 				notification->SetHomeAndNodeIds( m_homeId, 0xff );
 				QueueNotification( notification );
 			}
+			if( !m_awakeNodesQueried )
+			{
+				m_awakeNodesQueriedTime = elapsed;
+			}
+			m_allNodesQueriedTime = elapsed;
+			Log::Write( LogLevel_Info, "         Node queries took %d.%03d seconds", elapsed / 1000, elapsed % 1000 );
 			m_awakeNodesQueried = true;
 			m_allNodesQueried = true;
 		}
@@ -1505,6 +2320,8 @@ void Driver::CheckCompletedNodeQueries
 		{
 			if (!m_awakeNodesQueried )
 			{
+				m_awakeNodesQueriedTime = elapsed;
+				Log::Write( LogLevel_Info, "         Awake node queries took %d.%03d seconds", elapsed / 1000, elapsed % 1000 );
 				// only sleeping nodes remain, so signal awake nodes queried complete
 				Log::Write( LogLevel_Info, "         Node query processing complete except for sleeping nodes." );
 				Notification* notification = new Notification( Notification::Type_AwakeNodesQueried );
@@ -1516,6 +2333,242 @@ void Driver::CheckCompletedNodeQueries
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::ReadFastRestartOptions>
+// Read how long the results of each query stage may be reused on a restart
+//-----------------------------------------------------------------------------
+void Driver::ReadFastRestartOptions
+(
+)
+{
+	for( int32 i=0; i<(int32)Node::QueryStage_Complete; ++i )
+	{
+		m_queryStageTTL[i] = -1;
+	}
+
+	Options::Get()->GetOptionAsBool( "FastRestart", &m_fastRestart );
+	if( !m_fastRestart )
+	{
+		return;
+	}
+
+	// A list of stage=seconds pairs, such as "Associations=86400,Session=3600"
+	string ttls;
+	Options::Get()->GetOptionAsString( "FastRestartTTL", &ttls );
+	size_t pos = 0;
+	while( pos < ttls.size() )
+	{
+		size_t end = ttls.find( ',', pos );
+		if( end == string::npos )
+		{
+			end = ttls.size();
+		}
+		string entry = ttls.substr( pos, end-pos );
+		entry.erase( remove( entry.begin(), entry.end(), ' ' ), entry.end() );
+		pos = end + 1;
+		if( entry.empty() )
+		{
+			continue;
+		}
+
+		int32 stage = -1;
+		size_t eq = entry.find( '=' );
+		if( eq != string::npos )
+		{
+			string name = entry.substr( 0, eq );
+			for( int32 i=(int32)Node::QueryStage_Associations; i<(int32)Node::QueryStage_Configuration; ++i )
+			{
+				if( name == Node::GetQueryStageName( (Node::QueryStage)i ) )
+				{
+					stage = i;
+					break;
+				}
+			}
+		}
+		if( stage < 0 )
+		{
+			Log::Write( LogLevel_Warning, "Ignoring FastRestartTTL entry '%s'", entry.c_str() );
+			continue;
+		}
+		long ttl = strtol( entry.c_str()+eq+1, NULL, 0 );
+		m_queryStageTTL[stage] = ttl > 0 ? (int32)ttl : 0;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::AdmitInterview>
+// Check whether a node may carry on with its interview, or must wait for
+// another node to finish
+//-----------------------------------------------------------------------------
+bool Driver::AdmitInterview
+(
+		Node* _node
+)
+{
+	if( m_interviewLimit == 0 )
+	{
+		return true;
+	}
+
+	uint8 nodeId = _node->GetNodeId();
+	LockGuard LG(m_nodeMutex);
+	if( m_interviewing[nodeId] )
+	{
+		return true;
+	}
+
+	// Sleeping nodes are only queried while they are awake, so they are not held up
+	if( !_node->IsListeningDevice() && !_node->IsFrequentListeningDevice() )
+	{
+		return true;
+	}
+
+	if( m_interviewCount < m_interviewLimit )
+	{
+		m_interviewing[nodeId] = true;
+		++m_interviewCount;
+		m_interviewWaiting.remove( nodeId );
+		_node->m_queryStageStart.SetTime( 0 );
+		Log::Write( LogLevel_Info, nodeId, "Starting interview (%d of %d slots in use, %d nodes waiting)", m_interviewCount, m_interviewLimit, (int)m_interviewWaiting.size() );
+		return true;
+	}
+
+	if( find( m_interviewWaiting.begin(), m_interviewWaiting.end(), nodeId ) == m_interviewWaiting.end() )
+	{
+		Log::Write( LogLevel_Detail, nodeId, "Interview waiting for a free slot" );
+		m_interviewWaiting.push_back( nodeId );
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::EndInterview>
+// Free a node's interview slot, and start the interview of the next waiting
+// node.  Listening nodes are started before frequently listening ones.
+//-----------------------------------------------------------------------------
+void Driver::EndInterview
+(
+		uint8 const _nodeId
+)
+{
+	if( m_interviewLimit == 0 )
+	{
+		return;
+	}
+
+	LockGuard LG(m_nodeMutex);
+	if( m_interviewing[_nodeId] )
+	{
+		m_interviewing[_nodeId] = false;
+		--m_interviewCount;
+	}
+	else
+	{
+		m_interviewWaiting.remove( _nodeId );
+	}
+
+	if( m_exit || m_interviewCount >= m_interviewLimit )
+	{
+		return;
+	}
+
+	Node* next = NULL;
+	list<uint8>::iterator nit = m_interviewWaiting.end();
+	for( list<uint8>::iterator it = m_interviewWaiting.begin(); it != m_interviewWaiting.end(); ++it )
+	{
+		Node* node = m_nodes[*it];
+		if( node == NULL )
+		{
+			continue;
+		}
+		if( node->IsListeningDevice() )
+		{
+			next = node;
+			nit = it;
+			break;
+		}
+		if( next == NULL )
+		{
+			next = node;
+			nit = it;
+		}
+	}
+
+	if( next != NULL )
+	{
+		m_interviewWaiting.erase( nit );
+		next->AdvanceQueries();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::NextQueryItem>
+// Choose the query item to send next.  Without an interview limit this is
+// the front of the queue.  With one, each node being interviewed gets a
+// turn, so one slow node does not hold up the others' later stages.  Each
+// node's own items are always sent in the order they were queued.
+//-----------------------------------------------------------------------------
+Driver::MsgQueueItem* Driver::NextQueryItem
+(
+)
+{
+	MsgQueueItem* front = m_msgQueue[MsgQueue_Query].Front();
+	if( m_interviewLimit == 0 || MsgQueueCmd_Controller == front->m_command )
+	{
+		return front;
+	}
+
+	// The first item of the node that follows m_lastQueryNodeId, counting round from 255 to 0
+	MsgQueueItem* best = front;
+	uint32 bestDistance = 256;
+	for( MsgQueueItem* item = front; item != NULL; item = item->m_next )
+	{
+		uint32 distance = (uint8)( GetQueueItemNodeId( item ) - m_lastQueryNodeId - 1 );
+		if( distance < bestDistance )
+		{
+			best = item;
+			bestDistance = distance;
+			if( distance == 0 )
+			{
+				break;
+			}
+		}
+	}
+
+	m_lastQueryNodeId = GetQueueItemNodeId( best );
+	return best;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetQueueItemNodeId>
+// The node a queue item is for
+//-----------------------------------------------------------------------------
+uint8 Driver::GetQueueItemNodeId
+(
+		MsgQueueItem const* _item
+)
+{
+	switch( _item->m_command )
+	{
+		case MsgQueueCmd_SendMsg:
+		{
+			return _item->m_msg->GetTargetNodeId();
+		}
+		case MsgQueueCmd_QueryStageComplete:
+		{
+			return _item->m_nodeId;
+		}
+		case MsgQueueCmd_Controller:
+		{
+			return _item->m_cci->m_controllerCommandNode;
+		}
+		default:
+		{
+			return 0;
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::IsExpectedReply>
 // Determine if the reply is from the node we are expecting.
@@ -1559,78 +2612,70 @@ bool Driver::IsExpectedReply
 
 //-----------------------------------------------------------------------------
 // <Driver::ReadMsg>
-// Read data from the serial port
+// Parse and process all complete frames in the controller's receive buffer
 //-----------------------------------------------------------------------------
 bool Driver::ReadMsg
 (
 )
 {
-	uint8 buffer[1024] = {0};
-
-	if( !m_controller->Read( buffer, 1 ) )
-	{
-		// Nothing to read
-		return false;
-	}
+	bool dataRead = false;
 
-	switch( buffer[0] )
+	while( uint32 available = m_controller->GetDataSize() )
 	{
-		case SOF:
+		uint8 header = m_controller->Peek( 0 );
+		if( header == SOF )
 		{
-			m_SOFCnt++;
-			if( m_waitingForAck )
+			if( m_frameExpected == 0 )
 			{
-				// This can happen on any normal network when a transmission overlaps an unexpected
-				// reception and the data in the buffer doesn't contain the ACK. The controller will
-				// notice and send us a CAN to retransmit.
-				Log::Write( LogLevel_Detail, "Unsolicited message received while waiting for ACK." );
-				m_ACKWaiting++;
+				// Start of a new frame
+				m_SOFCnt++;
+				if( m_waitingForAck )
+				{
+					// This can happen on any normal network when a transmission overlaps an unexpected
+					// reception and the data in the buffer doesn't contain the ACK. The controller will
+					// notice and send us a CAN to retransmit.
+					Log::Write( LogLevel_Detail, "Unsolicited message received while waiting for ACK." );
+					m_ACKWaiting++;
+				}
+				m_frameExpected = 2;
+				m_frameTimeStamp.SetTime( FRAME_LENGTH_TIMEOUT );
 			}
 
-			// Read the length byte.  Keep trying until we get it.
-			m_controller->SetSignalThreshold( 1 );
-			int32 response = Wait::Single( m_controller, 50 );
-			if( response < 0 )
+			if( available < 2 )
 			{
-				Log::Write( LogLevel_Warning, "WARNING: 50ms passed without finding the length byte...aborting frame read");
-				m_readAborts++;
-				break;
+				// Wait for the length byte
+				m_controller->SetSignalThreshold( 2 );
+				return dataRead;
 			}
 
-			m_controller->Read( &buffer[1], 1 );
-			m_controller->SetSignalThreshold( buffer[1] );
-			if( Wait::Single( m_controller, 500 ) < 0 )
+			uint32 length = m_controller->Peek( 1 ) + 2;
+			if( m_frameExpected != length )
 			{
-				Log::Write( LogLevel_Warning, "WARNING: 500ms passed without reading the rest of the frame...aborting frame read" );
-				m_readAborts++;
-				m_controller->SetSignalThreshold( 1 );
-				break;
+				// Now that we know the length, allow time for the rest of the frame
+				m_frameExpected = length;
+				m_frameTimeStamp.SetTime( FRAME_BODY_TIMEOUT );
 			}
 
-			m_controller->Read( &buffer[2], buffer[1] );
-			m_controller->SetSignalThreshold( 1 );
+			if( available < length )
+			{
+				// Wait for the rest of the frame
+				m_controller->SetSignalThreshold( length );
+				return dataRead;
+			}
 
-			uint32 length = buffer[1] + 2;
+			// The whole frame is in the buffer, so work on it in place
+			uint8* buffer = m_controller->GetView( length );
+			m_frameExpected = 0;
+			dataRead = true;
 
 			// Log the data
-			string str = "";
-			for( uint32 i=0; i<length; ++i )
-			{
-				if( i )
-				{
-					str += ", ";
-				}
-
-				char byteStr[8];
-				snprintf( byteStr, sizeof(byteStr), "0x%.2x", buffer[i] );
-				str += byteStr;
-			}
 			uint8 nodeId = NodeFromMessage( buffer );
 			if( nodeId == 0 )
 			{
 				nodeId = GetNodeNumber( m_currentMsg );
 			}
-			Log::Write( LogLevel_Detail, nodeId, "  Received: %s", str.c_str() );
+			Log::WriteHex( LogLevel_Detail, nodeId, "  Received: ", buffer, length );
+			Trace::WriteFrame( Trace::TraceDirection_Received, nodeId, buffer, length );
 
 			// Verify checksum
 			uint8 checksum = 0xff;
@@ -1646,8 +2691,10 @@ bool Driver::ReadMsg
 				m_controller->Write( &ack, 1 );
 				m_readCnt++;
 
-				// Process the received message
+				// Process the received message.  The frame is only removed from
+				// the stream once it has been handled, so the pointer stays valid.
 				ProcessMsg( &buffer[2] );
+				m_controller->Skip( length );
 			}
 			else
 			{
@@ -1657,71 +2704,110 @@ bool Driver::ReadMsg
 				m_controller->Write( &nak, 1 );
 				m_controller->Purge();
 			}
-			break;
+			continue;
 		}
 
-		case CAN:
+		// All the other tokens are a single byte
+		m_controller->Skip( 1 );
+		dataRead = true;
+
+		switch( header )
 		{
-			// This is the other side of an unsolicited ACK. As mentioned there if we receive a message
-			// just after we transmitted one, the controller will notice and tell us to retransmit here.
-			// Don't increment the transmission counter as it is possible the message will never get out
-			// on very busy networks with lots of unsolicited messages being received. Increase the amount
-			// of retries but only up to a limit so we don't stay here forever.
-			Log::Write( LogLevel_Detail, GetNodeNumber( m_currentMsg ), "CAN received...triggering resend" );
-			m_CANCnt++;
-			if( m_currentMsg != NULL )
+			case CAN:
 			{
-				m_currentMsg->SetMaxSendAttempts( m_currentMsg->GetMaxSendAttempts() + 1 );
+				// This is the other side of an unsolicited ACK. As mentioned there if we receive a message
+				// just after we transmitted one, the controller will notice and tell us to retransmit here.
+				// Don't increment the transmission counter as it is possible the message will never get out
+				// on very busy networks with lots of unsolicited messages being received. Increase the amount
+				// of retries but only up to a limit so we don't stay here forever.
+				Log::Write( LogLevel_Detail, GetNodeNumber( m_currentMsg ), "CAN received...triggering resend" );
+				m_CANCnt++;
+				if( m_currentMsg != NULL )
+				{
+					m_currentMsg->SetMaxSendAttempts( m_currentMsg->GetMaxSendAttempts() + 1 );
+				}
+				else
+				{
+					Log::Write( LogLevel_Warning, "m_currentMsg was NULL when trying to set MaxSendAttempts" );
+					Log::QueueDump();
+				}
+				WriteMsg( "CAN" );
+				break;
 			}
-			else
+
+			case NAK:
 			{
-				Log::Write( LogLevel_Warning, "m_currentMsg was NULL when trying to set MaxSendAttempts" );
-				Log::QueueDump();
+				Log::Write( LogLevel_Warning, GetNodeNumber( m_currentMsg ), "WARNING: NAK received...triggering resend" );
+				m_NAKCnt++;
+				WriteMsg( "NAK" );
+				break;
 			}
-			WriteMsg( "CAN" );
-			break;
-		}
-
-		case NAK:
-		{
-			Log::Write( LogLevel_Warning, GetNodeNumber( m_currentMsg ), "WARNING: NAK received...triggering resend" );
-			m_NAKCnt++;
-			WriteMsg( "NAK" );
-			break;
-		}
 
-		case ACK:
-		{
-			m_ACKCnt++;
-			m_waitingForAck = false;
-			if( m_currentMsg == NULL )
+			case ACK:
 			{
-				Log::Write( LogLevel_StreamDetail, 255, "  ACK received" );
+				m_ACKCnt++;
+				if( m_waitingForAck )
+				{
+					m_ackLatencies.Record( GetElapsedSince( m_writeTime ) );
+				}
+				m_waitingForAck = false;
+				if( m_currentMsg == NULL )
+				{
+					Log::Write( LogLevel_StreamDetail, 255, "  ACK received" );
+				}
+				else
+				{
+					Log::Write( LogLevel_StreamDetail, GetNodeNumber( m_currentMsg ), "  ACK received CallbackId 0x%.2x Reply 0x%.2x", m_expectedCallbackId, m_expectedReply );
+					if( ( 0 == m_expectedCallbackId ) && ( 0 == m_expectedReply ) )
+					{
+						// Remove the message from the queue, now that it has been acknowledged.
+						RemoveCurrentMsg();
+					}
+				}
+				break;
 			}
-			else
+
+			default:
 			{
-				Log::Write( LogLevel_StreamDetail, GetNodeNumber( m_currentMsg ), "  ACK received CallbackId 0x%.2x Reply 0x%.2x", m_expectedCallbackId, m_expectedReply );
-				if( ( 0 == m_expectedCallbackId ) && ( 0 == m_expectedReply ) )
-				{
-					// Remove the message from the queue, now that it has been acknowledged.
-					RemoveCurrentMsg();
-				}
+				Log::Write( LogLevel_Warning, "WARNING: Out of frame flow! (0x%.2x).  Sending NAK.", header );
+				m_OOFCnt++;
+				uint8 nak = NAK;
+				m_controller->Write( &nak, 1 );
+				m_controller->Purge();
+				break;
 			}
-			break;
 		}
+	}
 
-		default:
-		{
-			Log::Write( LogLevel_Warning, "WARNING: Out of frame flow! (0x%.2x).  Sending NAK.", buffer[0] );
-			m_OOFCnt++;
-			uint8 nak = NAK;
-			m_controller->Write( &nak, 1 );
-			m_controller->Purge();
-			break;
-		}
+	// The buffer is empty, so wake up on the next byte
+	m_controller->SetSignalThreshold( 1 );
+	return dataRead;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::AbortFrameRead>
+// Give up on a frame whose remaining bytes did not arrive in time
+//-----------------------------------------------------------------------------
+void Driver::AbortFrameRead
+(
+)
+{
+	if( m_frameExpected == 2 )
+	{
+		Log::Write( LogLevel_Warning, "WARNING: %dms passed without finding the length byte...aborting frame read", FRAME_LENGTH_TIMEOUT );
+	}
+	else
+	{
+		Log::Write( LogLevel_Warning, "WARNING: %dms passed without reading the rest of the frame...aborting frame read", FRAME_BODY_TIMEOUT );
 	}
+	m_readAborts++;
+	m_frameExpected = 0;
 
-	return true;
+	// Discard the partial frame and resynchronize with the controller
+	uint8 nak = NAK;
+	m_controller->Write( &nak, 1 );
+	m_controller->Purge();
+	m_controller->SetSignalThreshold( 1 );
 }
 
 //-----------------------------------------------------------------------------
@@ -2812,6 +3898,8 @@ void Driver::HandleSendDataRequest
 			else
 			{
 				node->m_lastRequestRTT = -node->m_sentTS.TimeRemaining();
+				node->m_requestRTTs.Record( node->m_lastRequestRTT );
+				m_requestRTTs.Record( node->m_lastRequestRTT );
 
 				if( node->m_averageRequestRTT )
 				{
@@ -3313,6 +4401,8 @@ void Driver::HandleApplicationCommandHandlerRequest
 			// Need to confirm this is the correct response to the last sent request.
 			// At least ignore any received messages prior to the send data request.
 			node->m_lastResponseRTT = -node->m_sentTS.TimeRemaining();
+			node->m_responseRTTs.Record( node->m_lastResponseRTT );
+			m_responseRTTs.Record( node->m_lastResponseRTT );
 
 			if( node->m_averageResponseRTT )
 			{
@@ -3774,35 +4864,49 @@ bool Driver::EnablePoll
 		{
 			// update the value's pollIntensity
 			value->SetPollIntensity( _intensity );
+			SetNodeConfigDirty( nodeId );
 
-			// Add the valueid to the polling list
-			// See if the node is already in the poll list.
-			for( list<PollEntry>::iterator it = m_pollList.begin(); it != m_pollList.end(); ++it )
+			// See if the value is already in the poll schedule.
+			vector<PollEntry>::iterator it = FindPollEntry( _valueId );
+			if( it != m_pollHeap.end() )
 			{
-				if( (*it).m_id == _valueId )
-				{
-					// It is already in the poll list, so we have nothing to do.
-					Log::Write( LogLevel_Detail, "EnablePoll not required to do anything (value is already in the poll list)" );
-					value->Release();
-					m_pollMutex->Unlock();
-					return true;
-				}
+				// It is already scheduled, so we only need to pick up the new intensity.
+				it->m_intensity = _intensity;
+				Log::Write( LogLevel_Detail, "EnablePoll not required to do anything (value is already in the poll list)" );
+				value->Release();
+				m_pollMutex->Unlock();
+				return true;
 			}
 
-			// Not in the list, so we add it
+			// Not scheduled, so we add it.  The first polls are spread across the
+			// period, so enabling many values at once (or loading them from the
+			// config) does not send a burst of polls.  Stepping by the golden ratio
+			// keeps them spread however many are added.
+			TimeStamp now;
 			PollEntry pe;
 			pe.m_id = _valueId;
-			pe.m_pollCounter = value->GetPollIntensity();
-			m_pollList.push_back( pe );
+			pe.m_period = value->GetPollPeriod();
+			pe.m_intensity = value->GetPollIntensity();
+			pe.m_polls = 0;
+			pe.m_skipped = 0;
+			pe.m_cost = 0;
+			pe.m_failed = 0;
+			pe.m_backoff = 1;
+			uint32 count = (uint32)m_pollHeap.size();
+			uint64 period = GetEffectivePollPeriod( pe, count + 1 );
+			pe.m_due = now.GetAsMilliseconds() + ( period * ( ( count * 40503 ) & 0xffff ) >> 16 );
+			m_pollHeap.push_back( pe );
+			push_heap( m_pollHeap.begin(), m_pollHeap.end(), PollEntryLater() );
 			value->Release();
 			m_pollMutex->Unlock();
+			m_pollEvent->Set();
 
 			// send notification to indicate polling is enabled
 			Notification* notification = new Notification( Notification::Type_PollingEnabled );
 			notification->SetHomeAndNodeIds( m_homeId, _valueId.GetNodeId() );
 			QueueNotification( notification );
 			Log::Write( LogLevel_Info, nodeId, "EnablePoll for HomeID 0x%.8x, value(cc=0x%02x,in=0x%02x,id=0x%02x)--poll list has %d items",
-					_valueId.GetHomeId(), _valueId.GetCommandClassId(), _valueId.GetIndex(), _valueId.GetInstance(), m_pollList.size() );
+					_valueId.GetHomeId(), _valueId.GetCommandClassId(), _valueId.GetIndex(), _valueId.GetInstance(), m_pollHeap.size() );
 			return true;
 		}
 
@@ -3838,31 +4942,30 @@ bool Driver::DisablePoll
 	Node* node = GetNode( nodeId );
 	if( node != NULL)
 	{
-		// See if the value is already in the poll list.
-		for( list<PollEntry>::iterator it = m_pollList.begin(); it != m_pollList.end(); ++it )
+		// See if the value is in the poll schedule.
+		vector<PollEntry>::iterator it = FindPollEntry( _valueId );
+		if( it != m_pollHeap.end() )
 		{
-			if( (*it).m_id == _valueId )
-			{
-				// Found it
-				// remove it from the poll list
-				m_pollList.erase( it );
+			// Found it
+			// remove it from the poll schedule
+			m_pollHeap.erase( it );
+			make_heap( m_pollHeap.begin(), m_pollHeap.end(), PollEntryLater() );
 
-				// get the value object and reset pollIntensity to zero (indicating no polling)
-				Value* value = GetValue( _valueId );
-				if (!value)
-					continue;
+			// get the value object and reset pollIntensity to zero (indicating no polling)
+			if( Value* value = GetValue( _valueId ) )
+			{
 				value->SetPollIntensity( 0 );
 				value->Release();
-				m_pollMutex->Unlock();
-
-				// send notification to indicate polling is disabled
-				Notification* notification = new Notification( Notification::Type_PollingDisabled );
-				notification->SetHomeAndNodeIds( m_homeId, _valueId.GetNodeId() );
-				QueueNotification( notification );
-				Log::Write( LogLevel_Info, nodeId, "DisablePoll for HomeID 0x%.8x, value(cc=0x%02x,in=0x%02x,id=0x%02x)--poll list has %d items",
-						_valueId.GetHomeId(), _valueId.GetCommandClassId(), _valueId.GetIndex(), _valueId.GetInstance(), m_pollList.size() );
-				return true;
 			}
+			m_pollMutex->Unlock();
+
+			// send notification to indicate polling is disabled
+			Notification* notification = new Notification( Notification::Type_PollingDisabled );
+			notification->SetHomeAndNodeIds( m_homeId, _valueId.GetNodeId() );
+			QueueNotification( notification );
+			Log::Write( LogLevel_Info, nodeId, "DisablePoll for HomeID 0x%.8x, value(cc=0x%02x,in=0x%02x,id=0x%02x)--poll list has %d items",
+					_valueId.GetHomeId(), _valueId.GetCommandClassId(), _valueId.GetIndex(), _valueId.GetInstance(), m_pollHeap.size() );
+			return true;
 		}
 
 		// Not in the list
@@ -3892,6 +4995,10 @@ bool Driver::isPolled
 	// make sure the polling thread doesn't lock the node while we're in this function
 	m_pollMutex->Lock();
 
+	// confirm that this node exists
+	uint8 nodeId = _valueId.GetNodeId();
+	LockGuard LG(m_nodeMutex);
+
 	Value* value = GetValue( _valueId );
 	if( value && value->GetPollIntensity() != 0 )
 	{
@@ -3906,31 +5013,24 @@ bool Driver::isPolled
 
 	/*
 	 * This code is retained for the moment as a belt-and-suspenders test to confirm that
-	 * the pollIntensity member of each value and the pollList contents do not get out
+	 * the pollIntensity member of each value and the poll schedule do not get out
 	 * of sync.
 	 */
-	// confirm that this node exists
-	uint8 nodeId = _valueId.GetNodeId();
-	LockGuard LG(m_nodeMutex);
 	Node* node = GetNode( nodeId );
 	if( node != NULL)
 	{
-
-		// See if the value is already in the poll list.
-		for( list<PollEntry>::iterator it = m_pollList.begin(); it != m_pollList.end(); ++it )
+		// See if the value is in the poll schedule.
+		if( FindPollEntry( _valueId ) != m_pollHeap.end() )
 		{
-			if( (*it).m_id == _valueId )
+			// Found it
+			if( bPolled )
 			{
-				// Found it
-				if( bPolled )
-				{
-					m_pollMutex->Unlock();
-					return true;
-				}
-				else
-				{
-					Log::Write( LogLevel_Error, nodeId, "IsPolled setting for valueId 0x%016x is not consistent with the poll list", _valueId.GetId() );
-				}
+				m_pollMutex->Unlock();
+				return true;
+			}
+			else
+			{
+				Log::Write( LogLevel_Error, nodeId, "IsPolled setting for valueId 0x%016x is not consistent with the poll list", _valueId.GetId() );
 			}
 		}
 
@@ -3966,14 +5066,354 @@ void Driver::SetPollIntensity
 {
 	// make sure the polling thread doesn't lock the value while we're in this function
 	m_pollMutex->Lock();
+	LockGuard LG(m_nodeMutex);
 
 	Value* value = GetValue( _valueId );
 	if (!value)
+	{
+		m_pollMutex->Unlock();
 		return;
+	}
 	value->SetPollIntensity( _intensity );
+	value->Release();
+	SetNodeConfigDirty( _valueId.GetNodeId() );
+
+	// The new intensity takes effect when the value is next rescheduled
+	vector<PollEntry>::iterator it = FindPollEntry( _valueId );
+	if( it != m_pollHeap.end() )
+	{
+		it->m_intensity = _intensity;
+	}
+
+	m_pollMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SetPollPeriod>
+// Set the time between polls of this value
+//-----------------------------------------------------------------------------
+bool Driver::SetPollPeriod
+(
+		ValueID const &_valueId,
+		uint32 const _milliseconds
+)
+{
+	// make sure the polling thread doesn't lock the value while we're in this function
+	m_pollMutex->Lock();
+	LockGuard LG(m_nodeMutex);
 
+	Value* value = GetValue( _valueId );
+	if( !value )
+	{
+		m_pollMutex->Unlock();
+		Log::Write( LogLevel_Info, _valueId.GetNodeId(), "SetPollPeriod failed - value not found" );
+		return false;
+	}
+	value->SetPollPeriod( _milliseconds );
 	value->Release();
+	SetNodeConfigDirty( _valueId.GetNodeId() );
+
+	// If the value is already scheduled, count the new period from now so
+	// that a shorter period takes effect straight away
+	vector<PollEntry>::iterator it = FindPollEntry( _valueId );
+	if( it != m_pollHeap.end() )
+	{
+		PollEntry pe = *it;
+		pe.m_period = _milliseconds;
+		m_pollHeap.erase( it );
+		make_heap( m_pollHeap.begin(), m_pollHeap.end(), PollEntryLater() );
+
+		TimeStamp now;
+		SchedulePoll( pe, now.GetAsMilliseconds() );
+	}
+
+	m_pollMutex->Unlock();
+	m_pollEvent->Set();
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetPollSchedule>
+// Return the polled values, ordered by the time of their next poll
+//-----------------------------------------------------------------------------
+void Driver::GetPollSchedule
+(
+		vector<PollScheduleEntry>* o_schedule
+)
+{
+	o_schedule->clear();
+
+	m_pollMutex->Lock();
+	vector<PollEntry> entries = m_pollHeap;
+	uint32 count = (uint32)m_pollHeap.size();
 	m_pollMutex->Unlock();
+
+	// sort_heap leaves the latest deadline first, so walk the entries backwards
+	sort_heap( entries.begin(), entries.end(), PollEntryLater() );
+
+	TimeStamp now;
+	int64 nowMs = (int64)now.GetAsMilliseconds();
+	o_schedule->reserve( entries.size() );
+	for( vector<PollEntry>::reverse_iterator it = entries.rbegin(); it != entries.rend(); ++it )
+	{
+		PollScheduleEntry se;
+		se.m_id = it->m_id;
+		se.m_period = GetPollPeriod( *it, count );
+		se.m_effectivePeriod = GetEffectivePollPeriod( *it, count );
+		se.m_dueIn = (int32)( (int64)it->m_due - nowMs );
+		se.m_polls = it->m_polls;
+		se.m_skipped = it->m_skipped;
+		o_schedule->push_back( se );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::FindPollEntry>
+// Find a value in the poll heap.  The caller must hold m_pollMutex.
+//-----------------------------------------------------------------------------
+vector<Driver::PollEntry>::iterator Driver::FindPollEntry
+(
+		ValueID const& _valueId
+)
+{
+	vector<PollEntry>::iterator it = m_pollHeap.begin();
+	for( ; it != m_pollHeap.end(); ++it )
+	{
+		if( it->m_id == _valueId )
+		{
+			break;
+		}
+	}
+	return it;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetPollPeriod>
+// Work out the time between polls of a value
+//-----------------------------------------------------------------------------
+uint32 Driver::GetPollPeriod
+(
+		PollEntry const& _entry,
+		uint32 const _count
+)
+{
+	if( _entry.m_period != 0 )
+	{
+		return _entry.m_period;
+	}
+
+	// No explicit period, so derive one from the intensity in the same way as the
+	// old round-robin list: an intensity of n polls the value every nth pass.
+	int32 interval = m_pollInterval;
+	if( interval < 0 )
+	{
+		interval = 0;
+	}
+
+	uint32 pass;
+	if( m_bIntervalBetweenPolls )
+	{
+		// m_pollInterval separates each poll, so one pass takes an interval per value
+		pass = (uint32)interval * ( _count ? _count : 1 );
+	}
+	else
+	{
+		if( interval < 100 )
+		{
+			// Legacy setting in seconds
+			interval *= 1000;
+		}
+		pass = (uint32)interval;
+	}
+
+	// A zero period would spin the poll thread on a node that keeps being skipped
+	uint32 period = pass * ( _entry.m_intensity ? _entry.m_intensity : 1 );
+	return( period ? period : 100 );
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetEffectivePollPeriod>
+// Work out the time between polls of a value once throttling is applied
+//-----------------------------------------------------------------------------
+uint32 Driver::GetEffectivePollPeriod
+(
+		PollEntry const& _entry,
+		uint32 const _count
+)
+{
+	uint64 period = GetPollPeriod( _entry, _count );
+	if( m_pollPolicy == PollPolicy_Adaptive )
+	{
+		period = ( period * m_pollScale / 100 ) * _entry.m_backoff;
+		if( period > 0xffffffff )
+		{
+			period = 0xffffffff;
+		}
+	}
+	return (uint32)period;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::UpdatePollLoad>
+// Estimate the share of network time the poll schedule needs and, for the
+// adaptive policy, how much the periods must be stretched to stay within
+// m_pollLoadTarget.  The caller must hold m_pollMutex.
+//-----------------------------------------------------------------------------
+void Driver::UpdatePollLoad
+(
+)
+{
+	// Sum of cost/period over all the values, in thousandths of a percent
+	uint64 load = 0;
+	uint32 count = (uint32)m_pollHeap.size();
+	for( vector<PollEntry>::iterator it = m_pollHeap.begin(); it != m_pollHeap.end(); ++it )
+	{
+		load += ( (uint64)it->m_cost * 100000 ) / GetPollPeriod( *it, count );
+	}
+
+	m_pollLoad = (uint32)( load / 1000 );
+
+	uint32 scale = 100;
+	if( m_pollPolicy == PollPolicy_Adaptive && load > (uint64)m_pollLoadTarget * 1000 )
+	{
+		scale = (uint32)( load / ( (uint64)m_pollLoadTarget * 10 ) );
+	}
+
+	if( scale != m_pollScale )
+	{
+		Log::Write( LogLevel_Info, "Polling: schedule needs %d%% of the network, poll periods are now %d%% of their setting", m_pollLoad, scale );
+		m_pollScale = scale;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::SchedulePoll>
+// Put a value back on the poll heap, due one period from now.  The caller must
+// hold m_pollMutex.
+//-----------------------------------------------------------------------------
+void Driver::SchedulePoll
+(
+		PollEntry& _entry,
+		uint64 const _now
+)
+{
+	_entry.m_due = _now + GetEffectivePollPeriod( _entry, (uint32)m_pollHeap.size() + 1 );
+	m_pollHeap.push_back( _entry );
+	push_heap( m_pollHeap.begin(), m_pollHeap.end(), PollEntryLater() );
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::PollValue>
+// Request the state of a polled value from its node, unless the node is
+// asleep, dead or already has messages waiting to be sent to it
+//-----------------------------------------------------------------------------
+Driver::PollResult Driver::PollValue
+(
+		PollEntry& _entry
+)
+{
+	ValueID const& valueId = _entry.m_id;
+	uint8 nodeId = valueId.GetNodeId();
+
+	LockGuard LG(m_nodeMutex);
+	Node* node = GetNode( nodeId );
+	Value* value = ( node != NULL ) ? node->GetValue( valueId ) : NULL;
+	if( value == NULL )
+	{
+		Log::Write( LogLevel_Info, nodeId, "Polling: value(cc=0x%02x,in=0x%02x,id=0x%02x) no longer exists, removing it from the poll list",
+				valueId.GetCommandClassId(), valueId.GetIndex(), valueId.GetInstance() );
+		return PollResult_Removed;
+	}
+	value->Release();
+
+	// Estimate how long a poll of this node occupies the network.  Each failed
+	// message is counted as four round trips, to allow for retries and timeouts.
+	uint32 rtt = node->m_averageResponseRTT ? node->m_averageResponseRTT : node->m_averageRequestRTT;
+	if( rtt == 0 )
+	{
+		rtt = 100;
+	}
+	_entry.m_cost = node->m_sentCnt ? (uint32)( ( (uint64)rtt * ( node->m_sentCnt + 4 * node->m_sentFailed ) ) / node->m_sentCnt ) : rtt;
+
+	if( !node->IsListeningDevice() )
+	{
+		// The device is not awake all the time.  If it is not awake, we mark it
+		// as requiring a poll.  The poll will be done next time the node wakes up.
+		if( WakeUp* wakeUp = static_cast<WakeUp*>( node->GetCommandClass( WakeUp::StaticGetCommandClassId() ) ) )
+		{
+			if( !wakeUp->IsAwake() )
+			{
+				wakeUp->SetPollRequired();
+				_entry.m_skipped++;
+				return PollResult_Skipped;
+			}
+		}
+	}
+
+	if( !node->IsNodeAlive() )
+	{
+		// Polls to a dead node only hold up the rest of the queue
+		_entry.m_skipped++;
+		return PollResult_Skipped;
+	}
+
+	// If messages for this node are still waiting to be sent, another poll would
+	// only add to its backlog, so leave it until the next period
+	bool backlog = false;
+	m_sendMutex->Lock();
+	for( int32 i=0; i<MsgQueue_Count && !backlog; ++i )
+	{
+		for( MsgQueueItem* it = m_msgQueue[i].Front(); it != NULL; it = it->m_next )
+		{
+			if( ( MsgQueueCmd_SendMsg == it->m_command ) && ( it->m_msg->GetTargetNodeId() == nodeId ) )
+			{
+				backlog = true;
+				break;
+			}
+		}
+	}
+	m_sendMutex->Unlock();
+
+	if( backlog )
+	{
+		Log::Write( LogLevel_Detail, nodeId, "Polling: skipping value(cc=0x%02x,in=0x%02x,id=0x%02x), messages for the node are still queued",
+				valueId.GetCommandClassId(), valueId.GetIndex(), valueId.GetInstance() );
+		_entry.m_skipped++;
+		return PollResult_Skipped;
+	}
+
+	// Request an update of the value
+	CommandClass* cc = node->GetCommandClass( valueId.GetCommandClassId() );
+	if( cc == NULL )
+	{
+		_entry.m_skipped++;
+		return PollResult_Skipped;
+	}
+
+	if( m_pollPolicy == PollPolicy_Adaptive )
+	{
+		// Back off from a node that has failed messages since its last poll,
+		// and return to the full rate once it responds again
+		if( _entry.m_polls && node->m_sentFailed > _entry.m_failed )
+		{
+			if( _entry.m_backoff < 8 )
+			{
+				_entry.m_backoff <<= 1;
+			}
+		}
+		else
+		{
+			_entry.m_backoff = 1;
+		}
+	}
+	_entry.m_failed = node->m_sentFailed;
+
+	uint8 index = valueId.GetIndex();
+	uint8 instance = valueId.GetInstance();
+	Log::Write( LogLevel_Detail, nodeId, "Polling: %s index = %d instance = %d (poll queue has %d messages)", cc->GetCommandClassName().c_str(), index, instance, m_msgQueue[MsgQueue_Poll].Size() );
+	cc->RequestValue( 0, index, instance, MsgQueue_Poll );
+	_entry.m_polls++;
+	return PollResult_Sent;
 }
 
 //-----------------------------------------------------------------------------
@@ -3994,145 +5434,144 @@ void Driver::PollThreadEntryPoint
 }
 
 //-----------------------------------------------------------------------------
-// <Driver::PollThreadProc>
-// Thread for poll Z-Wave devices
+// <Driver::PollThreadProc>
+// Thread for poll Z-Wave devices
+//-----------------------------------------------------------------------------
+void Driver::PollThreadProc
+(
+		Event* _exitEvent
+)
+{
+	Wait* waitObjects[2];
+	waitObjects[0] = _exitEvent;		// Thread must exit.
+	waitObjects[1] = m_pollEvent;		// The poll schedule has changed.
+
+	while( 1 )
+	{
+		bool onSchedule;
+		int32 timeout = PollStep( &onSchedule );
+		if( timeout == 0 )
+		{
+			continue;
+		}
+
+		// Wait for the next deadline, a change to the schedule (unless a poll is
+		// still on its way out), or exit
+		if( Wait::Multiple( waitObjects, onSchedule ? 2 : 1, timeout ) == 0 )
+		{
+			// Exit has been called
+			return;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::PollStep>
+// Send the next poll if it is due.  Returns the milliseconds until the next
+// call, zero to call again at once, or Wait::Timeout_Infinite if nothing is
+// scheduled.  _onSchedule is set if a change to the schedule (m_pollEvent)
+// should bring the next call forward.
 //-----------------------------------------------------------------------------
-void Driver::PollThreadProc
+int32 Driver::PollStep
 (
-		Event* _exitEvent
+		bool* _onSchedule
 )
 {
-	while( 1 )
+	*_onSchedule = false;
+
+	if( m_pollDraining )
 	{
-		int32 pollInterval = m_pollInterval;
+		// Polling messages are only sent when there are no other messages waiting to be sent.
+		// The poll queue has the lowest priority, so wait for our request to leave it before
+		// queuing the next one.
+		if( !m_msgQueue[MsgQueue_Poll].Empty()
+				|| ( m_currentMsg != NULL && m_currentMsgQueueSource == MsgQueue_Poll ) )
+		{
+			if( !m_pollDrainWarned && m_pollDrainStart.TimeRemaining() <= -300000 )		// 300 seconds worth of delay?  Something unusual is going on
+			{
+				Log::Write( LogLevel_Warning, "Poll queue hasn't been able to execute for 300 secs or more" );
+				Log::QueueDump();
+				m_pollDrainWarned = true;
+			}
+			return 10;		// test conditions every 10ms
+		}
 
-		if( m_awakeNodesQueried && !m_pollList.empty() )
+		m_pollDraining = false;
+		if( m_bIntervalBetweenPolls )
 		{
-			// We only bother getting the lock if the pollList is not empty
-			m_pollMutex->Lock();
+			// insert the pollInterval delay before the next poll
+			m_pollResume.SetTime( m_pollInterval );
+		}
+	}
 
-			// Get the next value to be polled
-			PollEntry pe = m_pollList.front();
-			m_pollList.pop_front();
-			ValueID  valueId = pe.m_id;
+	int32 resume = m_pollResume.TimeRemaining();
+	if( resume > 0 )
+	{
+		return resume;
+	}
 
-			// only execute this poll if pe.m_pollCounter == 1; otherwise decrement the counter and process the next polled value
-			if( pe.m_pollCounter != 1)
-			{
-				pe.m_pollCounter--;
-				m_pollList.push_back( pe );
-				m_pollMutex->Unlock();
-				continue;
-			}
+	*_onSchedule = true;
 
-			// reset the poll counter to the full pollIntensity value and push it at the end of the list
-			// release the value object referenced; call GetNode to ensure the node objects are locked during this period
-			{
-				LockGuard LG(m_nodeMutex);
-				(void)GetNode( valueId.GetNodeId() );
-				Value* value = GetValue( valueId );
-				if (!value)
-					continue;
-				pe.m_pollCounter = value->GetPollIntensity();
-				m_pollList.push_back( pe );
-				value->Release();
-			}
-			// If the polling interval is for the whole poll list, calculate the time before the next poll,
-			// so that all polls can take place within the user-specified interval.
-			if( !m_bIntervalBetweenPolls )
-			{
-				if( pollInterval < 100 )
-				{
-					Log::Write( LogLevel_Info, "The pollInterval setting is only %d, which appears to be a legacy setting.  Multiplying by 1000 to convert to ms.", pollInterval );
-					pollInterval *= 1000;
-				}
-				pollInterval /= (int32) m_pollList.size();
-			}
+	// Don't poll until the awake nodes have been queried, but check again every half second
+	m_pollEvent->Reset();
+	if( !m_awakeNodesQueried )
+	{
+		return 500;
+	}
 
-			{
-				LockGuard LG(m_nodeMutex);
-				// Request the state of the value from the node to which it belongs
-				if( Node* node = GetNode( valueId.GetNodeId() ) )
-				{
-					bool requestState = true;
-					if( !node->IsListeningDevice() )
-					{
-						// The device is not awake all the time.  If it is not awake, we mark it
-						// as requiring a poll.  The poll will be done next time the node wakes up.
-						if( WakeUp* wakeUp = static_cast<WakeUp*>( node->GetCommandClass( WakeUp::StaticGetCommandClassId() ) ) )
-						{
-							if( !wakeUp->IsAwake() )
-							{
-								wakeUp->SetPollRequired();
-								requestState = false;
-							}
-						}
-					}
+	LockGuard LG( m_pollMutex );
+	if( m_pollHeap.empty() )
+	{
+		return Wait::Timeout_Infinite;
+	}
 
-					if( requestState )
-					{
-						// Request an update of the value
-						CommandClass* cc = node->GetCommandClass( valueId.GetCommandClassId() );
-						if (cc) {
-							uint8 index = valueId.GetIndex();
-							uint8 instance = valueId.GetInstance();
-							Log::Write( LogLevel_Detail, node->m_nodeId, "Polling: %s index = %d instance = %d (poll queue has %d messages)", cc->GetCommandClassName().c_str(), index, instance, m_msgQueue[MsgQueue_Poll].size() );
-							cc->RequestValue( 0, index, instance, MsgQueue_Poll );
-						}
-					}
+	TimeStamp now;
+	uint64 nowMs = now.GetAsMilliseconds();
+	uint64 due = m_pollHeap.front().m_due;
+	if( due > nowMs )
+	{
+		// Nothing is due yet, so sleep until the earliest deadline
+		return ( due - nowMs > 0x7fffffff ) ? 0x7fffffff : (int32)( due - nowMs );
+	}
+	if( m_pollPolicy == PollPolicy_Adaptive && GetSendQueueCount() > m_pollQueueLimit )
+	{
+		// The network is backed up, so hold the polls until the queues drain
+		return 100;
+	}
 
-				}
-			}
+	// Take the value with the earliest deadline off the heap
+	pop_heap( m_pollHeap.begin(), m_pollHeap.end(), PollEntryLater() );
+	PollEntry pe = m_pollHeap.back();
+	m_pollHeap.pop_back();
 
-			m_pollMutex->Unlock();
+	PollResult result = PollValue( pe );
+	if( result != PollResult_Removed )
+	{
+		SchedulePoll( pe, nowMs );
+	}
+	UpdatePollLoad();
 
-			// Polling messages are only sent when there are no other messages waiting to be sent
-			// While this makes the polls much more variable and uncertain if some other activity dominates
-			// a send queue, that may be appropriate
-			// TODO we can have a debate about whether to test all four queues or just the Poll queue
-			// Wait until the library isn't actively sending messages (or in the midst of a transaction)
-			int i32;
-			int loopCount = 0;
-			while( !m_msgQueue[MsgQueue_Poll].empty()
-					|| !m_msgQueue[MsgQueue_Send].empty()
-					|| !m_msgQueue[MsgQueue_Command].empty()
-					|| !m_msgQueue[MsgQueue_Query].empty()
-					|| m_currentMsg != NULL )
-			{
-				i32 = Wait::Single( _exitEvent, 10);		// test conditions every 10ms
-				if( i32 == 0 )
-				{
-					// Exit has been called
-					return;
-				}
-				loopCount++;
-				if( loopCount == 3000*10 )		// 300 seconds worth of delay?  Something unusual is going on
-				{
-					Log::Write( LogLevel_Warning, "Poll queue hasn't been able to execute for 300 secs or more" );
-					Log::QueueDump();
-					//					assert( 0 );
-				}
-			}
+	if( result == PollResult_Sent )
+	{
+		m_pollCnt++;
+		m_pollRateCnt++;
+		m_pollDraining = true;
+		m_pollDrainWarned = false;
+		m_pollDrainStart.SetTime();
+	}
+	else if( result == PollResult_Skipped )
+	{
+		m_pollSkipped++;
+	}
 
-			// ready for next poll...insert the pollInterval delay
-			i32 = Wait::Single( _exitEvent, pollInterval );
-			if( i32 == 0 )
-			{
-				// Exit has been called
-				return;
-			}
-		}
-		else		// poll list is empty or awake nodes haven't been fully queried yet
-		{
-			// don't poll just yet, wait for the pollInterval or exit before re-checking to see if the pollList has elements
-			int32 i32 = Wait::Single( _exitEvent, 500 );
-			if( i32 == 0 )
-			{
-				// Exit has been called
-				return;
-			}
-		}
+	int32 elapsed = -m_pollRateStart.TimeRemaining();
+	if( elapsed >= 60000 || elapsed < 0 )
+	{
+		m_pollRate = m_pollRateCnt;
+		m_pollRateCnt = 0;
+		m_pollRateStart.SetTime();
 	}
+	return 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -4812,8 +6251,7 @@ bool Driver::BeginControllerCommand
 	item.m_cci = cci;
 
 	m_sendMutex->Lock();
-	m_msgQueue[MsgQueue_Controller].push_back( item );
-	m_queueEvent[MsgQueue_Controller]->Set();
+	QueueItem( MsgQueue_Controller, item );
 	m_sendMutex->Unlock();
 
 	return true;
@@ -5501,6 +6939,45 @@ void Driver::QueueNotification
 		Notification* _notification
 )
 {
+	switch( _notification->GetType() )
+	{
+		case Notification::Type_ValueRefreshed:
+		case Notification::Type_NodeEvent:
+		case Notification::Type_SceneEvent:
+		case Notification::Type_ButtonOn:
+		case Notification::Type_ButtonOff:
+		case Notification::Type_Notification:
+		{
+			// Nothing that is saved has changed
+			break;
+		}
+		case Notification::Type_AwakeNodesQueried:
+		case Notification::Type_AllNodesQueried:
+		case Notification::Type_AllNodesQueriedSomeDead:
+		{
+			// A good time to save what the queries found
+			if( m_saveEvent != NULL )
+			{
+				m_saveEvent->Set();
+			}
+			break;
+		}
+		default:
+		{
+			if( uint8 nodeId = _notification->GetNodeId() )
+			{
+				SetNodeConfigDirty( nodeId );
+			}
+			break;
+		}
+	}
+
+	if( m_bDebounce && DebounceNotification( _notification ) )
+	{
+		return;
+	}
+
+	_notification->SetQueuedTime( GetElapsed() );
 	m_notifications.push_back( _notification );
 	m_notificationsEvent->Set();
 }
@@ -5525,7 +7002,9 @@ void Driver::NotifyWatchers
 			case Notification::Type_ValueRemoved:
 			case Notification::Type_ValueChanged:
 			case Notification::Type_ValueRefreshed:
-				if (!GetValue(notification->GetValueID())) {
+				if( Value* value = GetValue( notification->GetValueID() ) ) {
+					value->Release();
+				} else {
 					Log::Write(LogLevel_Info, notification->GetNodeId(), "Dropping Notification as ValueID does not exist");
 					nit = m_notifications.begin();
 					delete notification;
@@ -5537,6 +7016,7 @@ void Driver::NotifyWatchers
 		}
 
 		Manager::Get()->NotifyWatchers( notification );
+		m_notificationLatencies.Record( GetElapsedSince( notification->GetQueuedTime() ) );
 
 		delete notification;
 		nit = m_notifications.begin();
@@ -5544,6 +7024,195 @@ void Driver::NotifyWatchers
 	m_notificationsEvent->Reset();
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::ReadDebounceOptions>
+// Work out the debounce window for each command class
+//-----------------------------------------------------------------------------
+void Driver::ReadDebounceOptions
+(
+)
+{
+	int32 window = 0;
+	Options::Get()->GetOptionAsInt( "ValueChangeDebounce", &window );
+	if( window < 0 )
+	{
+		Log::Write( LogLevel_Warning, "ValueChangeDebounce of %d is out of range, using 0", window );
+		window = 0;
+	}
+	for( int32 i=0; i<256; ++i )
+	{
+		m_debounceWindow[i] = (uint32)window;
+	}
+
+	// Overrides for individual command classes, as a list of
+	// class=window pairs, such as "0x32=2000,0x31=1000"
+	string classes;
+	Options::Get()->GetOptionAsString( "ValueChangeDebounceClasses", &classes );
+	size_t pos = 0;
+	while( pos < classes.size() )
+	{
+		size_t end = classes.find( ',', pos );
+		if( end == string::npos )
+		{
+			end = classes.size();
+		}
+		string entry = classes.substr( pos, end-pos );
+		entry.erase( remove( entry.begin(), entry.end(), ' ' ), entry.end() );
+		pos = end + 1;
+		if( entry.empty() )
+		{
+			continue;
+		}
+
+		char* next = NULL;
+		long commandClassId = strtol( entry.c_str(), &next, 0 );
+		while( *next == ' ' )
+		{
+			++next;
+		}
+		if( ( *next != '=' ) || ( commandClassId < 0 ) || ( commandClassId > 255 ) )
+		{
+			Log::Write( LogLevel_Warning, "Ignoring ValueChangeDebounceClasses entry '%s'", entry.c_str() );
+			continue;
+		}
+		long classWindow = strtol( next+1, NULL, 0 );
+		m_debounceWindow[commandClassId] = classWindow > 0 ? (uint32)classWindow : 0;
+	}
+
+	m_bDebounce = false;
+	for( int32 i=0; i<256; ++i )
+	{
+		if( m_debounceWindow[i] != 0 )
+		{
+			m_bDebounce = true;
+			break;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::DebounceNotification>
+// Hold back a value update that arrives within its debounce window.  The
+// first update for a value is sent straight away and opens the window.  Any
+// more that arrive before the window ends replace each other, and the last
+// of them is sent when it ends.
+//-----------------------------------------------------------------------------
+bool Driver::DebounceNotification
+(
+		Notification* _notification
+)
+{
+	Notification::NotificationType type = _notification->GetType();
+	if( ( type != Notification::Type_ValueChanged ) && ( type != Notification::Type_ValueRefreshed ) )
+	{
+		return false;
+	}
+
+	ValueID const& valueId = _notification->GetValueID();
+	uint32 window = m_debounceWindow[valueId.GetCommandClassId()];
+	if( window == 0 )
+	{
+		return false;
+	}
+
+	map<ValueID,DebouncedValue>::iterator it = m_debouncedValues.find( valueId );
+	if( ( it == m_debouncedValues.end() ) || ( it->second.m_windowEnd.TimeRemaining() <= 0 ) )
+	{
+		// Send this one, and open a new window.  An update still held back
+		// from a window that has just ended goes first.
+		DebouncedValue& debounced = m_debouncedValues[valueId];
+		if( debounced.m_pending != NULL )
+		{
+			debounced.m_pending->SetSuppressedCount( debounced.m_suppressed );
+			debounced.m_pending->SetQueuedTime( GetElapsed() );
+			m_notifications.push_back( debounced.m_pending );
+		}
+		debounced.m_windowEnd.SetTime( window );
+		debounced.m_pending = NULL;
+		debounced.m_suppressed = 0;
+		return false;
+	}
+
+	// Inside the window - replace any update already held back
+	DebouncedValue& debounced = it->second;
+	if( debounced.m_pending != NULL )
+	{
+		// A change must not be hidden by a later refresh of the same value
+		if( debounced.m_pending->GetType() == Notification::Type_ValueChanged )
+		{
+			_notification->SetType( Notification::Type_ValueChanged );
+		}
+		delete debounced.m_pending;
+		debounced.m_suppressed++;
+		m_debounced++;
+	}
+	debounced.m_pending = _notification;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::FlushDebouncedNotifications>
+// Send the value updates whose debounce windows have ended
+//-----------------------------------------------------------------------------
+void Driver::FlushDebouncedNotifications
+(
+)
+{
+	map<ValueID,DebouncedValue>::iterator it = m_debouncedValues.begin();
+	while( it != m_debouncedValues.end() )
+	{
+		DebouncedValue& debounced = it->second;
+		if( debounced.m_windowEnd.TimeRemaining() > 0 )
+		{
+			++it;
+			continue;
+		}
+
+		if( debounced.m_pending == NULL )
+		{
+			// Nothing arrived during the window
+			m_debouncedValues.erase( it++ );
+			continue;
+		}
+
+		// Send the latest update, and open a new window after it
+		Notification* notification = debounced.m_pending;
+		notification->SetSuppressedCount( debounced.m_suppressed );
+		notification->SetQueuedTime( GetElapsed() );
+		m_notifications.push_back( notification );
+		m_notificationsEvent->Set();
+
+		debounced.m_pending = NULL;
+		debounced.m_suppressed = 0;
+		debounced.m_windowEnd.SetTime( m_debounceWindow[it->first.GetCommandClassId()] );
+		++it;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetDebounceTimeout>
+// Time until the next debounce window ends
+//-----------------------------------------------------------------------------
+int32 Driver::GetDebounceTimeout
+(
+)
+{
+	int32 timeout = Wait::Timeout_Infinite;
+	for( map<ValueID,DebouncedValue>::iterator it = m_debouncedValues.begin(); it != m_debouncedValues.end(); ++it )
+	{
+		int32 remaining = it->second.m_windowEnd.TimeRemaining();
+		if( remaining < 0 )
+		{
+			remaining = 0;
+		}
+		if( ( timeout == Wait::Timeout_Infinite ) || ( remaining < timeout ) )
+		{
+			timeout = remaining;
+		}
+	}
+	return timeout;
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::HandleRfPowerLevelSetResponse>
 // Process a response from the Z-Wave PC interface
@@ -6215,6 +7884,94 @@ void Driver::GetDriverStatistics
 	_data->m_routedbusy = m_routedbusy;
 	_data->m_broadcastReadCnt = m_broadcastReadCnt;
 	_data->m_broadcastWriteCnt = m_broadcastWriteCnt;
+	_data->m_coalesced = m_coalesced;
+	_data->m_debounced = m_debounced;
+	_data->m_pollCnt = m_pollCnt;
+	_data->m_pollSkipped = m_pollSkipped;
+	_data->m_pollRate = m_pollRate;
+	_data->m_pollLoad = m_pollLoad;
+	_data->m_pollScale = m_pollScale;
+	_data->m_interviewActive = m_interviewCount;
+	_data->m_interviewWaiting = (uint32)m_interviewWaiting.size();
+	_data->m_awakeNodesQueriedTime = m_awakeNodesQueriedTime;
+	_data->m_allNodesQueriedTime = m_allNodesQueriedTime;
+
+	Controller::ReadStatistics readStats;
+	m_controller->GetReadStatistics( &readStats );
+	_data->m_controllerReads = readStats.m_reads;
+	_data->m_controllerReadBytes = readStats.m_bytes;
+	_data->m_controllerWakeups = readStats.m_wakeups;
+	_data->m_controllerLatencyAvg = readStats.m_latencyAvg;
+	_data->m_controllerLatencyMax = readStats.m_latencyMax;
+	_data->m_controllerBufferSize = m_controller->GetBufferSize();
+	_data->m_controllerBufferHighWater = m_controller->GetHighWater();
+	_data->m_controllerOverflowBytes = m_controller->GetOverflowBytes();
+	m_requestRTTs.GetSummary( &_data->m_requestRTTs );
+	m_responseRTTs.GetSummary( &_data->m_responseRTTs );
+	m_ackLatencies.GetSummary( &_data->m_ackLatencies );
+	GetQueueStatistics( _data->m_queues );
+	m_notificationLatencies.GetSummary( &_data->m_notificationLatencies );
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetQueueStatistics>
+// Return the statistics for each send queue
+//-----------------------------------------------------------------------------
+void Driver::GetQueueStatistics
+(
+		QueueData* _data
+)
+{
+	m_sendMutex->Lock();
+	for( int32 i=0; i<MsgQueue_Count; ++i )
+	{
+		QueueStatistics const& stats = m_queueStats[i];
+		QueueData& data = _data[i];
+		data.m_depth = m_msgQueue[i].Size();
+		data.m_maxDepth = stats.m_maxDepth;
+		stats.m_waits.GetSummary( &data.m_wait );
+		data.m_sent = stats.m_sent;
+		data.m_retried = stats.m_retried;
+		data.m_dropped = stats.m_dropped;
+		data.m_coalesced = stats.m_coalesced;
+		data.m_blockedAck = stats.m_blockedAck;
+		data.m_blockedCallback = stats.m_blockedCallback;
+		data.m_blockedReply = stats.m_blockedReply;
+	}
+	m_sendMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::ChargeBlockedTime>
+// Add the time since the last call to the queue whose message the driver
+// is waiting on, if any.  Called each time the driver loop wakes, so the
+// flags it looks at have not changed since it was last called.
+//-----------------------------------------------------------------------------
+void Driver::ChargeBlockedTime
+(
+)
+{
+	uint32 now = GetElapsed();
+	int32 elapsed = (int32)( now - m_blockedSince );
+	m_blockedSince = now;
+	if( elapsed <= 0 )
+	{
+		return;
+	}
+
+	QueueStatistics& stats = m_queueStats[m_currentMsgQueueSource];
+	if( m_waitingForAck )
+	{
+		stats.m_blockedAck += elapsed;
+	}
+	else if( m_expectedCallbackId )
+	{
+		stats.m_blockedCallback += elapsed;
+	}
+	else if( m_expectedReply )
+	{
+		stats.m_blockedReply += elapsed;
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -6235,6 +7992,67 @@ void Driver::GetNodeStatistics
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::GetNodeMetrics>
+// Fill in the metrics of each node, up to _max of them.  Returns the number
+// filled in.
+//-----------------------------------------------------------------------------
+uint32 Driver::GetNodeMetrics
+(
+		Node::NodeMetrics* _data,
+		uint32 const _max
+)
+{
+	uint32 count = 0;
+	LockGuard LG(m_nodeMutex);
+	for( int32 i=0; ( i<256 ) && ( count<_max ); ++i )
+	{
+		if( m_nodes[i] != NULL )
+		{
+			m_nodes[i]->GetNodeMetrics( &_data[count++] );
+		}
+	}
+	return count;
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetQueueName>
+// Name of a send queue, as used in the log
+//-----------------------------------------------------------------------------
+char const* Driver::GetQueueName
+(
+		MsgQueue const _queue
+)
+{
+	return c_sendQueueNames[_queue];
+}
+
+//-----------------------------------------------------------------------------
+// <Driver::GetElapsedSince>
+// ms since a time taken with GetElapsed.  A clock stepped backwards gives 0.
+//-----------------------------------------------------------------------------
+uint32 Driver::GetElapsedSince
+(
+		uint32 const _time
+)
+{
+	int32 elapsed = (int32)( GetElapsed() - _time );
+	return ( elapsed > 0 ) ? (uint32)elapsed : 0;
+}
+
+//-----------------------------------------------------------------------------
+// <LogLatencies>
+// Write one line of latency percentiles to the log
+//-----------------------------------------------------------------------------
+static void LogLatencies
+(
+		char const* _label,
+		LatencyHistogram::Summary const& _summary
+)
+{
+	Log::Write( LogLevel_Always, "%-36s %9d %8d %8d %8d %8d %8d", _label, _summary.m_count, _summary.m_avg, _summary.m_p50, _summary.m_p90, _summary.m_p99, _summary.m_max );
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::LogDriverStatistics>
 // Report driver statistics to the driver's log
@@ -6263,6 +8081,30 @@ void Driver::LogDriverStatistics
 	Log::Write( LogLevel_Always, "Total messages successfully received: . . . . . . . . . . %ld", data.m_readCnt );
 	Log::Write( LogLevel_Always, "Total Messages successfully sent: . . . . . . . . . . . . %ld", data.m_writeCnt );
 	Log::Write( LogLevel_Always, "ACKs received from controller:  . . . . . . . . . . . . . %ld", data.m_ACKCnt );
+	Log::Write( LogLevel_Always, "*** Polling" );
+	Log::Write( LogLevel_Always, "Polls sent: . . . . . . . . . . . . . . . . . . . . . . . %ld", data.m_pollCnt );
+	Log::Write( LogLevel_Always, "Polls skipped (node asleep, busy or not responding):  . . %ld", data.m_pollSkipped );
+	Log::Write( LogLevel_Always, "Polls sent during the last minute:  . . . . . . . . . . . %ld", data.m_pollRate );
+	Log::Write( LogLevel_Always, "Network time needed by the poll schedule (%%): . . . . . . %ld", data.m_pollLoad );
+	Log::Write( LogLevel_Always, "Poll periods stretched to (%% of setting):  . . . . . . . %ld", data.m_pollScale );
+	Log::Write( LogLevel_Always, "*** Node queries" );
+	Log::Write( LogLevel_Always, "Time until all awake nodes were queried (ms):  . . . . . %ld", data.m_awakeNodesQueriedTime );
+	Log::Write( LogLevel_Always, "Time until all nodes were queried (ms): . . . . . . . . . %ld", data.m_allNodesQueriedTime );
+	Log::Write( LogLevel_Always, "*** Controller reads" );
+	Log::Write( LogLevel_Always, "Reads that returned data: . . . . . . . . . . . . . . . . %ld", data.m_controllerReads );
+	Log::Write( LogLevel_Always, "Bytes received: . . . . . . . . . . . . . . . . . . . . . %ld", data.m_controllerReadBytes );
+	Log::Write( LogLevel_Always, "Read path wakeups:  . . . . . . . . . . . . . . . . . . . %ld", data.m_controllerWakeups );
+	Log::Write( LogLevel_Always, "Average wait for received data to be read (ms): . . . . . %ld", data.m_controllerLatencyAvg );
+	Log::Write( LogLevel_Always, "Longest wait for received data to be read (ms): . . . . . %ld", data.m_controllerLatencyMax );
+	Log::Write( LogLevel_Always, "Receive buffer size:  . . . . . . . . . . . . . . . . . . %ld", data.m_controllerBufferSize );
+	Log::Write( LogLevel_Always, "Most data held in the receive buffer: . . . . . . . . . . %ld", data.m_controllerBufferHighWater );
+	Log::Write( LogLevel_Always, "Bytes dropped because the receive buffer was full:  . . . %ld", data.m_controllerOverflowBytes );
+	Log::Write( LogLevel_Always, "*** Latencies (ms)                       count      avg      p50      p90      p99      max" );
+	LogLatencies( "Request RTT", data.m_requestRTTs );
+	LogLatencies( "Response RTT", data.m_responseRTTs );
+	LogLatencies( "ACK", data.m_ackLatencies );
+	LogLatencies( "Notification delivery", data.m_notificationLatencies );
+	LogQueueStatistics();
 	// Consider tracking and adding:
 	//		Initialization messages
 	//		Ad-hoc command messages
@@ -6278,9 +8120,31 @@ void Driver::LogDriverStatistics
 	Log::Write( LogLevel_Always, "Out of frame data flow errors:  . . . . . . . . . . . . . %ld", data.m_OOFCnt );
 	Log::Write( LogLevel_Always, "Messages retransmitted: . . . . . . . . . . . . . . . . . %ld", data.m_retries );
 	Log::Write( LogLevel_Always, "Messages dropped and not delivered: . . . . . . . . . . . %ld", data.m_dropped );
+	Log::Write( LogLevel_Always, "Queued messages replaced by a duplicate or newer request: %ld", data.m_coalesced );
+	Log::Write( LogLevel_Always, "Value notifications replaced by a later one in the debounce window: %ld", data.m_debounced );
 	Log::Write( LogLevel_Always, "***************************************************************************" );
 }
 
+//-----------------------------------------------------------------------------
+// <Driver::LogQueueStatistics>
+// Report the send queue statistics to the driver's log
+//-----------------------------------------------------------------------------
+void Driver::LogQueueStatistics
+(
+)
+{
+	QueueData data[MsgQueue_Count];
+	GetQueueStatistics( data );
+
+	Log::Write( LogLevel_Always, "*** Send queues                                        wait (ms)          blocked on (ms)" );
+	Log::Write( LogLevel_Always, "           depth   max    sent retried dropped coalesced    avg    p99        ACK  callback     reply" );
+	for( int32 i=0; i<MsgQueue_Count; ++i )
+	{
+		QueueData const& q = data[i];
+		Log::Write( LogLevel_Always, "%-10s %5d %5d %7d %7d %7d %9d %6d %6d %10d %9d %9d", c_sendQueueNames[i], q.m_depth, q.m_maxDepth, q.m_sent, q.m_retried, q.m_dropped, q.m_coalesced, q.m_wait.m_avg, q.m_wait.m_p99, q.m_blockedAck, q.m_blockedCallback, q.m_blockedReply );
+	}
+}
+
 //-----------------------------------------------------------------------------
 // <Driver::GetNetworkKey>
 // Get the Network Key we will use for Security Command Class
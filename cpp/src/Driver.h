@@ -31,14 +31,18 @@
 #include <string>
 #include <map>
 #include <list>
+#include <vector>
 
 #include "Defs.h"
 #include "value_classes/ValueID.h"
 #include "Node.h"
+#include "LatencyHistogram.h"
 #include "platform/Event.h"
 #include "platform/Mutex.h"
 #include "platform/TimeStamp.h"
 
+class TiXmlDocument;
+
 namespace OpenZWave
 {
 	class Msg;
@@ -49,6 +53,8 @@ namespace OpenZWave
 	class Thread;
 	class ControllerReplication;
 	class Notification;
+	class WaitSet;
+	class DriverReactor;
 
 	/** \brief The Driver class handles communication between OpenZWave
 	 *  and a device attached via a serial port (typically a controller).
@@ -56,6 +62,8 @@ namespace OpenZWave
 	class OPENZWAVE_EXPORT Driver
 	{
 		friend class Manager;
+		friend class DriverReactor;
+		friend class Metrics;
 		friend class Node;
 		friend class Group;
 		friend class CommandClass;
@@ -98,9 +106,9 @@ namespace OpenZWave
 		virtual ~Driver();
 
 		/**
-		 *  Start the driverThread
+		 *  Start the driverThread, or hand the driver to the shared DriverReactor if one is given
 		 */
-		void Start();
+		void Start( DriverReactor* _reactor = NULL );
 		/**
 		 *  Entry point for driverThread
 		 */
@@ -139,6 +147,22 @@ namespace OpenZWave
 		 */
 		bool Init( uint32 _attempts );
 
+		/**
+		 *  Decide what to do after Init() has failed.
+		 *  \param _attempts number of attempts made so far.
+		 *  \return milliseconds to wait before the next attempt, or -1 if DriverMaxAttempts has been reached.
+		 */
+		int32 InitFailed( uint32 const _attempts );
+
+		// The body of the driver loop, shared with the DriverReactor.  The wait set holds
+		// the exit event, the notifications event, the controller and the queue events,
+		// in that order.  PrepareWait returns the timeout and sets the number of objects
+		// to wait on.  HandleWait acts on the index of the signalled object, or -1 for a
+		// timeout.  The exit event (index 0) is left to the caller.
+		void AddWaitObjects( WaitSet* _waitSet, Event* _exitEvent );
+		int32 PrepareWait( uint32* _count );
+		void HandleWait( int32 const _res );
+
 		/**
 		 * Remove any messages to a node on the queues
 		 * Used when deleting a node.
@@ -146,12 +170,22 @@ namespace OpenZWave
 		void RemoveQueues( uint8 const _nodeId );
 
 		Thread*					m_driverThread;			/**< Thread for reading from the Z-Wave controller, and for creating and managing the other threads for sending, polling etc. */
+		DriverReactor*			m_reactor;				/**< Shared thread running this driver instead of m_driverThread and m_pollThread, or NULL */
+		TimeStamp				m_ackTimeStamp;			/**< When the message awaiting an ACK will be sent again */
+		TimeStamp				m_retryTimeStamp;		/**< When the message awaiting a callback or reply will be sent again */
+		int32					m_retryTimeout;			/**< Milliseconds to wait for a callback or reply (RetryTimeout option) */
+		bool					m_waitFrameTimeout;		/**< The timeout from PrepareWait is the end of a partial frame */
+		bool					m_waitDebounceTimeout;	/**< The timeout from PrepareWait is the end of a debounce window */
 		bool					m_exit;					/**< Flag that is set when the application is exiting. */
 		bool					m_init;					/**< Set to true once the driver has been initialised */
 		bool					m_awakeNodesQueried;	/**< Set to true once the driver has polled all awake nodes */
 		bool					m_allNodesQueried;		/**< Set to true once the driver has polled all nodes */
 		bool					m_notifytransactions;
 		TimeStamp				m_startTime;			/**< Time this driver started (for log report purposes) */
+		bool					m_fastRestart;			/**< Nodes read from the configuration file skip the query stages that are still current */
+		int32					m_queryStageTTL[Node::QueryStage_Complete];	/**< Seconds for which each stage's cached results stay current on a fast restart, or -1 */
+
+		void ReadFastRestartOptions();
 
 	//-----------------------------------------------------------------------------
 	//	Configuration
@@ -159,7 +193,39 @@ namespace OpenZWave
 	private:
 		void RequestConfig();							// Get the network configuration from the Z-Wave network
 		bool ReadConfig();								// Read the configuration from a file
-		void WriteConfig();								// Save the configuration to a file
+		void WriteConfig( bool const _updateCache = false );	// Save the configuration to a file, and its binary cache if asked and it is out of date
+		void SetNodeConfigDirty( uint8 const _nodeId );	// Mark a node's saved configuration as out of date
+		bool GetConfigSnapshot( string* _contents, uint32* _generation, bool const _force );
+		bool SaveConfigSnapshot( string const& _contents, uint32 const _generation );
+		string GetConfigFilename( char const* _extension );	// Path of the configuration file, or of its binary cache
+		void WriteConfigCache( TiXmlDocument const& _doc, string const& _xml );	// Save the binary cache of the configuration file
+		static void SaveThreadEntryPoint( Event* _exitEvent, void* _context );
+		void SaveThreadProc( Event* _exitEvent );
+
+		// Each node's part of the configuration file is kept as text, and only
+		// written again when the node has changed since the last save.
+		struct NodeConfig
+		{
+			Node*			m_node;				// Node the text was written from, so a replaced node is caught
+			uint32			m_queryStage;		// The node's query stage when the text was written
+			string			m_xml;
+		};
+
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		NodeConfig				m_nodeConfig[256];		// Guarded by m_nodeMutex
+		string					m_configHeader;			// Driver element of the last snapshot
+OPENZWAVE_EXPORT_WARNINGS_ON
+		bool					m_nodeConfigDirty[256];	// Set when a node changes, guarded by m_configMutex
+		bool					m_configChanged;		// Set when anything has changed since the last snapshot, guarded by m_configMutex
+		uint32					m_configGeneration;		// Number of the last snapshot taken
+		uint32					m_savedGeneration;		// Number of the last snapshot written to the file
+		Mutex*					m_configMutex;
+		Mutex*					m_saveMutex;			// Held while the file is being written
+		Thread*					m_saveThread;			// Saves the configuration in the background, or NULL if SaveConfigInterval is 0
+		Event*					m_saveEvent;			// Set to ask the save thread for a save now
+		int32					m_saveInterval;			// Seconds between background saves
+		bool					m_configCache;			// Keep a binary cache of the configuration file alongside it
+		bool					m_configCacheStale;		// The file has been saved since the binary cache was written, guarded by m_saveMutex
 
 	//-----------------------------------------------------------------------------
 	//	Controller
@@ -205,7 +271,7 @@ namespace OpenZWave
 			int32 count = 0;
 			for( int32 i=0; i<MsgQueue_Count; ++i )
 			{
-				count += (int32) (m_msgQueue[i].size());
+				count += (int32) (m_msgQueue[i].Size());
 			}
 			return count;
 		}
@@ -269,7 +335,15 @@ namespace OpenZWave
 	//	Receiving Z-Wave messages
 	//-----------------------------------------------------------------------------
 	private:
+		/**
+		 *  Parses the bytes received from the controller in a single pass over its receive buffer.
+		 *  Every complete frame is checksummed and passed to ProcessMsg in place, without being
+		 *  copied.  If only part of a frame has arrived, the controller's signal threshold is raised
+		 *  to the size of the frame and the partial frame is left for the next call.
+		 *  \return true if any data was consumed.
+		 */
 		bool ReadMsg();
+		void AbortFrameRead();											// Discard a partial frame that timed out
 		void ProcessMsg( uint8* _data );
 
 		void HandleGetVersionResponse( uint8* _data );
@@ -339,10 +413,29 @@ namespace OpenZWave
 		uint8					m_expectedReply;							// If non-zero, we wait for a message with this function Id
 		uint8					m_expectedCommandClassId;					// If the expected reply is FUNC_ID_APPLICATION_COMMAND_HANDLER, this value stores the command class we're waiting to hear from
 		uint8					m_expectedNodeId;							// If we are waiting for a FUNC_ID_APPLICATION_COMMAND_HANDLER, make sure we only accept it from this node.
+		uint32					m_frameExpected;							// If non-zero, a partial frame is in the receive buffer and we are waiting for this many bytes
+		TimeStamp				m_frameTimeStamp;							// Time at which a partial frame read is aborted
 
 	//-----------------------------------------------------------------------------
 	//	Polling Z-Wave devices
 	//-----------------------------------------------------------------------------
+	public:
+		enum PollPolicy
+		{
+			PollPolicy_Fixed = 0,			// Poll each value at its period, however busy the network is
+			PollPolicy_Adaptive				// Stretch the poll periods to keep the network below the PollLoadTarget option
+		};
+
+		struct PollScheduleEntry
+		{
+			ValueID	m_id;
+			uint32	m_period;			// Time between polls of this value in milliseconds
+			uint32	m_effectivePeriod;	// Time between polls once adaptive throttling has been applied
+			int32	m_dueIn;			// Milliseconds until the next poll.  Negative if the poll is overdue.
+			uint32	m_polls;			// Number of times the value has been polled
+			uint32	m_skipped;			// Number of polls skipped because the node was busy or not responding
+		};
+
 	private:
 		int32 GetPollInterval(){ return m_pollInterval ; }
 		void SetPollInterval( int32 _milliseconds, bool _bIntervalBetweenPolls ){ m_pollInterval = _milliseconds; m_bIntervalBetweenPolls = _bIntervalBetweenPolls; }
@@ -350,21 +443,67 @@ namespace OpenZWave
 		bool DisablePoll( const ValueID &_valueId );
 		bool isPolled( const ValueID &_valueId );
 		void SetPollIntensity( const ValueID &_valueId, uint8 _intensity );
+		bool SetPollPeriod( const ValueID &_valueId, uint32 _milliseconds );
+		void GetPollSchedule( vector<PollScheduleEntry>* o_schedule );
 		static void PollThreadEntryPoint( Event* _exitEvent, void* _context );
 		void PollThreadProc( Event* _exitEvent );
+		int32 PollStep( bool* _onSchedule );		// Send the next poll if one is due.  Returns milliseconds until it should be called again.
 
-		Thread*					m_pollThread;								// Thread for polling devices on the Z-Wave network
 		struct PollEntry
 		{
 			ValueID	m_id;
-			uint8	m_pollCounter;
+			uint32	m_period;			// Poll period in milliseconds, or zero to derive it from the intensity and m_pollInterval
+			uint8	m_intensity;
+			uint64	m_due;				// Time of the next poll, in milliseconds since the epoch
+			uint32	m_polls;
+			uint32	m_skipped;
+			uint32	m_cost;				// Estimated network time taken by one poll, in milliseconds
+			uint32	m_failed;			// The node's failed message count when it was last polled
+			uint8	m_backoff;			// Multiplier applied to the period while the node is failing to respond
 		};
+
+		// Orders the poll heap so that the entry with the earliest deadline is at the front
+		struct PollEntryLater
+		{
+			bool operator () ( PollEntry const& _a, PollEntry const& _b )const{ return _a.m_due > _b.m_due; }
+		};
+
+		enum PollResult
+		{
+			PollResult_Sent = 0,
+			PollResult_Skipped,
+			PollResult_Removed
+		};
+
+		vector<PollEntry>::iterator FindPollEntry( ValueID const& _valueId );
+		void SchedulePoll( PollEntry& _entry, uint64 const _now );
+		uint32 GetPollPeriod( PollEntry const& _entry, uint32 const _count );
+		uint32 GetEffectivePollPeriod( PollEntry const& _entry, uint32 const _count );
+		void UpdatePollLoad();
+		PollResult PollValue( PollEntry& _entry );
+
+		Thread*					m_pollThread;								// Thread for polling devices on the Z-Wave network
 OPENZWAVE_EXPORT_WARNINGS_OFF
-		list<PollEntry>			m_pollList;									// List of nodes that need to be polled
+		vector<PollEntry>		m_pollHeap;									// Values that need to be polled, kept as a min-heap on m_due
 OPENZWAVE_EXPORT_WARNINGS_ON
-		Mutex*					m_pollMutex;								// Serialize access to the polling list
+		Mutex*					m_pollMutex;								// Serialize access to the polling heap
+		Event*					m_pollEvent;								// Signalled when the poll schedule changes, so the poll thread can recalculate its wait
 		int32					m_pollInterval;								// Time interval during which all nodes must be polled
 		bool					m_bIntervalBetweenPolls;					// if true, the library intersperses m_pollInterval between polls; if false, the library attempts to complete all polls within m_pollInterval
+		PollPolicy				m_pollPolicy;								// Whether poll periods are stretched when the network is busy
+		int32					m_pollLoadTarget;							// Percentage of network time the adaptive policy allows polls to use
+		int32					m_pollQueueLimit;							// The adaptive policy holds polls back while more than this many messages are queued
+		uint32					m_pollLoad;									// Percentage of network time the poll schedule asks for
+		uint32					m_pollScale;								// Percentage by which the adaptive policy stretches poll periods
+		uint32					m_pollCnt;									// Number of polls sent
+		uint32					m_pollSkipped;								// Number of polls skipped
+		uint32					m_pollRate;									// Polls sent during the last full minute
+		uint32					m_pollRateCnt;								// Polls sent so far in the current minute
+		TimeStamp				m_pollRateStart;							// Start of the current minute
+		bool					m_pollDraining;								// A poll has been sent, and the next waits for it to leave the poll queue
+		bool					m_pollDrainWarned;							// The poll queue has been stuck long enough to be logged
+		TimeStamp				m_pollDrainStart;							// When the last poll was sent
+		TimeStamp				m_pollResume;								// When the next poll may be sent, if m_bIntervalBetweenPolls is set
 
 	//-----------------------------------------------------------------------------
 	//	Retrieving Node information
@@ -627,6 +766,7 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		void SendQueryStageComplete( uint8 const _nodeId, Node::QueryStage const _stage );
 		void RetryQueryStageComplete( uint8 const _nodeId, Node::QueryStage const _stage );
 		void CheckCompletedNodeQueries();									// Send notifications if all awake and/or sleeping nodes have completed their queries
+		static bool IsCoalescedQueue( MsgQueue const _queue ){ return( _queue == MsgQueue_Send || _queue == MsgQueue_Query || _queue == MsgQueue_Poll ); }
 
 		// Requests to be sent to nodes are assigned to one of five queues.
 		// From highest to lowest priority, these are
@@ -677,7 +817,13 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 				m_nodeId(0),
 				m_queryStage(Node::QueryStage_None),
 				m_retry(false),
-				m_cci(NULL)
+				m_cci(NULL),
+				m_key(0),
+				m_indexed(false),
+				m_queuedTime(0),
+				m_next(NULL),
+				m_prev(NULL),
+				m_hashNext(NULL)
 		  	{}
 
 			bool operator == ( MsgQueueItem const& _other )const
@@ -707,10 +853,58 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 			Node::QueryStage		m_queryStage;
 			bool				m_retry;
 			ControllerCommandItem*		m_cci;
+			uint32				m_key;			// Msg::GetQueueKey of m_msg, if the item is indexed
+			bool				m_indexed;		// True if the item can be found by its key
+			uint32				m_queuedTime;		// When the item was added to its queue, in ms after the driver started
+			MsgQueueItem*			m_next;			// Links used while the item is in a MsgQueueList
+			MsgQueueItem*			m_prev;
+			MsgQueueItem*			m_hashNext;		// Next item in the same bucket of the list's key index
 		};
 
+		// A send queue.  The items are linked together through their own m_next and m_prev
+		// pointers, so adding and removing them never allocates.  Items that are indexed are
+		// also chained into a small hash table on their m_key, which lets duplicate requests
+		// be found without walking the whole queue.
+		class MsgQueueList
+		{
+		public:
+			MsgQueueList();
+
+			bool Empty()const{ return( m_head == NULL ); }
+			uint32 Size()const{ return m_size; }
+			MsgQueueItem* Front()const{ return m_head; }
+
+			void PushBack( MsgQueueItem* _item, bool const _index );
+			MsgQueueItem* Remove( MsgQueueItem* _item );			// Returns the item that followed the removed one
+			MsgQueueItem* FindKey( uint32 const _key, MsgQueueItem* _after = NULL )const;
+
+		private:
+			enum
+			{
+				HashSize = 64
+			};
+
+			MsgQueueItem*	m_head;
+			MsgQueueItem*	m_tail;
+			uint32			m_size;
+			MsgQueueItem*	m_hash[HashSize];
+		};
+
+		bool CoalesceMsg( MsgQueueItem& _item, MsgQueue const _queue );
+		void QueueItem( MsgQueue const _queue, MsgQueueItem const& _item );
+		MsgQueueItem* RemoveQueueItem( MsgQueue const _queue, MsgQueueItem* _item );	// Returns the item that followed the removed one
+		MsgQueueItem* AllocQueueItem();
+		void FreeQueueItem( MsgQueueItem* _item );
+
+		enum
+		{
+			QueueItemChunkSize = 32							// Queue items are allocated this many at a time
+		};
+
+		MsgQueueList				m_msgQueue[MsgQueue_Count];
+		MsgQueueItem*				m_freeQueueItems;					// Queue items that are not in use, linked through m_next
 OPENZWAVE_EXPORT_WARNINGS_OFF
-		list<MsgQueueItem>			m_msgQueue[MsgQueue_Count];
+		vector<MsgQueueItem*>			m_queueItemChunks;					// Every block of queue items, so they can be freed
 OPENZWAVE_EXPORT_WARNINGS_ON
 		Event*					m_queueEvent[MsgQueue_Count];				// Events for each queue, which are signalled when the queue is not empty
 		Mutex*					m_sendMutex;						// Serialize access to the queues
@@ -718,6 +912,31 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		MsgQueue				m_currentMsgQueueSource;			// identifies which queue held m_currentMsg
 		TimeStamp				m_resendTimeStamp;
 
+	//-----------------------------------------------------------------------------
+	// Interview scheduling
+	//-----------------------------------------------------------------------------
+	private:
+		// The controller sends one message at a time, so nodes cannot really be
+		// interviewed in parallel.  When InterviewConcurrency is set, at most that
+		// many listening nodes are interviewed at once, and the query queue sends
+		// for each of them in turn rather than strictly in the order queued.  A slot
+		// is freed when a node completes, is presumed dead or is removed.  Sleeping
+		// nodes don't take a slot, as they are only queried while awake.
+		bool AdmitInterview( Node* _node );				// Returns false if the node must wait for a slot
+		void EndInterview( uint8 const _nodeId );			// Free the node's slot and start the next waiting node
+		MsgQueueItem* NextQueryItem();						// The query item to send next.  The caller must hold m_sendMutex.
+		static uint8 GetQueueItemNodeId( MsgQueueItem const* _item );
+
+		uint32					m_interviewLimit;					// Nodes interviewed at once, or 0 for no limit
+		uint32					m_interviewCount;					// Nodes holding a slot
+		bool					m_interviewing[256];				// Nodes holding a slot
+OPENZWAVE_EXPORT_WARNINGS_OFF
+		list<uint8>				m_interviewWaiting;					// Nodes waiting for a slot, in the order they asked
+OPENZWAVE_EXPORT_WARNINGS_ON
+		uint8					m_lastQueryNodeId;					// Node of the query item sent last
+		uint32					m_awakeNodesQueriedTime;			// ms from the driver starting until all awake nodes were queried
+		uint32					m_allNodesQueriedTime;				// ms from the driver starting until all nodes were queried
+
 	//-----------------------------------------------------------------------------
 	// Network functions
 	//-----------------------------------------------------------------------------
@@ -778,16 +997,46 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 	private:
 		void QueueNotification( Notification* _notification );				// Adds a notification to the list.  Notifications are queued until a point in the thread where we know we do not have any nodes locked.
 		void NotifyWatchers();												// Passes the notifications to all the registered watcher callbacks in turn.
+		bool DebounceNotification( Notification* _notification );			// Hold back a value update that arrives within its debounce window.  Returns true if the notification was taken.
+		void FlushDebouncedNotifications();									// Queue the held back updates whose windows have ended
+		int32 GetDebounceTimeout();											// Milliseconds until the next debounce window ends, or Wait::Timeout_Infinite
+		void ReadDebounceOptions();
+
+		// A value that has recently sent a ValueChanged or ValueRefreshed notification.
+		// Until m_windowEnd, further updates replace m_pending rather than being sent.
+		struct DebouncedValue
+		{
+			TimeStamp		m_windowEnd;
+			Notification*	m_pending;			// Latest update held back, or NULL
+			uint32			m_suppressed;		// Number of updates m_pending replaces
+		};
 
 OPENZWAVE_EXPORT_WARNINGS_OFF
 		list<Notification*>		m_notifications;
+		map<ValueID,DebouncedValue>	m_debouncedValues;
 OPENZWAVE_EXPORT_WARNINGS_ON
 		Event*				m_notificationsEvent;
+		uint32				m_debounceWindow[256];				// ValueChanged debounce window in ms for each command class, 0 if updates are sent straight away
+		bool				m_bDebounce;						// True if any command class has a debounce window
 
 	//-----------------------------------------------------------------------------
 	//	Statistics
 	//-----------------------------------------------------------------------------
 	public:
+		struct QueueData
+		{
+			uint32 m_depth;				// Number of items in the queue
+			uint32 m_maxDepth;			// Most items the queue has held at once
+			LatencyHistogram::Summary m_wait;	// ms items spent in the queue before being taken off it
+			uint32 m_sent;				// Number of messages from the queue sent to the controller
+			uint32 m_retried;			// Number of times a message from the queue was sent again
+			uint32 m_dropped;			// Number of messages from the queue given up on
+			uint32 m_coalesced;			// Number of messages not queued or removed because the same request was already queued
+			uint32 m_blockedAck;			// ms no other message could be sent while waiting for an ACK to a message from this queue
+			uint32 m_blockedCallback;		// ms no other message could be sent while waiting for a callback to a message from this queue
+			uint32 m_blockedReply;			// ms no other message could be sent while waiting for a reply to a message from this queue
+		};
+
 		struct DriverData
 		{
 			uint32 m_SOFCnt;			// Number of SOF bytes received
@@ -811,13 +1060,40 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 			uint32 m_routedbusy;			// Number of messages received with routed busy status
 			uint32 m_broadcastReadCnt;		// Number of broadcasts read
 			uint32 m_broadcastWriteCnt;		// Number of broadcasts sent
+			uint32 m_coalesced;			// Number of queued messages dropped because an identical or newer one replaced them
+			uint32 m_debounced;			// Number of value notifications not sent because a later one in the debounce window replaced them
+			uint32 m_pollCnt;			// Number of polls sent
+			uint32 m_pollSkipped;			// Number of polls skipped because the node was asleep, busy or not responding
+			uint32 m_pollRate;			// Polls sent during the last full minute
+			uint32 m_pollLoad;			// Percentage of network time the poll schedule asks for
+			uint32 m_pollScale;			// Percentage by which poll periods are stretched (100 when not throttled)
+			uint32 m_interviewActive;		// Number of nodes being interviewed
+			uint32 m_interviewWaiting;		// Number of nodes waiting for an interview slot (InterviewConcurrency)
+			uint32 m_awakeNodesQueriedTime;	// ms from the driver starting until all awake nodes were queried, or 0
+			uint32 m_allNodesQueriedTime;		// ms from the driver starting until all nodes were queried, or 0
+			uint32 m_controllerReads;		// Number of reads from the controller that returned data
+			uint32 m_controllerReadBytes;		// Number of bytes received from the controller
+			uint32 m_controllerWakeups;		// Number of times the read path woke up to look for data
+			uint32 m_controllerLatencyAvg;	// Average ms received data may have waited in the controller before it was read
+			uint32 m_controllerLatencyMax;	// Longest ms received data may have waited in the controller before it was read
+			uint32 m_controllerBufferSize;	// Size of the receive buffer (ControllerBufferSize)
+			uint32 m_controllerBufferHighWater;	// Most data the receive buffer has held at once
+			uint32 m_controllerOverflowBytes;	// Bytes dropped because the receive buffer was full
+			LatencyHistogram::Summary m_requestRTTs;	// ms from sending a message to a node until its callback, for every node
+			LatencyHistogram::Summary m_responseRTTs;	// ms from sending a message to a node until its reply, for every node
+			LatencyHistogram::Summary m_ackLatencies;	// ms from writing a frame to the controller until it is ACKed
+			QueueData m_queues[MsgQueue_Count];	// Statistics for each send queue
+			LatencyHistogram::Summary m_notificationLatencies;	// ms from a notification being queued until the watchers have been given it
 		};
 
 		void LogDriverStatistics();
+		void LogQueueStatistics();
 
 	private:
 		void GetDriverStatistics( DriverData* _data );
 		void GetNodeStatistics( uint8 const _nodeId, Node::NodeData* _data );
+		uint32 GetNodeMetrics( Node::NodeMetrics* _data, uint32 const _max );
+		static char const* GetQueueName( MsgQueue const _queue );
 
 		uint32 m_SOFCnt;			// Number of SOF bytes received
 		uint32 m_ACKWaiting;			// Number of unsolcited messages while waiting for an ACK
@@ -840,6 +1116,40 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		uint32 m_routedbusy;			// Number of messages received with routed busy status
 		uint32 m_broadcastReadCnt;		// Number of broadcasts read
 		uint32 m_broadcastWriteCnt;		// Number of broadcasts sent
+		uint32 m_coalesced;			// Number of queued messages dropped because an identical or newer one replaced them
+		uint32 m_debounced;			// Number of value notifications not sent because a later one in the debounce window replaced them
+		LatencyHistogram m_requestRTTs;
+		LatencyHistogram m_responseRTTs;
+		LatencyHistogram m_ackLatencies;
+		LatencyHistogram m_notificationLatencies;
+		uint32 m_writeTime;			// When the frame awaiting an ACK was written, in ms after the driver started
+
+		struct QueueStatistics
+		{
+			QueueStatistics(): m_maxDepth( 0 ), m_sent( 0 ), m_retried( 0 ), m_dropped( 0 ), m_coalesced( 0 ), m_blockedAck( 0 ), m_blockedCallback( 0 ), m_blockedReply( 0 ){}
+
+			LatencyHistogram m_waits;
+			uint32 m_maxDepth;
+			uint32 m_sent;
+			uint32 m_retried;
+			uint32 m_dropped;
+			uint32 m_coalesced;
+			uint32 m_blockedAck;
+			uint32 m_blockedCallback;
+			uint32 m_blockedReply;
+		};
+
+		QueueStatistics m_queueStats[MsgQueue_Count];
+		uint32 m_blockedSince;			// When blocked time was last charged to a queue, in ms after the driver started
+		int32 m_queueLogInterval;		// Seconds between writing the queue statistics to the log (QueueStatisticsInterval), or 0
+		TimeStamp m_queueLogTimeStamp;		// When the queue statistics are next written to the log
+		bool m_waitQueueLogTimeout;		// The timeout from PrepareWait is the next write of the queue statistics
+
+		void GetQueueStatistics( QueueData* _data );
+		void ChargeBlockedTime();
+
+		uint32 GetElapsed(){ return (uint32)( -m_startTime.TimeRemaining() ); }	// ms since the driver started
+		uint32 GetElapsedSince( uint32 const _time );
 		//time_t m_commandStart;	// Start time of last command
 		//time_t m_timeoutLost;		// Cumulative time lost to timeouts
 
@@ -0,0 +1,427 @@
+//-----------------------------------------------------------------------------
+//
+//	DriverReactor.cpp
+//
+//	Runs every driver's message loop and poll schedule on two shared threads
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include "Defs.h"
+#include "DriverReactor.h"
+#include "Driver.h"
+#include "platform/Event.h"
+#include "platform/Log.h"
+#include "platform/Mutex.h"
+#include "platform/Thread.h"
+#include "platform/Wait.h"
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+// <DriverReactor::DriverReactor>
+// Constructor
+//-----------------------------------------------------------------------------
+DriverReactor::DriverReactor
+(
+):
+	m_reactorThread( new Thread( "reactor" ) ),
+	m_mutex( new Mutex() ),
+	m_driversChanged( new Event() ),
+	m_wakeup( new WaitSet() ),
+	m_pollThread( new Thread( "poll" ) ),
+	m_pollMutex( new Mutex() ),
+	m_pollsChanged( new Event() ),
+	m_pollWakeup( new WaitSet() )
+{
+	m_wakeup->Add( m_driversChanged );
+	m_pollWakeup->Add( m_pollsChanged );
+
+	m_reactorThread->Start( DriverReactor::ReactorThreadEntryPoint, this );
+	m_pollThread->Start( DriverReactor::PollThreadEntryPoint, this );
+
+	Log::Write( LogLevel_Info, "Running all drivers on a shared thread" );
+}
+
+//-----------------------------------------------------------------------------
+// <DriverReactor::~DriverReactor>
+// Destructor
+//-----------------------------------------------------------------------------
+DriverReactor::~DriverReactor
+(
+)
+{
+	// The Manager removes the drivers first, so the threads are idle
+	m_pollThread->Stop();
+	m_pollThread->Release();
+	m_reactorThread->Stop();
+	m_reactorThread->Release();
+
+	for( vector<PollState*>::iterator it = m_polls.begin(); it != m_polls.end(); ++it )
+	{
+		delete (*it)->m_waitSet;
+		delete *it;
+	}
+	for( vector<DriverState*>::iterator it = m_drivers.begin(); it != m_drivers.end(); ++it )
+	{
+		delete (*it)->m_waitSet;
+		delete *it;
+	}
+
+	delete m_pollWakeup;
+	m_pollsChanged->Release();
+	m_pollMutex->Release();
+	delete m_wakeup;
+	m_driversChanged->Release();
+	m_mutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+// <DriverReactor::AddDriver>
+// Start running a driver on the reactor thread
+//-----------------------------------------------------------------------------
+void DriverReactor::AddDriver
+(
+	Driver* _driver
+)
+{
+	DriverState* state = new DriverState();
+	state->m_driver = _driver;
+	state->m_waitSet = NULL;
+	state->m_attempts = 0;
+	state->m_count = 0;
+	state->m_timeout = 0;
+
+	m_mutex->Lock();
+	m_drivers.push_back( state );
+	m_mutex->Unlock();
+
+	m_driversChanged->Set();
+}
+
+//-----------------------------------------------------------------------------
+// <DriverReactor::RemoveDriver>
+// Stop running a driver.  Once this returns, the shared threads will not
+// touch the driver again.
+//-----------------------------------------------------------------------------
+void DriverReactor::RemoveDriver
+(
+	Driver* _driver
+)
+{
+	m_pollMutex->Lock();
+	for( vector<PollState*>::iterator it = m_polls.begin(); it != m_polls.end(); ++it )
+	{
+		if( (*it)->m_driver == _driver )
+		{
+			delete (*it)->m_waitSet;
+			delete *it;
+			m_polls.erase( it );
+			break;
+		}
+	}
+	m_pollMutex->Unlock();
+
+	m_mutex->Lock();
+	for( vector<DriverState*>::iterator it = m_drivers.begin(); it != m_drivers.end(); ++it )
+	{
+		if( (*it)->m_driver == _driver )
+		{
+			delete (*it)->m_waitSet;
+			delete *it;
+			m_drivers.erase( it );
+			break;
+		}
+	}
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <DriverReactor::StartPolling>
+// Start running a driver's poll schedule on the poll thread
+//-----------------------------------------------------------------------------
+void DriverReactor::StartPolling
+(
+	Driver* _driver
+)
+{
+	m_pollMutex->Lock();
+	for( vector<PollState*>::iterator it = m_polls.begin(); it != m_polls.end(); ++it )
+	{
+		if( (*it)->m_driver == _driver )
+		{
+			m_pollMutex->Unlock();
+			return;
+		}
+	}
+
+	PollState* state = new PollState();
+	state->m_driver = _driver;
+	state->m_waitSet = new WaitSet( m_pollWakeup );
+	state->m_waitSet->Add( _driver->m_pollEvent );
+	state->m_onSchedule = true;
+	state->m_timeout = 0;
+	m_polls.push_back( state );
+	m_pollMutex->Unlock();
+
+	m_pollsChanged->Set();
+}
+
+//-----------------------------------------------------------------------------
+// <DriverReactor::ReactorThreadEntryPoint>
+// Entry point of the thread running the drivers
+//-----------------------------------------------------------------------------
+void DriverReactor::ReactorThreadEntryPoint
+(
+	Event* _exitEvent,
+	void* _context
+)
+{
+	DriverReactor* reactor = (DriverReactor*)_context;
+	if( reactor )
+	{
+		reactor->ReactorThreadProc( _exitEvent );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <DriverReactor::ReactorThreadProc>
+// Take each driver in turn until none has anything to do, then sleep until
+// one of them is signalled or the earliest timeout
+//-----------------------------------------------------------------------------
+void DriverReactor::ReactorThreadProc
+(
+	Event* _exitEvent
+)
+{
+	WaitSet exitSet( m_wakeup );
+	exitSet.Add( _exitEvent );
+
+	while( true )
+	{
+		m_driversChanged->Reset();
+
+		int32 timeout = Wait::Timeout_Infinite;
+		m_mutex->Lock();
+		for( size_t i=0; i<m_drivers.size(); ++i )
+		{
+			if( exitSet.Check( 1 ) == 0 )
+			{
+				m_mutex->Unlock();
+				return;
+			}
+
+			int32 driverTimeout;
+			if( !RunDriver( m_drivers[i], _exitEvent, &driverTimeout ) )
+			{
+				// The driver has given up on its controller
+				delete m_drivers[i]->m_waitSet;
+				delete m_drivers[i];
+				m_drivers.erase( m_drivers.begin() + i );
+				--i;
+				continue;
+			}
+			if( ( driverTimeout != Wait::Timeout_Infinite ) && ( ( timeout == Wait::Timeout_Infinite ) || ( driverTimeout < timeout ) ) )
+			{
+				timeout = driverTimeout;
+			}
+		}
+		m_mutex->Unlock();
+
+		if( timeout != 0 )
+		{
+			m_wakeup->Sleep( timeout );
+		}
+		if( exitSet.Check( 1 ) == 0 )
+		{
+			return;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <DriverReactor::RunDriver>
+// Handle one thing a driver is waiting for, if anything.  Returns false if
+// the driver has given up trying to open its controller.
+//-----------------------------------------------------------------------------
+bool DriverReactor::RunDriver
+(
+	DriverState* _state,
+	Event* _exitEvent,
+	int32* _timeout
+)
+{
+	Driver* driver = _state->m_driver;
+	if( _state->m_waitSet == NULL )
+	{
+		// The controller is not open yet
+		int32 remaining = _state->m_due.TimeRemaining();
+		if( remaining > 0 )
+		{
+			*_timeout = remaining;
+			return true;
+		}
+
+		if( !driver->Init( _state->m_attempts ) )
+		{
+			int32 retryDelay = driver->InitFailed( ++_state->m_attempts );
+			if( retryDelay < 0 )
+			{
+				return false;
+			}
+			_state->m_due.SetTime( retryDelay );
+			*_timeout = retryDelay;
+			return true;
+		}
+
+		_state->m_waitSet = new WaitSet( m_wakeup );
+		driver->AddWaitObjects( _state->m_waitSet, _exitEvent );
+	}
+	else
+	{
+		int32 res = _state->m_waitSet->Check( _state->m_count );
+		if( res == 0 )
+		{
+			// Exit is handled by the reactor thread
+			*_timeout = Wait::Timeout_Infinite;
+			return true;
+		}
+		if( res < 0 )
+		{
+			// Nothing is signalled, so only the timeout can need attention
+			if( _state->m_timeout == Wait::Timeout_Infinite )
+			{
+				*_timeout = Wait::Timeout_Infinite;
+				return true;
+			}
+			int32 remaining = _state->m_due.TimeRemaining();
+			if( remaining > 0 )
+			{
+				*_timeout = remaining;
+				return true;
+			}
+		}
+		driver->HandleWait( res );
+	}
+
+	_state->m_timeout = driver->PrepareWait( &_state->m_count );
+	if( _state->m_timeout != Wait::Timeout_Infinite )
+	{
+		_state->m_due.SetTime( _state->m_timeout );
+	}
+
+	// Come back at once, in case more is waiting
+	*_timeout = 0;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <DriverReactor::PollThreadEntryPoint>
+// Entry point of the thread running the poll schedules
+//-----------------------------------------------------------------------------
+void DriverReactor::PollThreadEntryPoint
+(
+	Event* _exitEvent,
+	void* _context
+)
+{
+	DriverReactor* reactor = (DriverReactor*)_context;
+	if( reactor )
+	{
+		reactor->PollThreadProc( _exitEvent );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <DriverReactor::PollThreadProc>
+// Run each poll schedule that is due or has changed, then sleep until the
+// earliest is due or one changes
+//-----------------------------------------------------------------------------
+void DriverReactor::PollThreadProc
+(
+	Event* _exitEvent
+)
+{
+	WaitSet exitSet( m_pollWakeup );
+	exitSet.Add( _exitEvent );
+
+	while( true )
+	{
+		m_pollsChanged->Reset();
+
+		int32 timeout = Wait::Timeout_Infinite;
+		m_pollMutex->Lock();
+		for( size_t i=0; i<m_polls.size(); ++i )
+		{
+			if( exitSet.Check( 1 ) == 0 )
+			{
+				m_pollMutex->Unlock();
+				return;
+			}
+
+			int32 pollTimeout = RunPoll( m_polls[i] );
+			if( ( pollTimeout != Wait::Timeout_Infinite ) && ( ( timeout == Wait::Timeout_Infinite ) || ( pollTimeout < timeout ) ) )
+			{
+				timeout = pollTimeout;
+			}
+		}
+		m_pollMutex->Unlock();
+
+		if( timeout != 0 )
+		{
+			m_pollWakeup->Sleep( timeout );
+		}
+		if( exitSet.Check( 1 ) == 0 )
+		{
+			return;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <DriverReactor::RunPoll>
+// Take the next step of a poll schedule if it is due.  Returns the
+// milliseconds until it is due again.
+//-----------------------------------------------------------------------------
+int32 DriverReactor::RunPoll
+(
+	PollState* _state
+)
+{
+	bool due = ( _state->m_onSchedule && ( _state->m_waitSet->Check( 1 ) == 0 ) );
+	if( !due )
+	{
+		if( _state->m_timeout == Wait::Timeout_Infinite )
+		{
+			return Wait::Timeout_Infinite;
+		}
+		int32 remaining = _state->m_due.TimeRemaining();
+		if( remaining > 0 )
+		{
+			return remaining;
+		}
+	}
+
+	_state->m_timeout = _state->m_driver->PollStep( &_state->m_onSchedule );
+	if( _state->m_timeout != Wait::Timeout_Infinite )
+	{
+		_state->m_due.SetTime( _state->m_timeout );
+	}
+	return _state->m_timeout;
+}
@@ -0,0 +1,110 @@
+//-----------------------------------------------------------------------------
+//
+//	DriverReactor.h
+//
+//	Runs every driver's message loop and poll schedule on two shared threads
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _DriverReactor_H
+#define _DriverReactor_H
+
+#include <vector>
+#include "Defs.h"
+#include "platform/TimeStamp.h"
+
+namespace OpenZWave
+{
+	class Driver;
+	class Event;
+	class Mutex;
+	class Thread;
+	class WaitSet;
+
+	/** \brief Runs every driver's message loop and poll schedule on two shared threads.
+	 *
+	 * Normally each driver has a thread of its own for its message loop and another for
+	 * its poll schedule.  When the SharedDriverThread option is set, the Manager creates
+	 * one DriverReactor instead.  Its reactor thread takes each driver in turn, handles
+	 * one thing the driver is waiting for (received data, a queued message, a timeout),
+	 * and sleeps once none of them has anything to do.  Its poll thread does the same
+	 * for the poll schedules.  Every driver's wait objects share a single wakeup, so a
+	 * signal from any of them wakes the thread that serves it.
+	 *
+	 * Drivers are run one at a time, so a slow watcher called from the reactor thread
+	 * holds up every controller.  NotificationThreads moves the watchers onto their own
+	 * threads, but with NotificationOverflow set to Block, a watcher that fills the
+	 * notification queue still makes the reactor thread wait, and with it every
+	 * controller.  The Manager warns when the two are combined.
+	 */
+	class DriverReactor
+	{
+	public:
+		DriverReactor();
+		~DriverReactor();
+
+		void AddDriver( Driver* _driver );			// Opens the controller and runs the driver's loop on the reactor thread
+		void RemoveDriver( Driver* _driver );		// Waits for any work on the driver in progress on the shared threads
+		void StartPolling( Driver* _driver );		// Runs the driver's poll schedule on the poll thread
+
+	private:
+		struct DriverState
+		{
+			Driver*		m_driver;
+			WaitSet*	m_waitSet;			// The driver loop's wait objects, or NULL until the controller is open
+			uint32		m_attempts;			// Failed attempts to open the controller
+			uint32		m_count;			// Number of wait objects the driver can act on
+			int32		m_timeout;			// Timeout from the driver, or Wait::Timeout_Infinite
+			TimeStamp	m_due;				// When the timeout ends, or when to try opening the controller again
+		};
+
+		struct PollState
+		{
+			Driver*		m_driver;
+			WaitSet*	m_waitSet;			// The driver's poll schedule event
+			bool		m_onSchedule;		// A change to the schedule brings the next step forward
+			int32		m_timeout;			// Time until the next step, or Wait::Timeout_Infinite
+			TimeStamp	m_due;
+		};
+
+		static void ReactorThreadEntryPoint( Event* _exitEvent, void* _context );
+		void ReactorThreadProc( Event* _exitEvent );
+		bool RunDriver( DriverState* _state, Event* _exitEvent, int32* _timeout );
+
+		static void PollThreadEntryPoint( Event* _exitEvent, void* _context );
+		void PollThreadProc( Event* _exitEvent );
+		int32 RunPoll( PollState* _state );
+
+		Thread*						m_reactorThread;
+		Mutex*						m_mutex;				// Guards m_drivers.  Held while the drivers are being run.
+		Event*						m_driversChanged;		// Set when a driver is added
+		WaitSet*					m_wakeup;				// Woken by every driver's wait objects
+		vector<DriverState*>		m_drivers;
+
+		Thread*						m_pollThread;
+		Mutex*						m_pollMutex;			// Guards m_polls.  Held while the poll schedules are being run.
+		Event*						m_pollsChanged;			// Set when a driver starts polling
+		WaitSet*					m_pollWakeup;			// Woken by every driver's poll schedule event
+		vector<PollState*>			m_polls;
+	};
+
+} // namespace OpenZWave
+
+#endif //_DriverReactor_H
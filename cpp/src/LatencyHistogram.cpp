@@ -0,0 +1,193 @@
+//-----------------------------------------------------------------------------
+//
+//	LatencyHistogram.cpp
+//
+//	Fixed-bucket histogram of latencies in milliseconds
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+#include "Defs.h"
+#include "LatencyHistogram.h"
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+// <LatencyHistogram::Record>
+// Count a value
+//-----------------------------------------------------------------------------
+void LatencyHistogram::Record
+(
+	uint32 const _ms
+)
+{
+	++m_buckets[BucketIndex( _ms )];
+	++m_count;
+	m_total += _ms;
+	if( _ms > m_max )
+	{
+		m_max = _ms;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <LatencyHistogram::Reset>
+// Forget every value recorded
+//-----------------------------------------------------------------------------
+void LatencyHistogram::Reset
+(
+)
+{
+	memset( m_buckets, 0, sizeof(m_buckets) );
+	m_count = 0;
+	m_max = 0;
+	m_total = 0;
+}
+
+//-----------------------------------------------------------------------------
+// <LatencyHistogram::GetSummary>
+// Return the count, percentiles and largest value
+//-----------------------------------------------------------------------------
+void LatencyHistogram::GetSummary
+(
+	Summary* _summary
+)const
+{
+	// Work from a copy, so that values recorded meanwhile by another thread
+	// cannot make the percentiles disagree with each other
+	uint32 buckets[BucketCount];
+	memcpy( buckets, m_buckets, sizeof(buckets) );
+	uint32 count = 0;
+	for( uint32 i=0; i<BucketCount; ++i )
+	{
+		count += buckets[i];
+	}
+	uint32 max = m_max;
+	uint64 total = m_total;
+
+	_summary->m_count = count;
+	_summary->m_avg = count ? (uint32)( total / count ) : 0;
+	_summary->m_sum = total;
+	_summary->m_p50 = Percentile( buckets, count, max, 500 );
+	_summary->m_p90 = Percentile( buckets, count, max, 900 );
+	_summary->m_p99 = Percentile( buckets, count, max, 990 );
+	_summary->m_max = count ? max : 0;
+}
+
+//-----------------------------------------------------------------------------
+// <LatencyHistogram::GetPercentile>
+// Value at or below which the given share of the recorded values lie
+//-----------------------------------------------------------------------------
+uint32 LatencyHistogram::GetPercentile
+(
+	uint32 const _perMille
+)const
+{
+	return Percentile( m_buckets, m_count, m_max, _perMille );
+}
+
+//-----------------------------------------------------------------------------
+// <LatencyHistogram::Percentile>
+// Walk the buckets to the value of the given rank
+//-----------------------------------------------------------------------------
+uint32 LatencyHistogram::Percentile
+(
+	uint32 const* _buckets,
+	uint32 const _count,
+	uint32 const _max,
+	uint32 const _perMille
+)
+{
+	if( _count == 0 )
+	{
+		return 0;
+	}
+
+	// Rank of the value wanted, counting from one
+	uint64 rank = ( (uint64)_count * _perMille + 999 ) / 1000;
+	if( rank == 0 )
+	{
+		rank = 1;
+	}
+
+	uint64 seen = 0;
+	for( uint32 i=0; i<BucketCount; ++i )
+	{
+		seen += _buckets[i];
+		if( seen >= rank )
+		{
+			uint32 upper = BucketUpperBound( i );
+			return ( upper < _max ) ? upper : _max;
+		}
+	}
+	return _max;
+}
+
+//-----------------------------------------------------------------------------
+// <LatencyHistogram::BucketIndex>
+// Bucket that holds a value
+//-----------------------------------------------------------------------------
+uint32 LatencyHistogram::BucketIndex
+(
+	uint32 const _ms
+)
+{
+	uint32 value = _ms;
+	if( value >= ( 1u << MaxBits ) )
+	{
+		value = ( 1u << MaxBits ) - 1;
+	}
+	if( value < ( 2 * SubBuckets ) )
+	{
+		return value;
+	}
+
+	// Position of the highest set bit
+#if defined __GNUC__
+	uint32 msb = 31 - __builtin_clz( value );
+#else
+	uint32 msb = SubBucketBits;
+	while( value >> ( msb + 1 ) )
+	{
+		++msb;
+	}
+#endif
+	uint32 shift = msb - SubBucketBits;
+	return ( ( shift + 1 ) * SubBuckets ) + ( value >> shift ) - SubBuckets;
+}
+
+//-----------------------------------------------------------------------------
+// <LatencyHistogram::BucketUpperBound>
+// Largest value that falls in a bucket
+//-----------------------------------------------------------------------------
+uint32 LatencyHistogram::BucketUpperBound
+(
+	uint32 const _index
+)
+{
+	if( _index < ( 2 * SubBuckets ) )
+	{
+		return _index;
+	}
+
+	uint32 shift = ( _index / SubBuckets ) - 1;
+	uint32 mantissa = ( _index % SubBuckets ) + SubBuckets;
+	return ( ( mantissa + 1 ) << shift ) - 1;
+}
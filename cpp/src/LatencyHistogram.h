@@ -0,0 +1,95 @@
+//-----------------------------------------------------------------------------
+//
+//	LatencyHistogram.h
+//
+//	Fixed-bucket histogram of latencies in milliseconds
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _LatencyHistogram_H
+#define _LatencyHistogram_H
+
+#include "Defs.h"
+
+namespace OpenZWave
+{
+	/** \brief Fixed-bucket histogram of latencies in milliseconds.
+	 *
+	 * Values up to 31ms have a bucket each.  Above that, each power of two is split
+	 * into 16 buckets, so a percentile is never more than about 6% above the true
+	 * value.  Values of 2^21ms (about 35 minutes) and over share the last bucket, but
+	 * the largest value is kept exactly.  The buckets are a fixed array, so recording
+	 * a value never allocates, and costs a few instructions.
+	 *
+	 * Recording is done by one thread.  A summary can be taken from any thread, and
+	 * is consistent even if values are recorded while it is being taken.
+	 */
+	class LatencyHistogram
+	{
+	public:
+		struct Summary
+		{
+			uint32 m_count;				// Number of values recorded
+			uint32 m_avg;				// Mean, in ms
+			uint64 m_sum;				// Sum of the values, in ms
+			uint32 m_p50;				// Median, in ms
+			uint32 m_p90;				// 90th percentile, in ms
+			uint32 m_p99;				// 99th percentile, in ms
+			uint32 m_max;				// Largest value, in ms
+		};
+
+		LatencyHistogram(){ Reset(); }
+
+		void Record( uint32 const _ms );
+		void GetSummary( Summary* _summary )const;
+		void Reset();
+
+		uint32 GetCount()const{ return m_count; }
+		uint32 GetMax()const{ return m_max; }
+
+		/**
+		 * Value at or below which the given share of the recorded values lie.
+		 * \param _perMille the share, in thousandths.
+		 * \return the value in ms, or 0 if nothing has been recorded.
+		 */
+		uint32 GetPercentile( uint32 const _perMille )const;
+
+	private:
+		enum
+		{
+			SubBucketBits	= 4,
+			SubBuckets		= 1 << SubBucketBits,
+			MaxBits			= 21,
+			BucketCount		= ( MaxBits - SubBucketBits + 1 ) * SubBuckets
+		};
+
+		static uint32 BucketIndex( uint32 const _ms );
+		static uint32 BucketUpperBound( uint32 const _index );
+		static uint32 Percentile( uint32 const* _buckets, uint32 const _count, uint32 const _max, uint32 const _perMille );
+
+		uint32	m_buckets[BucketCount];
+		uint32	m_count;
+		uint32	m_max;
+		uint64	m_total;
+	};
+
+} // namespace OpenZWave
+
+#endif //_LatencyHistogram_H
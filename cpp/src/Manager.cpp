@@ -32,6 +32,9 @@
 #include "Defs.h"
 #include "Manager.h"
 #include "Driver.h"
+#include "DriverReactor.h"
+#include "Metrics.h"
+#include "Msg.h"
 #include "Node.h"
 #include "Notification.h"
 #include "Options.h"
@@ -40,10 +43,14 @@
 
 #include "platform/Mutex.h"
 #include "platform/Event.h"
+#include "platform/FileOps.h"
 #include "platform/Log.h"
+#include "platform/MetricsSocket.h"
+#include "platform/Trace.h"
 
 #include "command_classes/CommandClasses.h"
 #include "command_classes/CommandClass.h"
+#include "command_classes/ManufacturerSpecific.h"
 #include "command_classes/WakeUp.h"
 
 #include "value_classes/ValueID.h"
@@ -130,7 +137,11 @@ ozwversion Manager::getVersion() {
 Manager::Manager
 (
 ):
-m_notificationMutex( new Mutex() )
+m_notificationMutex( new Mutex() ),
+m_notificationDispatcher( NULL ),
+m_driverReactor( NULL ),
+m_metrics( NULL ),
+m_metricsSocket( NULL )
 {
 	// Ensure the singleton instance is set
 	s_instance = this;
@@ -169,10 +180,94 @@ m_notificationMutex( new Mutex() )
 	int nDumpTrigger = (int) LogLevel_Warning;
 	Options::Get()->GetOptionAsInt( "DumpTriggerLevel", &nDumpTrigger );
 
+	bool bAsyncLogging = false;
+	Options::Get()->GetOptionAsBool( "AsyncLogging", &bAsyncLogging );
+
 	string logFilename = userPath + logFileNameBase;
-	Log::Create( logFilename, bAppend, bConsoleOutput, (LogLevel) nSaveLogLevel, (LogLevel) nQueueLogLevel, (LogLevel) nDumpTrigger );
+	Log::Create( logFilename, bAppend, bConsoleOutput, (LogLevel) nSaveLogLevel, (LogLevel) nQueueLogLevel, (LogLevel) nDumpTrigger, bAsyncLogging );
 	Log::SetLoggingState( logging );
 
+	// Start the binary trace (if enabled)
+	bool trace = false;
+	Options::Get()->GetOptionAsBool( "Trace", &trace );
+	if( trace )
+	{
+		string traceFileName = "OZW_Trace.bin";
+		Options::Get()->GetOptionAsString( "TraceFileName", &traceFileName );
+
+		int nTraceLevel = (int) LogLevel_Info;
+		Options::Get()->GetOptionAsInt( "TraceLevel", &nTraceLevel );
+		if ((nTraceLevel == 0) || (nTraceLevel > LogLevel_StreamDetail)) {
+			Log::Write(LogLevel_Warning, "Invalid LogLevel Specified for TraceLevel in Options.xml");
+			nTraceLevel = (int) LogLevel_Info;
+		}
+
+		Trace::Create( userPath + traceFileName, bAppend, (LogLevel) nTraceLevel );
+	}
+
+	// Run all the drivers on shared threads (if enabled)
+	bool sharedDriverThread = false;
+	Options::Get()->GetOptionAsBool( "SharedDriverThread", &sharedDriverThread );
+
+	// Deliver notifications on worker threads (if enabled)
+	int nNotificationThreads = 0;
+	Options::Get()->GetOptionAsInt( "NotificationThreads", &nNotificationThreads );
+	if( sharedDriverThread && nNotificationThreads <= 0 )
+	{
+		// A slow watcher called from the shared thread would hold up every controller
+		Log::Write( LogLevel_Info, "SharedDriverThread is set, so notifications are delivered on a worker thread" );
+		nNotificationThreads = 1;
+	}
+	if( nNotificationThreads > 0 )
+	{
+		int nQueueSize = 1000;
+		Options::Get()->GetOptionAsInt( "NotificationQueueSize", &nQueueSize );
+		if( nQueueSize <= 0 ) {
+			Log::Write(LogLevel_Warning, "Invalid NotificationQueueSize Specified in Options.xml");
+			nQueueSize = 1000;
+		}
+
+		string overflow = "Block";
+		Options::Get()->GetOptionAsString( "NotificationOverflow", &overflow );
+		NotificationDispatcher::OverflowPolicy policy = NotificationDispatcher::OverflowPolicy_Block;
+		if( ToLower( overflow ) == "dropoldest" )
+		{
+			policy = NotificationDispatcher::OverflowPolicy_DropOldest;
+		}
+		else if( ToLower( overflow ) == "coalesce" )
+		{
+			policy = NotificationDispatcher::OverflowPolicy_Coalesce;
+		}
+		else if( ToLower( overflow ) != "block" )
+		{
+			Log::Write( LogLevel_Warning, "Invalid NotificationOverflow Specified in Options.xml" );
+		}
+
+		if( sharedDriverThread && ( policy == NotificationDispatcher::OverflowPolicy_Block ) )
+		{
+			// The reactor thread runs every driver, so it waiting for room in a full queue holds up every controller
+			Log::Write( LogLevel_Warning, "WARNING: SharedDriverThread is set and NotificationOverflow is Block.  A watcher that falls %d notifications behind will hold up every controller.  Set NotificationOverflow to DropOldest or Coalesce to avoid this.", nQueueSize );
+		}
+
+		m_notificationDispatcher = new NotificationDispatcher( (uint32)nNotificationThreads, (uint32)nQueueSize, policy );
+	}
+
+	if( sharedDriverThread )
+	{
+		m_driverReactor = new DriverReactor();
+	}
+
+	m_metrics = new Metrics( m_notificationDispatcher );
+	string metricsSocket = "";
+	Options::Get()->GetOptionAsString( "MetricsSocket", &metricsSocket );
+	if( !metricsSocket.empty() )
+	{
+		m_metricsSocket = new MetricsSocket( metricsSocket, Metrics::RenderEntryPoint, m_metrics );
+	}
+
+	Msg::CreatePool();
+	FileOps::Create();
+	ManufacturerSpecific::CreateConfigCache();
 	CommandClasses::RegisterCommandClasses();
 	Scene::ReadScenes();
 	Log::Write(LogLevel_Always, "OpenZwave Version %s Starting Up", getVersionAsString().c_str());
@@ -186,6 +281,13 @@ Manager::~Manager
 (
 )
 {
+	// Stop serving the metrics before the drivers go
+	if( m_metricsSocket != NULL )
+	{
+		delete m_metricsSocket;
+		m_metricsSocket = NULL;
+	}
+
 	// Clear the pending list
 	while( !m_pendingDrivers.empty() )
 	{
@@ -198,10 +300,28 @@ Manager::~Manager
 	while( !m_readyDrivers.empty() )
 	{
 		map<uint32,Driver*>::iterator it = m_readyDrivers.begin();
+		m_metrics->RemoveDriver( it->second );
 		delete it->second;
 		m_readyDrivers.erase( it );
 	}
 
+	delete m_metrics;
+	m_metrics = NULL;
+
+	// Stop the shared driver threads
+	if( m_driverReactor != NULL )
+	{
+		delete m_driverReactor;
+		m_driverReactor = NULL;
+	}
+
+	// Deliver the last of the notifications, and stop the worker threads
+	if( m_notificationDispatcher != NULL )
+	{
+		delete m_notificationDispatcher;
+		m_notificationDispatcher = NULL;
+	}
+
 	m_notificationMutex->Release();
 
 	// Clear the watchers list
@@ -220,6 +340,10 @@ Manager::~Manager
 		Node::s_genericDeviceClasses.erase( git );
 	}
 
+	ManufacturerSpecific::DestroyConfigCache();
+	Msg::DestroyPool();
+	FileOps::Destroy();
+	Trace::Destroy();
 	Log::Destroy();
 }
 
@@ -248,6 +372,18 @@ void Manager::WriteConfig
 	Scene::WriteXML( "zwscene.xml" );
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::FlushDeviceConfigCache>
+// Discard the parsed device configuration files
+//-----------------------------------------------------------------------------
+void Manager::FlushDeviceConfigCache
+(
+)
+{
+	ManufacturerSpecific::FlushConfigCache();
+	Log::Write( LogLevel_Info, "mgr,     Manager::FlushDeviceConfigCache completed" );
+}
+
 //-----------------------------------------------------------------------------
 //	Drivers
 //-----------------------------------------------------------------------------
@@ -286,7 +422,7 @@ bool Manager::AddDriver
 
 	Driver* driver = new Driver( _controllerPath, _interface );
 	m_pendingDrivers.push_back( driver );
-	driver->Start();
+	driver->Start( m_driverReactor );
 
 	Log::Write( LogLevel_Info, "mgr,     Added driver for controller %s", _controllerPath.c_str() );
 	return true;
@@ -332,6 +468,7 @@ bool Manager::RemoveDriver
 			 * will crash and burn if they can't get a valid Driver back...
 			 */
 			Log::Write( LogLevel_Info, "mgr,     Driver for controller %s pending removal", _controllerPath.c_str() );
+			m_metrics->RemoveDriver( rit->second );
 			delete rit->second;
 			m_readyDrivers.erase( rit );
 			Log::Write( LogLevel_Info, "mgr,     Driver for controller %s removed", _controllerPath.c_str() );
@@ -396,6 +533,10 @@ void Manager::SetDriverReady
 
 		// Add the driver to the ready map
 		m_readyDrivers[_driver->GetHomeId()] = _driver;
+		if( success )
+		{
+			m_metrics->AddDriver( _driver );
+		}
 
 		// Notify the watchers
 		Notification* notification = new Notification(success ? Notification::Type_DriverReady : Notification::Type_DriverFailed );
@@ -741,6 +882,70 @@ uint8 Manager::GetPollIntensity
 	return intensity;
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::SetPollPeriod>
+// Change the time between polls of this value
+//-----------------------------------------------------------------------------
+bool Manager::SetPollPeriod
+(
+		ValueID const &_valueId,
+		uint32 const _milliseconds
+)
+{
+	if( Driver* driver = GetDriver( _valueId.GetHomeId() ) )
+	{
+		return( driver->SetPollPeriod( _valueId, _milliseconds ) );
+	}
+
+	Log::Write( LogLevel_Error, "mgr,     SetPollPeriod failed - Driver with Home ID 0x%.8x is not available", _valueId.GetHomeId() );
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetPollPeriod>
+// Get the time between polls of this value
+//-----------------------------------------------------------------------------
+uint32 Manager::GetPollPeriod
+(
+		ValueID const &_valueId
+)
+{
+	uint32 period = 0;
+	if( Driver* driver = GetDriver( _valueId.GetHomeId() ) )
+	{
+		LockGuard LG(driver->m_nodeMutex);
+		if( Value* value = driver->GetValue( _valueId ) )
+		{
+			period = value->GetPollPeriod();
+			value->Release();
+		} else {
+			OZW_ERROR(OZWException::OZWEXCEPTION_INVALID_VALUEID, "Invalid ValueID passed to GetPollPeriod");
+		}
+	}
+
+	return period;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetPollSchedule>
+// Get the polled values of a driver in the order they are due
+//-----------------------------------------------------------------------------
+void Manager::GetPollSchedule
+(
+		uint32 const _homeId,
+		vector<Driver::PollScheduleEntry>* o_schedule
+)
+{
+	if( Driver* driver = GetDriver( _homeId ) )
+	{
+		driver->GetPollSchedule( o_schedule );
+		return;
+	}
+
+	o_schedule->clear();
+	Log::Write( LogLevel_Info, "mgr,     GetPollSchedule failed - Driver with Home ID 0x%.8x is not available", _homeId );
+}
+
 //-----------------------------------------------------------------------------
 //	Retrieving Node information
 //-----------------------------------------------------------------------------
@@ -1502,6 +1707,7 @@ void Manager::SetValueLabel
 		if( Value* value = driver->GetValue( _id ) )
 		{
 			value->SetLabel( _value );
+			driver->SetNodeConfigDirty( _id.GetNodeId() );
 			value->Release();
 		} else {
 			OZW_ERROR(OZWException::OZWEXCEPTION_INVALID_VALUEID, "Invalid ValueID passed to SetValueLabel");
@@ -1550,6 +1756,7 @@ void Manager::SetValueUnits
 		if( Value* value = driver->GetValue( _id ) )
 		{
 			value->SetUnits( _value );
+			driver->SetNodeConfigDirty( _id.GetNodeId() );
 			value->Release();
 		} else {
 			OZW_ERROR(OZWException::OZWEXCEPTION_INVALID_VALUEID, "Invalid ValueID passed to SetValueUnits");
@@ -1598,6 +1805,7 @@ void Manager::SetValueHelp
 		if( Value* value = driver->GetValue( _id ) )
 		{
 			value->SetHelp( _value );
+			driver->SetNodeConfigDirty( _id.GetNodeId() );
 			value->Release();
 		} else {
 			OZW_ERROR(OZWException::OZWEXCEPTION_INVALID_VALUEID, "Invalid ValueID passed to SetValueHelp");
@@ -2756,6 +2964,7 @@ void Manager::SetChangeVerified
 		if( Value* value = driver->GetValue( _id ) )
 		{
 			value->SetChangeVerified( _verify );
+			driver->SetNodeConfigDirty( _id.GetNodeId() );
 			value->Release();
 		} else {
 			OZW_ERROR(OZWException::OZWEXCEPTION_INVALID_VALUEID, "Invalid ValueID passed to SetChangeVerified");
@@ -3248,6 +3457,20 @@ bool Manager::AddWatcher
 		pfnOnNotification_t _watcher,
 		void* _context
 )
+{
+	return AddWatcher( _watcher, _context, NotificationFilter() );
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::AddWatcher>
+// Add a watcher with a filter to the list
+//-----------------------------------------------------------------------------
+bool Manager::AddWatcher
+(
+		pfnOnNotification_t _watcher,
+		void* _context,
+		NotificationFilter const& _filter
+)
 {
 	// Ensure this watcher is not already on the list
 	m_notificationMutex->Lock();
@@ -3261,8 +3484,14 @@ bool Manager::AddWatcher
 		}
 	}
 
-	m_watchers.push_back( new Watcher( _watcher, _context ) );
+	m_watchers.push_back( new Watcher( _watcher, _context, _filter ) );
+	UpdateWatcherTable();
 	m_notificationMutex->Unlock();
+
+	if( m_notificationDispatcher != NULL )
+	{
+		m_notificationDispatcher->AddWatcher( _watcher, _context, _filter );
+	}
 	return true;
 }
 
@@ -3284,7 +3513,14 @@ bool Manager::RemoveWatcher
 		{
 			delete (*it);
 			m_watchers.erase( it );
+			UpdateWatcherTable();
 			m_notificationMutex->Unlock();
+
+			// Outside the lock, as this may wait for the watcher to return
+			if( m_notificationDispatcher != NULL )
+			{
+				m_notificationDispatcher->RemoveWatcher( _watcher, _context );
+			}
 			return true;
 		}
 		++it;
@@ -3304,14 +3540,69 @@ void Manager::NotifyWatchers
 )
 {
 	m_notificationMutex->Lock();
-	for( list<Watcher*>::iterator it = m_watchers.begin(); it != m_watchers.end(); ++it )
+	vector<Watcher*> const& watchers = m_watchersByType[_notification->GetType() & 0x1f];
+
+	if( m_notificationDispatcher != NULL )
 	{
-		Watcher* pWatcher = *it;
-		pWatcher->m_callback( _notification, pWatcher->m_context );
+		// Only queue the notification if some watcher wants it.  The
+		// worker threads call the watchers with their own copy.
+		bool wanted = false;
+		for( vector<Watcher*>::const_iterator it = watchers.begin(); it != watchers.end() && !wanted; ++it )
+		{
+			wanted = (*it)->m_filter.Matches( _notification );
+		}
+		m_notificationMutex->Unlock();
+
+		if( wanted )
+		{
+			m_notificationDispatcher->QueueNotification( _notification );
+		}
+		return;
+	}
+
+	// Index rather than iterate, as a watcher may remove watchers, which
+	// rebuilds the list in place
+	size_t i = 0;
+	while( i<watchers.size() )
+	{
+		Watcher* pWatcher = watchers[i];
+		if( pWatcher->m_filter.Matches( _notification ) )
+		{
+			pWatcher->m_callback( _notification, pWatcher->m_context );
+			if( ( i>=watchers.size() ) || ( watchers[i] != pWatcher ) )
+			{
+				// A watcher at or before this one was removed, so the next
+				// one has moved down into this place
+				continue;
+			}
+		}
+		++i;
 	}
 	m_notificationMutex->Unlock();
 }
 
+//-----------------------------------------------------------------------------
+// <Manager::UpdateWatcherTable>
+// Rebuild the lists of watchers for each notification type.  The caller
+// must hold m_notificationMutex.
+//-----------------------------------------------------------------------------
+void Manager::UpdateWatcherTable
+(
+)
+{
+	for( uint32 type=0; type<32; ++type )
+	{
+		m_watchersByType[type].clear();
+		for( list<Watcher*>::iterator it = m_watchers.begin(); it != m_watchers.end(); ++it )
+		{
+			if( (*it)->m_filter.PassesType( (Notification::NotificationType)type ) )
+			{
+				m_watchersByType[type].push_back( *it );
+			}
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 //	Controller commands
 //-----------------------------------------------------------------------------
@@ -4216,3 +4507,34 @@ void Manager::GetNodeStatistics
 	}
 
 }
+
+//-----------------------------------------------------------------------------
+// <Manager::GetNotificationStatistics>
+// Retrieve the notification queue counters.
+//-----------------------------------------------------------------------------
+bool Manager::GetNotificationStatistics
+(
+		NotificationDispatcher::DispatcherData* _data
+)
+{
+	if( m_notificationDispatcher == NULL )
+	{
+		return false;
+	}
+
+	m_notificationDispatcher->GetDispatcherStatistics( _data );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <Manager::GetMetrics>
+// Write the statistics of every driver in the Prometheus text format.
+//-----------------------------------------------------------------------------
+uint32 Manager::GetMetrics
+(
+		char* _buffer,
+		uint32 const _size
+)
+{
+	return m_metrics->Render( _buffer, _size );
+}
@@ -37,6 +37,8 @@
 
 #include "Defs.h"
 #include "Driver.h"
+#include "Notification.h"
+#include "NotificationDispatcher.h"
 #include "value_classes/ValueID.h"
 
 namespace OpenZWave
@@ -50,6 +52,9 @@ namespace OpenZWave
 	class SerialPort;
 	class Thread;
 	class Notification;
+	class DriverReactor;
+	class Metrics;
+	class MetricsSocket;
 	class ValueBool;
 	class ValueByte;
 	class ValueDecimal;
@@ -194,6 +199,15 @@ namespace OpenZWave
 		 */
 		void WriteConfig( uint32 const _homeId );
 
+		/**
+		 * \brief Discards the parsed device configuration files held for the nodes of every driver.
+		 * Each device configuration file is parsed once and shared by all the nodes that use it.  A file is
+		 * parsed again if its size or modification time changes, so this only needs to be called if files in
+		 * the config folder have been replaced in a way that preserves both, or to free the memory.
+		 * Files are read again the next time a node's configuration is loaded.
+		 */
+		void FlushDeviceConfigCache();
+
 		/**
 		 * \brief Gets a pointer to the locked Options object.
 		 * \return pointer to the Options object.
@@ -414,6 +428,33 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 */
 		uint8 GetPollIntensity( ValueID const &_valueId );
 
+		/**
+		 * \brief Set the time between polls of a value.
+		 * A non-zero period overrides the poll intensity, so the value is polled on its own
+		 * schedule rather than once every few passes through the polled values.  Polling must
+		 * still be enabled with EnablePoll.
+		 * \param _valueId The ID of the value whose poll period should be set.
+		 * \param _milliseconds The time between polls, or zero to use the poll intensity.
+		 * \return True if the period was set.
+		 */
+		bool SetPollPeriod( ValueID const &_valueId, uint32 const _milliseconds );
+
+		/**
+		 * \brief Get the time between polls of a value.
+		 * \param _valueId The ID of the value to check.
+		 * \return The poll period in milliseconds, or zero if the value is polled according to its intensity.
+		 * \throws OZWException with Type OZWException::OZWEXCEPTION_INVALID_VALUEID if the ValueID is invalid
+		 * \throws OZWException with Type OZWException::OZWEXCEPTION_INVALID_HOMEID if the Driver cannot be found
+		 */
+		uint32 GetPollPeriod( ValueID const &_valueId );
+
+		/**
+		 * \brief Get the poll schedule of a driver.
+		 * \param _homeId The Home ID of the Z-Wave controller.
+		 * \param o_schedule Filled with an entry for each polled value, the next one due first.
+		 */
+		void GetPollSchedule( uint32 const _homeId, vector<Driver::PollScheduleEntry>* o_schedule );
+
 	/*@}*/
 
 	//-----------------------------------------------------------------------------
@@ -1516,6 +1557,18 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 */
 		bool AddWatcher( pfnOnNotification_t _watcher, void* _context );
 
+		/**
+		 * \brief Add a notification watcher that only wants some of the notifications.
+		 * The same as AddWatcher above, except that notifications that do not pass the filter
+		 * are not sent to the watcher.
+		 * \param _watcher pointer to a function that will be called by the notification system.
+		 * \param _context pointer to user defined data that will be passed to the watcher function with each notification.
+		 * \param _filter the notification types, nodes, command classes and genres the watcher wants.  The filter is copied.
+		 * \return true if the watcher was successfully added.
+		 * \see RemoveWatcher, Notification, NotificationFilter
+		 */
+		bool AddWatcher( pfnOnNotification_t _watcher, void* _context, NotificationFilter const& _filter );
+
 		/**
 		 * \brief Remove a notification watcher.
 		 * \param _watcher pointer to a function that must match that passed to a previous call to AddWatcher
@@ -1528,27 +1581,36 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 
 	private:
 		void NotifyWatchers( Notification* _notification );					// Passes the notifications to all the registered watcher callbacks in turn.
+		void UpdateWatcherTable();											// Rebuild m_watchersByType after a watcher is added or removed
 
 		struct Watcher
 		{
 			pfnOnNotification_t	m_callback;
 			void*				m_context;
+			NotificationFilter	m_filter;
 
 			Watcher
 			(
 				pfnOnNotification_t _callback,
-				void* _context
+				void* _context,
+				NotificationFilter const& _filter
 			):
 				m_callback( _callback ),
-				m_context( _context )
+				m_context( _context ),
+				m_filter( _filter )
 			{
 			}
 		};
 
 OPENZWAVE_EXPORT_WARNINGS_OFF
 		list<Watcher*>		m_watchers;										// List of all the registered watchers.
+		vector<Watcher*>	m_watchersByType[32];							// The watchers that want each Notification::NotificationType
 OPENZWAVE_EXPORT_WARNINGS_ON
 		Mutex*				m_notificationMutex;
+		NotificationDispatcher*	m_notificationDispatcher;						// Calls the watchers on worker threads, if NotificationThreads is set
+		DriverReactor*		m_driverReactor;								// Runs all the drivers on shared threads, if SharedDriverThread is set
+		Metrics*			m_metrics;										// The statistics of every ready driver, for GetMetrics
+		MetricsSocket*		m_metricsSocket;								// Serves m_metrics, if MetricsSocket is set
 
 	//-----------------------------------------------------------------------------
 	// Controller commands
@@ -2040,6 +2102,29 @@ OPENZWAVE_EXPORT_WARNINGS_ON
 		 */
 		void GetNodeStatistics( uint32 const _homeId, uint8 const _nodeId, Node::NodeData* _data );
 
+		/**
+		 * \brief Retrieve the notification queue counters
+		 * \param _data Pointer to structure DispatcherData to return values
+		 * \return false if notifications are delivered on the driver threads (the NotificationThreads option is 0),
+		 * in which case there is no queue and _data is not changed.
+		 */
+		bool GetNotificationStatistics( NotificationDispatcher::DispatcherData* _data );
+
+		/**
+		 * \brief Write the statistics of every driver in the Prometheus text exposition format
+		 *
+		 * Covers the driver counters, the send queues, each node's counters and round trip times,
+		 * polling, and the notification queue if NotificationThreads is set.  The statistics are
+		 * copied into space set aside when each driver became ready, so nothing is allocated, and
+		 * the strings and lists in Node::NodeData are not built.  The MetricsSocket option serves
+		 * the same text on a Unix socket.
+		 * \param _buffer Where to write the text.  It is always nul terminated, and may be NULL if _size is 0.
+		 * \param _size Size of the buffer in bytes.
+		 * \return The length of the whole text.  If it is not less than _size, the text was cut short,
+		 * and the call should be made again with a larger buffer.
+		 */
+		uint32 GetMetrics( char* _buffer, uint32 const _size );
+
 	};
 	/*@}*/
 } // namespace OpenZWave
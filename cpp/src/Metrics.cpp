@@ -0,0 +1,446 @@
+//-----------------------------------------------------------------------------
+//
+//	Metrics.cpp
+//
+//	Driver and node statistics in the Prometheus text format
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "Defs.h"
+#include "Metrics.h"
+#include "Driver.h"
+#include "Node.h"
+#include "platform/Mutex.h"
+
+using namespace OpenZWave;
+
+enum
+{
+	Scope_Driver = 0,		// One sample for each driver, from DriverData
+	Scope_Queue,			// One sample for each send queue, from QueueData
+	Scope_Node,				// One sample for each node, from NodeMetrics
+	Scope_Dispatcher		// One sample, from NotificationDispatcher::DispatcherData
+};
+
+enum
+{
+	Kind_Counter = 0,
+	Kind_Gauge,
+	Kind_CounterMs,			// A counter of ms, exported in seconds
+	Kind_GaugeMs,			// A gauge of ms, exported in seconds
+	Kind_Summary			// A LatencyHistogram::Summary of ms, exported in seconds
+};
+
+struct Metrics::Family
+{
+	char const*	m_name;
+	char const*	m_help;
+	uint8		m_scope;
+	uint8		m_kind;
+	size_t		m_offset;		// Offset of the value in the structure the scope names
+};
+
+struct Metrics::DriverSnapshot
+{
+	Driver*				m_driver;
+	uint32				m_homeId;
+	Driver::DriverData	m_data;
+	uint32				m_nodeCount;
+	Node::NodeMetrics	m_nodes[256];
+};
+
+#define DRIVER_METRIC( _name, _kind, _member, _help )	{ _name, _help, Scope_Driver, _kind, offsetof( Driver::DriverData, _member ) }
+#define QUEUE_METRIC( _name, _kind, _member, _help )	{ _name, _help, Scope_Queue, _kind, offsetof( Driver::QueueData, _member ) }
+#define NODE_METRIC( _name, _kind, _member, _help )		{ _name, _help, Scope_Node, _kind, offsetof( Node::NodeMetrics, _member ) }
+#define DISPATCHER_METRIC( _name, _kind, _member, _help )	{ _name, _help, Scope_Dispatcher, _kind, offsetof( NotificationDispatcher::DispatcherData, _member ) }
+
+Metrics::Family const Metrics::s_families[] =
+{
+	DRIVER_METRIC( "ozw_frames_read_total", Kind_Counter, m_readCnt, "Messages read from the controller" ),
+	DRIVER_METRIC( "ozw_frames_written_total", Kind_Counter, m_writeCnt, "Messages written to the controller" ),
+	DRIVER_METRIC( "ozw_sof_total", Kind_Counter, m_SOFCnt, "SOF bytes received" ),
+	DRIVER_METRIC( "ozw_ack_total", Kind_Counter, m_ACKCnt, "ACK bytes received" ),
+	DRIVER_METRIC( "ozw_nak_total", Kind_Counter, m_NAKCnt, "NAK bytes received" ),
+	DRIVER_METRIC( "ozw_can_total", Kind_Counter, m_CANCnt, "CAN bytes received" ),
+	DRIVER_METRIC( "ozw_out_of_frame_bytes_total", Kind_Counter, m_OOFCnt, "Bytes received out of framing" ),
+	DRIVER_METRIC( "ozw_bad_checksums_total", Kind_Counter, m_badChecksum, "Messages received with a bad checksum" ),
+	DRIVER_METRIC( "ozw_read_aborts_total", Kind_Counter, m_readAborts, "Reads aborted by a timeout" ),
+	DRIVER_METRIC( "ozw_ack_waiting_total", Kind_Counter, m_ACKWaiting, "Unsolicited messages received while waiting for an ACK" ),
+	DRIVER_METRIC( "ozw_messages_dropped_total", Kind_Counter, m_dropped, "Messages given up on" ),
+	DRIVER_METRIC( "ozw_messages_retried_total", Kind_Counter, m_retries, "Messages sent again" ),
+	DRIVER_METRIC( "ozw_messages_coalesced_total", Kind_Counter, m_coalesced, "Queued messages replaced by an identical or newer one" ),
+	DRIVER_METRIC( "ozw_unexpected_callbacks_total", Kind_Counter, m_callbacks, "Unexpected callbacks" ),
+	DRIVER_METRIC( "ozw_bad_routes_total", Kind_Counter, m_badroutes, "Messages failed by a bad route" ),
+	DRIVER_METRIC( "ozw_no_ack_total", Kind_Counter, m_noack, "Messages not ACKed by the node" ),
+	DRIVER_METRIC( "ozw_network_busy_total", Kind_Counter, m_netbusy, "Network busy or failure responses" ),
+	DRIVER_METRIC( "ozw_not_idle_total", Kind_Counter, m_notidle, "Network not idle responses" ),
+	DRIVER_METRIC( "ozw_non_delivery_total", Kind_Counter, m_nondelivery, "Messages not delivered to the network" ),
+	DRIVER_METRIC( "ozw_routed_busy_total", Kind_Counter, m_routedbusy, "Messages received with routed busy status" ),
+	DRIVER_METRIC( "ozw_broadcasts_read_total", Kind_Counter, m_broadcastReadCnt, "Broadcasts read" ),
+	DRIVER_METRIC( "ozw_broadcasts_written_total", Kind_Counter, m_broadcastWriteCnt, "Broadcasts sent" ),
+	DRIVER_METRIC( "ozw_notifications_debounced_total", Kind_Counter, m_debounced, "Value notifications replaced by a later one in the debounce window" ),
+	DRIVER_METRIC( "ozw_polls_total", Kind_Counter, m_pollCnt, "Polls sent" ),
+	DRIVER_METRIC( "ozw_polls_skipped_total", Kind_Counter, m_pollSkipped, "Polls skipped because the node was asleep, busy or not responding" ),
+	DRIVER_METRIC( "ozw_polls_per_minute", Kind_Gauge, m_pollRate, "Polls sent during the last full minute" ),
+	DRIVER_METRIC( "ozw_poll_load_percent", Kind_Gauge, m_pollLoad, "Percentage of network time the poll schedule asks for" ),
+	DRIVER_METRIC( "ozw_poll_scale_percent", Kind_Gauge, m_pollScale, "Percentage by which poll periods are stretched" ),
+	DRIVER_METRIC( "ozw_interviews_active", Kind_Gauge, m_interviewActive, "Nodes being interviewed" ),
+	DRIVER_METRIC( "ozw_interviews_waiting", Kind_Gauge, m_interviewWaiting, "Nodes waiting for an interview slot" ),
+	DRIVER_METRIC( "ozw_controller_reads_total", Kind_Counter, m_controllerReads, "Reads from the controller that returned data" ),
+	DRIVER_METRIC( "ozw_controller_read_bytes_total", Kind_Counter, m_controllerReadBytes, "Bytes received from the controller" ),
+	DRIVER_METRIC( "ozw_controller_wakeups_total", Kind_Counter, m_controllerWakeups, "Times the read path woke up to look for data" ),
+	DRIVER_METRIC( "ozw_controller_read_latency_seconds_max", Kind_GaugeMs, m_controllerLatencyMax, "Longest received data may have waited in the controller before it was read" ),
+	DRIVER_METRIC( "ozw_controller_buffer_bytes", Kind_Gauge, m_controllerBufferSize, "Size of the receive buffer" ),
+	DRIVER_METRIC( "ozw_controller_buffer_high_water_bytes", Kind_Gauge, m_controllerBufferHighWater, "Most data the receive buffer has held at once" ),
+	DRIVER_METRIC( "ozw_controller_overflow_bytes_total", Kind_Counter, m_controllerOverflowBytes, "Bytes dropped because the receive buffer was full" ),
+	DRIVER_METRIC( "ozw_ack_latency_seconds", Kind_Summary, m_ackLatencies, "Time from writing a message to the controller until it is ACKed" ),
+	DRIVER_METRIC( "ozw_request_rtt_seconds", Kind_Summary, m_requestRTTs, "Time from sending a message to any node until its callback" ),
+	DRIVER_METRIC( "ozw_response_rtt_seconds", Kind_Summary, m_responseRTTs, "Time from sending a message to any node until its reply" ),
+	DRIVER_METRIC( "ozw_notification_latency_seconds", Kind_Summary, m_notificationLatencies, "Time from a notification being queued until the watchers have been given it.  The count is the number of notifications sent." ),
+
+	QUEUE_METRIC( "ozw_queue_depth", Kind_Gauge, m_depth, "Messages in the send queue" ),
+	QUEUE_METRIC( "ozw_queue_depth_max", Kind_Gauge, m_maxDepth, "Most messages the send queue has held at once" ),
+	QUEUE_METRIC( "ozw_queue_sent_total", Kind_Counter, m_sent, "Messages from the send queue sent to the controller" ),
+	QUEUE_METRIC( "ozw_queue_retried_total", Kind_Counter, m_retried, "Times a message from the send queue was sent again" ),
+	QUEUE_METRIC( "ozw_queue_dropped_total", Kind_Counter, m_dropped, "Messages from the send queue given up on" ),
+	QUEUE_METRIC( "ozw_queue_coalesced_total", Kind_Counter, m_coalesced, "Messages not queued or removed because the same request was already queued" ),
+	QUEUE_METRIC( "ozw_queue_blocked_ack_seconds_total", Kind_CounterMs, m_blockedAck, "Time nothing else could be sent while waiting for an ACK to a message from the queue" ),
+	QUEUE_METRIC( "ozw_queue_blocked_callback_seconds_total", Kind_CounterMs, m_blockedCallback, "Time nothing else could be sent while waiting for a callback to a message from the queue" ),
+	QUEUE_METRIC( "ozw_queue_blocked_reply_seconds_total", Kind_CounterMs, m_blockedReply, "Time nothing else could be sent while waiting for a reply to a message from the queue" ),
+	QUEUE_METRIC( "ozw_queue_wait_seconds", Kind_Summary, m_wait, "Time messages spent in the send queue" ),
+
+	NODE_METRIC( "ozw_node_sent_total", Kind_Counter, m_sentCnt, "Messages sent to the node" ),
+	NODE_METRIC( "ozw_node_sent_failed_total", Kind_Counter, m_sentFailed, "Messages to the node that failed" ),
+	NODE_METRIC( "ozw_node_retries_total", Kind_Counter, m_retries, "Messages to the node sent again" ),
+	NODE_METRIC( "ozw_node_received_total", Kind_Counter, m_receivedCnt, "Messages received from the node" ),
+	NODE_METRIC( "ozw_node_received_duplicates_total", Kind_Counter, m_receivedDups, "Duplicate messages received from the node" ),
+	NODE_METRIC( "ozw_node_received_unsolicited_total", Kind_Counter, m_receivedUnsolicited, "Unsolicited messages received from the node" ),
+	NODE_METRIC( "ozw_node_request_rtt_seconds", Kind_Summary, m_requestRTTs, "Time from sending a message to the node until its callback" ),
+	NODE_METRIC( "ozw_node_response_rtt_seconds", Kind_Summary, m_responseRTTs, "Time from sending a message to the node until its reply" ),
+
+	DISPATCHER_METRIC( "ozw_notification_queue_depth", Kind_Gauge, m_queueDepth, "Notifications not yet delivered to every watcher" ),
+	DISPATCHER_METRIC( "ozw_notification_queue_depth_max", Kind_Gauge, m_maxQueueDepth, "Most notifications the queue has held at once" ),
+	DISPATCHER_METRIC( "ozw_notifications_queued_total", Kind_Counter, m_queued, "Notifications queued for the watchers" ),
+	DISPATCHER_METRIC( "ozw_notification_deliveries_total", Kind_Counter, m_delivered, "Calls made to watchers" ),
+	DISPATCHER_METRIC( "ozw_notifications_dropped_total", Kind_Counter, m_dropped, "Notifications dropped because the queue was full" ),
+	DISPATCHER_METRIC( "ozw_notifications_coalesced_total", Kind_Counter, m_coalesced, "ValueChanged notifications absorbed by one already queued" ),
+	DISPATCHER_METRIC( "ozw_notification_queue_blocked_total", Kind_Counter, m_blocked, "Times a driver waited for room in the queue" )
+};
+
+//-----------------------------------------------------------------------------
+// <Metrics::Metrics>
+// Constructor
+//-----------------------------------------------------------------------------
+Metrics::Metrics
+(
+	NotificationDispatcher* _dispatcher
+):
+	m_mutex( new Mutex() ),
+	m_dispatcher( _dispatcher ),
+	m_out( NULL ),
+	m_size( 0 ),
+	m_length( 0 )
+{
+}
+
+//-----------------------------------------------------------------------------
+// <Metrics::~Metrics>
+// Destructor
+//-----------------------------------------------------------------------------
+Metrics::~Metrics
+(
+)
+{
+	for( vector<DriverSnapshot*>::iterator it = m_drivers.begin(); it != m_drivers.end(); ++it )
+	{
+		delete *it;
+	}
+	m_mutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+// <Metrics::AddDriver>
+// Start exporting a driver's statistics
+//-----------------------------------------------------------------------------
+void Metrics::AddDriver
+(
+	Driver* _driver
+)
+{
+	// The snapshot is made here so rendering never allocates
+	DriverSnapshot* snapshot = new DriverSnapshot();
+	snapshot->m_driver = _driver;
+	snapshot->m_homeId = 0;
+	snapshot->m_nodeCount = 0;
+
+	m_mutex->Lock();
+	m_drivers.push_back( snapshot );
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Metrics::RemoveDriver>
+// Stop exporting a driver's statistics.  Once this returns, the driver will
+// not be touched again.
+//-----------------------------------------------------------------------------
+void Metrics::RemoveDriver
+(
+	Driver* _driver
+)
+{
+	m_mutex->Lock();
+	for( vector<DriverSnapshot*>::iterator it = m_drivers.begin(); it != m_drivers.end(); ++it )
+	{
+		if( (*it)->m_driver == _driver )
+		{
+			delete *it;
+			m_drivers.erase( it );
+			break;
+		}
+	}
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Metrics::RenderEntryPoint>
+// Render function for a MetricsSocket
+//-----------------------------------------------------------------------------
+uint32 Metrics::RenderEntryPoint
+(
+	char* _buffer,
+	uint32 const _size,
+	void* _context
+)
+{
+	return ((Metrics*)_context)->Render( _buffer, _size );
+}
+
+//-----------------------------------------------------------------------------
+// <Metrics::Render>
+// Snapshot every driver and write the text into the buffer.  Returns the
+// length of the whole text.  If that is not less than _size, the text was
+// cut short and the caller should try again with a larger buffer.
+//-----------------------------------------------------------------------------
+uint32 Metrics::Render
+(
+	char* _buffer,
+	uint32 const _size
+)
+{
+	m_mutex->Lock();
+
+	for( vector<DriverSnapshot*>::iterator it = m_drivers.begin(); it != m_drivers.end(); ++it )
+	{
+		DriverSnapshot* snapshot = *it;
+		snapshot->m_homeId = snapshot->m_driver->GetHomeId();
+		snapshot->m_driver->GetDriverStatistics( &snapshot->m_data );
+		snapshot->m_nodeCount = snapshot->m_driver->GetNodeMetrics( snapshot->m_nodes, 256 );
+	}
+	if( m_dispatcher != NULL )
+	{
+		m_dispatcher->GetDispatcherStatistics( &m_dispatcherData );
+	}
+
+	m_out = _buffer;
+	m_size = ( _buffer != NULL ) ? _size : 0;
+	m_length = 0;
+	if( m_size > 0 )
+	{
+		m_out[0] = 0;
+	}
+
+	for( uint32 i=0; i<sizeof(s_families)/sizeof(s_families[0]); ++i )
+	{
+		if( ( s_families[i].m_scope == Scope_Dispatcher ) && ( m_dispatcher == NULL ) )
+		{
+			continue;
+		}
+		WriteFamily( s_families[i], false );
+		if( s_families[i].m_kind == Kind_Summary )
+		{
+			WriteFamily( s_families[i], true );
+		}
+	}
+
+	uint32 length = m_length;
+	m_out = NULL;
+	m_mutex->Unlock();
+	return length;
+}
+
+//-----------------------------------------------------------------------------
+// <Metrics::WriteFamily>
+// Write one metric's samples for every driver.  For a summary, _max writes
+// the largest value seen as a separate gauge.
+//-----------------------------------------------------------------------------
+void Metrics::WriteFamily
+(
+	Family const& _family,
+	bool const _max
+)
+{
+	static char const* c_types[] = { "counter", "gauge", "counter", "gauge", "summary" };
+
+	char const* suffix = _max ? "_max" : "";
+	if( _max )
+	{
+		Write( "# HELP %s_max Longest of: %s\n# TYPE %s_max gauge\n", _family.m_name, _family.m_help, _family.m_name );
+	}
+	else
+	{
+		Write( "# HELP %s %s\n# TYPE %s %s\n", _family.m_name, _family.m_help, _family.m_name, c_types[_family.m_kind] );
+	}
+
+	if( _family.m_scope == Scope_Dispatcher )
+	{
+		uint8 const* base = (uint8 const*)&m_dispatcherData;
+		Write( "%s %u\n", _family.m_name, *(uint32 const*)( base + _family.m_offset ) );
+		return;
+	}
+
+	for( vector<DriverSnapshot*>::iterator it = m_drivers.begin(); it != m_drivers.end(); ++it )
+	{
+		DriverSnapshot const* snapshot = *it;
+
+		uint32 count = 1;
+		if( _family.m_scope == Scope_Queue )
+		{
+			count = Driver::MsgQueue_Count;
+		}
+		else if( _family.m_scope == Scope_Node )
+		{
+			count = snapshot->m_nodeCount;
+		}
+
+		for( uint32 i=0; i<count; ++i )
+		{
+			char labels[96];
+			uint8 const* base;
+			if( _family.m_scope == Scope_Queue )
+			{
+				snprintf( labels, sizeof(labels), "home_id=\"0x%.8x\",queue=\"%s\"", snapshot->m_homeId, Driver::GetQueueName( (Driver::MsgQueue)i ) );
+				base = (uint8 const*)&snapshot->m_data.m_queues[i];
+			}
+			else if( _family.m_scope == Scope_Node )
+			{
+				snprintf( labels, sizeof(labels), "home_id=\"0x%.8x\",node=\"%d\"", snapshot->m_homeId, snapshot->m_nodes[i].m_nodeId );
+				base = (uint8 const*)&snapshot->m_nodes[i];
+			}
+			else
+			{
+				snprintf( labels, sizeof(labels), "home_id=\"0x%.8x\"", snapshot->m_homeId );
+				base = (uint8 const*)&snapshot->m_data;
+			}
+
+			if( _family.m_kind != Kind_Summary )
+			{
+				uint32 value = *(uint32 const*)( base + _family.m_offset );
+				WriteSample( _family.m_name, suffix, labels, value, ( _family.m_kind == Kind_CounterMs ) || ( _family.m_kind == Kind_GaugeMs ) );
+				continue;
+			}
+
+			LatencyHistogram::Summary const& summary = *(LatencyHistogram::Summary const*)( base + _family.m_offset );
+			if( _max )
+			{
+				WriteSample( _family.m_name, suffix, labels, summary.m_max, true );
+				continue;
+			}
+
+			char quantile[128];
+			snprintf( quantile, sizeof(quantile), "%s,quantile=\"0.5\"", labels );
+			WriteSample( _family.m_name, "", quantile, summary.m_p50, true );
+			snprintf( quantile, sizeof(quantile), "%s,quantile=\"0.9\"", labels );
+			WriteSample( _family.m_name, "", quantile, summary.m_p90, true );
+			snprintf( quantile, sizeof(quantile), "%s,quantile=\"0.99\"", labels );
+			WriteSample( _family.m_name, "", quantile, summary.m_p99, true );
+			Write( "%s_sum{%s} %llu.%03u\n", _family.m_name, labels, (unsigned long long)( summary.m_sum / 1000 ), (uint32)( summary.m_sum % 1000 ) );
+			WriteSample( _family.m_name, "_count", labels, summary.m_count, false );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Metrics::WriteSample>
+// Write one sample.  A value in ms is written in seconds.
+//-----------------------------------------------------------------------------
+void Metrics::WriteSample
+(
+	char const* _name,
+	char const* _suffix,
+	char const* _labels,
+	uint32 const _value,
+	bool const _ms
+)
+{
+	if( _ms )
+	{
+		Write( "%s%s{%s} %u.%03u\n", _name, _suffix, _labels, _value / 1000, _value % 1000 );
+	}
+	else
+	{
+		Write( "%s%s{%s} %u\n", _name, _suffix, _labels, _value );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Metrics::Write>
+// Append to the text.  Once the buffer is full, only the length is counted.
+//-----------------------------------------------------------------------------
+void Metrics::Write
+(
+	char const* _format,
+	...
+)
+{
+	va_list args;
+	va_start( args, _format );
+#ifdef _MSC_VER
+	int count = _vscprintf( _format, args );
+	va_end( args );
+	va_start( args, _format );
+	if( ( count > 0 ) && ( m_length + count < m_size ) )
+	{
+		_vsnprintf_s( m_out + m_length, m_size - m_length, _TRUNCATE, _format, args );
+	}
+	else if( m_length < m_size )
+	{
+		// Do not leave part of a line at the end
+		m_out[m_length] = 0;
+	}
+#else
+	char* out = NULL;
+	size_t space = 0;
+	if( m_length < m_size )
+	{
+		out = m_out + m_length;
+		space = m_size - m_length;
+	}
+	int count = vsnprintf( out, space, _format, args );
+#endif
+	va_end( args );
+
+	if( count > 0 )
+	{
+		m_length += (uint32)count;
+	}
+}
@@ -0,0 +1,87 @@
+//-----------------------------------------------------------------------------
+//
+//	Metrics.h
+//
+//	Driver and node statistics in the Prometheus text format
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _Metrics_H
+#define _Metrics_H
+
+#include <vector>
+#include "Defs.h"
+#include "NotificationDispatcher.h"
+
+namespace OpenZWave
+{
+	class Driver;
+	class Mutex;
+
+	/** \brief Driver and node statistics in the Prometheus text format.
+	 *
+	 * The Manager adds each driver once it is ready.  Render takes a snapshot of every
+	 * driver's statistics, and the counters of each of its nodes, into space set aside
+	 * when the driver was added, then writes them into the caller's buffer.  Nothing is
+	 * allocated while rendering, and the strings and lists in Node::NodeData are never
+	 * built.
+	 *
+	 * Each metric's samples for every driver are written together, under one HELP and
+	 * TYPE line.  Every driver sample has a home_id label, queue metrics a queue label and
+	 * node metrics a node label.  Latencies are in seconds, and their quantiles cover
+	 * everything since the driver started.  When notifications are delivered on worker
+	 * threads, the notification queue's counters follow, without labels.
+	 */
+	class Metrics
+	{
+	public:
+		Metrics( NotificationDispatcher* _dispatcher );		// _dispatcher may be NULL
+		~Metrics();
+
+		void AddDriver( Driver* _driver );
+		void RemoveDriver( Driver* _driver );			// Waits for a render in progress to finish with the driver
+
+		uint32 Render( char* _buffer, uint32 const _size );	// Returns the length of the text, which is more than _size if it did not fit
+		static uint32 RenderEntryPoint( char* _buffer, uint32 const _size, void* _context );
+
+	private:
+		struct Family;
+		struct DriverSnapshot;
+
+		static Family const s_families[];		// Every metric, in the order they are written
+
+		void WriteFamily( Family const& _family, bool const _max );
+		void WriteSample( char const* _name, char const* _suffix, char const* _labels, uint32 const _value, bool const _ms );
+		void Write( char const* _format, ... );
+
+		Mutex*						m_mutex;				// Guards m_drivers, and serializes renders
+		vector<DriverSnapshot*>		m_drivers;
+		NotificationDispatcher*		m_dispatcher;
+		NotificationDispatcher::DispatcherData	m_dispatcherData;
+
+		// The render in progress
+		char*						m_out;
+		uint32						m_size;
+		uint32						m_length;				// Length of the text so far, including any that did not fit
+	};
+
+} // namespace OpenZWave
+
+#endif //_Metrics_H
@@ -25,16 +25,35 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <string.h>
 #include "Defs.h"
 #include "Msg.h"
 #include "Node.h"
 #include "platform/Log.h"
+#include "platform/Mutex.h"
 #include "command_classes/MultiInstance.h"
 
 using namespace OpenZWave;
 
 uint8 Msg::s_nextCallbackId = 1;
 
+Mutex*	Msg::s_poolMutex = NULL;
+void*	Msg::s_poolFree = NULL;
+uint8*	Msg::s_poolChunks = NULL;
+uint32	Msg::s_poolInUse = 0;
+
+// Each block starts with a small header recording where it came from, so that
+// messages allocated while there is no pool can still be deleted safely.
+static size_t const c_poolHeaderSize = 16;
+static size_t const c_poolBlockSize = c_poolHeaderSize + ( ( sizeof(Msg) + 15 ) & ~(size_t)15 );
+static uint32 const c_poolChunkBlocks = 32;
+
+struct MsgPoolHeader
+{
+	void*	m_next;						// Next free block, while on the free list
+	bool	m_pooled;					// False if the block came straight from the heap
+};
+
 
 //-----------------------------------------------------------------------------
 // <Msg::Msg>
@@ -42,7 +61,7 @@ uint8 Msg::s_nextCallbackId = 1;
 //-----------------------------------------------------------------------------
 Msg::Msg
 ( 
-	string const& _logText,
+	char const* _logText,
 	uint8 _targetNodeId,
 	uint8 const _msgType,
 	uint8 const _function,
@@ -51,7 +70,6 @@ Msg::Msg
 	uint8 const _expectedReply,			// = 0
 	uint8 const _expectedCommandClassId	// = 0
 ):
-	m_logText( _logText ),
 	m_bFinal( false ),
 	m_bCallbackRequired( _bCallbackRequired ),
 	m_callbackId( 0 ),
@@ -63,7 +81,9 @@ Msg::Msg
 	m_maxSendAttempts( MAX_TRIES ),
 	m_instance( 1 ),
 	m_endPoint( 0 ),
-	m_flags( 0 )
+	m_flags( 0 ),
+	m_encapLength( 0 ),
+	m_supersedeLength( 0 )
 {
 	if( _bReplyRequired )
 	{
@@ -71,6 +91,19 @@ Msg::Msg
 		m_expectedReply = _expectedReply ? _expectedReply : _function;
 	}
 
+	// Copied by hand, as snprintf on Windows fails rather than truncating
+	size_t length = _logText ? strlen( _logText ) : 0;
+	if( length < sizeof(m_logText) )
+	{
+		memcpy( m_logText, _logText ? _logText : "", length + 1 );
+	}
+	else
+	{
+		// Show that the text was cut short
+		memcpy( m_logText, _logText, sizeof(m_logText) - 4 );
+		memcpy( &m_logText[sizeof(m_logText)-4], "...", 4 );
+	}
+
 	m_buffer[0] = SOF;
 	m_buffer[1] = 0;					// Length of the following data, filled in during Finalize.
 	m_buffer[2] = _msgType;
@@ -141,7 +174,9 @@ void Msg::Finalize()
 	// Deal with Multi-Channel/Instance encapsulation
 	if( ( m_flags & ( m_MultiChannel | m_MultiInstance ) ) != 0 )
 	{
+		uint8 length = m_length;
 		MultiEncap();
+		m_encapLength = m_length - length;
 	}
 
 	// Add the callback id
@@ -199,13 +234,87 @@ void Msg::UpdateCallbackId()
 }
 
 
+//-----------------------------------------------------------------------------
+// <Msg::Supersedes>
+// Check whether this message sets the same value as another one
+//-----------------------------------------------------------------------------
+bool Msg::Supersedes
+(
+	Msg const& _other
+)const
+{
+	if( !m_bFinal || !_other.m_bFinal || ( m_supersedeLength == 0 ) )
+	{
+		return false;
+	}
+
+	if( ( m_buffer[3] != FUNC_ID_ZW_SEND_DATA ) || ( _other.m_buffer[3] != FUNC_ID_ZW_SEND_DATA ) )
+	{
+		return false;
+	}
+
+	if( ( m_targetNodeId != _other.m_targetNodeId ) || ( m_supersedeLength != _other.m_supersedeLength ) || ( m_encapLength != _other.m_encapLength ) )
+	{
+		return false;
+	}
+
+	// Compare the encapsulation header and the bytes that identify the value
+	uint32 length = m_encapLength + m_supersedeLength;
+	if( ( length > m_buffer[5] ) || ( length > _other.m_buffer[5] ) )
+	{
+		return false;
+	}
+	return( !memcmp( &m_buffer[6], &_other.m_buffer[6], length ) );
+}
+
+//-----------------------------------------------------------------------------
+// <Msg::GetQueueKey>
+// Hash the parts of the message that identify a duplicate
+//-----------------------------------------------------------------------------
+uint32 Msg::GetQueueKey
+(
+)const
+{
+	uint32 start = 2;
+	uint32 end = m_length;
+	if( m_buffer[3] == FUNC_ID_ZW_SEND_DATA )
+	{
+		// Node id, then the command class data (and any encapsulation)
+		start = 4;
+		end = 6 + m_buffer[5];
+		if( ( m_supersedeLength != 0 ) && ( m_encapLength + m_supersedeLength <= m_buffer[5] ) )
+		{
+			end = 6 + m_encapLength + m_supersedeLength;
+		}
+	}
+	else if( m_bFinal )
+	{
+		// Leave out the callback id and checksum
+		end = m_length - ( m_bCallbackRequired ? 2 : 1 );
+	}
+
+	// 32 bit FNV-1a, skipping the data length byte so that a longer or shorter
+	// set of the same value has the same key
+	uint32 hash = 2166136261U;
+	for( uint32 i=start; i<end; ++i )
+	{
+		if( ( i == 5 ) && ( start == 4 ) )
+		{
+			continue;
+		}
+		hash ^= m_buffer[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
 //-----------------------------------------------------------------------------
 // <Msg::GetAsString>
 // Create a string containing the raw data
 //-----------------------------------------------------------------------------
 string Msg::GetAsString()
 {
-	string str = m_logText;
+	string str = GetLogText();
 
 	char byteStr[16];
 	if( m_targetNodeId != 0xff )
@@ -230,6 +339,24 @@ string Msg::GetAsString()
 	return str;
 }
 
+//-----------------------------------------------------------------------------
+// <Msg::GetLogText>
+// Describe the message, including any encapsulation added by Finalize
+//-----------------------------------------------------------------------------
+string Msg::GetLogText
+(
+)const
+{
+	if( m_encapLength == 0 )
+	{
+		return m_logText;
+	}
+
+	char str[MaxLogText+48];
+	snprintf( str, sizeof(str), "%s Encapsulated (instance=%d): %s", ( m_flags & m_MultiChannel ) ? "MultiChannel" : "MultiInstance", m_instance, m_logText );
+	return str;
+}
+
 //-----------------------------------------------------------------------------
 // <Msg::MultiEncap>
 // Encapsulate the data inside a MultiInstance/Multicommand message
@@ -238,7 +365,6 @@ void Msg::MultiEncap
 (
 )
 {
-	char str[256];
 	if( m_buffer[3]	!= FUNC_ID_ZW_SEND_DATA )
 	{
 		return;
@@ -259,9 +385,6 @@ void Msg::MultiEncap
 		m_buffer[8] = 1;
 		m_buffer[9] = m_endPoint;
 		m_length += 4;
-
-		snprintf( str, sizeof(str), "MultiChannel Encapsulated (instance=%d): %s", m_instance, m_logText.c_str() );
-		m_logText = str;
 	}
 	else
 	{
@@ -276,8 +399,123 @@ void Msg::MultiEncap
 		m_buffer[7] = MultiInstance::MultiInstanceCmd_Encap;
 		m_buffer[8] = m_instance;
 		m_length += 3;
+	}
+}
 
-		snprintf( str, sizeof(str), "MultiInstance Encapsulated (instance=%d): %s", m_instance, m_logText.c_str() );
-		m_logText = str;
+//-----------------------------------------------------------------------------
+// <Msg::operator new>
+// Take a block from the message pool
+//-----------------------------------------------------------------------------
+void* Msg::operator new
+(
+	size_t _size
+)
+{
+	MsgPoolHeader* header = NULL;
+	if( ( s_poolMutex != NULL ) && ( _size <= c_poolBlockSize - c_poolHeaderSize ) )
+	{
+		s_poolMutex->Lock();
+		if( s_poolFree == NULL )
+		{
+			// Add a chunk of blocks to the free list.  The first block
+			// of each chunk links it to the previous chunk.
+			uint8* chunk = (uint8*)::operator new( c_poolBlockSize * ( c_poolChunkBlocks + 1 ) );
+			*(uint8**)chunk = s_poolChunks;
+			s_poolChunks = chunk;
+			for( uint32 i=1; i<=c_poolChunkBlocks; ++i )
+			{
+				MsgPoolHeader* block = (MsgPoolHeader*)( chunk + i * c_poolBlockSize );
+				block->m_next = s_poolFree;
+				block->m_pooled = true;
+				s_poolFree = block;
+			}
+		}
+
+		header = (MsgPoolHeader*)s_poolFree;
+		s_poolFree = header->m_next;
+		++s_poolInUse;
+		s_poolMutex->Unlock();
+	}
+	else
+	{
+		header = (MsgPoolHeader*)::operator new( c_poolHeaderSize + _size );
+		header->m_pooled = false;
+	}
+
+	return( ((uint8*)header) + c_poolHeaderSize );
+}
+
+//-----------------------------------------------------------------------------
+// <Msg::operator delete>
+// Return a block to the message pool
+//-----------------------------------------------------------------------------
+void Msg::operator delete
+(
+	void* _p
+)
+{
+	if( _p == NULL )
+	{
+		return;
+	}
+
+	MsgPoolHeader* header = (MsgPoolHeader*)( ((uint8*)_p) - c_poolHeaderSize );
+	if( !header->m_pooled )
+	{
+		::operator delete( header );
+		return;
 	}
+
+	// A pooled block can only exist while the pool does, since
+	// DestroyPool leaves the pool alone if any blocks are in use.
+	s_poolMutex->Lock();
+	header->m_next = s_poolFree;
+	s_poolFree = header;
+	--s_poolInUse;
+	s_poolMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <Msg::CreatePool>
+// Set up the message pool
+//-----------------------------------------------------------------------------
+void Msg::CreatePool
+(
+)
+{
+	if( s_poolMutex == NULL )
+	{
+		s_poolMutex = new Mutex();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <Msg::DestroyPool>
+// Free the memory held by the message pool
+//-----------------------------------------------------------------------------
+void Msg::DestroyPool
+(
+)
+{
+	if( s_poolMutex == NULL )
+	{
+		return;
+	}
+
+	if( s_poolInUse != 0 )
+	{
+		Log::Write( LogLevel_Warning, "WARNING: %d messages still in use - leaving the message pool in place", s_poolInUse );
+		return;
+	}
+
+	while( s_poolChunks != NULL )
+	{
+		uint8* chunk = s_poolChunks;
+		s_poolChunks = *(uint8**)chunk;
+		::operator delete( chunk );
+	}
+	s_poolFree = NULL;
+
+	s_poolMutex->Release();
+	s_poolMutex = NULL;
 }
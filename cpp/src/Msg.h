@@ -36,6 +36,7 @@
 namespace OpenZWave
 {
 	class CommandClass;
+	class Mutex;
 
 	/** \brief Message object to be passed to and from devices on the Z-Wave network.
 	 */
@@ -48,9 +49,34 @@ namespace OpenZWave
 			m_MultiInstance			= 0x02,		// Indicate MultiInstance encapsulation
 		};
 
-		Msg( string const& _logtext, uint8 _targetNodeId, uint8 const _msgType, uint8 const _function, bool const _bCallbackRequired, bool const _bReplyRequired = true, uint8 const _expectedReply = 0, uint8 const _expectedCommandClassId = 0 );
+		enum
+		{
+			MaxLogText = 160			// Longest log text kept with a message, including the terminator.  The longest in use is a Security encapsulation of an encapsulated message, about 130 characters.  Longer text is truncated and ends in "...".
+		};
+
+		Msg( char const* _logtext, uint8 _targetNodeId, uint8 const _msgType, uint8 const _function, bool const _bCallbackRequired, bool const _bReplyRequired = true, uint8 const _expectedReply = 0, uint8 const _expectedCommandClassId = 0 );
 		~Msg(){}
 
+		/**
+		 * \brief Messages are allocated from a pool of fixed size blocks, so that the send path
+		 * does not go to the heap for every message.  Blocks are recycled, never returned to
+		 * the heap, until DestroyPool is called.
+		 */
+		static void* operator new( size_t _size );
+		static void operator delete( void* _p );
+
+		/**
+		 * \brief Set up the message pool.  Called by the Manager before any driver is created.
+		 * Messages allocated before this, or after DestroyPool, come straight from the heap.
+		 */
+		static void CreatePool();
+
+		/**
+		 * \brief Release the message pool.  Called by the Manager once all drivers are gone.
+		 * If any pooled messages are still in use, the pool is left in place.
+		 */
+		static void DestroyPool();
+
 		void SetInstance( CommandClass* _cc, uint8 const _instance );	// Used to enable wrapping with MultiInstance/MultiChannel during finalize.
 
 		void Append( uint8 const _data );
@@ -101,9 +127,9 @@ namespace OpenZWave
 //		uint8 GetExpectedIndex()const{ return m_expectedIndex; }
 		/**
 		 * \brief get the LogText Associated with this message
-		 * \return the LogText used during the constructor
+		 * \return the LogText used during the constructor, with a note of any MultiInstance/MultiChannel encapsulation
 		 */
-		string GetLogText()const{ return m_logText; }
+		string GetLogText()const;
 
 		uint32 GetLength()const{ return m_length; }
 		uint8* GetBuffer(){ return m_buffer; }
@@ -124,6 +150,29 @@ namespace OpenZWave
 			return( m_bFinal && (m_length==11) && (m_buffer[3]==0x13) && (m_buffer[6]==0x00) && (m_buffer[7]==0x00) );
 		}
 
+		/**
+		 * \brief Mark this message as setting a value, so that while it is queued, a newer
+		 * message setting the same value replaces it.
+		 * \param _length Number of command class bytes, starting with the command class id,
+		 * that identify the value being set (for example the command class, command and
+		 * parameter number of a ConfigurationCmd_Set).
+		 */
+		void SetSupersede( uint8 const _length ){ m_supersedeLength = _length; }
+
+		/**
+		 * \brief Determine whether this message sets the same value as another queued message,
+		 * making the other one redundant.
+		 * \see SetSupersede
+		 */
+		bool Supersedes( Msg const& _other )const;
+
+		/**
+		 * \brief Hash of the target node and the command class data (or, for a message marked with
+		 * SetSupersede, just the bytes that identify the value).  Messages that are equal or that
+		 * supersede each other have the same key.
+		 */
+		uint32 GetQueueKey()const;
+
 		bool operator == ( Msg const& _other )const
 		{
 			if( m_bFinal && _other.m_bFinal )
@@ -146,7 +195,7 @@ namespace OpenZWave
 	private:
 		void MultiEncap();					// Encapsulate the data inside a MultiInstance/Multicommand message
 
-		string			m_logText;
+		char			m_logText[MaxLogText];
 		bool			m_bFinal;
 		bool			m_bCallbackRequired;
 
@@ -163,8 +212,15 @@ namespace OpenZWave
 		uint8			m_instance;
 		uint8			m_endPoint;			// Endpoint to use if the message must be wrapped in a multiInstance or multiChannel command class
 		uint8			m_flags;
+		uint8			m_encapLength;		// Number of bytes added by MultiInstance/MultiChannel encapsulation
+		uint8			m_supersedeLength;	// Number of command class bytes that identify the value set by this message
 
 		static uint8		s_nextCallbackId;		// counter to get a unique callback id
+
+		static Mutex*		s_poolMutex;			// Guards the message pool.  NULL when there is no pool.
+		static void*		s_poolFree;				// Free list of pooled blocks
+		static uint8*		s_poolChunks;			// Chunks of blocks, linked through their first bytes
+		static uint32		s_poolInUse;			// Number of pooled blocks handed out
 	};
 
 } // namespace OpenZWave
@@ -25,6 +25,7 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <time.h>
 #include "Node.h"
 #include "Defs.h"
 #include "Group.h"
@@ -118,6 +119,7 @@ Node::Node
 	m_manufacturerSpecificClassReceived( false ),
 	m_nodeInfoSupported( true ),
 	m_nodeAlive( true ),	// assome live node
+	m_fastRestart( false ),
 	m_listening( true ),	// assume we start out listening
 	m_frequentListening( false ),
 	m_beaming( false ),
@@ -157,6 +159,8 @@ Node::Node
 {
 	memset( m_neighbors, 0, sizeof(m_neighbors) );
 	memset( m_routeNodes, 0, sizeof(m_routeNodes) );
+	memset( m_queryStageTime, 0, sizeof(m_queryStageTime) );
+	memset( m_queryStageRefreshed, 0, sizeof(m_queryStageRefreshed) );
 	AddCommandClass( 0 );
 }
 
@@ -170,6 +174,7 @@ Node::~Node
 {
 	// Remove any messages from queues
 	GetDriver()->RemoveQueues( m_nodeId );
+	GetDriver()->EndInterview( m_nodeId );
 
 	// Remove the values from the poll list
 	for( ValueStore::Iterator it = m_values->Begin(); it != m_values->End(); ++it )
@@ -233,6 +238,14 @@ void Node::AdvanceQueries
 
 	Log::Write( LogLevel_Detail, m_nodeId, "AdvanceQueries queryPending=%d queryRetries=%d queryStage=%s live=%d", m_queryPending, m_queryRetries, c_queryStageNames[m_queryStage], m_nodeAlive );
 	bool addQSC = false;			// We only want to add a query stage complete if we did some work.
+
+	// Past the protocol info, which only asks the controller, the driver may
+	// limit how many nodes are interviewed at once
+	if( m_queryStage > QueryStage_ProtocolInfo && m_queryStage != QueryStage_Complete && !GetDriver()->AdmitInterview( this ) )
+	{
+		return;
+	}
+
 	while( !m_queryPending && m_nodeAlive )
 	{
 		switch( m_queryStage )
@@ -509,9 +522,10 @@ void Node::AdvanceQueries
 				// Send a NoOperation message to see if the node is awake
 				// and alive. Based on the response or lack of response
 				// will determine next step. Called here when configuration exists.
+				// On a fast restart the background refresh finds out instead.
 				//
 				NoOperation* noop = static_cast<NoOperation*>( GetCommandClass( NoOperation::StaticGetCommandClassId() ) );
-				if( GetDriver()->GetNodeId() != m_nodeId )
+				if( GetDriver()->GetNodeId() != m_nodeId && !m_fastRestart )
 				{
 					noop->Set( true );
 				      	m_queryPending = true;
@@ -529,7 +543,7 @@ void Node::AdvanceQueries
 				// if this device supports COMMAND_CLASS_ASSOCIATION, determine to which groups this node belong
 				Log::Write( LogLevel_Detail, m_nodeId, "QueryStage_Associations" );
 				Association* acc = static_cast<Association*>( GetCommandClass( Association::StaticGetCommandClassId() ) );
-				if( acc )
+				if( acc && !IsQueryStageFresh( QueryStage_Associations ) )
 				{
 					acc->RequestAllGroups( 0 );
 					m_queryPending = true;
@@ -547,6 +561,12 @@ void Node::AdvanceQueries
 			{
 				// retrieves this node's neighbors and stores the neighbor bitmap in the node object
 				Log::Write( LogLevel_Detail, m_nodeId, "QueryStage_Neighbors" );
+				if( IsQueryStageFresh( QueryStage_Neighbors ) )
+				{
+					m_queryStage = QueryStage_Session;
+					m_queryRetries = 0;
+					break;
+				}
 				GetDriver()->RequestNodeNeighbors( m_nodeId, 0 );
 				m_queryPending = true;
 				addQSC = true;
@@ -557,11 +577,14 @@ void Node::AdvanceQueries
 				// Request the session values from the command classes in turn
 				// examples of Session information are: current thermostat setpoints, node names and climate control schedules
 				Log::Write( LogLevel_Detail, m_nodeId, "QueryStage_Session" );
-				for( map<uint8,CommandClass*>::const_iterator it = m_commandClassMap.begin(); it != m_commandClassMap.end(); ++it )
+				if( !IsQueryStageFresh( QueryStage_Session ) )
 				{
-					if( !it->second->IsAfterMark() )
+					for( map<uint8,CommandClass*>::const_iterator it = m_commandClassMap.begin(); it != m_commandClassMap.end(); ++it )
 					{
-						m_queryPending |= it->second->RequestStateForAllInstances( CommandClass::RequestFlag_Session, Driver::MsgQueue_Query );
+						if( !it->second->IsAfterMark() )
+						{
+							m_queryPending |= it->second->RequestStateForAllInstances( CommandClass::RequestFlag_Session, Driver::MsgQueue_Query );
+						}
 					}
 				}
 				addQSC = m_queryPending;
@@ -577,7 +600,19 @@ void Node::AdvanceQueries
 				// Request the dynamic values from the node, that can change at any time
 				// Examples include on/off state, heating mode, temperature, etc.
 				Log::Write( LogLevel_Detail, m_nodeId, "QueryStage_Dynamic" );
-				m_queryPending = RequestDynamicValues();
+				if( m_fastRestart )
+				{
+					// The cached values are used straight away, and stay unset
+					// (see Manager::IsValueSet) until the node reports them
+					if( !IsQueryStageFresh( QueryStage_Dynamic ) )
+					{
+						RequestDynamicValues( true );
+					}
+				}
+				else
+				{
+					m_queryPending = RequestDynamicValues();
+				}
 				addQSC = m_queryPending;
 
 				if( !m_queryPending )
@@ -610,6 +645,7 @@ void Node::AdvanceQueries
 			case QueryStage_Complete:
 			{
 				ClearAddingNode();
+				m_fastRestart = false;
 				// Notify the watchers that the queries are complete for this node
 				Log::Write( LogLevel_Detail, m_nodeId, "QueryStage_Complete" );
 				Notification* notification = new Notification( Notification::Type_NodeQueriesComplete );
@@ -618,6 +654,7 @@ void Node::AdvanceQueries
 
 				// Check whether all nodes are now complete
 				GetDriver()->CheckCompletedNodeQueries();
+				GetDriver()->EndInterview( m_nodeId );
 				return;
 			}
 			default:
@@ -652,6 +689,12 @@ void Node::QueryStageComplete
 
 	if( m_queryStage != QueryStage_Complete )
 	{
+		int32 elapsed = -m_queryStageStart.TimeRemaining();
+		m_queryStageTime[m_queryStage] += (uint32)elapsed;
+		m_queryStageRefreshed[m_queryStage] = (uint32)time( NULL );
+		m_queryStageStart.SetTime( 0 );
+		Log::Write( LogLevel_Info, m_nodeId, "Query stage %s complete after %d ms", c_queryStageNames[m_queryStage], elapsed );
+
 		// Move to the next stage
 		m_queryPending = false;
 		m_queryStage = (QueryStage)( (uint32)m_queryStage + 1 );
@@ -663,6 +706,37 @@ void Node::QueryStageComplete
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <Node::IsQueryStageFresh>
+// On a fast restart, check whether a stage completed recently enough that
+// the results read from the configuration file can be used as they are
+//-----------------------------------------------------------------------------
+bool Node::IsQueryStageFresh
+(
+	QueryStage const _stage
+)
+{
+	if( !m_fastRestart || m_queryStageRefreshed[_stage] == 0 )
+	{
+		return false;
+	}
+
+	int32 ttl = GetDriver()->m_queryStageTTL[_stage];
+	if( ttl < 0 )
+	{
+		return false;
+	}
+
+	uint32 age = (uint32)time( NULL ) - m_queryStageRefreshed[_stage];
+	if( age > (uint32)ttl )
+	{
+		return false;
+	}
+
+	Log::Write( LogLevel_Info, m_nodeId, "Using the cached results of query stage %s, from %d seconds ago", c_queryStageNames[_stage], age );
+	return true;
+}
+
 //-----------------------------------------------------------------------------
 // <Node::QueryStageRetry>
 // Retry a stage up to the specified maximum
@@ -820,6 +894,9 @@ void Node::ReadXML
 		{
 			m_queryConfiguration = true;
 		}
+
+		// Only a node that got through its static stages can skip ahead
+		m_fastRestart = GetDriver()->m_fastRestart && ( queryStage == QueryStage_Associations );
 	}
 
 	if( m_queryStage != QueryStage_None )
@@ -946,6 +1023,35 @@ void Node::ReadXML
 			{
 				ReadCommandClassesXML( child );
 			}
+			else if( !strcmp( str, "Refreshed" ) )
+			{
+				for( uint32 i=0; i<(uint32)QueryStage_Complete; ++i )
+				{
+					if( TIXML_SUCCESS == child->QueryIntAttribute( c_queryStageNames[i], &intVal ) )
+					{
+						m_queryStageRefreshed[i] = (uint32)intVal;
+					}
+				}
+			}
+			else if( !strcmp( str, "Neighbors" ) )
+			{
+				// Comma separated list of node ids
+				str = child->GetText();
+				while( str != NULL && *str )
+				{
+					char* end;
+					uint32 neighbor = (uint32)strtol( str, &end, 10 );
+					if( end == str )
+					{
+						break;
+					}
+					if( neighbor >= 1 && neighbor <= 29*8 )
+					{
+						m_neighbors[(neighbor-1)>>3] |= (uint8)( 0x01 << ( (neighbor-1) & 0x07 ) );
+					}
+					str = ( *end == ',' ) ? end + 1 : end;
+				}
+			}
 			else if( !strcmp( str, "Manufacturer" ) )
 			{
 				str = child->Attribute( "id" );
@@ -1170,6 +1276,39 @@ void Node::WriteXML
 	productElement->SetAttribute( "id", m_productId.c_str() );
 	productElement->SetAttribute( "name", m_productName.c_str() );
 
+	// Write when the stages that are refreshed on every start last completed,
+	// and the neighbors, so that FastRestart can skip the ones still current
+	TiXmlElement* refreshedElement = NULL;
+	for( uint32 i=(uint32)QueryStage_Associations; i<(uint32)QueryStage_Configuration; ++i )
+	{
+		if( m_queryStageRefreshed[i] != 0 )
+		{
+			if( refreshedElement == NULL )
+			{
+				refreshedElement = new TiXmlElement( "Refreshed" );
+				nodeElement->LinkEndChild( refreshedElement );
+			}
+			snprintf( str, 32, "%u", m_queryStageRefreshed[i] );
+			refreshedElement->SetAttribute( c_queryStageNames[i], str );
+		}
+	}
+
+	if( m_queryStageRefreshed[QueryStage_Neighbors] != 0 )
+	{
+		string neighbors;
+		for( uint32 i=0; i<29*8; ++i )
+		{
+			if( m_neighbors[i>>3] & ( 0x01 << ( i & 0x07 ) ) )
+			{
+				snprintf( str, 32, neighbors.empty() ? "%d" : ",%d", i+1 );
+				neighbors += str;
+			}
+		}
+		TiXmlElement* neighborsElement = new TiXmlElement( "Neighbors" );
+		nodeElement->LinkEndChild( neighborsElement );
+		neighborsElement->LinkEndChild( new TiXmlText( neighbors.c_str() ) );
+	}
+
 	// Write the command classes
 	TiXmlElement* ccsElement = new TiXmlElement( "CommandClasses" );
 	nodeElement->LinkEndChild( ccsElement );
@@ -1448,6 +1587,7 @@ void Node::SetNodeAlive
 		{
 			// Check whether all nodes are now complete
 			GetDriver()->CheckCompletedNodeQueries();
+			GetDriver()->EndInterview( m_nodeId );
 		}
 		notification = new Notification( Notification::Type_Notification );
 		notification->SetHomeAndNodeIds( m_homeId, m_nodeId );
@@ -1735,10 +1875,10 @@ bool Node::RequestAllConfigParams
 	if( Configuration* cc = static_cast<Configuration*>( GetCommandClass( Configuration::StaticGetCommandClassId() ) ) )
 	{
 		// Go through all the values in the value store, and request all those which are in the Configuration command class
-		for( ValueStore::Iterator it = m_values->Begin(); it != m_values->End(); ++it )
+		for( ValueStore::Iterator it = m_values->Begin( Configuration::StaticGetCommandClassId() ); it != m_values->End( Configuration::StaticGetCommandClassId() ); ++it )
 		{
 			Value* value = it->second;
-			if( value->GetID().GetCommandClassId() == Configuration::StaticGetCommandClassId() && !value->IsWriteOnly() )
+			if( !value->IsWriteOnly() )
 			{
 				/* put the ConfigParams Request into the MsgQueue_Query queue. This is so MsgQueue_Send doesn't get backlogged with a
 				 * lot of ConfigParams requests, and should help speed up any user generated messages being sent out (as the MsgQueue_Send has a higher
@@ -1758,6 +1898,7 @@ bool Node::RequestAllConfigParams
 //-----------------------------------------------------------------------------
 bool Node::RequestDynamicValues
 (
+	bool const _background	// = false
 )
 {
 	bool res = false;
@@ -1765,7 +1906,7 @@ bool Node::RequestDynamicValues
 	{
 		if( !it->second->IsAfterMark() )
 		{
-			res |= it->second->RequestStateForAllInstances( CommandClass::RequestFlag_Dynamic, Driver::MsgQueue_Send );
+			res |= it->second->RequestStateForAllInstances( CommandClass::RequestFlag_Dynamic, _background ? Driver::MsgQueue_Poll : Driver::MsgQueue_Send );
 		}
 	}
 
@@ -2786,8 +2927,11 @@ void Node::GetNodeStatistics
 	_data->m_receivedTS = m_receivedTS.GetAsString();
 	_data->m_averageRequestRTT = m_averageRequestRTT;
 	_data->m_averageResponseRTT = m_averageResponseRTT;
+	m_requestRTTs.GetSummary( &_data->m_requestRTTs );
+	m_responseRTTs.GetSummary( &_data->m_responseRTTs );
 	_data->m_quality = m_quality;
 	memcpy( _data->m_lastReceivedMessage, m_lastReceivedMessage, sizeof(m_lastReceivedMessage) );
+	memcpy( _data->m_queryStageTime, m_queryStageTime, sizeof(m_queryStageTime) );
 	for( map<uint8,CommandClass*>::const_iterator it = m_commandClassMap.begin(); it != m_commandClassMap.end(); ++it )
 	{
 		CommandClassData ccData;
@@ -2798,6 +2942,26 @@ void Node::GetNodeStatistics
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <Node::GetNodeMetrics>
+// Return the counters exported as metrics
+//-----------------------------------------------------------------------------
+void Node::GetNodeMetrics
+(
+	NodeMetrics* _data
+)
+{
+	_data->m_nodeId = m_nodeId;
+	_data->m_sentCnt = m_sentCnt;
+	_data->m_sentFailed = m_sentFailed;
+	_data->m_retries = m_retries;
+	_data->m_receivedCnt = m_receivedCnt;
+	_data->m_receivedDups = m_receivedDups;
+	_data->m_receivedUnsolicited = m_receivedUnsolicited;
+	m_requestRTTs.GetSummary( &_data->m_requestRTTs );
+	m_responseRTTs.GetSummary( &_data->m_responseRTTs );
+}
+
 //-----------------------------------------------------------------------------
 // <DeviceClass::DeviceClass>
 // Constructor
@@ -36,6 +36,7 @@
 #include "value_classes/ValueID.h"
 #include "value_classes/ValueList.h"
 #include "Msg.h"
+#include "LatencyHistogram.h"
 #include "platform/TimeStamp.h"
 
 class TiXmlElement;
@@ -207,7 +208,7 @@ namespace OpenZWave
 		 * \return Specified query stage string.
 		 * \see m_queryStage, m_queryPending
 		 */
-		string GetQueryStageName( QueryStage const _stage );
+		static string GetQueryStageName( QueryStage const _stage );
 
 		/**
 		 * Returns whether the library thinks a node is functioning properly
@@ -255,6 +256,12 @@ namespace OpenZWave
 		bool		m_manufacturerSpecificClassReceived;
 		bool		m_nodeInfoSupported;
 		bool		m_nodeAlive;
+		TimeStamp	m_queryStageStart;					// When the current query stage started
+		uint32		m_queryStageTime[QueryStage_Complete];		// ms spent in each query stage
+		uint32		m_queryStageRefreshed[QueryStage_Complete];	// When each query stage last completed, in seconds since 1970, or 0
+		bool		m_fastRestart;						// Read from the configuration file with FastRestart set, and not yet fully refreshed
+
+		bool IsQueryStageFresh( QueryStage const _stage );	// FastRestart: the stage's results are recent enough to be used without asking the node
 
 	//-----------------------------------------------------------------------------
 	// Capabilities
@@ -457,7 +464,7 @@ namespace OpenZWave
 	// Dynamic Values (used by query and other command classes for updating)
 	//-----------------------------------------------------------------------------
 	private:
-		bool RequestDynamicValues();
+		bool RequestDynamicValues( bool const _background = false );	// _background sends the requests on the poll queue
 	//-----------------------------------------------------------------------------
 	// Groups
 	//-----------------------------------------------------------------------------
@@ -547,13 +554,31 @@ namespace OpenZWave
 			uint32 m_averageRequestRTT;				// ms
 			uint32 m_lastResponseRTT;
 			uint32 m_averageResponseRTT;
+			LatencyHistogram::Summary m_requestRTTs;		// Callback RTT of every message sent to the node, in ms
+			LatencyHistogram::Summary m_responseRTTs;		// RTT of every reply from the node, in ms
 			uint8 m_quality;					// Node quality measure
 			uint8 m_lastReceivedMessage[254];
 			list<CommandClassData> m_ccData;
+			uint32 m_queryStageTime[QueryStage_Complete];	// ms spent in each query stage, including waiting for a sleeping node to wake
+		};
+
+		// The counters from NodeData that the metrics export, without the strings and lists
+		struct NodeMetrics
+		{
+			uint8 m_nodeId;
+			uint32 m_sentCnt;
+			uint32 m_sentFailed;
+			uint32 m_retries;
+			uint32 m_receivedCnt;
+			uint32 m_receivedDups;
+			uint32 m_receivedUnsolicited;
+			LatencyHistogram::Summary m_requestRTTs;
+			LatencyHistogram::Summary m_responseRTTs;
 		};
 
 	private:
 		void GetNodeStatistics( NodeData* _data );
+		void GetNodeMetrics( NodeMetrics* _data );
 
 		uint32 m_sentCnt;				// Number of messages sent from this node.
 		uint32 m_sentFailed;				// Number of sent messages failed
@@ -567,6 +592,8 @@ namespace OpenZWave
 		TimeStamp m_receivedTS;				// Last message received time
 		uint32 m_averageRequestRTT;			// Average Request round trip time.
 		uint32 m_averageResponseRTT;			// Average Reponse round trip time.
+		LatencyHistogram m_requestRTTs;			// Every request RTT, for percentiles
+		LatencyHistogram m_responseRTTs;		// Every response RTT, for percentiles
 		uint8 m_quality;				// Node quality measure
 		uint8 m_lastReceivedMessage[254];		// Place to hold last received message
 		uint8 m_errors;					// Count errors for dead node detection
@@ -42,6 +42,7 @@ namespace OpenZWave
 	class OPENZWAVE_EXPORT Notification
 	{
 		friend class Manager;
+		friend class NotificationDispatcher;
 		friend class Driver;
 		friend class Node;
 		friend class Group;
@@ -171,8 +172,16 @@ namespace OpenZWave
 		 */
 		uint8 GetByte()const{ return m_byte; }
 
+		/**
+		 * Get the number of earlier notifications for the same value that this one replaces.
+		 * Only non-zero for Type_ValueChanged and Type_ValueRefreshed notifications held back by the
+		 * ValueChangeDebounce option, in which case only the latest update within the window is sent.
+		 * \return the number of updates that were not sent.
+		 */
+		uint32 GetSuppressedCount()const{ return m_suppressed; }
+
 	private:
-		Notification( NotificationType _type ): m_type( _type ), m_byte(0){}
+		Notification( NotificationType _type ): m_type( _type ), m_byte(0), m_suppressed(0), m_queuedTime(0){}
 		~Notification(){}
 
 		void SetHomeAndNodeIds( uint32 const _homeId, uint8 const _nodeId ){ m_valueId = ValueID( _homeId, _nodeId ); }
@@ -183,10 +192,157 @@ namespace OpenZWave
 		void SetSceneId( uint8 const _sceneId ){ assert(Type_SceneEvent==m_type); m_byte = _sceneId; }
 		void SetButtonId( uint8 const _buttonId ){ assert(Type_CreateButton==m_type||Type_DeleteButton==m_type||Type_ButtonOn==m_type||Type_ButtonOff==m_type); m_byte = _buttonId; }
 		void SetNotification( uint8 const _noteId ){ assert(Type_Notification==m_type); m_byte = _noteId; }
+		void SetSuppressedCount( uint32 const _count ){ m_suppressed = _count; }
+		void SetType( NotificationType const _type ){ m_type = _type; }
+		void SetQueuedTime( uint32 const _time ){ m_queuedTime = _time; }
+		uint32 GetQueuedTime()const{ return m_queuedTime; }
 
 		NotificationType		m_type;
 		ValueID				m_valueId;
 		uint8				m_byte;
+		uint32				m_suppressed;
+		uint32				m_queuedTime;		// When the driver queued the notification for the watchers, in ms after the driver started
+	};
+
+	/** \brief Selects the notifications sent to a watcher.
+	 *
+	 *    Passed to Manager::AddWatcher.  A new filter lets everything through.
+	 *    Each call narrows it down, and a notification must pass every part:
+	 *
+	 *    - Types: the notification types wanted, as a mask of TypeMask() bits.
+	 *    - Nodes: if any nodes are added, only notifications about those nodes
+	 *      are sent.  Notifications about the driver or the whole network
+	 *      (DriverReady, AllNodesQueried and so on) are not filtered by node.
+	 *    - Command classes and genres: if set, value notifications (ValueAdded,
+	 *      ValueRemoved, ValueChanged and ValueRefreshed) are only sent for values
+	 *      of those command classes and genres.  Other notifications are not
+	 *      filtered by command class or genre.
+	 *
+	 *    Every test is a bit lookup, so filtering a notification takes the same
+	 *    time however many nodes or command classes are selected.
+	 */
+	class OPENZWAVE_EXPORT NotificationFilter
+	{
+	public:
+		NotificationFilter():
+			m_types( 0xffffffff ),
+			m_genres( 0xffffffff ),
+			m_bAnyNode( true ),
+			m_bAnyCommandClass( true )
+		{
+			for( int i=0; i<8; ++i )
+			{
+				m_nodes[i] = 0;
+				m_commandClasses[i] = 0;
+			}
+		}
+
+		/**
+		 * Get the mask bit for a notification type.
+		 * \param _type The notification type.
+		 * \return the bit to include in a mask passed to SetTypes.
+		 */
+		static uint32 TypeMask( Notification::NotificationType const _type ){ return( 1u << _type ); }
+
+		/**
+		 * Only send notifications of the given types.
+		 * \param _types Types wanted, made by ORing together TypeMask values.
+		 */
+		void SetTypes( uint32 const _types ){ m_types = _types; }
+
+		/**
+		 * Only send notifications about the nodes added with this method.
+		 * \param _nodeId A node of interest.  May be called as many times as needed.
+		 */
+		void AddNode( uint8 const _nodeId ){ m_bAnyNode = false; m_nodes[_nodeId>>5] |= ( 1u << (_nodeId&0x1f) ); }
+
+		/**
+		 * Only send value notifications for the command classes added with this method.
+		 * \param _commandClassId A command class of interest.  May be called as many times as needed.
+		 */
+		void AddCommandClass( uint8 const _commandClassId ){ m_bAnyCommandClass = false; m_commandClasses[_commandClassId>>5] |= ( 1u << (_commandClassId&0x1f) ); }
+
+		/**
+		 * Only send value notifications for the given genres.
+		 * \param _genres Genres wanted, as a mask of ( 1 << ValueID::ValueGenre ) bits.
+		 */
+		void SetGenres( uint32 const _genres ){ m_genres = _genres; }
+
+		/**
+		 * Determine whether a notification passes the filter.
+		 * \param _notification The notification to test.
+		 * \return true if the notification should be sent to the watcher.
+		 */
+		bool Matches( Notification const* _notification )const
+		{
+			Notification::NotificationType type = _notification->GetType();
+			if( !PassesType( type ) )
+			{
+				return false;
+			}
+
+			if( !m_bAnyNode && !IsNetworkType( type ) )
+			{
+				uint8 nodeId = _notification->GetNodeId();
+				if( ( m_nodes[nodeId>>5] & ( 1u << (nodeId&0x1f) ) ) == 0 )
+				{
+					return false;
+				}
+			}
+
+			if( type <= Notification::Type_ValueRefreshed )
+			{
+				ValueID const& valueId = _notification->GetValueID();
+				if( ( m_genres & ( 1u << valueId.GetGenre() ) ) == 0 )
+				{
+					return false;
+				}
+
+				uint8 commandClassId = valueId.GetCommandClassId();
+				if( !m_bAnyCommandClass && ( m_commandClasses[commandClassId>>5] & ( 1u << (commandClassId&0x1f) ) ) == 0 )
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		/**
+		 * Determine whether any notifications of a type can pass the filter.
+		 * \param _type The notification type.
+		 * \return false if notifications of this type are never sent to the watcher.
+		 */
+		bool PassesType( Notification::NotificationType const _type )const{ return( ( m_types & TypeMask( _type ) ) != 0 ); }
+
+	private:
+		static bool IsNetworkType( Notification::NotificationType const _type )
+		{
+			switch( _type )
+			{
+				case Notification::Type_DriverReady:
+				case Notification::Type_DriverFailed:
+				case Notification::Type_DriverReset:
+				case Notification::Type_DriverRemoved:
+				case Notification::Type_AwakeNodesQueried:
+				case Notification::Type_AllNodesQueriedSomeDead:
+				case Notification::Type_AllNodesQueried:
+				{
+					return true;
+				}
+				default:
+				{
+					return false;
+				}
+			}
+		}
+
+		uint32	m_types;
+		uint32	m_genres;
+		bool	m_bAnyNode;
+		bool	m_bAnyCommandClass;
+		uint32	m_nodes[8];
+		uint32	m_commandClasses[8];
 	};
 
 } //namespace OpenZWave
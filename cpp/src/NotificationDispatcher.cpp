@@ -0,0 +1,529 @@
+//-----------------------------------------------------------------------------
+//
+//	NotificationDispatcher.cpp
+//
+//	Delivers notifications to the watchers on a pool of worker threads
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include "Defs.h"
+#include "NotificationDispatcher.h"
+#include "Notification.h"
+#include "platform/Event.h"
+#include "platform/Log.h"
+#include "platform/Mutex.h"
+#include "platform/Thread.h"
+#include "platform/TimeStamp.h"
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::NotificationDispatcher>
+// Constructor
+//-----------------------------------------------------------------------------
+NotificationDispatcher::NotificationDispatcher
+(
+	uint32 const _threads,
+	uint32 const _queueSize,
+	OverflowPolicy const _policy
+):
+	m_mutex( new Mutex() ),
+	m_workEvent( new Event() ),
+	m_spaceEvent( new Event() ),
+	m_policy( _policy ),
+	m_exit( false ),
+	m_head( 0 ),
+	m_tail( 0 ),
+	m_maxQueueDepth( 0 ),
+	m_queued( 0 ),
+	m_delivered( 0 ),
+	m_dropped( 0 ),
+	m_coalesced( 0 ),
+	m_blocked( 0 )
+{
+	// The notifications are allocated once, and copied into and out of
+	uint32 size = _queueSize ? _queueSize : 1;
+	m_ring.reserve( size );
+	for( uint32 i=0; i<size; ++i )
+	{
+		m_ring.push_back( new Notification( Notification::Type_ValueAdded ) );
+	}
+
+	for( uint32 i=0; i<_threads; ++i )
+	{
+		char name[32];
+		snprintf( name, sizeof(name), "notify%d", i );
+
+		Worker* worker = new Worker();
+		worker->m_dispatcher = this;
+		worker->m_thread = new Thread( name );
+		worker->m_notification = new Notification( Notification::Type_ValueAdded );
+		m_workers.push_back( worker );
+		worker->m_thread->Start( NotificationDispatcher::WorkerThreadEntryPoint, worker );
+	}
+
+	Log::Write( LogLevel_Info, "Dispatching notifications on %d threads, queue size %d", _threads, size );
+}
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::~NotificationDispatcher>
+// Destructor
+//-----------------------------------------------------------------------------
+NotificationDispatcher::~NotificationDispatcher
+(
+)
+{
+	// Give the watchers a chance to see the last notifications,
+	// such as those sent when the drivers were removed
+	Flush( 5000 );
+
+	m_mutex->Lock();
+	m_exit = true;
+	m_spaceEvent->Set();
+	m_mutex->Unlock();
+
+	for( vector<Worker*>::iterator it = m_workers.begin(); it != m_workers.end(); ++it )
+	{
+		Worker* worker = *it;
+		worker->m_thread->Stop();
+		worker->m_thread->Release();
+		delete worker->m_notification;
+		delete worker;
+	}
+	m_workers.clear();
+
+	while( !m_watchers.empty() )
+	{
+		WatcherState* watcher = m_watchers.front();
+		watcher->m_callbackMutex->Release();
+		delete watcher->m_filter;
+		delete watcher;
+		m_watchers.pop_front();
+	}
+
+	for( vector<Notification*>::iterator it = m_ring.begin(); it != m_ring.end(); ++it )
+	{
+		delete *it;
+	}
+	m_ring.clear();
+
+	m_spaceEvent->Release();
+	m_workEvent->Release();
+	m_mutex->Release();
+}
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::AddWatcher>
+// Start sending notifications to a watcher
+//-----------------------------------------------------------------------------
+void NotificationDispatcher::AddWatcher
+(
+	pfnOnNotification_t _callback,
+	void* _context,
+	NotificationFilter const& _filter
+)
+{
+	WatcherState* watcher = new WatcherState();
+	watcher->m_callback = _callback;
+	watcher->m_context = _context;
+	watcher->m_filter = new NotificationFilter( _filter );
+	watcher->m_busy = false;
+	watcher->m_removed = false;
+	watcher->m_callbackMutex = new Mutex();
+
+	// A new watcher only sees notifications queued from now on
+	m_mutex->Lock();
+	watcher->m_cursor = m_head;
+	m_watchers.push_back( watcher );
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::RemoveWatcher>
+// Stop sending notifications to a watcher
+//-----------------------------------------------------------------------------
+void NotificationDispatcher::RemoveWatcher
+(
+	pfnOnNotification_t _callback,
+	void* _context
+)
+{
+	m_mutex->Lock();
+	for( list<WatcherState*>::iterator it = m_watchers.begin(); it != m_watchers.end(); ++it )
+	{
+		WatcherState* watcher = *it;
+		if( ( watcher->m_callback != _callback ) || ( watcher->m_context != _context ) || watcher->m_removed )
+		{
+			continue;
+		}
+
+		watcher->m_removed = true;
+		if( !watcher->m_busy )
+		{
+			RemoveWatcherState( it );
+			m_mutex->Unlock();
+			return;
+		}
+
+		// A worker thread is calling the watcher, and will remove it when the
+		// call returns.  Wait for that, so that the application can free the
+		// context once we return.  The callback mutex is recursive, so this does
+		// not wait if the watcher is removing itself from inside its callback.
+		Mutex* callbackMutex = watcher->m_callbackMutex;
+		callbackMutex->AddRef();
+		m_mutex->Unlock();
+
+		callbackMutex->Lock();
+		callbackMutex->Unlock();
+		callbackMutex->Release();
+		return;
+	}
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::RemoveWatcherState>
+// Forget a watcher.  The caller must hold m_mutex.
+//-----------------------------------------------------------------------------
+void NotificationDispatcher::RemoveWatcherState
+(
+	list<WatcherState*>::iterator _it
+)
+{
+	WatcherState* watcher = *_it;
+	m_watchers.erase( _it );
+	watcher->m_callbackMutex->Release();
+	delete watcher->m_filter;
+	delete watcher;
+
+	// The slots this watcher was holding on to may now be free
+	ReleaseSlots();
+}
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::QueueNotification>
+// Copy a notification into the ring, for the worker threads to deliver
+//-----------------------------------------------------------------------------
+void NotificationDispatcher::QueueNotification
+(
+	Notification const* _notification
+)
+{
+	m_mutex->Lock();
+	if( m_watchers.empty() )
+	{
+		// Nobody to tell
+		m_mutex->Unlock();
+		return;
+	}
+
+	uint64 size = m_ring.size();
+	while( ( m_head - m_tail ) >= size )
+	{
+		if( m_policy == OverflowPolicy_Block && !m_exit )
+		{
+			// Wait for the slowest watcher to make some room
+			m_blocked++;
+			m_spaceEvent->Reset();
+			m_mutex->Unlock();
+			Wait::Single( m_spaceEvent );
+			m_mutex->Lock();
+			continue;
+		}
+
+		if( m_policy == OverflowPolicy_Coalesce && CoalesceNotification( _notification ) )
+		{
+			m_coalesced++;
+			m_mutex->Unlock();
+			return;
+		}
+
+		// Drop the oldest notification.  Any watcher being called with it
+		// already has its own copy.
+		for( list<WatcherState*>::iterator it = m_watchers.begin(); it != m_watchers.end(); ++it )
+		{
+			if( (*it)->m_cursor == m_tail )
+			{
+				(*it)->m_cursor++;
+			}
+		}
+		m_tail++;
+		m_dropped++;
+	}
+
+	*m_ring[m_head % size] = *_notification;
+	m_head++;
+	m_queued++;
+
+	uint32 depth = (uint32)( m_head - m_tail );
+	if( depth > m_maxQueueDepth )
+	{
+		m_maxQueueDepth = depth;
+	}
+
+	m_workEvent->Set();
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::CoalesceNotification>
+// Look for a ValueChanged for the same value that no watcher has started on.
+// The caller must hold m_mutex.
+//-----------------------------------------------------------------------------
+bool NotificationDispatcher::CoalesceNotification
+(
+	Notification const* _notification
+)
+{
+	if( _notification->GetType() != Notification::Type_ValueChanged )
+	{
+		return false;
+	}
+
+	// Find the first notification that every watcher is still to be called with
+	uint64 start = m_tail;
+	for( list<WatcherState*>::iterator it = m_watchers.begin(); it != m_watchers.end(); ++it )
+	{
+		WatcherState* watcher = *it;
+		uint64 next = watcher->m_busy ? watcher->m_cursor + 1 : watcher->m_cursor;
+		if( next > start )
+		{
+			start = next;
+		}
+	}
+
+	uint64 size = m_ring.size();
+	for( uint64 seq = start; seq < m_head; ++seq )
+	{
+		Notification const* queued = m_ring[seq % size];
+		if( ( queued->GetType() == Notification::Type_ValueChanged ) && ( queued->GetValueID() == _notification->GetValueID() ) )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::ReleaseSlots>
+// Move the tail of the ring up to the slowest watcher.  The caller must hold m_mutex.
+//-----------------------------------------------------------------------------
+void NotificationDispatcher::ReleaseSlots
+(
+)
+{
+	uint64 tail = m_head;
+	for( list<WatcherState*>::iterator it = m_watchers.begin(); it != m_watchers.end(); ++it )
+	{
+		if( !(*it)->m_removed && ( (*it)->m_cursor < tail ) )
+		{
+			tail = (*it)->m_cursor;
+		}
+	}
+
+	if( tail > m_tail )
+	{
+		m_tail = tail;
+		m_spaceEvent->Set();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::GetNextWatcher>
+// Find a watcher with notifications waiting that no other thread is running.
+// The caller must hold m_mutex.
+//-----------------------------------------------------------------------------
+NotificationDispatcher::WatcherState* NotificationDispatcher::GetNextWatcher
+(
+)
+{
+	uint64 size = m_ring.size();
+	bool skipped = false;
+	WatcherState* next = NULL;
+	for( list<WatcherState*>::iterator it = m_watchers.begin(); it != m_watchers.end(); ++it )
+	{
+		WatcherState* watcher = *it;
+		if( watcher->m_busy || watcher->m_removed )
+		{
+			continue;
+		}
+
+		// Move past anything the watcher has filtered out
+		while( ( watcher->m_cursor < m_head ) && !watcher->m_filter->Matches( m_ring[watcher->m_cursor % size] ) )
+		{
+			watcher->m_cursor++;
+			skipped = true;
+		}
+
+		if( watcher->m_cursor < m_head )
+		{
+			// Send it to the back, so the other watchers get a turn
+			m_watchers.splice( m_watchers.end(), m_watchers, it );
+			next = watcher;
+			break;
+		}
+	}
+
+	if( skipped )
+	{
+		ReleaseSlots();
+	}
+	return next;
+}
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::Flush>
+// Wait for the watchers to catch up
+//-----------------------------------------------------------------------------
+void NotificationDispatcher::Flush
+(
+	uint32 const _timeout
+)
+{
+	TimeStamp deadline;
+	deadline.SetTime( _timeout );
+
+	m_mutex->Lock();
+	while( ( m_tail < m_head ) && !m_workers.empty() && ( deadline.TimeRemaining() > 0 ) )
+	{
+		m_mutex->Unlock();
+		Wait::Single( m_spaceEvent, 10 );
+		m_mutex->Lock();
+	}
+
+	if( m_tail < m_head )
+	{
+		Log::Write( LogLevel_Warning, "WARNING: %d notifications were not delivered", (uint32)( m_head - m_tail ) );
+	}
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::GetDispatcherStatistics>
+// Report the queue depth and counters
+//-----------------------------------------------------------------------------
+void NotificationDispatcher::GetDispatcherStatistics
+(
+	DispatcherData* _data
+)
+{
+	m_mutex->Lock();
+	_data->m_queueDepth = (uint32)( m_head - m_tail );
+	_data->m_maxQueueDepth = m_maxQueueDepth;
+	_data->m_queued = m_queued;
+	_data->m_delivered = m_delivered;
+	_data->m_dropped = m_dropped;
+	_data->m_coalesced = m_coalesced;
+	_data->m_blocked = m_blocked;
+	m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::WorkerThreadEntryPoint>
+// Entry point of a worker thread
+//-----------------------------------------------------------------------------
+void NotificationDispatcher::WorkerThreadEntryPoint
+(
+	Event* _exitEvent,
+	void* _context
+)
+{
+	Worker* worker = (Worker*)_context;
+	if( worker )
+	{
+		worker->m_dispatcher->WorkerThreadProc( _exitEvent, worker );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <NotificationDispatcher::WorkerThreadProc>
+// Deliver notifications to the watchers, one watcher at a time
+//-----------------------------------------------------------------------------
+void NotificationDispatcher::WorkerThreadProc
+(
+	Event* _exitEvent,
+	Worker* _worker
+)
+{
+	while( true )
+	{
+		Wait* waitObjects[2];
+		waitObjects[0] = _exitEvent;			// Thread must exit.
+		waitObjects[1] = m_workEvent;			// Notifications waiting to be delivered.
+		if( Wait::Multiple( waitObjects, 2 ) == 0 )
+		{
+			return;
+		}
+
+		m_mutex->Lock();
+		WatcherState* watcher = GetNextWatcher();
+		if( watcher == NULL )
+		{
+			// Every watcher is up to date, or being run by another thread
+			m_workEvent->Reset();
+			m_mutex->Unlock();
+			continue;
+		}
+
+		// Take a copy, so the slot can be dropped while the watcher runs
+		uint64 seq = watcher->m_cursor;
+		*_worker->m_notification = *m_ring[seq % m_ring.size()];
+		watcher->m_busy = true;
+		m_mutex->Unlock();
+
+		watcher->m_callbackMutex->Lock();
+		if( !watcher->m_removed )
+		{
+			watcher->m_callback( _worker->m_notification, watcher->m_context );
+		}
+		watcher->m_callbackMutex->Unlock();
+
+		m_mutex->Lock();
+		m_delivered++;
+		watcher->m_busy = false;
+		if( watcher->m_cursor == seq )
+		{
+			// Unless the notification was dropped while the watcher ran
+			watcher->m_cursor++;
+		}
+
+		if( watcher->m_removed )
+		{
+			for( list<WatcherState*>::iterator it = m_watchers.begin(); it != m_watchers.end(); ++it )
+			{
+				if( *it == watcher )
+				{
+					RemoveWatcherState( it );
+					break;
+				}
+			}
+		}
+		else
+		{
+			ReleaseSlots();
+		}
+
+		// This watcher, or one that was skipped while it was busy, may have more to do
+		m_workEvent->Set();
+		m_mutex->Unlock();
+	}
+}
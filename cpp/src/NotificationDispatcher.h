@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+//
+//	NotificationDispatcher.h
+//
+//	Delivers notifications to the watchers on a pool of worker threads
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _NotificationDispatcher_H
+#define _NotificationDispatcher_H
+
+#include <list>
+#include <vector>
+#include "Defs.h"
+
+namespace OpenZWave
+{
+	class Event;
+	class Mutex;
+	class Notification;
+	class NotificationFilter;
+	class Thread;
+
+	/** \brief Delivers notifications to the watchers on a pool of worker threads.
+	 *
+	 * Without a dispatcher, the driver thread calls every watcher itself, so a slow
+	 * watcher holds up the serial port.  With one, the driver thread copies each
+	 * notification into a fixed size ring and carries on.  Every watcher has its own
+	 * position in the ring, and is only ever run by one worker thread at a time, so
+	 * each watcher sees the notifications in the order they were sent.  A slot in the
+	 * ring is reused once every watcher has passed it.
+	 *
+	 * When the ring is full, the OverflowPolicy decides what happens to the driver thread.
+	 */
+	class NotificationDispatcher
+	{
+	public:
+		typedef void (*pfnOnNotification_t)( Notification const* _pNotification, void* _context );
+
+		enum OverflowPolicy
+		{
+			OverflowPolicy_Block = 0,			/**< The driver thread waits for the slowest watcher */
+			OverflowPolicy_DropOldest,			/**< The oldest notification is dropped for the watchers that have not had it */
+			OverflowPolicy_Coalesce				/**< A ValueChanged already waiting for every watcher absorbs a new one for the same value.  Otherwise the oldest notification is dropped. */
+		};
+
+		struct DispatcherData
+		{
+			uint32 m_queueDepth;			// Number of notifications not yet delivered to every watcher
+			uint32 m_maxQueueDepth;			// Highest queue depth seen
+			uint32 m_queued;				// Number of notifications queued
+			uint32 m_delivered;				// Number of calls made to watchers
+			uint32 m_dropped;				// Number of notifications dropped because the queue was full
+			uint32 m_coalesced;				// Number of ValueChanged notifications absorbed by one already queued
+			uint32 m_blocked;				// Number of times the driver thread waited for room in the queue
+		};
+
+		NotificationDispatcher( uint32 const _threads, uint32 const _queueSize, OverflowPolicy const _policy );
+		~NotificationDispatcher();
+
+		void AddWatcher( pfnOnNotification_t _callback, void* _context, NotificationFilter const& _filter );
+		void RemoveWatcher( pfnOnNotification_t _callback, void* _context );		// Waits for any call to the watcher in progress on another thread
+
+		void QueueNotification( Notification const* _notification );			// Copies the notification, so the caller keeps ownership
+		void GetDispatcherStatistics( DispatcherData* _data );
+
+	private:
+		struct WatcherState
+		{
+			pfnOnNotification_t	m_callback;
+			void*				m_context;
+			NotificationFilter*	m_filter;				// Notifications that fail the filter are skipped over
+			uint64				m_cursor;				// Sequence number of the next notification for this watcher
+			bool				m_busy;					// True while a worker thread is running the watcher
+			bool				m_removed;
+			Mutex*				m_callbackMutex;		// Held while the watcher is being called
+		};
+
+		struct Worker
+		{
+			NotificationDispatcher*	m_dispatcher;
+			Thread*					m_thread;
+			Notification*			m_notification;		// The worker's copy of the notification being delivered
+		};
+
+		static void WorkerThreadEntryPoint( Event* _exitEvent, void* _context );
+		void WorkerThreadProc( Event* _exitEvent, Worker* _worker );
+
+		WatcherState* GetNextWatcher();
+		void RemoveWatcherState( list<WatcherState*>::iterator _it );
+		void ReleaseSlots();
+		bool CoalesceNotification( Notification const* _notification );
+		void Flush( uint32 const _timeout );
+
+		Mutex*						m_mutex;				// Guards everything below
+		Event*						m_workEvent;			// Set when a watcher may have notifications waiting
+		Event*						m_spaceEvent;			// Set when there is room in the ring
+		OverflowPolicy				m_policy;
+		bool						m_exit;
+
+		vector<Notification*>		m_ring;
+		uint64						m_head;					// Sequence number of the next notification to be queued
+		uint64						m_tail;					// Sequence number of the oldest notification still in the ring
+
+		list<WatcherState*>			m_watchers;				// A watcher moves to the back when it is run, so they take turns
+		vector<Worker*>				m_workers;
+
+		uint32						m_maxQueueDepth;
+		uint32						m_queued;
+		uint32						m_delivered;
+		uint32						m_dropped;
+		uint32						m_coalesced;
+		uint32						m_blocked;
+	};
+
+} // namespace OpenZWave
+
+#endif //_NotificationDispatcher_H
@@ -106,6 +106,10 @@ Options* Options::Create
 		s_instance->AddOptionInt(		"SaveLogLevel",				LogLevel_Detail );			// Save (to file) log messages equal to or above LogLevel_Detail
 		s_instance->AddOptionInt(		"QueueLogLevel",			LogLevel_Debug );			// Save (in RAM) log messages equal to or above LogLevel_Debug
 		s_instance->AddOptionInt(		"DumpTriggerLevel",			LogLevel_None );			// Default is to never dump RAM-stored log messages
+		s_instance->AddOptionBool(		"AsyncLogging",				false );					// Write the log file and console output from a background thread (not supported on Windows)
+		s_instance->AddOptionBool(		"Trace",					false );					// Record serial frames and log messages in a binary trace file (decode with ozw-tracedump)
+		s_instance->AddOptionString(	"TraceFileName",			"OZW_Trace.bin",	false );	// Name of the binary trace file
+		s_instance->AddOptionInt(		"TraceLevel",				LogLevel_Info );			// Record log messages equal to or above LogLevel_Info in the trace (frames are always recorded)
 
 		s_instance->AddOptionBool(		"Associate",				true );						// Enable automatic association of the controller with group one of every device.
 		s_instance->AddOptionString(	"Exclude",					string(""),		true );		// Remove support for the listed command classes.
@@ -113,19 +117,39 @@ Options* Options::Create
 		s_instance->AddOptionBool(		"NotifyTransactions",		false );					// Notifications when transaction complete is reported.
 		s_instance->AddOptionString(	"Interface",				string(""),		true );		// Identify the serial port to be accessed (TODO: change the code so more than one serial port can be specified and HID)
 		s_instance->AddOptionBool(		"SaveConfiguration",		true );						// Save the XML configuration upon driver close.
+		s_instance->AddOptionInt(		"SaveConfigInterval",		0 );						// If SaveConfiguration is true, seconds between background saves of the XML configuration while anything has changed.  0 saves only upon driver close.
+		s_instance->AddOptionBool(		"ConfigCache",				false );					// Keep a binary copy of the XML configuration (zwcfg_*.bin) for a faster start.  The XML file is read instead whenever the copy is out of date.
+		s_instance->AddOptionBool(		"DeviceDatabase",			true );						// Use devices.bin in the config folder, made by ozw-devicedb, in place of manufacturer_specific.xml and the device configuration files it is current for.
 		s_instance->AddOptionInt(		"DriverMaxAttempts",		0);
+		s_instance->AddOptionBool(		"HidInterruptReads",		false );					// HID controllers: fetch received data when an input report says it is waiting, instead of looking every 10ms
+		s_instance->AddOptionInt(		"HidMaxReadTimeout",		500 );						// HidInterruptReads: longest wait, in ms, for an input report on an idle port before looking for data anyway
+		s_instance->AddOptionInt(		"ControllerBufferSize",		2048 );						// Bytes buffered between the port and the driver, rounded up to a power of two (at least 512).  Data that arrives while the buffer is full is dropped and counted.
 
 		s_instance->AddOptionInt(		"PollInterval",				30000);						// 30 seconds (can easily poll 30 values in this time; ~120 values is the effective limit for 30 seconds)
 		s_instance->AddOptionBool(		"IntervalBetweenPolls",		false );					// if false, try to execute the entire poll list within the PollInterval time frame
 																								// if true, wait for PollInterval milliseconds between polls
+		s_instance->AddOptionString(	"PollPolicy",				"Fixed",	false );		// "Fixed" polls each value at its period; "Adaptive" stretches the periods when the network is busy
+		s_instance->AddOptionInt(		"PollLoadTarget",			50 );						// Adaptive policy: percentage of network time that polls may use
+		s_instance->AddOptionInt(		"PollQueueLimit",			10 );						// Adaptive policy: hold polls back while more than this many messages are waiting to be sent
+		s_instance->AddOptionInt(		"InterviewConcurrency",		0 );						// Listening nodes interviewed at once, taking turns to send.  Listening nodes start before frequently listening ones.  0 interviews every node at once, strictly in queued order.
+		s_instance->AddOptionBool(		"FastRestart",				false );					// Nodes read from the configuration file skip the query stages that are still current (FastRestartTTL), and refresh their dynamic values in the background.  Values stay unset until the node reports them.
+		s_instance->AddOptionString(	"FastRestartTTL",			string("Associations=86400,Neighbors=86400,Session=86400"),	false );	// FastRestart: seconds for which the results of the Associations, Neighbors, Session and Dynamic stages stay current
 		s_instance->AddOptionBool(		"SuppressValueRefresh",		false );					// if true, notifications for refreshed (but unchanged) values will not be sent
+		s_instance->AddOptionInt(		"ValueChangeDebounce",		0 );						// Time in ms that ValueChanged/ValueRefreshed notifications for a value are held back after the last one sent, only the latest being delivered.  0 sends every one.
+		s_instance->AddOptionString(	"ValueChangeDebounceClasses",	"",	false );			// Debounce time per command class, overriding ValueChangeDebounce, such as "0x32=2000,0x31=500"
 		s_instance->AddOptionBool(		"PerformReturnRoutes",		true );					// if true, return routes will be updated
 		s_instance->AddOptionString(	"NetworkKey", 				string(""), 			false);
 		s_instance->AddOptionBool(		"RefreshAllUserCodes",		false ); 					// if true, during startup, we refresh all the UserCodes the device reports it supports. If False, we stop after we get the first "Available" slot (Some devices have 250+ usercode slots! - That makes our Session Stage Very Long )
 		s_instance->AddOptionInt( 		"RetryTimeout", 			RETRY_TIMEOUT);				// How long do we wait to timeout messages sent
+		s_instance->AddOptionInt(		"QueueStatisticsInterval",	0 );						// Seconds between writing the send queue statistics to the log.  0 only writes them with the driver statistics.
 		s_instance->AddOptionBool( 		"EnableSIS", 				true);						// Automatically become a SUC if there is no SUC on the network.
 		s_instance->AddOptionBool( 		"AssumeAwake", 				true);						// Assume Devices that Support the Wakeup CC are awake when we first query them....
 		s_instance->AddOptionBool(		"NotifyOnDriverUnload",		false);						// Should we send the Node/Value Notifications on Driver Unloading - Read comments in Driver::~Driver() method about possible race conditions
+		s_instance->AddOptionBool(		"SharedDriverThread",		false );					// Run every driver's message loop on one shared thread and every poll schedule on another, instead of two threads per controller.  Serial ports are also read by one shared thread (not on Windows).  Implies NotificationThreads of at least 1.  With NotificationOverflow of Block, a full notification queue still holds up every controller.
+		s_instance->AddOptionInt(		"NotificationThreads",		0 );						// Number of threads calling the watchers.  0 calls them on the driver thread.
+		s_instance->AddOptionInt(		"NotificationQueueSize",	1000 );						// Notifications that can wait for the slowest watcher when NotificationThreads is set
+		s_instance->AddOptionString(	"NotificationOverflow",		"Block",	false );		// What to do when the queue is full: "Block" the driver thread, "DropOldest", or "Coalesce" ValueChanged notifications
+		s_instance->AddOptionString(	"MetricsSocket",			"",			false );		// Path of a Unix socket serving the statistics in the Prometheus text format (not on Windows).  Empty for none.
 	}
 
 	return s_instance;
@@ -485,15 +485,11 @@ void CommandClass::WriteXML
 
 	// Write out the values for this command class
 	ValueStore* store = GetNodeUnsafe()->GetValueStore();
-	for( ValueStore::Iterator it = store->Begin(); it != store->End(); ++it )
+	for( ValueStore::Iterator it = store->Begin( GetCommandClassId() ); it != store->End( GetCommandClassId() ); ++it )
 	{
-		Value* value = it->second;
-		if( value->GetID().GetCommandClassId() == GetCommandClassId() )
-		{
-			TiXmlElement* valueElement = new TiXmlElement( "Value" );
-			_ccElement->LinkEndChild( valueElement );
-			value->WriteXML( valueElement );
-		}
+		TiXmlElement* valueElement = new TiXmlElement( "Value" );
+		_ccElement->LinkEndChild( valueElement );
+		it->second->WriteXML( valueElement );
 	}
 	// Write out the TriggerRefreshValue if it exists
 	for (uint32 i = 0; i < m_RefreshClassValues.size(); i++)
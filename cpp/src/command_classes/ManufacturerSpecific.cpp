@@ -36,7 +36,10 @@
 #include "Manager.h"
 #include "Driver.h"
 #include "Notification.h"
+#include "DeviceDatabase.h"
+#include "platform/FileOps.h"
 #include "platform/Log.h"
+#include "platform/Mutex.h"
 
 #include "value_classes/ValueStore.h"
 #include "value_classes/ValueString.h"
@@ -52,6 +55,10 @@ enum ManufacturerSpecificCmd
 map<uint16,string> ManufacturerSpecific::s_manufacturerMap;
 map<int64,ManufacturerSpecific::Product*> ManufacturerSpecific::s_productMap;
 bool ManufacturerSpecific::s_bXmlLoaded = false;
+DeviceDatabase* ManufacturerSpecific::s_deviceDatabase = NULL;
+bool ManufacturerSpecific::s_bDatabaseProducts = false;
+map<string,ManufacturerSpecific::ConfigFile*> ManufacturerSpecific::s_configFiles;
+Mutex* ManufacturerSpecific::s_configFilesMutex = NULL;
 
 //-----------------------------------------------------------------------------
 // <ManufacturerSpecific::RequestState>
@@ -126,19 +133,10 @@ string ManufacturerSpecific::SetProductDetails
 	string configPath = "";
 
 	// Try to get the real manufacturer and product names
-	map<uint16,string>::iterator mit = s_manufacturerMap.find( manufacturerId );
-	if( mit != s_manufacturerMap.end() )
+	if( GetManufacturerName( manufacturerId, &manufacturerName ) )
 	{
-		// Replace the id with the real name
-		manufacturerName = mit->second;
-
 		// Get the product
-		map<int64,Product*>::iterator pit = s_productMap.find( Product::GetKey( manufacturerId, productType, productId ) );
-		if( pit != s_productMap.end() )
-		{
-			productName = pit->second->GetProductName();
-			configPath = pit->second->GetConfigPath();
-		}
+		GetProduct( manufacturerId, productType, productId, &productName, &configPath );
 	}
 
 	// Set the values into the node
@@ -231,6 +229,27 @@ bool ManufacturerSpecific::LoadProductXML
 
 	string filename =  configPath + "manufacturer_specific.xml";
 
+	// Use the precompiled tables if ozw-devicedb has been run on the config folder
+	bool useDatabase = true;
+	Options::Get()->GetOptionAsBool( "DeviceDatabase", &useDatabase );
+	if( useDatabase && s_deviceDatabase == NULL )
+	{
+		s_deviceDatabase = DeviceDatabase::Open( configPath + "devices.bin" );
+		if( s_deviceDatabase != NULL )
+		{
+			Log::Write( LogLevel_Info, "Using device database %sdevices.bin", configPath.c_str() );
+		}
+	}
+	if( s_deviceDatabase != NULL )
+	{
+		if( s_deviceDatabase->IsProductTableCurrent( filename ) )
+		{
+			s_bDatabaseProducts = true;
+			return true;
+		}
+		Log::Write( LogLevel_Info, "The product table in %sdevices.bin is out of date, reading %s", configPath.c_str(), filename.c_str() );
+	}
+
 	TiXmlDocument* pDoc = new TiXmlDocument();
 	if( !pDoc->LoadFile( filename.c_str(), TIXML_ENCODING_UTF8 ) )
 	{
@@ -365,10 +384,65 @@ void ManufacturerSpecific::UnloadProductXML
 			mit = s_manufacturerMap.begin();
 		}
 
+		delete s_deviceDatabase;
+		s_deviceDatabase = NULL;
+		s_bDatabaseProducts = false;
 		s_bXmlLoaded = false;
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <ManufacturerSpecific::GetManufacturerName>
+// Look up a manufacturer's name
+//-----------------------------------------------------------------------------
+bool ManufacturerSpecific::GetManufacturerName
+(
+	uint16 const _manufacturerId,
+	string* _name
+)
+{
+	if( s_bDatabaseProducts )
+	{
+		return s_deviceDatabase->GetManufacturerName( _manufacturerId, _name );
+	}
+
+	map<uint16,string>::iterator mit = s_manufacturerMap.find( _manufacturerId );
+	if( mit == s_manufacturerMap.end() )
+	{
+		return false;
+	}
+	*_name = mit->second;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// <ManufacturerSpecific::GetProduct>
+// Look up a product's name and config file
+//-----------------------------------------------------------------------------
+bool ManufacturerSpecific::GetProduct
+(
+	uint16 const _manufacturerId,
+	uint16 const _productType,
+	uint16 const _productId,
+	string* _name,
+	string* _configPath
+)
+{
+	if( s_bDatabaseProducts )
+	{
+		return s_deviceDatabase->GetProduct( _manufacturerId, _productType, _productId, _name, _configPath );
+	}
+
+	map<int64,Product*>::iterator pit = s_productMap.find( Product::GetKey( _manufacturerId, _productType, _productId ) );
+	if( pit == s_productMap.end() )
+	{
+		return false;
+	}
+	*_name = pit->second->GetProductName();
+	*_configPath = pit->second->GetConfigPath();
+	return true;
+}
+
 //-----------------------------------------------------------------------------
 // <ManufacturerSpecific::LoadConfigXML>
 // Try to find and load an XML file describing the device's config params
@@ -384,15 +458,15 @@ bool ManufacturerSpecific::LoadConfigXML
 
 	string filename =  configPath + _configXML;
 
-	TiXmlDocument* doc = new TiXmlDocument();
 	Log::Write( LogLevel_Info, _node->GetNodeId(), "  Opening config param file %s", filename.c_str() );
-	if( !doc->LoadFile( filename.c_str(), TIXML_ENCODING_UTF8 ) )
+	ConfigFile* configFile = GetConfigFile( _configXML, filename );
+	if( configFile == NULL )
 	{
-		delete doc;
 		Log::Write( LogLevel_Info, _node->GetNodeId(), "Unable to find or load Config Param file %s", filename.c_str() );
 		return false;
 	}
 
+	TiXmlDocument const* doc = configFile->GetDocument();
 	Node::QueryStage qs = _node->GetCurrentQueryStage();
 	if( qs == Node::QueryStage_ManufacturerSpecific1 )
 	{
@@ -407,10 +481,165 @@ bool ManufacturerSpecific::LoadConfigXML
 		_node->ReadCommandClassesXML( doc->RootElement() );
 	}
 
-	delete doc;
+	ReleaseConfigFile( configFile );
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// <ManufacturerSpecific::CreateConfigCache>
+// Set up the cache of device configuration files
+//-----------------------------------------------------------------------------
+void ManufacturerSpecific::CreateConfigCache
+(
+)
+{
+	if( s_configFilesMutex == NULL )
+	{
+		s_configFilesMutex = new Mutex();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <ManufacturerSpecific::DestroyConfigCache>
+// Free the cached device configuration files
+//-----------------------------------------------------------------------------
+void ManufacturerSpecific::DestroyConfigCache
+(
+)
+{
+	if( s_configFilesMutex == NULL )
+	{
+		return;
+	}
+
+	FlushConfigCache();
+	s_configFilesMutex->Release();
+	s_configFilesMutex = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// <ManufacturerSpecific::FlushConfigCache>
+// Forget the cached device configuration files, so they are read again when
+// next needed.  Any still being read are freed when the reader is done.
+//-----------------------------------------------------------------------------
+void ManufacturerSpecific::FlushConfigCache
+(
+)
+{
+	if( s_configFilesMutex == NULL )
+	{
+		return;
+	}
+
+	s_configFilesMutex->Lock();
+	for( map<string,ConfigFile*>::iterator it = s_configFiles.begin(); it != s_configFiles.end(); ++it )
+	{
+		it->second->Release();
+	}
+	s_configFiles.clear();
+	s_configFilesMutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// <ManufacturerSpecific::GetConfigFile>
+// Get a device configuration file, parsing it only if it is not already
+// cached or has changed since it was.  The caller must pass the result to
+// ReleaseConfigFile.
+//-----------------------------------------------------------------------------
+ManufacturerSpecific::ConfigFile* ManufacturerSpecific::GetConfigFile
+(
+	string const& _configXML,
+	string const& _filename
+)
+{
+	// The file may be missing if its copy in the device database is used
+	uint64 modified = 0;
+	uint64 size = 0;
+	FileOps::FileInfo( _filename, &modified, &size );
+
+	if( s_configFilesMutex != NULL )
+	{
+		s_configFilesMutex->Lock();
+	}
+
+	ConfigFile* configFile = NULL;
+	map<string,ConfigFile*>::iterator it = s_configFiles.find( _filename );
+	if( it != s_configFiles.end() )
+	{
+		if( it->second->IsCurrent( modified, size ) )
+		{
+			configFile = it->second;
+			configFile->AddRef();
+		}
+		else
+		{
+			Log::Write( LogLevel_Info, "  Config param file %s has changed", _filename.c_str() );
+			it->second->Release();
+			s_configFiles.erase( it );
+		}
+	}
+
+	if( configFile == NULL )
+	{
+		// Parse while holding the lock, so drivers interviewing the same product
+		// at the same time don't each parse the file
+		TiXmlDocument* doc = new TiXmlDocument();
+		if( ( s_deviceDatabase != NULL && s_deviceDatabase->GetDocument( _configXML, _filename, doc ) )
+			|| doc->LoadFile( _filename.c_str(), TIXML_ENCODING_UTF8 ) )
+		{
+			configFile = new ConfigFile( doc, modified, size );
+			if( s_configFilesMutex != NULL )
+			{
+				// One reference for the cache, one for the caller
+				configFile->AddRef();
+				s_configFiles[_filename] = configFile;
+			}
+		}
+		else
+		{
+			delete doc;
+		}
+	}
+
+	if( s_configFilesMutex != NULL )
+	{
+		s_configFilesMutex->Unlock();
+	}
+	return configFile;
+}
+
+//-----------------------------------------------------------------------------
+// <ManufacturerSpecific::ReleaseConfigFile>
+// Release a device configuration file returned by GetConfigFile
+//-----------------------------------------------------------------------------
+void ManufacturerSpecific::ReleaseConfigFile
+(
+	ConfigFile* _configFile
+)
+{
+	if( s_configFilesMutex != NULL )
+	{
+		s_configFilesMutex->Lock();
+		_configFile->Release();
+		s_configFilesMutex->Unlock();
+	}
+	else
+	{
+		_configFile->Release();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <ManufacturerSpecific::ConfigFile::~ConfigFile>
+// Destructor
+//-----------------------------------------------------------------------------
+ManufacturerSpecific::ConfigFile::~ConfigFile
+(
+)
+{
+	delete m_doc;
+}
+
 //-----------------------------------------------------------------------------
 // <ManufacturerSpecific::ReLoadConfigXML>
 // Reload previously discovered device configuration.
@@ -427,17 +656,14 @@ void ManufacturerSpecific::ReLoadConfigXML
 		uint16 productType = (uint16)strtol( node->GetProductType().c_str(), NULL, 16 );
 		uint16 productId = (uint16)strtol( node->GetProductId().c_str(), NULL, 16 );
 
-		map<uint16,string>::iterator mit = s_manufacturerMap.find( manufacturerId );
-		if( mit != s_manufacturerMap.end() )
+		string manufacturerName;
+		string productName;
+		string configPath;
+		if( GetManufacturerName( manufacturerId, &manufacturerName ) && GetProduct( manufacturerId, productType, productId, &productName, &configPath ) )
 		{
-			map<int64,Product*>::iterator pit = s_productMap.find( Product::GetKey( manufacturerId, productType, productId ) );
-			if( pit != s_productMap.end() )
+			if( configPath.size() > 0 )
 			{
-				string configPath = pit->second->GetConfigPath();
-				if( configPath.size() > 0 )
-				{
-					LoadConfigXML( node, configPath );
-				}
+				LoadConfigXML( node, configPath );
 			}
 		}
 	}
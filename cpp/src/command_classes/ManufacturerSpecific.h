@@ -30,9 +30,15 @@
 
 #include <map>
 #include "command_classes/CommandClass.h"
+#include "platform/Ref.h"
+
+class TiXmlDocument;
 
 namespace OpenZWave
 {
+	class DeviceDatabase;
+	class Mutex;
+
 	/** \brief Implements COMMAND_CLASS_MANUFACTURER_SPECIFIC (0x72), a Z-Wave device command class.
 	 */
 	class ManufacturerSpecific: public CommandClass
@@ -56,10 +62,21 @@ namespace OpenZWave
 		
 		void ReLoadConfigXML();
 
+		/**
+		 * The device configuration files are parsed once per process, and shared by every
+		 * node using the same file.  A file is read again if its size or modification time
+		 * has changed.
+		 */
+		static void CreateConfigCache();
+		static void DestroyConfigCache();
+		static void FlushConfigCache();
+
 	private:
 		ManufacturerSpecific( uint32 const _homeId, uint8 const _nodeId ): CommandClass( _homeId, _nodeId ){ SetStaticRequest( StaticRequest_Values ); }
 		static bool LoadProductXML();
 		static void UnloadProductXML();
+		static bool GetManufacturerName( uint16 const _manufacturerId, string* _name );
+		static bool GetProduct( uint16 const _manufacturerId, uint16 const _productType, uint16 const _productId, string* _name, string* _configPath );
 
 		class Product
 		{
@@ -105,9 +122,33 @@ namespace OpenZWave
 			string	m_configPath;
 		};
 
+		class ConfigFile : public Ref
+		{
+		public:
+			ConfigFile( TiXmlDocument* _doc, uint64 const _modified, uint64 const _size ): m_doc( _doc ), m_modified( _modified ), m_size( _size ){}
+
+			TiXmlDocument const* GetDocument()const{ return m_doc; }
+			bool IsCurrent( uint64 const _modified, uint64 const _size )const{ return( ( m_modified == _modified ) && ( m_size == _size ) ); }
+
+		protected:
+			virtual ~ConfigFile();
+
+		private:
+			TiXmlDocument*	m_doc;
+			uint64			m_modified;
+			uint64			m_size;
+		};
+
+		static ConfigFile* GetConfigFile( string const& _configXML, string const& _filename );
+		static void ReleaseConfigFile( ConfigFile* _configFile );
+
 		static map<uint16,string>	s_manufacturerMap;
 		static map<int64,Product*>	s_productMap;
 		static bool					s_bXmlLoaded;
+		static DeviceDatabase*		s_deviceDatabase;			// Precompiled config folder, or NULL
+		static bool					s_bDatabaseProducts;		// Products are looked up in s_deviceDatabase rather than the maps
+		static map<string,ConfigFile*>	s_configFiles;			// Parsed device configuration files, by path
+		static Mutex*				s_configFilesMutex;		// Guards s_configFiles and the ConfigFile reference counts
 	};
 
 } // namespace OpenZWave
@@ -620,7 +620,7 @@ bool Security::EncryptMessage
 	string LogMessage("SecurityCmd_MessageEncap (");
 	LogMessage.append(payload->logmsg);
 	LogMessage.append(")");
-	Msg* msg = new Msg( LogMessage, GetNodeId(), REQUEST, FUNC_ID_ZW_SEND_DATA, true, true, FUNC_ID_APPLICATION_COMMAND_HANDLER, GetCommandClassId() );
+	Msg* msg = new Msg( LogMessage.c_str(), GetNodeId(), REQUEST, FUNC_ID_ZW_SEND_DATA, true, true, FUNC_ID_APPLICATION_COMMAND_HANDLER, GetCommandClassId() );
 	msg->Append( GetNodeId() );
 	msg->Append( payload->m_length + 20 );
 	msg->Append( GetCommandClassId() );
@@ -444,6 +444,7 @@ bool SwitchMultilevel::SetLevel
 {
 	Log::Write( LogLevel_Info, GetNodeId(), "SwitchMultilevel::Set - Setting to level %d", _level );
 	Msg* msg = new Msg( "SwitchMultilevelCmd_Set", GetNodeId(), REQUEST, FUNC_ID_ZW_SEND_DATA, true );
+	msg->SetSupersede( 2 );
 	msg->SetInstance( this, _instance );
 	msg->Append( GetNodeId() );
 
@@ -308,6 +308,7 @@ bool ThermostatFanMode::SetValue
 		uint8 state = (uint8)value->GetItem().m_value;
 
 		Msg* msg = new Msg( "ThermostatFanModeCmd_Set", GetNodeId(), REQUEST, FUNC_ID_ZW_SEND_DATA, true );
+		msg->SetSupersede( 2 );
 		msg->SetInstance( this, _value.GetID().GetInstance() );
 		msg->Append( GetNodeId() );
 		msg->Append( 3 );
@@ -291,6 +291,7 @@ bool ThermostatSetpoint::SetValue
 		uint8 scale = strcmp( "C", value->GetUnits().c_str() ) ? 1 : 0;
 
 		Msg* msg = new Msg( "ThermostatSetpointCmd_Set", GetNodeId(), REQUEST, FUNC_ID_ZW_SEND_DATA, true );
+		msg->SetSupersede( 3 );
 		msg->SetInstance( this, _value.GetID().GetInstance() );
 		msg->Append( GetNodeId() );
 		msg->Append( 4 + GetAppendValueSize( value->GetValue() ) );
@@ -26,10 +26,44 @@
 //-----------------------------------------------------------------------------
 #include "Defs.h"
 #include "Driver.h"
+#include "Options.h"
 #include "platform/Controller.h"
 
 using namespace OpenZWave;
 
+//-----------------------------------------------------------------------------
+// <Controller::Controller>
+//  Constructor
+//-----------------------------------------------------------------------------
+Controller::Controller
+(
+):
+	Stream( GetBufferSizeOption() ),
+	m_reads( 0 ),
+	m_readBytes( 0 ),
+	m_readWakeups( 0 ),
+	m_readLatencyTotal( 0 ),
+	m_readLatencyMax( 0 )
+{
+}
+
+//-----------------------------------------------------------------------------
+// <Controller::GetBufferSizeOption>
+//  Size of the receive buffer, from the ControllerBufferSize option
+//-----------------------------------------------------------------------------
+uint32 Controller::GetBufferSizeOption
+(
+)
+{
+	int32 size = 2048;
+	Options::Get()->GetOptionAsInt( "ControllerBufferSize", &size );
+	if( size < 0 )
+	{
+		size = 2048;
+	}
+	return (uint32)size;
+}
+
 //-----------------------------------------------------------------------------
 // <Controller::PlayInitSequence>
 //  Queues up the controller's initialization commands.
@@ -66,3 +100,39 @@ uint32 Controller::Read
 	return 0;
 }
 
+//-----------------------------------------------------------------------------
+//	<Controller::Received>
+//	Pass data from the read path to the driver, and count it
+//-----------------------------------------------------------------------------
+void Controller::Received
+(
+	uint8* _buffer,
+	uint32 _length,
+	uint32 _latency
+)
+{
+	++m_reads;
+	m_readBytes += _length;
+	m_readLatencyTotal += _latency;
+	if( _latency > m_readLatencyMax )
+	{
+		m_readLatencyMax = _latency;
+	}
+	Put( _buffer, _length );
+}
+
+//-----------------------------------------------------------------------------
+//	<Controller::GetReadStatistics>
+//	Return the read path counters
+//-----------------------------------------------------------------------------
+void Controller::GetReadStatistics
+(
+	ReadStatistics* _data
+)const
+{
+	_data->m_reads = m_reads;
+	_data->m_bytes = m_readBytes;
+	_data->m_wakeups = m_readWakeups;
+	_data->m_latencyAvg = m_reads ? (uint32)( m_readLatencyTotal / m_reads ) : 0;
+	_data->m_latencyMax = m_readLatencyMax;
+}
@@ -49,7 +49,7 @@ namespace OpenZWave
 		 * Consructor.
 		 * Creates the controller object.
 		 */
-		Controller():Stream( 2048 ){}
+		Controller();
 
 		/**
 		 * Destructor.
@@ -99,6 +99,44 @@ namespace OpenZWave
 		 * @see Write, Open, Close
 		 */
 		uint32 Read( uint8* _buffer, uint32 _length );
+
+		/**
+		 * Counters kept by the read path.  Every kind of controller keeps the same ones.
+		 */
+		struct ReadStatistics
+		{
+			uint32 m_reads;				// Number of reads from the port that returned data
+			uint32 m_bytes;				// Number of bytes received
+			uint32 m_wakeups;			// Number of times the read path woke up to look for data
+			uint32 m_latencyAvg;		// Average ms received data may have waited in the device before it was fetched
+			uint32 m_latencyMax;		// Longest ms received data may have waited in the device before it was fetched
+		};
+
+		/**
+		 * Pass data read from the port to the driver, and count it.  Called by the read path.
+		 * @param _buffer Pointer to the data.
+		 * @param _length Length in bytes of the data.
+		 * @param _latency Milliseconds the data may have been waiting in the device before it was fetched.
+		 * Zero for ports that are woken as soon as data arrives.
+		 */
+		void Received( uint8* _buffer, uint32 _length, uint32 _latency = 0 );
+
+		/**
+		 * Count a wakeup of the read path.  Compared with the number of reads, this shows
+		 * how much of the read path's work finds nothing to do.
+		 */
+		void CountWakeup(){ ++m_readWakeups; }
+
+		void GetReadStatistics( ReadStatistics* _data )const;
+
+	private:
+		static uint32 GetBufferSizeOption();
+
+		uint32	m_reads;
+		uint32	m_readBytes;
+		uint32	m_readWakeups;
+		uint64	m_readLatencyTotal;
+		uint32	m_readLatencyMax;
 	};
 
 } // namespace OpenZWave
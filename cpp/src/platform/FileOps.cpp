@@ -82,6 +82,74 @@ bool FileOps::FolderExists
 	return false;
 }
 
+//-----------------------------------------------------------------------------
+//	<FileOps::FileWriteAtomic>
+//	Static method to replace the contents of a file in a single step
+//-----------------------------------------------------------------------------
+bool FileOps::FileWriteAtomic
+(
+	const string &_filename,
+	const string &_contents
+)
+{
+	if( s_instance != NULL )
+	{
+		return s_instance->m_pImpl->FileWriteAtomic( _filename, _contents );
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+//	<FileOps::FileMap>
+//	Static method to map a file into memory
+//-----------------------------------------------------------------------------
+void const* FileOps::FileMap
+(
+	const string &_filename,
+	size_t* _size
+)
+{
+	if( s_instance != NULL )
+	{
+		return s_instance->m_pImpl->FileMap( _filename, _size );
+	}
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+//	<FileOps::FileUnmap>
+//	Static method to release a mapped file
+//-----------------------------------------------------------------------------
+void FileOps::FileUnmap
+(
+	void const* _data,
+	size_t _size
+)
+{
+	if( s_instance != NULL && _data != NULL )
+	{
+		s_instance->m_pImpl->FileUnmap( _data, _size );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<FileOps::FileInfo>
+//	Static method to get the size and modification time of a file
+//-----------------------------------------------------------------------------
+bool FileOps::FileInfo
+(
+	const string &_filename,
+	uint64* _modified,
+	uint64* _size
+)
+{
+	if( s_instance != NULL )
+	{
+		return s_instance->m_pImpl->FileInfo( _filename, _modified, _size );
+	}
+	return false;
+}
+
 //-----------------------------------------------------------------------------
 //	<FileOps::FileOps>
 //	Constructor
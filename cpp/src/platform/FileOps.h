@@ -61,6 +61,43 @@ namespace OpenZWave
 		 */
 		static bool FolderExists( const string &_folderName );
 
+		/**
+		 * FileWriteAtomic. Replace the contents of a file so that a crash or power cut leaves
+		 * either the old or the new file, never a partly written one.  The data is written to
+		 * a temporary file in the same folder, flushed to disk and then renamed over the original.
+		 * \param string. File name.
+		 * \param string. New contents of the file.
+		 * \return Bool value indicating success.
+		 */
+		static bool FileWriteAtomic( const string &_filename, const string &_contents );
+
+		/**
+		 * FileMap. Map a whole file into memory, read only.  The pages are shared
+		 * with any other process that maps the same file.
+		 * \param string. File name.
+		 * \param size_t. Receives the size of the file.
+		 * \return Pointer to the start of the file, or NULL if it could not be mapped.
+		 * \see FileUnmap.
+		 */
+		static void const* FileMap( const string &_filename, size_t* _size );
+
+		/**
+		 * FileUnmap. Release a file mapped by FileMap.
+		 * \param void. Pointer returned by FileMap.
+		 * \param size_t. Size of the file.
+		 * \see FileMap.
+		 */
+		static void FileUnmap( void const* _data, size_t _size );
+
+		/**
+		 * FileInfo. Get the size and last modification time of a file.
+		 * \param string. File name.
+		 * \param uint64. Receives the modification time, in platform-specific units.  Only useful for comparing with an earlier result.
+		 * \param uint64. Receives the size of the file.
+		 * \return Bool value indicating whether the file exists.
+		 */
+		static bool FileInfo( const string &_filename, uint64* _modified, uint64* _size );
+
 	private:
 		FileOps();
 		~FileOps();
@@ -26,6 +26,7 @@
 //-----------------------------------------------------------------------------
 
 #include "Msg.h"
+#include "Options.h"
 #include "platform/Thread.h"
 #include "platform/Event.h"
 #include "platform/Log.h"
@@ -42,6 +43,9 @@
 #define INPUT_REPORT_LENGTH 0x5
 #define OUTPUT_REPORT_LENGTH 0x0
 
+// Wait for an input report while data is arriving
+#define MIN_READ_TIMEOUT 10
+
 using namespace OpenZWave;
 
 //-----------------------------------------------------------------------------
@@ -57,8 +61,16 @@ HidController::HidController
 	m_productId( 0x01 ),	// ControlThink ThinkStick
 	m_serialNumber( "" ),
 	m_hidControllerName( "" ),
-	m_bOpen( false )
+	m_bOpen( false ),
+	m_interruptReads( false ),
+	m_maxReadTimeout( 500 )
 {
+	Options::Get()->GetOptionAsBool( "HidInterruptReads", &m_interruptReads );
+	Options::Get()->GetOptionAsInt( "HidMaxReadTimeout", &m_maxReadTimeout );
+	if( m_maxReadTimeout < MIN_READ_TIMEOUT )
+	{
+		m_maxReadTimeout = MIN_READ_TIMEOUT;
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -214,7 +226,7 @@ void HidController::ThreadProc
 		{
 			// Enter read loop.  Call will only return if
 			// an exit is requested or an error occurs
-			Read();
+			Read( _exitEvent );
 
 			// Reset the attempts, so we get a rapid retry for temporary errors
 			attempts = 0;
@@ -374,42 +386,44 @@ HidOpenFailure:
 //-----------------------------------------------------------------------------
 void HidController::Read
 (
+	Event* _exitEvent
+)
+{
+	if( m_interruptReads )
+	{
+		ReadInterrupt( _exitEvent );
+	}
+	else
+	{
+		ReadPolled( _exitEvent );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <HidController::ReadPolled>
+// Look for received data every 10ms
+//-----------------------------------------------------------------------------
+void HidController::ReadPolled
+(
+	Event* _exitEvent
 )
 {
-	uint8 buffer[FEATURE_REPORT_LENGTH];
-	int bytesRead = 0;
 	uint8 inputReport[INPUT_REPORT_LENGTH];
 	TimeStamp readTimer;
+	TimeStamp lastEmpty;
 
  	while( true )
 	{
-		// Rx feature report buffer should contain
-		// [0]      - 0x05 (rx feature report ID)
-		// [1]      - length of rx data (or 0x00 and no further bytes if no rx data waiting)
-		// [2]...   - rx data
-	  	// We poll this waiting for data.
-		bytesRead = GetFeatureReport(FEATURE_REPORT_LENGTH, 0x5, buffer);
-		CHECK_HIDAPI_RESULT(bytesRead, HidPortError);
-		if( bytesRead >= 2 )
-		{
+		CountWakeup();
 
-			if( buffer[1] > 0 )
-			{
-				string tmp = "";
-				for (int i = 0; i < buffer[1]; i++)
-				{
-					char bstr[16];
-					snprintf( bstr, sizeof(bstr), "0x%.2x ", buffer[2+i] );
-					tmp += bstr;
-				}
-				Log::Write( LogLevel_Detail, "hid report read=%d ID=%d len=%d %s", bytesRead, buffer[0], buffer[1], tmp.c_str() );
-			}
-
-			if( buffer[1] > 0 )
-			{
-				Put( &buffer[2], buffer[1] );
-			}
+		// Any data found may have arrived just after the previous look
+		int result = FetchFeatureReports( (uint32)-lastEmpty.TimeRemaining() );
+		if( result < 0 )
+		{
+			return;
 		}
+		lastEmpty.SetTime();
+
 		if( readTimer.TimeRemaining() <= 0 )
 		{
 			// Hang a hid_read to acknowledge receipt. Seems the response is conveying
@@ -441,12 +455,132 @@ void HidController::Read
 			}
 			readTimer.SetTime( 100 );
 		}
-		m_thread->Sleep(10);
+
+		if( Wait::Single( _exitEvent, 10 ) == 0 )
+		{
+			// Exit signalled.
+			return;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <HidController::ReadInterrupt>
+// Wait for input reports, and fetch the received data when one says it is
+// waiting.  While data is arriving, the wait for an input report is short.
+// When the port is idle, the wait doubles up to m_maxReadTimeout, and the
+// feature report is checked each time the wait ends in case an input report
+// was missed.
+//-----------------------------------------------------------------------------
+void HidController::ReadInterrupt
+(
+	Event* _exitEvent
+)
+{
+	uint8 inputReport[INPUT_REPORT_LENGTH];
+	int32 timeout = MIN_READ_TIMEOUT;
+	TimeStamp lastEmpty;
+
+	while( true )
+	{
+		if( Wait::Single( _exitEvent, 0 ) == 0 )
+		{
+			// Exit signalled.
+			return;
+		}
+
+		// See the comments in ReadPolled for the layout of the input report
+		int hidApiResult = hid_read_timeout( m_hHidController, inputReport, INPUT_REPORT_LENGTH, timeout );
+		CountWakeup();
+		if( hidApiResult < 0 )
+		{
+			const wchar_t* errString = hid_error(m_hHidController);
+			Log::Write( LogLevel_Warning, "Error: HID port returned error reading input bytes: 0x%08hx, HIDAPI error string: %ls", hidApiResult, errString );
+			return;
+		}
+
+		uint32 latency;
+		if( hidApiResult == 0 )
+		{
+			// Timed out.  Any data found may have arrived just after the previous look.
+			latency = (uint32)-lastEmpty.TimeRemaining();
+		}
+		else if( hidApiResult >= 3 && inputReport[2] == 0x02 )
+		{
+			// The device says received data is waiting
+			latency = 0;
+		}
+		else
+		{
+			continue;
+		}
+
+		int result = FetchFeatureReports( latency );
+		if( result < 0 )
+		{
+			return;
+		}
+		lastEmpty.SetTime();
+
+		if( result > 0 )
+		{
+			// Data is arriving, so expect more soon
+			timeout = MIN_READ_TIMEOUT;
+		}
+		else if( hidApiResult == 0 && timeout < m_maxReadTimeout )
+		{
+			// Idle, so back off
+			timeout = ( timeout * 2 > m_maxReadTimeout ) ? m_maxReadTimeout : timeout * 2;
+		}
 	}
+}
+
+//-----------------------------------------------------------------------------
+// <HidController::FetchFeatureReports>
+// Pass the waiting received data to the driver.  Returns the number of
+// reports that held data, or -1 on error.
+//-----------------------------------------------------------------------------
+int HidController::FetchFeatureReports
+(
+	uint32 const _latency
+)
+{
+	uint8 buffer[FEATURE_REPORT_LENGTH];
+	int reports = 0;
 
-HidPortError:
-	Log::Write( LogLevel_Warning, "Error: HID port returned error reading rest of packet: 0x%08hx, HIDAPI error string:", bytesRead );
-	Log::Write( LogLevel_Warning, "%ls", hid_error(m_hHidController));
+	while( true )
+	{
+		// Rx feature report buffer should contain
+		// [0]      - 0x05 (rx feature report ID)
+		// [1]      - length of rx data (or 0x00 and no further bytes if no rx data waiting)
+		// [2]...   - rx data
+		int bytesRead = GetFeatureReport(FEATURE_REPORT_LENGTH, 0x5, buffer);
+		if( bytesRead < 0 )
+		{
+			Log::Write( LogLevel_Warning, "Error: HID port returned error reading rest of packet: 0x%08hx, HIDAPI error string:", bytesRead );
+			Log::Write( LogLevel_Warning, "%ls", hid_error(m_hHidController));
+			return -1;
+		}
+		if( bytesRead < 2 || buffer[1] == 0 )
+		{
+			return reports;
+		}
+
+		if( Log::IsLevelEnabled( LogLevel_Detail ) )
+		{
+			string tmp = "";
+			for (int i = 0; i < buffer[1]; i++)
+			{
+				char bstr[16];
+				snprintf( bstr, sizeof(bstr), "0x%.2x ", buffer[2+i] );
+				tmp += bstr;
+			}
+			Log::Write( LogLevel_Detail, "hid report read=%d ID=%d len=%d %s", bytesRead, buffer[0], buffer[1], tmp.c_str() );
+		}
+
+		Received( &buffer[2], buffer[1], _latency );
+		++reports;
+	}
 }
 
 //-----------------------------------------------------------------------------
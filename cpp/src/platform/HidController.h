@@ -112,7 +112,10 @@ namespace OpenZWave
 
 	private:
 		bool Init( uint32 const _attempts );
-		void Read();
+		void Read( Event* _exitEvent );
+		void ReadPolled( Event* _exitEvent );
+		void ReadInterrupt( Event* _exitEvent );
+		int FetchFeatureReports( uint32 const _latency );
 
 	        // helpers for internal use only
 
@@ -143,6 +146,8 @@ namespace OpenZWave
 	        string          	m_serialNumber;
 		string			m_hidControllerName;
 		bool			m_bOpen;
+		bool			m_interruptReads;	// Fetch received data when an input report says it is waiting, rather than every 10ms
+		int32			m_maxReadTimeout;	// Longest wait for an input report before looking for data anyway
 	};
 
 } // namespace OpenZWave
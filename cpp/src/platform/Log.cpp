@@ -30,6 +30,7 @@
 #include "Defs.h"
 #include "platform/Mutex.h"
 #include "platform/Log.h"
+#include "platform/Trace.h"
 
 #ifdef WIN32
 #include "platform/windows/LogImpl.h"	// Platform-specific implementation of a log
@@ -61,7 +62,9 @@ char const *OpenZWave::LogLevelString[] =
 
 Log* Log::s_instance = NULL;
 i_LogImpl* Log::m_pImpl = NULL;
-static bool s_dologging;
+bool Log::s_dologging = false;
+LogLevel Log::s_maxLevel = LogLevel_Invalid;
+LogLevel Log::s_traceLevel = LogLevel_Invalid;
 
 //-----------------------------------------------------------------------------
 //	<Log::Create>
@@ -74,16 +77,17 @@ Log* Log::Create
 	bool const _bConsoleOutput,
 	LogLevel const _saveLevel,
 	LogLevel const _queueLevel,
-	LogLevel const _dumpTrigger
+	LogLevel const _dumpTrigger,
+	bool const _bAsyncWrite
 )
 {
 	if( NULL == s_instance )
 	{
-		s_instance = new Log( _filename, _bAppend, _bConsoleOutput, _saveLevel, _queueLevel, _dumpTrigger );
+		s_instance = new Log( _filename, _bAppend, _bConsoleOutput, _saveLevel, _queueLevel, _dumpTrigger, _bAsyncWrite );
 		s_dologging = true; // default logging to true so no change to what people experience now
 	} else {
 		Log::Destroy();
-		s_instance = new Log( _filename, _bAppend, _bConsoleOutput, _saveLevel, _queueLevel, _dumpTrigger );
+		s_instance = new Log( _filename, _bAppend, _bConsoleOutput, _saveLevel, _queueLevel, _dumpTrigger, _bAsyncWrite );
 		s_dologging = true; // default logging to true so no change to what people experience now
 	}
 
@@ -189,6 +193,13 @@ void Log::SetLoggingState
 		s_dologging = false;
 	}
 
+	// remember the least severe level in use so callers can skip formatting messages that would be discarded
+	s_maxLevel = _saveLevel;
+	if( _queueLevel > s_maxLevel )
+		s_maxLevel = _queueLevel;
+	if( _dumpTrigger > s_maxLevel )
+		s_maxLevel = _dumpTrigger;
+
 	if( s_instance && s_dologging && s_instance->m_pImpl )
 	{
 	  	s_instance->m_logMutex->Lock();
@@ -221,6 +232,19 @@ void Log::Write
 	...
 )
 {
+	if( _level <= s_traceLevel )
+	{
+		va_list args;
+		va_start( args, _format );
+		Trace::WriteMessage( _level, 0, _format, args );
+		va_end( args );
+	}
+
+	if( !( s_dologging && ( _level <= s_maxLevel ) ) && ( _level != LogLevel_Internal ) )
+	{
+		return;
+	}
+
 	if( s_instance && s_dologging && s_instance->m_pImpl )
 	{
 		s_instance->m_logMutex->Lock(); // double locks if recursive
@@ -244,6 +268,19 @@ void Log::Write
 	...
 )
 {
+	if( _level <= s_traceLevel )
+	{
+		va_list args;
+		va_start( args, _format );
+		Trace::WriteMessage( _level, _nodeId, _format, args );
+		va_end( args );
+	}
+
+	if( !( s_dologging && ( _level <= s_maxLevel ) ) && ( _level != LogLevel_Internal ) )
+	{
+		return;
+	}
+
 	if( s_instance && s_dologging && s_instance->m_pImpl )
 	{
 		if( _level != LogLevel_Internal )
@@ -257,6 +294,48 @@ void Log::Write
 	}
 }
 
+//-----------------------------------------------------------------------------
+//	<Log::WriteHex>
+//	Write a block of bytes to the log as a list of hex values
+//-----------------------------------------------------------------------------
+void Log::WriteHex
+(
+	LogLevel _level,
+	uint8 const _nodeId,
+	char const* _prefix,
+	uint8 const* _data,
+	uint32 const _length
+)
+{
+	static char const c_hexDigits[] = "0123456789abcdef";
+
+	if( !( s_dologging && ( _level <= s_maxLevel ) ) )
+	{
+		// Don't format anything that will be thrown away.  Byte dumps are not
+		// needed just for the trace, which records the frames themselves.
+		return;
+	}
+
+	// Each byte is written as "0x00, ".  Anything that will not fit in a log line is dropped.
+	char hexBuf[1024];
+	uint32 pos = 0;
+	for( uint32 i=0; ( i<_length ) && ( ( pos + 7 ) <= sizeof(hexBuf) ); ++i )
+	{
+		if( i )
+		{
+			hexBuf[pos++] = ',';
+			hexBuf[pos++] = ' ';
+		}
+		hexBuf[pos++] = '0';
+		hexBuf[pos++] = 'x';
+		hexBuf[pos++] = c_hexDigits[_data[i] >> 4];
+		hexBuf[pos++] = c_hexDigits[_data[i] & 0x0f];
+	}
+	hexBuf[pos] = 0;
+
+	Write( _level, _nodeId, "%s%s", _prefix, hexBuf );
+}
+
 //-----------------------------------------------------------------------------
 //	<Log::QueueDump>
 //	Send queued messages to the log (and empty the queue)
@@ -317,12 +396,19 @@ Log::Log
 	bool const _bConsoleOutput,
 	LogLevel const _saveLevel,
 	LogLevel const _queueLevel,
-	LogLevel const _dumpTrigger
+	LogLevel const _dumpTrigger,
+	bool const _bAsyncWrite
 ):
 	m_logMutex( new Mutex() )
 {
         if (NULL == m_pImpl)
-        	m_pImpl = new LogImpl( _filename, _bAppend, _bConsoleOutput, _saveLevel, _queueLevel, _dumpTrigger );
+        	m_pImpl = new LogImpl( _filename, _bAppend, _bConsoleOutput, _saveLevel, _queueLevel, _dumpTrigger, _bAsyncWrite );
+
+	s_maxLevel = _saveLevel;
+	if( _queueLevel > s_maxLevel )
+		s_maxLevel = _queueLevel;
+	if( _dumpTrigger > s_maxLevel )
+		s_maxLevel = _dumpTrigger;
 }
 
 //-----------------------------------------------------------------------------
@@ -336,4 +422,5 @@ Log::~Log
 	m_logMutex->Release();
 	delete m_pImpl;
 	m_pImpl = NULL;
+	s_maxLevel = LogLevel_Invalid;
 }
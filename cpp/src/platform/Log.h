@@ -76,10 +76,12 @@ namespace OpenZWave
 		 * Create a log.
 		 * Creates the cross-platform logging singleton.
 		 * Any previous log will be cleared.
+		 * \param _bAsyncWrite If true, and the platform supports it, lines are written to the file
+		 * and console by a background thread rather than by the caller.
 		 * \return a pointer to the logging object.
 		 * \see Destroy, Write
 		 */
-		static Log* Create( string const& _filename, bool const _bAppend, bool const _bConsoleOutput, LogLevel const _saveLevel, LogLevel const _queueLevel, LogLevel const _dumpTrigger );
+		static Log* Create( string const& _filename, bool const _bAppend, bool const _bConsoleOutput, LogLevel const _saveLevel, LogLevel const _queueLevel, LogLevel const _dumpTrigger, bool const _bAsyncWrite = false );
 
 		/**
 		 * Create a log.
@@ -165,6 +167,29 @@ namespace OpenZWave
 		 */
 		static void Write( LogLevel _level, uint8 const _nodeId, char const* _format, ... );
 
+		/**
+		 * Write a block of bytes to the log.
+		 * The bytes are written as a comma separated list of hex values following the
+		 * prefix.  The list is only built if the log will make use of the message.
+		 * \param _level	Specifies the type of log message (Error, Warning, Debug, etc.)
+		 * \param _nodeId	Node Id this entry is about.
+		 * \param _prefix	Text to write before the bytes.
+		 * \param _data	Pointer to the bytes to write.
+		 * \param _length	Number of bytes to write.
+		 * \see Write, IsLevelEnabled
+		 */
+		static void WriteHex( LogLevel _level, uint8 const _nodeId, char const* _prefix, uint8 const* _data, uint32 const _length );
+
+		/**
+		 * Determine whether a message of the given level would be written, queued or traced.
+		 * This is a cheap test that callers can use to avoid building the arguments for
+		 * messages that the log is going to discard.
+		 * \param _level	Specifies the type of log message (Error, Warning, Debug, etc.)
+		 * \return true if a message of this level will be used by the log.
+		 * \see Write
+		 */
+		static bool IsLevelEnabled( LogLevel _level ){ return( ( s_dologging && ( _level <= s_maxLevel ) ) || ( _level <= s_traceLevel ) ); }
+
 		/**
 		 * Send the queued log messages to the log output.
 		 */
@@ -176,11 +201,16 @@ namespace OpenZWave
 		static void QueueClear();
 
 	private:
-		Log( string const& _filename, bool const _bAppend, bool const _bConsoleOutput, LogLevel _saveLevel, LogLevel _queueLevel, LogLevel _dumpTrigger );
+		Log( string const& _filename, bool const _bAppend, bool const _bConsoleOutput, LogLevel _saveLevel, LogLevel _queueLevel, LogLevel _dumpTrigger, bool const _bAsyncWrite );
 		~Log();
 
 		static i_LogImpl*	m_pImpl;		/**< Pointer to an object that encapsulates the platform-specific logging implementation. */
 		static Log*	s_instance;
+		static bool	s_dologging;		/**< True if any messages are to be saved in file or queue */
+		static LogLevel	s_maxLevel;		/**< Least severe level that the log will make use of */
+		static LogLevel	s_traceLevel;	/**< Least severe level that is written to the binary trace */
+
+		friend class Trace;
 		Mutex*		m_logMutex;
 	};
 } // namespace OpenZWave
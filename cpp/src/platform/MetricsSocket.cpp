@@ -0,0 +1,71 @@
+//-----------------------------------------------------------------------------
+//
+//	MetricsSocket.cpp
+//
+//	Serves the metrics text on a local socket
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include "Defs.h"
+#include "platform/MetricsSocket.h"
+
+#ifdef WIN32
+#include "platform/windows/MetricsSocketImpl.h"	// Platform-specific implementation of a metrics socket
+#else
+#include "platform/unix/MetricsSocketImpl.h"	// Platform-specific implementation of a metrics socket
+#endif
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+//	<MetricsSocket::MetricsSocket>
+//	Constructor
+//-----------------------------------------------------------------------------
+MetricsSocket::MetricsSocket
+(
+	string const& _path,
+	pfnRender_t _render,
+	void* _context
+):
+	m_pImpl( new MetricsSocketImpl( _path, _render, _context ) )
+{
+}
+
+//-----------------------------------------------------------------------------
+//	<MetricsSocket::~MetricsSocket>
+//	Destructor
+//-----------------------------------------------------------------------------
+MetricsSocket::~MetricsSocket
+(
+)
+{
+	delete m_pImpl;
+}
+
+//-----------------------------------------------------------------------------
+//	<MetricsSocket::IsOpen>
+//	Return true if the socket is listening
+//-----------------------------------------------------------------------------
+bool MetricsSocket::IsOpen
+(
+)const
+{
+	return m_pImpl->IsOpen();
+}
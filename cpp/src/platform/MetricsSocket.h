@@ -0,0 +1,85 @@
+//-----------------------------------------------------------------------------
+//
+//	MetricsSocket.h
+//
+//	Serves the metrics text on a local socket
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _MetricsSocket_H
+#define _MetricsSocket_H
+
+#include <string>
+#include "Defs.h"
+
+namespace OpenZWave
+{
+	class MetricsSocketImpl;
+
+	/** \brief Serves the metrics text on a local socket.
+	 *
+	 * A thread listens on the socket.  Each client that connects is sent the text
+	 * returned by the render function, and the connection is closed.  A client that
+	 * sends an HTTP GET request first gets an HTTP response, so the socket can be
+	 * scraped through a proxy or with curl --unix-socket.  Any other client gets the
+	 * bare text.
+	 */
+	class MetricsSocket
+	{
+	public:
+		/**
+		 * Render the metrics text.
+		 * \param _buffer where to write the text.
+		 * \param _size size of the buffer in bytes.
+		 * \param _context the context passed to the constructor.
+		 * \return the length of the whole text, which is more than _size if it did not fit.
+		 */
+		typedef uint32 (*pfnRender_t)( char* _buffer, uint32 const _size, void* _context );
+
+		/**
+		 * Constructor.
+		 * Starts listening on the socket.  Any file already at the path is replaced.
+		 * \param _path the path of the socket.
+		 * \param _render called on the socket's thread for each client.
+		 * \param _context passed to _render.
+		 */
+		MetricsSocket( string const& _path, pfnRender_t _render, void* _context );
+
+		/**
+		 * Destructor.
+		 * Stops the thread and removes the socket.
+		 */
+		~MetricsSocket();
+
+		/**
+		 * Returns true if the socket is listening.
+		 */
+		bool IsOpen()const;
+
+	private:
+		MetricsSocket( MetricsSocket const& );					// prevent copy
+		MetricsSocket& operator = ( MetricsSocket const& );		// prevent assignment
+
+		MetricsSocketImpl*	m_pImpl;			// Pointer to an object that encapsulates the platform-specific implementation of the socket.
+	};
+
+} // namespace OpenZWave
+
+#endif //_MetricsSocket_H
@@ -26,15 +26,52 @@
 //
 //-----------------------------------------------------------------------------
 #include "platform/Stream.h"
-#include "platform/Mutex.h"
 #include "platform/Log.h"
 
 #include <string.h>
 
 #include <cstdio>
 
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
+
 using namespace OpenZWave;
 
+//-----------------------------------------------------------------------------
+//	The producer publishes data by moving m_head, and the consumer frees space
+//	by moving m_tail.  Each side reads the other's position with acquire
+//	semantics and moves its own with release semantics, so the bytes behind a
+//	position are always visible before the position itself.
+//-----------------------------------------------------------------------------
+static inline uint32 LoadAcquire
+(
+	volatile uint32 const* _pos
+)
+{
+#ifdef _MSC_VER
+	uint32 value = *_pos;
+	MemoryBarrier();
+	return value;
+#else
+	return __atomic_load_n( _pos, __ATOMIC_ACQUIRE );
+#endif
+}
+
+static inline void StoreRelease
+(
+	volatile uint32* _pos,
+	uint32 const _value
+)
+{
+#ifdef _MSC_VER
+	MemoryBarrier();
+	*_pos = _value;
+#else
+	__atomic_store_n( _pos, _value, __ATOMIC_RELEASE );
+#endif
+}
+
 //-----------------------------------------------------------------------------
 //	<Stream::Stream>
 //	Constructor
@@ -43,14 +80,24 @@ Stream::Stream
 (
 	uint32 _bufferSize
 ):
-	m_bufferSize( _bufferSize ),
+	m_bufferSize( MaxViewSize ),
 	m_signalSize(1),
-	m_dataSize(0),
 	m_head(0),
 	m_tail(0),
-	m_mutex( new Mutex() )
+	m_overflowBytes(0),
+	m_highWater(0),
+	m_overflowing(false)
 {
-	m_buffer = new uint8[m_bufferSize];
+	while( ( m_bufferSize < _bufferSize ) && ( m_bufferSize < 0x80000000 ) )
+	{
+		m_bufferSize <<= 1;
+	}
+	m_mask = m_bufferSize - 1;
+
+	// The extra space past the end of the ring is used by GetView to
+	// present wrapped data as a single contiguous block.
+	m_buffer = new uint8[m_bufferSize + MaxViewSize];
+	memset( m_buffer, 0, m_bufferSize + MaxViewSize );
 }
 
 //-----------------------------------------------------------------------------
@@ -61,7 +108,6 @@ Stream::~Stream
 (
 )
 {
-	m_mutex->Release();
 	delete [] m_buffer;
 }
 
@@ -92,35 +138,32 @@ bool Stream::Get
 	uint32 _size
 )
 {
-	if( m_dataSize < _size )
+	if( GetDataSize() < _size )
 	{
 		// There is not enough data in the buffer to fulfill the request
 		Log::Write( LogLevel_Error, "ERROR: Not enough data in stream buffer");
 		return false;
 	}
 
-	m_mutex->Lock();
-	if( (m_tail + _size) > m_bufferSize )
+	uint32 tail = m_tail & m_mask;
+	if( (tail + _size) > m_bufferSize )
 	{
 		// We will have to wrap around
-		uint32 block1 = m_bufferSize - m_tail;
+		uint32 block1 = m_bufferSize - tail;
 		uint32 block2 = _size - block1;
 
-		memcpy( _buffer, &m_buffer[m_tail], block1 );
+		memcpy( _buffer, &m_buffer[tail], block1 );
 		memcpy( &_buffer[block1], m_buffer, block2 );
-		m_tail = block2;
 	}
 	else
 	{
 		// Requested data is in a contiguous block
-		memcpy( _buffer, &m_buffer[m_tail], _size );
-		m_tail += _size;
+		memcpy( _buffer, &m_buffer[tail], _size );
 	}
 
 	LogData( _buffer, _size, "      Read (buffer->application): ");
 
-	m_dataSize -= _size;
-	m_mutex->Unlock();
+	StoreRelease( &m_tail, m_tail + _size );
 	return true;
 }
 
@@ -128,41 +171,62 @@ bool Stream::Get
 //	<Stream::Put>
 //	Add data to the buffer
 //-----------------------------------------------------------------------------
-bool Stream::Put
+uint32 Stream::Put
 (
 	uint8* _buffer,
 	uint32 _size
 )
 {
-	if( (m_bufferSize-m_dataSize) < _size )
+	uint32 used = m_head - LoadAcquire( &m_tail );
+	uint32 size = _size;
+	if( (m_bufferSize-used) < size )
 	{
-		// There is not enough space left in the buffer for the data
-		Log::Write( LogLevel_Error, "ERROR: Not enough space in stream buffer");
-		return false;
+		// Keep what fits.  The driver resynchronises on the next frame, so
+		// the loss is limited to the frames that were cut short.
+		size = m_bufferSize - used;
+		m_overflowBytes += _size - size;
+		if( !m_overflowing )
+		{
+			Log::Write( LogLevel_Error, "ERROR: Not enough space in stream buffer, dropping %d of %d bytes", _size - size, _size );
+			m_overflowing = true;
+		}
+	}
+	else
+	{
+		m_overflowing = false;
+	}
+
+	if( size == 0 )
+	{
+		return 0;
 	}
 
-	m_mutex->Lock();
-	if( (m_head + _size) > m_bufferSize )
+	uint32 head = m_head & m_mask;
+	if( (head + size) > m_bufferSize )
 	{
 		// We will have to wrap around
-		uint32 block1 = m_bufferSize - m_head;
-		uint32 block2 = _size - block1;
+		uint32 block1 = m_bufferSize - head;
+		uint32 block2 = size - block1;
 
-		memcpy( &m_buffer[m_head], _buffer, block1 );
+		memcpy( &m_buffer[head], _buffer, block1 );
 		memcpy( m_buffer, &_buffer[block1], block2 );
-		m_head = block2;
-		LogData( m_buffer + m_head - block1, block1, "      Read (controller->buffer):  ");
+		LogData( &m_buffer[head], block1, "      Read (controller->buffer):  ");
 		LogData( m_buffer, block2, "      Read (controller->buffer):  ");
 	}
 	else
 	{
 		// There is enough space before we reach the end of the buffer
-		memcpy( &m_buffer[m_head], _buffer, _size );
-		m_head += _size;
-		LogData(m_buffer+m_head-_size, _size, "      Read (controller->buffer):  ");
+		memcpy( &m_buffer[head], _buffer, size );
+		LogData( &m_buffer[head], size, "      Read (controller->buffer):  ");
 	}
 
-	m_dataSize += _size;
+	StoreRelease( &m_head, m_head + size );
+
+	used += size;
+	if( used > m_highWater )
+	{
+		m_highWater = used;
+	}
 
 	if( IsSignalled() )
 	{
@@ -170,10 +234,66 @@ bool Stream::Put
 		Notify();
 	}
 
-	m_mutex->Unlock();
+	return size;
+}
+
+//-----------------------------------------------------------------------------
+//	<Stream::GetView>
+//	Return a contiguous pointer to the oldest data in the buffer
+//-----------------------------------------------------------------------------
+uint8* Stream::GetView
+(
+	uint32 _size
+)
+{
+	if( ( GetDataSize() < _size ) || ( _size > MaxViewSize ) )
+	{
+		return NULL;
+	}
+
+	uint32 tail = m_tail & m_mask;
+	if( (tail + _size) > m_bufferSize )
+	{
+		// Mirror the wrapped part after the end of the ring.  The producer never
+		// writes there, and the bytes being copied are not free space, so no lock
+		// is needed.
+		uint32 block1 = m_bufferSize - tail;
+		memcpy( &m_buffer[m_bufferSize], m_buffer, _size - block1 );
+	}
+	return &m_buffer[tail];
+}
+
+//-----------------------------------------------------------------------------
+//	<Stream::Skip>
+//	Remove data from the buffer without copying it
+//-----------------------------------------------------------------------------
+bool Stream::Skip
+(
+	uint32 _size
+)
+{
+	if( GetDataSize() < _size )
+	{
+		// There is not enough data in the buffer to fulfill the request
+		Log::Write( LogLevel_Error, "ERROR: Not enough data in stream buffer");
+		return false;
+	}
+
+	StoreRelease( &m_tail, m_tail + _size );
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+//	<Stream::GetDataSize>
+//	Return the amount of data in the buffer
+//-----------------------------------------------------------------------------
+uint32 Stream::GetDataSize
+(
+)const
+{
+	return( LoadAcquire( &m_head ) - m_tail );
+}
+
 //-----------------------------------------------------------------------------
 //	<Stream::Purge>
 //	Empty the data buffer
@@ -182,9 +302,9 @@ void Stream::Purge
 (
 )
 {
-	m_tail = 0;
-	m_head = 0;
-	m_dataSize = 0;
+	// Only the consumer's position moves, so data the producer is adding
+	// now is either discarded whole or kept whole
+	StoreRelease( &m_tail, LoadAcquire( &m_head ) );
 }
 
 //-----------------------------------------------------------------------------
@@ -195,7 +315,7 @@ bool Stream::IsSignalled
 (
 )
 {
-	return( m_dataSize >= m_signalSize );
+	return( GetDataSize() >= m_signalSize );
 }
 
 //-----------------------------------------------------------------------------
@@ -206,22 +326,10 @@ void Stream::LogData
 (
 	uint8* _buffer,
 	uint32 _length,
-	const string &_function
+	char const* _function
 )
 {
 	if( !_length ) return;
 
-	string str = "";
-	for( uint32 i=0; i<_length; ++i ) 
-	{
-		if( i )
-		{
-			str += ", ";
-		}
-			
-		char byteStr[8];
-		snprintf( byteStr, sizeof(byteStr), "0x%.2x", _buffer[i] );
-		str += byteStr;
-	}
-	Log::Write( LogLevel_StreamDetail, "%s%s", _function.c_str(), str.c_str() );
+	Log::WriteHex( LogLevel_StreamDetail, 0, _function, _buffer, _length );
 }
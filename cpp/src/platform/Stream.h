@@ -35,9 +35,13 @@
 
 namespace OpenZWave
 {
-	class Mutex;
-
 	/** \brief Platform-independent definition of a circular buffer.
+	 *
+	 * The buffer has a single producer, which calls Put, and a single consumer, which
+	 * calls everything else.  Neither takes a lock.  Each side owns one of the two
+	 * positions, and only reads the other's, so the producer is never held up by the
+	 * consumer.  The size is a power of two, so the positions can run freely and wrap
+	 * with a mask.
 	 */
 	class Stream: public Wait
 	{
@@ -47,6 +51,7 @@ namespace OpenZWave
 		/**
 		 * Constructor.
 		 * Creates a cross-platform ring buffer object
+		 * \param _bufferSize size of the buffer in bytes.  Rounded up to a power of two.
 		 */
 		Stream( uint32 _bufferSize );
 
@@ -73,29 +78,80 @@ namespace OpenZWave
 
 		/**
 		 * Copies the requested amount of data from the buffer into the stream.
-		 * If there is insufficient room available in the stream's circular buffer, and no data is transferred.
+		 * If there is insufficient room available in the stream's circular buffer, as much as fits
+		 * is copied and the rest is dropped and counted.  Only the producer may call this.
 		 * \param _buffer pointer to a block of memory that will be copied into the stream.
 		 * \param _size the amount of data in bytes to copy to the stream.
-		 * \return true if all the requested data has been copied.  False if there was not enough space in
-		 * the stream's circular buffer.
-		 * \see Get, GetDataSize
+		 * \return the number of bytes copied.
+		 * \see Get, GetDataSize, GetOverflowBytes
+		 */
+		uint32 Put( uint8* _buffer, uint32 _size );
+
+		/**
+		 * Returns a byte from the stream without removing it.
+		 * \param _offset position of the byte, counted from the oldest byte in the stream.  Must be
+		 * less than GetDataSize().
+		 * \return the requested byte.
+		 * \see GetView, Skip
+		 */
+		uint8 Peek( uint32 _offset )const
+		{
+			return m_buffer[( m_tail + _offset ) & m_mask];
+		}
+
+		/**
+		 * Returns a pointer to the oldest data in the stream, without copying or removing it.
+		 * If the data wraps around the end of the circular buffer, the wrapped bytes are mirrored
+		 * just past the end of the buffer, so the returned block is always contiguous.  The pointer
+		 * remains valid until the data is removed with Skip, Get or Purge.
+		 * \param _size the amount of data in bytes that must be available.  At most MaxViewSize.
+		 * \return pointer to the data, or NULL if there is not enough data in the stream.
+		 * \see Peek, Skip
+		 */
+		uint8* GetView( uint32 _size );
+
+		/**
+		 * Removes the requested amount of data from the stream without copying it.
+		 * \param _size the amount of data in bytes to remove.
+		 * \return true if the data was removed.  False if there was not enough data in the stream.
+		 * \see GetView, Get
 		 */
-		bool Put( uint8* _buffer, uint32 _size );
+		bool Skip( uint32 _size );
+
+		enum
+		{
+			MaxViewSize = 512		// Largest block that can be returned by GetView
+		};
 
  		/**
 		 * Returns the amount of data in bytes that is stored in the stream.
 		 * \return the number of bytes of data in the stream.
 		 * \see Get, GetDataSize
 		 */
-		uint32 GetDataSize()const{ return m_dataSize; }
+		uint32 GetDataSize()const;
 
  		/**
 		 * Empties the stream bytes held in the buffer.  
 		 * This is called when the library gets out of sync with the controller and sends a "NAK" 
-		 * to the controller.
+		 * to the controller.  Only the consumer may call this.
 		 */
 		void Purge();
 
+		/**
+		 * Returns the size of the circular buffer in bytes.
+		 */
+		uint32 GetBufferSize()const{ return m_bufferSize; }
+
+		/**
+		 * Returns the number of bytes dropped by Put because the buffer was full.
+		 */
+		uint32 GetOverflowBytes()const{ return m_overflowBytes; }
+
+		/**
+		 * Returns the most data the buffer has held at once.
+		 */
+		uint32 GetHighWater()const{ return m_highWater; }
+
 	protected:
 		/**
 		 * Formats stream buffer data for output to the log.
@@ -103,7 +159,7 @@ namespace OpenZWave
 		 * \param _size number of valid bytes currently in the buffer
 		 * \param _function string containing text to display before the data
 		 */
-		void LogData( uint8* _buffer, uint32 _size, const string &_function );
+		void LogData( uint8* _buffer, uint32 _size, char const* _function );
 
 		/**
 		 * Used by the Wait class to test whether the buffer contains sufficient data.
@@ -120,13 +176,15 @@ namespace OpenZWave
 		Stream( Stream const&	);					// prevent copy
 		Stream& operator = ( Stream const& );		// prevent assignment
 
-		uint8*	m_buffer;
-		uint32	m_bufferSize;
-		uint32	m_signalSize;
-		uint32	m_dataSize;
-		uint32	m_head;
-		uint32	m_tail;
- 		Mutex*	m_mutex;
+		uint8*			m_buffer;
+		uint32			m_bufferSize;
+		uint32			m_mask;
+		uint32			m_signalSize;
+		volatile uint32	m_head;				// Bytes ever written.  Only changed by the producer.
+		volatile uint32	m_tail;				// Bytes ever removed.  Only changed by the consumer.
+		uint32			m_overflowBytes;
+		uint32			m_highWater;
+		bool			m_overflowing;		// Put is dropping data, and has logged it
 	};
 
 } // namespace OpenZWave
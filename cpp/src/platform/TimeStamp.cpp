@@ -92,6 +92,17 @@ string TimeStamp::GetAsString
 {
 	return m_pImpl->GetAsString();
 }
+//-----------------------------------------------------------------------------
+//	<TimeStamp::GetAsMilliseconds>
+//	Return object as milliseconds since the Unix epoch
+//-----------------------------------------------------------------------------
+uint64 TimeStamp::GetAsMilliseconds
+(
+)
+{
+	return m_pImpl->GetAsMilliseconds();
+}
+
 //-----------------------------------------------------------------------------
 //	<TimeStamp::operator->
 //	Overload the subtract operator to get the difference between two 
@@ -72,6 +72,12 @@ namespace OpenZWave
 		 */
 		string GetAsString();
 
+		/**
+		 * Return as the number of milliseconds since 1970-01-01 00:00:00 UTC.
+		 * \return uint64
+		 */
+		uint64 GetAsMilliseconds();
+
 		/**
 		 * Overload the subtract operator to get the difference between
 		 * two timestamps in milliseconds.
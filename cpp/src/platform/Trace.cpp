@@ -0,0 +1,517 @@
+//-----------------------------------------------------------------------------
+//
+//	Trace.cpp
+//
+//	Compact binary trace of log messages and serial frames
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+#include "Defs.h"
+#include "platform/Trace.h"
+#include "platform/Mutex.h"
+#include "platform/TimeStamp.h"
+
+using namespace OpenZWave;
+
+Trace* Trace::s_instance = NULL;
+
+static char const c_traceSignature[] = "OZWTRACE";
+
+//-----------------------------------------------------------------------------
+//	<PutUint16>
+//	Store a little-endian uint16
+//-----------------------------------------------------------------------------
+static inline uint8* PutUint16
+(
+	uint8* _dest,
+	uint16 const _value
+)
+{
+	_dest[0] = (uint8)( _value & 0xff );
+	_dest[1] = (uint8)( _value >> 8 );
+	return _dest + 2;
+}
+
+//-----------------------------------------------------------------------------
+//	<PutUint32>
+//	Store a little-endian uint32
+//-----------------------------------------------------------------------------
+static inline uint8* PutUint32
+(
+	uint8* _dest,
+	uint32 const _value
+)
+{
+	for( int i=0; i<4; ++i )
+	{
+		_dest[i] = (uint8)( _value >> ( i * 8 ) );
+	}
+	return _dest + 4;
+}
+
+//-----------------------------------------------------------------------------
+//	<PutUint64>
+//	Store a little-endian uint64
+//-----------------------------------------------------------------------------
+static inline uint8* PutUint64
+(
+	uint8* _dest,
+	uint64 const _value
+)
+{
+	for( int i=0; i<8; ++i )
+	{
+		_dest[i] = (uint8)( _value >> ( i * 8 ) );
+	}
+	return _dest + 8;
+}
+
+//-----------------------------------------------------------------------------
+//	<Fits>
+//	Check there is room to store an argument, and stop storing once there isn't
+//-----------------------------------------------------------------------------
+static inline bool Fits
+(
+	uint8 const* _p,
+	uint8 const* _end,
+	uint32 const _size,
+	bool& _full
+)
+{
+	if( !_full && ( (uint32)( _end - _p ) >= _size ) )
+	{
+		return true;
+	}
+	_full = true;
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+//	<Trace::Create>
+//	Static creation of the singleton
+//-----------------------------------------------------------------------------
+Trace* Trace::Create
+(
+	string const& _filename,
+	bool const _bAppend,
+	LogLevel const _level
+)
+{
+	Destroy();
+
+	FILE* file = fopen( _filename.c_str(), _bAppend ? "ab" : "wb" );
+	if( file == NULL )
+	{
+		Log::Write( LogLevel_Warning, "Could not open trace file %s", _filename.c_str() );
+		return NULL;
+	}
+
+	// Every session starts with a header, so appended traces can be decoded too
+	uint8 header[sizeof(c_traceSignature)];
+	memcpy( header, c_traceSignature, sizeof(c_traceSignature) - 1 );
+	header[sizeof(c_traceSignature) - 1] = Version;
+	fwrite( header, 1, sizeof(header), file );
+
+	s_instance = new Trace( file );
+	Log::s_traceLevel = _level;
+	return s_instance;
+}
+
+//-----------------------------------------------------------------------------
+//	<Trace::Destroy>
+//	Static method to destroy the singleton
+//-----------------------------------------------------------------------------
+void Trace::Destroy
+(
+)
+{
+	Log::s_traceLevel = LogLevel_Invalid;
+	delete s_instance;
+	s_instance = NULL;
+}
+
+//-----------------------------------------------------------------------------
+//	<Trace::Trace>
+//	Constructor
+//-----------------------------------------------------------------------------
+Trace::Trace
+(
+	FILE* _file
+):
+	m_file( _file ),
+	m_mutex( new Mutex() ),
+	m_now( new TimeStamp() )
+{
+}
+
+//-----------------------------------------------------------------------------
+//	<Trace::~Trace>
+//	Destructor
+//-----------------------------------------------------------------------------
+Trace::~Trace
+(
+)
+{
+	fclose( m_file );
+	m_mutex->Release();
+	delete m_now;
+}
+
+//-----------------------------------------------------------------------------
+//	<Trace::WriteMessage>
+//	Record a log message without formatting it
+//-----------------------------------------------------------------------------
+void Trace::WriteMessage
+(
+	LogLevel _level,
+	uint8 const _nodeId,
+	char const* _format,
+	va_list _args
+)
+{
+	if( ( s_instance == NULL ) || !IsLevelEnabled( _level ) || ( _format == NULL ) )
+	{
+		return;
+	}
+
+	Trace* trace = s_instance;
+	trace->m_mutex->Lock();
+
+	uint8* payload = trace->m_payload;
+	trace->m_now->SetTime();
+	uint8* p = PutUint64( payload, trace->m_now->GetAsMilliseconds() );
+	*p++ = _nodeId;
+	*p++ = (uint8)_level;
+
+	uint16 formatId = trace->GetFormatId( _format );
+	p = PutUint16( p, formatId );
+
+	uint32 length = p - payload;
+	if( formatId == 0xffff )
+	{
+		// Out of format ids, so store the formatted text as a single string
+		char text[MaxStringLength];
+#ifdef WIN32
+		_vsnprintf_s( text, sizeof(text), _TRUNCATE, _format, _args );
+#else
+		vsnprintf( text, sizeof(text), _format, _args );
+#endif
+		uint16 textLength = (uint16)strlen( text );
+		p = PutUint16( p, textLength );
+		memcpy( p, text, textLength );
+		length += 2 + textLength;
+	}
+	else
+	{
+		length += trace->PackArgs( p, MaxPayload - length, _format, _args );
+	}
+
+	trace->WriteRecord( TraceRecord_Message, payload, length );
+
+	// Make sure anything serious reaches the disk
+	if( _level <= LogLevel_Warning )
+	{
+		fflush( trace->m_file );
+	}
+
+	trace->m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<Trace::WriteFrame>
+//	Record the bytes of a serial frame
+//-----------------------------------------------------------------------------
+void Trace::WriteFrame
+(
+	TraceDirection _direction,
+	uint8 const _nodeId,
+	uint8 const* _data,
+	uint32 const _length
+)
+{
+	if( s_instance == NULL )
+	{
+		return;
+	}
+
+	Trace* trace = s_instance;
+	trace->m_mutex->Lock();
+
+	uint8* payload = trace->m_payload;
+	trace->m_now->SetTime();
+	uint8* p = PutUint64( payload, trace->m_now->GetAsMilliseconds() );
+	*p++ = _nodeId;
+	*p++ = (uint8)_direction;
+
+	uint32 length = _length;
+	if( length > ( MaxPayload - 10 ) )
+	{
+		length = MaxPayload - 10;
+	}
+	memcpy( p, _data, length );
+
+	trace->WriteRecord( TraceRecord_Frame, payload, 10 + length );
+	trace->m_mutex->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+//	<Trace::GetFormatId>
+//	Find or assign the id of a format string, writing out any new ones
+//-----------------------------------------------------------------------------
+uint16 Trace::GetFormatId
+(
+	char const* _format
+)
+{
+	map<char const*,uint16>::iterator it = m_formatIds.find( _format );
+	if( ( it != m_formatIds.end() ) && ( m_formats[it->second] == _format ) )
+	{
+		return it->second;
+	}
+
+	if( m_formats.size() >= MaxFormats )
+	{
+		return 0xffff;
+	}
+
+	// New format string (or a buffer that now holds a different one)
+	uint16 formatId = (uint16)m_formats.size();
+	m_formats.push_back( _format );
+	m_formatIds[_format] = formatId;
+
+	uint8 payload[2 + MaxStringLength];
+	uint32 length = strlen( _format );
+	if( length > MaxStringLength )
+	{
+		length = MaxStringLength;
+	}
+	PutUint16( payload, formatId );
+	memcpy( &payload[2], _format, length );
+	WriteRecord( TraceRecord_Format, payload, 2 + length );
+	return formatId;
+}
+
+//-----------------------------------------------------------------------------
+//	<Trace::WriteRecord>
+//	Write a record header and payload to the file
+//-----------------------------------------------------------------------------
+void Trace::WriteRecord
+(
+	TraceRecord _type,
+	uint8 const* _payload,
+	uint32 _length
+)
+{
+	uint8 header[3];
+	header[0] = (uint8)_type;
+	PutUint16( &header[1], (uint16)_length );
+	fwrite( header, 1, sizeof(header), m_file );
+	fwrite( _payload, 1, _length, m_file );
+}
+
+//-----------------------------------------------------------------------------
+//	<Trace::PackArgs>
+//	Store the arguments used by a printf format string
+//-----------------------------------------------------------------------------
+uint32 Trace::PackArgs
+(
+	uint8* _buffer,
+	uint32 _size,
+	char const* _format,
+	va_list _args
+)
+{
+	uint8* p = _buffer;
+	uint8* end = _buffer + _size;
+
+	// Once an argument doesn't fit, the rest are dropped so the decoder stays in step.
+	bool full = false;
+
+	for( char const* f = _format; *f; ++f )
+	{
+		if( *f != '%' )
+		{
+			continue;
+		}
+		if( *(++f) == '%' )
+		{
+			continue;
+		}
+
+		// Flags
+		while( *f && strchr( "-+ #0'", *f ) )
+		{
+			++f;
+		}
+
+		// Width and precision, either of which may be passed as an argument
+		for( int part=0; part<2; ++part )
+		{
+			if( *f == '*' )
+			{
+				int32 value = va_arg( _args, int );
+				if( Fits( p, end, 4, full ) )
+				{
+					p = PutUint32( p, (uint32)value );
+				}
+				++f;
+			}
+			while( ( *f >= '0' ) && ( *f <= '9' ) )
+			{
+				++f;
+			}
+			if( ( part == 0 ) && ( *f == '.' ) )
+			{
+				++f;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		// Length modifier
+		bool isLong = false;
+		bool isLongLong = false;
+		bool isSize = false;
+		bool isLongDouble = false;
+		while( *f && strchr( "hlLqjzt", *f ) )
+		{
+			switch( *f )
+			{
+				case 'l':	isLongLong = isLong; isLong = true;	break;
+				case 'q':	isLongLong = true;					break;
+				case 'j':	isLongLong = true;					break;
+				case 'z':
+				case 't':	isSize = true;						break;
+				case 'L':	isLongDouble = true;				break;
+				default:										break;
+			}
+			++f;
+		}
+
+		switch( *f )
+		{
+			case 'd':
+			case 'i':
+			case 'c':
+			case 'u':
+			case 'o':
+			case 'x':
+			case 'X':
+			{
+				if( isLongLong || isLong || isSize )
+				{
+					uint64 value;
+					if( isLongLong )
+					{
+						value = (uint64)va_arg( _args, long long );
+					}
+					else if( isLong )
+					{
+						value = (uint64)va_arg( _args, long );
+					}
+					else
+					{
+						value = (uint64)va_arg( _args, size_t );
+					}
+					if( Fits( p, end, 8, full ) )
+					{
+						p = PutUint64( p, value );
+					}
+				}
+				else
+				{
+					uint32 value = (uint32)va_arg( _args, int );
+					if( Fits( p, end, 4, full ) )
+					{
+						p = PutUint32( p, value );
+					}
+				}
+				break;
+			}
+			case 'e':
+			case 'E':
+			case 'f':
+			case 'F':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A':
+			{
+				double value = isLongDouble ? (double)va_arg( _args, long double ) : va_arg( _args, double );
+				uint64 bits;
+				memcpy( &bits, &value, sizeof(bits) );
+				if( Fits( p, end, 8, full ) )
+				{
+					p = PutUint64( p, bits );
+				}
+				break;
+			}
+			case 's':
+			{
+				char const* value = va_arg( _args, char const* );
+				if( value == NULL )
+				{
+					value = "(null)";
+				}
+				uint32 length = strlen( value );
+				if( length > MaxStringLength )
+				{
+					length = MaxStringLength;
+				}
+				if( Fits( p, end, 2 + length, full ) )
+				{
+					p = PutUint16( p, (uint16)length );
+					memcpy( p, value, length );
+					p += length;
+				}
+				break;
+			}
+			case 'p':
+			{
+				void* value = va_arg( _args, void* );
+				if( Fits( p, end, 8, full ) )
+				{
+					p = PutUint64( p, (uint64)(size_t)value );
+				}
+				break;
+			}
+			case 'n':
+			{
+				// Nothing is written back, but the argument must be skipped
+				(void)va_arg( _args, void* );
+				break;
+			}
+			default:
+			{
+				if( *f == 0 )
+				{
+					// Format ended part way through a conversion
+					return p - _buffer;
+				}
+				break;
+			}
+		}
+	}
+
+	return p - _buffer;
+}
@@ -0,0 +1,156 @@
+//-----------------------------------------------------------------------------
+//
+//	Trace.h
+//
+//	Compact binary trace of log messages and serial frames
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _Trace_H
+#define _Trace_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string>
+#include <map>
+#include <vector>
+#include "Defs.h"
+#include "platform/Log.h"
+
+namespace OpenZWave
+{
+	class Mutex;
+	class TimeStamp;
+
+	/** \brief Writes log messages and serial frames to a compact binary file.
+	 *
+	 * The trace file starts with the eight byte signature "OZWTRACE" and a one byte
+	 * version number.  This is followed by records, each made up of a one byte
+	 * TraceRecord type, a two byte little-endian payload length and the payload.
+	 * All multi-byte values are little-endian.
+	 *
+	 * - TraceRecord_Format: uint16 format id, then the printf format string.  Written
+	 *   the first time a format string is used.
+	 * - TraceRecord_Message: uint64 time in ms since the Unix epoch, uint8 node id,
+	 *   uint8 LogLevel, uint16 format id, then the arguments in the order they appear
+	 *   in the format string.  Integers are four bytes, or eight if the conversion has
+	 *   an l, ll, q, j, z or t modifier.  Floating point values are eight byte doubles,
+	 *   pointers are eight bytes, and strings are a uint16 length followed by the text.
+	 *   A '*' width or precision is stored as a four byte integer.
+	 * - TraceRecord_Frame: uint64 time, uint8 node id, uint8 TraceDirection, then the
+	 *   bytes of the frame.
+	 *
+	 * The ozw-tracedump tool turns a trace file back into the text log format.
+	 */
+	class Trace
+	{
+	public:
+		enum
+		{
+			Version = 1,
+			MaxFormats = 4096,				/**< Format strings beyond this many are written as plain text */
+			MaxStringLength = 1024,			/**< Longest string argument that is kept */
+			MaxPayload = 4096				/**< Largest record payload.  Arguments that do not fit are dropped. */
+		};
+
+		enum TraceRecord
+		{
+			TraceRecord_Format = 1,
+			TraceRecord_Message,
+			TraceRecord_Frame
+		};
+
+		enum TraceDirection
+		{
+			TraceDirection_Received = 0,
+			TraceDirection_Sent
+		};
+
+		/**
+		 * Create the trace.
+		 * Opens the trace file and starts recording.  Any previous trace is closed.
+		 * \param _filename Name of the file to write.
+		 * \param _bAppend If true, records are added to an existing trace file.
+		 * \param _level Least severe level of log message to record.  Frames are always recorded.
+		 * \return a pointer to the trace, or NULL if the file could not be opened.
+		 * \see Destroy
+		 */
+		static Trace* Create( string const& _filename, bool const _bAppend, LogLevel const _level );
+
+		/**
+		 * Destroy the trace.
+		 * Flushes and closes the trace file.
+		 * \see Create
+		 */
+		static void Destroy();
+
+		/**
+		 * Determine whether a log message of the given level is recorded.
+		 * \param _level Specifies the type of log message (Error, Warning, Debug, etc.)
+		 * \return true if messages of this level are written to the trace.
+		 */
+		static bool IsLevelEnabled( LogLevel _level ){ return( _level <= Log::s_traceLevel ); }
+
+		/**
+		 * Determine whether a trace is being recorded.
+		 * \return true if frames are written to the trace.
+		 */
+		static bool IsEnabled(){ return( s_instance != NULL ); }
+
+		/**
+		 * Record a log message.
+		 * Called by Log::Write.  The message is stored unformatted.
+		 * \param _level Specifies the type of log message (Error, Warning, Debug, etc.)
+		 * \param _nodeId Node Id this entry is about.
+		 * \param _format A string formatted in the same manner as used with printf etc.
+		 * \param _args The arguments referenced by _format.
+		 */
+		static void WriteMessage( LogLevel _level, uint8 const _nodeId, char const* _format, va_list _args );
+
+		/**
+		 * Record a serial frame.
+		 * \param _direction Whether the frame was received from or sent to the controller.
+		 * \param _nodeId Node Id the frame is about.
+		 * \param _data Pointer to the bytes of the frame.
+		 * \param _length Number of bytes in the frame.
+		 */
+		static void WriteFrame( TraceDirection _direction, uint8 const _nodeId, uint8 const* _data, uint32 const _length );
+
+	private:
+		Trace( FILE* _file );
+		~Trace();
+
+		uint16 GetFormatId( char const* _format );
+		void WriteRecord( TraceRecord _type, uint8 const* _payload, uint32 _length );
+		uint32 PackArgs( uint8* _buffer, uint32 _size, char const* _format, va_list _args );
+
+		static Trace*		s_instance;
+
+		FILE*							m_file;
+		Mutex*							m_mutex;
+		TimeStamp*						m_now;
+		uint8							m_payload[MaxPayload];
+		map<char const*,uint16>			m_formatIds;		/**< Format ids keyed by the address of the format string */
+		vector<string>					m_formats;			/**< Text of each format, to spot an address being reused for a different string */
+	};
+
+} // namespace OpenZWave
+
+#endif //_Trace_H
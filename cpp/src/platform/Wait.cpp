@@ -180,3 +180,174 @@ void WaitMultipleCallback
 	waitEvent->Set();
 }
 
+
+//-----------------------------------------------------------------------------
+//	<WaitSet::WaitSet>
+//	Constructor
+//-----------------------------------------------------------------------------
+WaitSet::WaitSet
+(
+):
+	m_numObjects( 0 ),
+	m_pImpl( new WaitSetImpl() ),
+	m_ownImpl( true )
+{
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSet::WaitSet>
+//	Constructor for a set that wakes the thread sleeping on another set
+//-----------------------------------------------------------------------------
+WaitSet::WaitSet
+(
+	WaitSet* _wakeup
+):
+	m_numObjects( 0 ),
+	m_pImpl( _wakeup->m_pImpl ),
+	m_ownImpl( false )
+{
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSet::~WaitSet>
+//	Destructor
+//-----------------------------------------------------------------------------
+WaitSet::~WaitSet
+(
+)
+{
+	for( uint32 i=0; i<m_numObjects; ++i )
+	{
+		m_objects[i]->RemoveWatcher( WaitSetCallback, m_pImpl );
+	}
+	if( m_ownImpl )
+	{
+		delete m_pImpl;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSet::Add>
+//	Add an object to the set, and start watching it
+//-----------------------------------------------------------------------------
+int32 WaitSet::Add
+(
+	Wait* _object
+)
+{
+	if( m_numObjects >= MaxObjects )
+	{
+		assert(0);
+		return -1;
+	}
+
+	m_objects[m_numObjects] = _object;
+	_object->AddWatcher( WaitSetCallback, m_pImpl );
+	return (int32)m_numObjects++;
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSet::Multiple>
+//	Wait for one of the objects at the start of the set to become signalled.
+//-----------------------------------------------------------------------------
+int32 WaitSet::Multiple
+(
+	uint32 _numObjects,
+	int32 _timeout // = -1
+)
+{
+	if( _numObjects > m_numObjects )
+	{
+		_numObjects = m_numObjects;
+	}
+
+	if( _timeout > 0 )
+	{
+		m_deadline.SetTime( _timeout );
+	}
+
+	while( true )
+	{
+		// The watchers wake us on every transition to signalled, so an object
+		// signalled after this scan cannot be missed by the wait below.
+		for( uint32 i=0; i<_numObjects; ++i )
+		{
+			if( m_objects[i]->IsSignalled() )
+			{
+				return (int32)i;
+			}
+		}
+
+		int32 remaining = _timeout;
+		if( _timeout > 0 )
+		{
+			remaining = m_deadline.TimeRemaining();
+			if( remaining < 0 )
+			{
+				remaining = 0;
+			}
+		}
+
+		if( !m_pImpl->Wait( remaining ) )
+		{
+			// Timed out.  Take one last look in case we raced with a signal.
+			for( uint32 i=0; i<_numObjects; ++i )
+			{
+				if( m_objects[i]->IsSignalled() )
+				{
+					return (int32)i;
+				}
+			}
+			return -1;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSet::Check>
+//	Test the objects at the start of the set without waiting
+//-----------------------------------------------------------------------------
+int32 WaitSet::Check
+(
+	uint32 _numObjects
+)
+{
+	if( _numObjects > m_numObjects )
+	{
+		_numObjects = m_numObjects;
+	}
+
+	for( uint32 i=0; i<_numObjects; ++i )
+	{
+		if( m_objects[i]->IsSignalled() )
+		{
+			return (int32)i;
+		}
+	}
+	return -1;
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSet::Sleep>
+//	Sleep until any set sharing our wakeup has an object signalled
+//-----------------------------------------------------------------------------
+bool WaitSet::Sleep
+(
+	int32 _timeout // = -1
+)
+{
+	return m_pImpl->Wait( _timeout );
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSet::WaitSetCallback>
+//	Callback handler for the watchers added by WaitSet::Add
+//-----------------------------------------------------------------------------
+void WaitSet::WaitSetCallback
+(
+	void* _context
+)
+{
+	WaitSetImpl* impl = (WaitSetImpl*)_context;
+	impl->Signal();
+}
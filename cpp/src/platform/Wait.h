@@ -31,16 +31,19 @@
 
 #include <list>
 #include "platform/Ref.h"
+#include "platform/TimeStamp.h"
 
 namespace OpenZWave
 {
 	class WaitImpl;
+	class WaitSetImpl;
 
 	/** \brief Platform-independent definition of Wait objects.
 	 */
 	class Wait: public Ref
 	{
 		friend class WaitImpl;
+		friend class WaitSet;
 		friend class ThreadImpl;
 
 	public:
@@ -107,6 +110,92 @@ namespace OpenZWave
 		WaitImpl*	m_pImpl;					// Pointer to an object that encapsulates the platform-specific implementation of a Wait object.
 	};
 
+	/** \brief A persistent set of Wait objects that can be waited on repeatedly.
+	 *
+	 * Wait::Multiple creates an event and adds and removes a watcher on every object
+	 * each time it is called.  A WaitSet registers its watcher once, when an object is
+	 * added, so waiting on the set neither allocates memory nor touches the watcher
+	 * lists of the objects.  On Linux the set sleeps in epoll on an eventfd.
+	 */
+	class WaitSet
+	{
+	public:
+		enum
+		{
+			MaxObjects = 16
+		};
+
+		/**
+		 * Constructor.
+		 * Creates an empty wait set.
+		 */
+		WaitSet();
+
+		/**
+		 * Constructor.
+		 * Creates an empty wait set that shares the wakeup of another set, so one thread
+		 * can sleep on several sets with _wakeup->Sleep and then Check each of them.
+		 * \param _wakeup the set whose wakeup is shared.  It must outlive this set.
+		 */
+		WaitSet( WaitSet* _wakeup );
+
+		/**
+		 * Destructor.
+		 * Removes the watchers from all the objects in the set.
+		 */
+		~WaitSet();
+
+		/**
+		 * Add an object to the set.  The object is watched until the set is destroyed.
+		 * \param _object pointer to the object to add.
+		 * \return index of the object in the set, or -1 if the set is full.
+		 */
+		int32 Add( Wait* _object );
+
+		/**
+		 * Returns the number of objects in the set.
+		 */
+		uint32 GetCount()const{ return m_numObjects; }
+
+		/**
+		 * Wait for one of the first _numObjects objects in the set to become signalled.  If more
+		 * than one object is in a signalled state, the lowest index will be returned.
+		 * \param _numObjects number of objects, counted from the start of the set, to wait on.
+		 * \param _timeout optional maximum time to wait.  Defaults to -1, which means wait forever.
+		 * \return index of the object that was signalled, -1 if the wait timed out.
+		 */
+		int32 Multiple( uint32 _numObjects, int32 _timeout = -1 );
+
+		/**
+		 * Test the first _numObjects objects in the set without waiting.
+		 * \param _numObjects number of objects, counted from the start of the set, to test.
+		 * \return index of the first object that is signalled, -1 if none are.
+		 */
+		int32 Check( uint32 _numObjects );
+
+		/**
+		 * Sleep until an object in this set, or in any set sharing its wakeup, becomes
+		 * signalled.  An object signalled since the last Sleep or Multiple ends the sleep
+		 * at once, so a thread can Check its sets and then Sleep without missing a signal.
+		 * Unlike Multiple, Sleep may return when nothing is signalled.
+		 * \param _timeout optional maximum time to wait.  Defaults to -1, which means wait forever.
+		 * \return false if the wait timed out.
+		 */
+		bool Sleep( int32 _timeout = -1 );
+
+	private:
+		WaitSet( WaitSet const& );					// prevent copy
+		WaitSet& operator = ( WaitSet const& );		// prevent assignment
+
+		static void WaitSetCallback( void* _context );
+
+		Wait*			m_objects[MaxObjects];
+		uint32			m_numObjects;
+		TimeStamp		m_deadline;
+		WaitSetImpl*	m_pImpl;					// Pointer to an object that encapsulates the platform-specific wakeup mechanism.
+		bool			m_ownImpl;					// False if m_pImpl belongs to the set passed to the constructor
+	};
+
 } // namespace OpenZWave
 
 #endif //_Wait_H
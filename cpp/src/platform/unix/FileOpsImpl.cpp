@@ -27,6 +27,12 @@
 //-----------------------------------------------------------------------------
 
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "FileOpsImpl.h"
 
 using namespace OpenZWave;
@@ -69,3 +75,137 @@ bool FileOpsImpl::FolderExists
 	else
 		return false;
 }
+
+//-----------------------------------------------------------------------------
+//	<FileOpsImpl::FileWriteAtomic>
+//	Write to a temporary file, then rename it over the original
+//-----------------------------------------------------------------------------
+bool FileOpsImpl::FileWriteAtomic
+(
+	const string &_filename,
+	const string &_contents
+)
+{
+	string tempName = _filename + ".tmp";
+	int fd = open( tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if( fd < 0 )
+	{
+		return false;
+	}
+
+	char const* data = _contents.data();
+	size_t remaining = _contents.size();
+	while( remaining > 0 )
+	{
+		ssize_t written = write( fd, data, remaining );
+		if( written < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			close( fd );
+			unlink( tempName.c_str() );
+			return false;
+		}
+		data += written;
+		remaining -= written;
+	}
+
+	// The data must be on disk before the rename makes it the live file
+	if( fsync( fd ) != 0 || close( fd ) != 0 )
+	{
+		unlink( tempName.c_str() );
+		return false;
+	}
+
+	if( rename( tempName.c_str(), _filename.c_str() ) != 0 )
+	{
+		unlink( tempName.c_str() );
+		return false;
+	}
+
+	// Make the rename itself durable
+	string folder = ".";
+	size_t pos = _filename.rfind( '/' );
+	if( pos != string::npos )
+	{
+		folder = _filename.substr( 0, pos+1 );
+	}
+	int dirfd = open( folder.c_str(), O_RDONLY );
+	if( dirfd >= 0 )
+	{
+		fsync( dirfd );
+		close( dirfd );
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<FileOpsImpl::FileMap>
+//	Map a whole file into memory, read only
+//-----------------------------------------------------------------------------
+void const* FileOpsImpl::FileMap
+(
+	const string &_filename,
+	size_t* _size
+)
+{
+	int fd = open( _filename.c_str(), O_RDONLY );
+	if( fd < 0 )
+	{
+		return NULL;
+	}
+
+	struct stat st;
+	if( fstat( fd, &st ) != 0 || st.st_size == 0 )
+	{
+		close( fd );
+		return NULL;
+	}
+
+	void* data = mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+	if( data == MAP_FAILED )
+	{
+		return NULL;
+	}
+
+	*_size = (size_t)st.st_size;
+	return data;
+}
+
+//-----------------------------------------------------------------------------
+//	<FileOpsImpl::FileUnmap>
+//	Release a mapped file
+//-----------------------------------------------------------------------------
+void FileOpsImpl::FileUnmap
+(
+	void const* _data,
+	size_t _size
+)
+{
+	munmap( const_cast<void*>( _data ), _size );
+}
+
+//-----------------------------------------------------------------------------
+//	<FileOpsImpl::FileInfo>
+//	Get the size and modification time of a file
+//-----------------------------------------------------------------------------
+bool FileOpsImpl::FileInfo
+(
+	const string &_filename,
+	uint64* _modified,
+	uint64* _size
+)
+{
+	struct stat st;
+	if( stat( _filename.c_str(), &st ) != 0 )
+	{
+		return false;
+	}
+
+	*_modified = (uint64)st.st_mtime;
+	*_size = (uint64)st.st_size;
+	return true;
+}
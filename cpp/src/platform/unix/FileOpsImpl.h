@@ -44,6 +44,10 @@ namespace OpenZWave
 		~FileOpsImpl();
 
 		bool FolderExists( string _filename );
+		bool FileWriteAtomic( const string &_filename, const string &_contents );
+		void const* FileMap( const string &_filename, size_t* _size );
+		void FileUnmap( void const* _data, size_t _size );
+		bool FileInfo( const string &_filename, uint64* _modified, uint64* _size );
 	};
 
 } // namespace OpenZWave
@@ -29,8 +29,14 @@
 #include <cstring>
 #include <pthread.h>
 #include <iostream>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
 #include "Defs.h"
 #include "LogImpl.h"
+#include "platform/Event.h"
+#include "platform/Thread.h"
+#include "platform/Wait.h"
 
 using namespace OpenZWave;
 
@@ -45,14 +51,29 @@ LogImpl::LogImpl
 		bool const _bConsoleOutput,
 		LogLevel const _saveLevel,
 		LogLevel const _queueLevel,
-		LogLevel const _dumpTrigger
+		LogLevel const _dumpTrigger,
+		bool const _bAsyncWrite
 ):
 m_filename( _filename ),					// name of log file
 m_bConsoleOutput( _bConsoleOutput ),		// true to provide a copy of output to console
 m_bAppendLog( _bAppendLog ),				// true to append (and not overwrite) any existing log
 m_saveLevel( _saveLevel ),					// level of messages to log to file
 m_queueLevel( _queueLevel ),				// level of messages to log to queue
-m_dumpTrigger( _dumpTrigger )				// dump queued messages when this level is seen
+m_dumpTrigger( _dumpTrigger ),				// dump queued messages when this level is seen
+pFile( NULL ),
+m_queueBuffer( new char[LogQueueBufferSize] ),
+m_queueHead( 0 ),
+m_queueTail( 0 ),
+m_queueUsed( 0 ),
+m_queueCount( 0 ),
+m_bAsyncWrite( false ),
+m_records( NULL ),
+m_enqueuePos( 0 ),
+m_dequeuePos( 0 ),
+m_droppedRecords( 0 ),
+m_wakePending( 0 ),
+m_dataEvent( NULL ),
+m_writerThread( NULL )
 {
 	if (!m_filename.empty()) {
 		if ( !m_bAppendLog )
@@ -69,6 +90,23 @@ m_dumpTrigger( _dumpTrigger )				// dump queued messages when this level is seen
 		}
 	}
 	setlinebuf(stdout);	// To prevent buffering and lock contention issues
+
+	if( _bAsyncWrite && ( this->pFile != NULL || m_bConsoleOutput ) )
+	{
+		// Hand the file and console writes to a thread of their own, so that a slow
+		// disk cannot hold up whoever is logging.
+		m_records = new LogRecord[LogRecordCount];
+		for( uint32 i=0; i<LogRecordCount; ++i )
+		{
+			m_records[i].m_sequence = i;
+			m_records[i].m_length = 0;
+		}
+
+		m_dataEvent = new Event();
+		m_writerThread = new Thread( "log" );
+		m_bAsyncWrite = true;
+		m_writerThread->Start( LogImpl::WriterThreadEntryPoint, this );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -79,8 +117,19 @@ LogImpl::~LogImpl
 (
 )
 {
+	if( m_writerThread )
+	{
+		// The writer flushes any outstanding lines before it exits
+		m_writerThread->Stop();
+		m_writerThread->Release();
+		m_dataEvent->Release();
+		delete [] m_records;
+	}
+
 	if (this->pFile)
 		fclose( this->pFile );
+
+	delete [] m_queueBuffer;
 }
 
 //-----------------------------------------------------------------------------
@@ -95,14 +144,12 @@ void LogImpl::Write
 		va_list _args
 )
 {
-	// create a timestamp string
-	string timeStr = GetTimeStampString();
-	string nodeStr = GetNodeString( _nodeId );
-	string loglevelStr = GetLogLevelString(_logLevel);
-
 	// handle this message
 	if( (_logLevel <= m_queueLevel) || (_logLevel == LogLevel_Internal) )	// we're going to do something with this message...
 	{
+		// create a timestamp string
+		string timeStr = GetTimeStampString();
+
 		char lineBuf[1024] = {0};
 		//int lineLen = 0;
 		if( _format != NULL && _format[0] != '\0' )
@@ -117,28 +164,43 @@ void LogImpl::Write
 		// should this message be saved to file (and possibly written to console?)
 		if( (_logLevel <= m_saveLevel) || (_logLevel == LogLevel_Internal) )
 		{
-			std::string outBuf;
-
 			if ( this->pFile != NULL || m_bConsoleOutput )
 			{
+				char outBuf[LogRecordSize];
+				int outLen;
 				if( _logLevel != LogLevel_Internal )						// don't add a second timestamp to display of queued messages
 				{
-					outBuf.append(timeStr);
-					outBuf.append(loglevelStr);
-					outBuf.append(nodeStr);
-					outBuf.append(lineBuf);
-					outBuf.append("\n");
-
+					string nodeStr = GetNodeString( _nodeId );
+					string loglevelStr = GetLogLevelString(_logLevel);
+					outLen = snprintf( outBuf, sizeof(outBuf), "%s%s%s%s\n", timeStr.c_str(), loglevelStr.c_str(), nodeStr.c_str(), lineBuf );
+				}
+				else
+				{
+					outLen = snprintf( outBuf, sizeof(outBuf), "%s\n", lineBuf );
+				}
+				if( outLen >= (int)sizeof(outBuf) )
+				{
+					// Truncated, but still end the line
+					outLen = sizeof(outBuf) - 1;
+					outBuf[outLen-1] = '\n';
 				}
 
-				// print message to file (and possibly screen)
-				if( this->pFile != NULL )
+				if( m_bAsyncWrite )
 				{
-					fputs( outBuf.c_str(), pFile );
+					// Only routine messages are dropped if the writer can't keep up
+					Post( outBuf, outLen, ( _logLevel <= LogLevel_Alert ) || ( _logLevel == LogLevel_Internal ) );
 				}
-				if( m_bConsoleOutput )
+				else
 				{
-					fputs( outBuf.c_str(), stdout );
+					// print message to file (and possibly screen)
+					if( this->pFile != NULL )
+					{
+						fputs( outBuf, pFile );
+					}
+					if( m_bConsoleOutput )
+					{
+						fputs( outBuf, stdout );
+					}
 				}
 			}
 		}
@@ -166,14 +228,24 @@ void LogImpl::Queue
 		char const* _buffer
 )
 {
-	string bufStr = _buffer;
-	m_logQueue.push_back( bufStr );
+	uint32 length = strlen( _buffer );
+	if( length >= LogRecordSize )
+	{
+		length = LogRecordSize - 1;
+	}
 
 	// rudimentary queue size management
-	if( m_logQueue.size() > 500 )
+	while( ( m_queueCount >= LogQueueSize ) || ( ( LogQueueBufferSize - m_queueUsed ) < ( length + 2 ) ) )
 	{
-		m_logQueue.pop_front();
+		QueuePop( NULL );
 	}
+
+	char header[2];
+	header[0] = (char)( length >> 8 );
+	header[1] = (char)( length & 0xff );
+	QueueCopyIn( header, 2 );
+	QueueCopyIn( _buffer, length );
+	++m_queueCount;
 }
 
 //-----------------------------------------------------------------------------
@@ -187,14 +259,12 @@ void LogImpl::QueueDump
 	Log::Write( LogLevel_Always, "" );
 	Log::Write( LogLevel_Always, "Dumping queued log messages");
 	Log::Write( LogLevel_Always, "" );
-	list<string>::iterator it = m_logQueue.begin();
-	while( it != m_logQueue.end() )
+	char line[LogRecordSize];
+	while( m_queueCount )
 	{
-		string strTemp = *it;
-		Log::Write( LogLevel_Internal, strTemp.c_str() );
-		it++;
+		QueuePop( line );
+		Log::Write( LogLevel_Internal, "%s", line );
 	}
-	m_logQueue.clear();
 	Log::Write( LogLevel_Always, "" );
 	Log::Write( LogLevel_Always, "End of queued log message dump");
 	Log::Write( LogLevel_Always, "" );
@@ -208,7 +278,300 @@ void LogImpl::QueueClear
 (
 )
 {
-	m_logQueue.clear();
+	m_queueHead = 0;
+	m_queueTail = 0;
+	m_queueUsed = 0;
+	m_queueCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+//	<LogImpl::QueuePop>
+//	Remove the oldest message from the LogQueue, optionally copying it out
+//-----------------------------------------------------------------------------
+void LogImpl::QueuePop
+(
+		char* _buffer
+)
+{
+	char header[2];
+	QueueCopyOut( header, 2 );
+	uint32 length = ( ( (uint32)(uint8)header[0] ) << 8 ) | (uint8)header[1];
+
+	if( _buffer )
+	{
+		// Callers provide a LogRecordSize buffer.  Queued lines are never longer than that.
+		QueueCopyOut( _buffer, length );
+		_buffer[length] = 0;
+	}
+	else
+	{
+		m_queueTail = ( m_queueTail + length ) % LogQueueBufferSize;
+	}
+
+	m_queueUsed -= ( length + 2 );
+	--m_queueCount;
+}
+
+//-----------------------------------------------------------------------------
+//	<LogImpl::QueueCopyIn>
+//	Copy data into the LogQueue ring at its head
+//-----------------------------------------------------------------------------
+void LogImpl::QueueCopyIn
+(
+		char const* _data,
+		uint32 const _length
+)
+{
+	uint32 block1 = LogQueueBufferSize - m_queueHead;
+	if( block1 > _length )
+	{
+		block1 = _length;
+	}
+	memcpy( &m_queueBuffer[m_queueHead], _data, block1 );
+	memcpy( m_queueBuffer, &_data[block1], _length - block1 );
+	m_queueHead = ( m_queueHead + _length ) % LogQueueBufferSize;
+	m_queueUsed += _length;
+}
+
+//-----------------------------------------------------------------------------
+//	<LogImpl::QueueCopyOut>
+//	Copy data out of the LogQueue ring from its tail
+//-----------------------------------------------------------------------------
+void LogImpl::QueueCopyOut
+(
+		char* _data,
+		uint32 const _length
+)
+{
+	uint32 block1 = LogQueueBufferSize - m_queueTail;
+	if( block1 > _length )
+	{
+		block1 = _length;
+	}
+	memcpy( _data, &m_queueBuffer[m_queueTail], block1 );
+	memcpy( &_data[block1], m_queueBuffer, _length - block1 );
+	m_queueTail = ( m_queueTail + _length ) % LogQueueBufferSize;
+}
+
+//-----------------------------------------------------------------------------
+//	<LogImpl::Post>
+//	Pass a line to the writer thread
+//-----------------------------------------------------------------------------
+void LogImpl::Post
+(
+		char const* _text,
+		uint32 const _length,
+		bool const _bWait
+)
+{
+	// Claim the next free record
+	LogRecord* record;
+	uint32 pos = m_enqueuePos;
+	while( true )
+	{
+		record = &m_records[pos & ( LogRecordCount - 1 )];
+		int32 diff = (int32)( record->m_sequence - pos );
+		if( diff == 0 )
+		{
+			if( __sync_bool_compare_and_swap( &m_enqueuePos, pos, pos + 1 ) )
+			{
+				break;
+			}
+		}
+		else if( diff < 0 )
+		{
+			// The writer has fallen a full ring behind
+			if( !_bWait )
+			{
+				// Drop the line rather than hold up the caller
+				__sync_fetch_and_add( &m_droppedRecords, 1 );
+				return;
+			}
+			sched_yield();
+		}
+		pos = m_enqueuePos;
+	}
+
+	memcpy( record->m_text, _text, _length );
+	record->m_length = _length;
+
+	// Publish the record, then wake the writer if it isn't already on its way
+	__sync_synchronize();
+	record->m_sequence = pos + 1;
+	__sync_synchronize();
+	if( __sync_lock_test_and_set( &m_wakePending, 1 ) == 0 )
+	{
+		m_dataEvent->Set();
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<LogImpl::WriteLines>
+//	Write a batch of lines to a file descriptor, coping with partial writes
+//-----------------------------------------------------------------------------
+void LogImpl::WriteLines
+(
+		int _fd,
+		struct iovec const* _lines,
+		int _count
+)
+{
+	// writev may update the entries, so work on a copy
+	struct iovec iov[LogBatchSize];
+	if( _count > LogBatchSize )
+	{
+		_count = LogBatchSize;
+	}
+	memcpy( iov, _lines, _count * sizeof(struct iovec) );
+
+	struct iovec* next = iov;
+	while( _count > 0 )
+	{
+		ssize_t written = writev( _fd, next, _count );
+		if( written < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			// Nowhere to report the failure
+			return;
+		}
+
+		// Skip past whatever was written
+		while( ( _count > 0 ) && ( (size_t)written >= next->iov_len ) )
+		{
+			written -= next->iov_len;
+			++next;
+			--_count;
+		}
+		if( _count > 0 )
+		{
+			next->iov_base = (char*)next->iov_base + written;
+			next->iov_len -= written;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<LogImpl::FlushRecords>
+//	Write all published records to the file and console
+//-----------------------------------------------------------------------------
+void LogImpl::FlushRecords
+(
+)
+{
+	struct iovec lines[LogBatchSize];
+	while( true )
+	{
+		// Gather a batch of consecutive published records
+		uint32 count = 0;
+		while( count < LogBatchSize )
+		{
+			uint32 pos = m_dequeuePos + count;
+			LogRecord* record = &m_records[pos & ( LogRecordCount - 1 )];
+			if( record->m_sequence != ( pos + 1 ) )
+			{
+				break;
+			}
+			lines[count].iov_base = record->m_text;
+			lines[count].iov_len = record->m_length;
+			++count;
+		}
+
+		if( count == 0 )
+		{
+			break;
+		}
+
+		// Make sure the text is read after the sequence numbers that published it
+		__sync_synchronize();
+
+		if( this->pFile != NULL )
+		{
+			WriteLines( fileno( this->pFile ), lines, count );
+		}
+		if( m_bConsoleOutput )
+		{
+			WriteLines( STDOUT_FILENO, lines, count );
+		}
+
+		// Hand the records back to the producers
+		__sync_synchronize();
+		for( uint32 i=0; i<count; ++i )
+		{
+			uint32 pos = m_dequeuePos + i;
+			m_records[pos & ( LogRecordCount - 1 )].m_sequence = pos + LogRecordCount;
+		}
+		m_dequeuePos += count;
+	}
+
+	uint32 dropped = __sync_fetch_and_and( &m_droppedRecords, 0 );
+	if( dropped )
+	{
+		char buf[64];
+		struct iovec line;
+		line.iov_base = buf;
+		line.iov_len = snprintf( buf, sizeof(buf), "%d log messages were dropped\n", dropped );
+		if( this->pFile != NULL )
+		{
+			WriteLines( fileno( this->pFile ), &line, 1 );
+		}
+		if( m_bConsoleOutput )
+		{
+			WriteLines( STDOUT_FILENO, &line, 1 );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<LogImpl::WriterThreadEntryPoint>
+//	Entry point of the thread that writes log lines in async mode
+//-----------------------------------------------------------------------------
+void LogImpl::WriterThreadEntryPoint
+(
+		Event* _exitEvent,
+		void* _context
+)
+{
+	LogImpl* impl = (LogImpl*)_context;
+	if( impl )
+	{
+		impl->WriterThreadProc( _exitEvent );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<LogImpl::WriterThreadProc>
+//	Write out log lines as they are posted, until told to exit
+//-----------------------------------------------------------------------------
+void LogImpl::WriterThreadProc
+(
+		Event* _exitEvent
+)
+{
+	Wait* waitObjects[2];
+	waitObjects[0] = _exitEvent;
+	waitObjects[1] = m_dataEvent;
+
+	while( true )
+	{
+		int32 res = Wait::Multiple( waitObjects, 2 );
+
+		// Re-arm the wakeup before looking at the ring, so a line posted
+		// while we are writing will set the event again.
+		m_dataEvent->Reset();
+		__sync_lock_release( &m_wakePending );
+		__sync_synchronize();
+
+		FlushRecords();
+
+		if( res == 0 )
+		{
+			// Exit has been signalled
+			break;
+		}
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -32,17 +32,37 @@
 #include <stdarg.h>
 #include <time.h>
 #include <sys/time.h>
-#include <list>
+#include <sys/uio.h>
 #include "platform/Log.h"
 
 namespace OpenZWave
 {
+	class Event;
+	class Thread;
+
 	class LogImpl : public i_LogImpl
 	{
 	private:
 		friend class Log;
 
-		LogImpl( string const& _filename, bool const _bAppendLog, bool const _bConsoleOutput, LogLevel const _saveLevel, LogLevel const _queueLevel, LogLevel const _dumpTrigger );
+		enum
+		{
+			LogRecordSize		= 1152,		/**< Maximum length of a line written to the file, including the timestamp and node */
+			LogRecordCount		= 256,		/**< Number of lines the async writer can buffer (must be a power of two) */
+			LogBatchSize		= 64,		/**< Maximum number of lines passed to a single writev */
+			LogQueueSize		= 500,		/**< Maximum number of messages held for a queue dump */
+			LogQueueBufferSize	= 65536		/**< Bytes of storage for the messages held for a queue dump */
+		};
+
+		// A line waiting to be written by the async writer thread
+		struct LogRecord
+		{
+			uint32 volatile	m_sequence;		/**< Ring position this record is ready to be written (+1) or filled (+0) at */
+			uint32			m_length;
+			char			m_text[LogRecordSize];
+		};
+
+		LogImpl( string const& _filename, bool const _bAppendLog, bool const _bConsoleOutput, LogLevel const _saveLevel, LogLevel const _queueLevel, LogLevel const _dumpTrigger, bool const _bAsyncWrite );
 		~LogImpl();
 
 		void Write( LogLevel _level, uint8 const _nodeId, char const* _format, va_list _args );
@@ -57,14 +77,42 @@ namespace OpenZWave
 		string GetThreadId();
 		string GetLogLevelString(LogLevel _level);
 
+		void Post( char const* _text, uint32 const _length, bool const _bWait );
+		void FlushRecords();
+		static void WriteLines( int _fd, struct iovec const* _lines, int _count );
+		void QueuePop( char* _buffer );
+		void QueueCopyIn( char const* _data, uint32 const _length );
+		void QueueCopyOut( char* _data, uint32 const _length );
+
+		static void WriterThreadEntryPoint( Event* _exitEvent, void* _context );
+		void WriterThreadProc( Event* _exitEvent );
+
 		string m_filename;						/**< filename specified by user (default is ozw_log.txt) */
 		bool m_bConsoleOutput;					/**< if true, send log output to console as well as to the file */
 		bool m_bAppendLog;						/**< if true, the log file should be appended to any with the same name */
-		list<string> m_logQueue;				/**< list of queued log messages */
 		LogLevel m_saveLevel;
 		LogLevel m_queueLevel;
 		LogLevel m_dumpTrigger;
 		FILE* pFile;
+
+		// Messages held in RAM for a queue dump.  Each one is stored as a two byte length
+		// followed by its text, in a ring that discards the oldest messages when full.
+		char* m_queueBuffer;
+		uint32 m_queueHead;						/**< Offset at which the next message will be stored */
+		uint32 m_queueTail;						/**< Offset of the oldest message */
+		uint32 m_queueUsed;						/**< Bytes of m_queueBuffer in use */
+		uint32 m_queueCount;					/**< Number of messages in m_queueBuffer */
+
+		// Async writer.  Callers claim a record with a compare-and-swap on m_enqueuePos, fill it
+		// and publish it by updating its sequence number.  The writer thread is the only consumer.
+		bool m_bAsyncWrite;						/**< if true, lines are written to the file and console by m_writerThread */
+		LogRecord* m_records;
+		uint32 volatile m_enqueuePos;
+		uint32 m_dequeuePos;
+		uint32 volatile m_droppedRecords;		/**< Lines discarded because the writer could not keep up */
+		uint32 volatile m_wakePending;			/**< Non-zero once m_dataEvent has been set and not yet handled */
+		Event* m_dataEvent;
+		Thread* m_writerThread;
 	};
 
 } // namespace OpenZWave
@@ -0,0 +1,277 @@
+//-----------------------------------------------------------------------------
+//
+//	MetricsSocketImpl.cpp
+//
+//	POSIX implementation of the metrics socket
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "Defs.h"
+#include "platform/Log.h"
+#include "platform/Thread.h"
+#include "MetricsSocketImpl.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+using namespace OpenZWave;
+
+static uint32 const c_initialBufferSize = 64 * 1024;
+static int32 const c_requestTimeout = 100;		// ms to wait for a client to say whether it wants HTTP
+static int32 const c_sendTimeout = 2000;		// ms to wait for a client that has stopped reading
+
+//-----------------------------------------------------------------------------
+//	<MetricsSocketImpl::MetricsSocketImpl>
+//	Constructor
+//-----------------------------------------------------------------------------
+MetricsSocketImpl::MetricsSocketImpl
+(
+	string const& _path,
+	MetricsSocket::pfnRender_t _render,
+	void* _context
+):
+	m_path( _path ),
+	m_render( _render ),
+	m_context( _context ),
+	m_listenFd( -1 ),
+	m_thread( NULL )
+{
+	m_wakeFds[0] = -1;
+	m_wakeFds[1] = -1;
+
+	struct sockaddr_un addr;
+	memset( &addr, 0, sizeof(addr) );
+	addr.sun_family = AF_UNIX;
+	if( m_path.size() >= sizeof(addr.sun_path) )
+	{
+		Log::Write( LogLevel_Error, "ERROR: MetricsSocket path %s is too long", m_path.c_str() );
+		return;
+	}
+	strncpy( addr.sun_path, m_path.c_str(), sizeof(addr.sun_path) - 1 );
+
+	int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if( fd < 0 )
+	{
+		Log::Write( LogLevel_Error, "ERROR: Cannot create the metrics socket: %s", strerror( errno ) );
+		return;
+	}
+
+	unlink( m_path.c_str() );
+	if( ( bind( fd, (struct sockaddr*)&addr, sizeof(addr) ) != 0 ) || ( listen( fd, 8 ) != 0 ) )
+	{
+		Log::Write( LogLevel_Error, "ERROR: Cannot listen on metrics socket %s: %s", m_path.c_str(), strerror( errno ) );
+		close( fd );
+		return;
+	}
+	if( pipe( m_wakeFds ) != 0 )
+	{
+		Log::Write( LogLevel_Error, "ERROR: Cannot create the metrics socket's wake pipe: %s", strerror( errno ) );
+		m_wakeFds[0] = -1;
+		m_wakeFds[1] = -1;
+		close( fd );
+		unlink( m_path.c_str() );
+		return;
+	}
+
+	// A client that goes away between select and accept must not block the thread
+	fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+	m_listenFd = fd;
+	m_buffer.resize( c_initialBufferSize );
+
+	m_thread = new Thread( "metrics" );
+	m_thread->Start( MetricsSocketImpl::ListenThreadEntryPoint, this );
+	Log::Write( LogLevel_Info, "Serving metrics on %s", m_path.c_str() );
+}
+
+//-----------------------------------------------------------------------------
+//	<MetricsSocketImpl::~MetricsSocketImpl>
+//	Destructor
+//-----------------------------------------------------------------------------
+MetricsSocketImpl::~MetricsSocketImpl
+(
+)
+{
+	if( m_thread != NULL )
+	{
+		char wake = 1;
+		ssize_t res = write( m_wakeFds[1], &wake, 1 );
+		(void)res;
+		m_thread->Stop();
+		m_thread->Release();
+	}
+	if( m_wakeFds[0] >= 0 )
+	{
+		close( m_wakeFds[0] );
+		close( m_wakeFds[1] );
+	}
+	if( m_listenFd >= 0 )
+	{
+		close( m_listenFd );
+		unlink( m_path.c_str() );
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<MetricsSocketImpl::ListenThreadEntryPoint>
+//	Entry point of the thread serving the socket
+//-----------------------------------------------------------------------------
+void MetricsSocketImpl::ListenThreadEntryPoint
+(
+	Event* _exitEvent,
+	void* _context
+)
+{
+	MetricsSocketImpl* impl = (MetricsSocketImpl*)_context;
+	if( impl )
+	{
+		impl->ListenThreadProc();
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<MetricsSocketImpl::ListenThreadProc>
+//	Serve each client in turn until woken through the pipe
+//-----------------------------------------------------------------------------
+void MetricsSocketImpl::ListenThreadProc
+(
+)
+{
+	while( true )
+	{
+		fd_set rds;
+		FD_ZERO( &rds );
+		FD_SET( m_listenFd, &rds );
+		FD_SET( m_wakeFds[0], &rds );
+		int maxFd = ( m_listenFd > m_wakeFds[0] ) ? m_listenFd : m_wakeFds[0];
+
+		if( select( maxFd + 1, &rds, NULL, NULL, NULL ) < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			Log::Write( LogLevel_Error, "ERROR: Metrics socket select failed: %s", strerror( errno ) );
+			return;
+		}
+		if( FD_ISSET( m_wakeFds[0], &rds ) )
+		{
+			return;
+		}
+		if( FD_ISSET( m_listenFd, &rds ) )
+		{
+			int fd = accept( m_listenFd, NULL, NULL );
+			if( fd >= 0 )
+			{
+				// BSD and macOS pass O_NONBLOCK on from the listening socket,
+				// which would cut a large reply short.  Block instead, but not
+				// for so long that a stuck client holds up the Manager's shutdown.
+				fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) & ~O_NONBLOCK );
+				struct timeval timeout;
+				timeout.tv_sec = c_sendTimeout / 1000;
+				timeout.tv_usec = ( c_sendTimeout % 1000 ) * 1000;
+				setsockopt( fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout) );
+#ifdef SO_NOSIGPIPE
+				int on = 1;
+				setsockopt( fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on) );
+#endif
+				Serve( fd );
+				close( fd );
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+//	<MetricsSocketImpl::Serve>
+//	Send the metrics text to a client
+//-----------------------------------------------------------------------------
+void MetricsSocketImpl::Serve
+(
+	int _fd
+)
+{
+	// An HTTP client sends its request straight away.  Anything else is
+	// sent the text without waiting for it.
+	bool http = false;
+	fd_set rds;
+	FD_ZERO( &rds );
+	FD_SET( _fd, &rds );
+	struct timeval when;
+	when.tv_sec = 0;
+	when.tv_usec = c_requestTimeout * 1000;
+	if( select( _fd + 1, &rds, NULL, NULL, &when ) > 0 )
+	{
+		char request[512];
+		ssize_t count = recv( _fd, request, sizeof(request), 0 );
+		http = ( count >= 4 ) && ( memcmp( request, "GET ", 4 ) == 0 );
+	}
+
+	uint32 length = m_render( &m_buffer[0], (uint32)m_buffer.size(), m_context );
+	if( length >= m_buffer.size() )
+	{
+		m_buffer.resize( length + 1024 );
+		length = m_render( &m_buffer[0], (uint32)m_buffer.size(), m_context );
+		if( length >= m_buffer.size() )
+		{
+			length = (uint32)m_buffer.size() - 1;
+		}
+	}
+
+	char header[160];
+	int headerLength = 0;
+	if( http )
+	{
+		headerLength = snprintf( header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %u\r\nConnection: close\r\n\r\n", length );
+	}
+
+	char const* parts[2] = { header, &m_buffer[0] };
+	uint32 sizes[2] = { (uint32)headerLength, length };
+	for( int i=0; i<2; ++i )
+	{
+		uint32 sent = 0;
+		while( sent < sizes[i] )
+		{
+			ssize_t res = send( _fd, parts[i] + sent, sizes[i] - sent, MSG_NOSIGNAL );
+			if( res < 0 )
+			{
+				if( errno == EINTR )
+				{
+					continue;
+				}
+				if( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) )
+				{
+					Log::Write( LogLevel_Warning, "Metrics client on %s stopped reading, dropping it", m_path.c_str() );
+				}
+				return;
+			}
+			sent += (uint32)res;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+//-----------------------------------------------------------------------------
+//
+//	MetricsSocketImpl.h
+//
+//	POSIX implementation of the metrics socket
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _MetricsSocketImpl_H
+#define _MetricsSocketImpl_H
+
+#include <string>
+#include <vector>
+#include "Defs.h"
+#include "platform/MetricsSocket.h"
+
+namespace OpenZWave
+{
+	class Event;
+	class Thread;
+
+	class MetricsSocketImpl
+	{
+	private:
+		friend class MetricsSocket;
+
+		MetricsSocketImpl( string const& _path, MetricsSocket::pfnRender_t _render, void* _context );
+		~MetricsSocketImpl();
+
+		bool IsOpen()const{ return( m_listenFd >= 0 ); }
+
+		static void ListenThreadEntryPoint( Event* _exitEvent, void* _context );
+		void ListenThreadProc();
+		void Serve( int _fd );
+
+		string						m_path;
+		MetricsSocket::pfnRender_t	m_render;
+		void*						m_context;
+		int							m_listenFd;
+		int							m_wakeFds[2];			// Written to make the thread exit
+		Thread*						m_thread;
+		vector<char>				m_buffer;				// Reused for every client, and only grows when the text does
+	};
+
+} // namespace OpenZWave
+
+#endif //_MetricsSocketImpl_H
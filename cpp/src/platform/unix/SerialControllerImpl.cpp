@@ -32,6 +32,7 @@
 #include "platform/Event.h"
 #include "SerialControllerImpl.h"
 #include "platform/Log.h"
+#include "Options.h"
 
 #ifdef __linux__
 #include <libudev.h>
@@ -39,6 +40,10 @@
 
 using namespace OpenZWave;
 
+pthread_mutex_t SerialControllerImpl::s_sharedMutex = PTHREAD_MUTEX_INITIALIZER;
+list<SerialControllerImpl*> SerialControllerImpl::s_sharedPorts;
+SerialControllerImpl::SharedReader* SerialControllerImpl::s_sharedReader = NULL;
+
 //-----------------------------------------------------------------------------
 // <SerialControllerImpl::SerialControllerImpl>
 // Constructor
@@ -48,7 +53,9 @@ SerialControllerImpl::SerialControllerImpl
 	SerialController* _owner
 ):
 	m_owner( _owner ),
-	m_hSerialController( -1 )
+	m_hSerialController( -1 ),
+	m_pThread( NULL ),
+	m_shared( false )
 {
 }
 
@@ -81,6 +88,16 @@ bool SerialControllerImpl::Open
 		return false;
 	}
 
+	bool shared = false;
+	Options::Get()->GetOptionAsBool( "SharedDriverThread", &shared );
+	if( shared )
+	{
+		// Read by the thread shared with the other ports
+		m_shared = true;
+		AddSharedPort( this );
+		return true;
+	}
+
 	// Start the read thread
 	m_pThread = new Thread( "SerialController" );
 	m_pThread->Start( SerialReadThreadEntryPoint, this );
@@ -96,6 +113,11 @@ void SerialControllerImpl::Close
 ( 
 )
 {
+	if( m_shared )
+	{
+		RemoveSharedPort( this );
+		m_shared = false;
+	}
 	if( m_pThread )
 	{
 		m_pThread->Stop();
@@ -170,6 +192,200 @@ void SerialControllerImpl::ReadThreadProc
 	}
 }
 
+//-----------------------------------------------------------------------------
+// <SerialControllerImpl::AddSharedPort>
+// Have the shared thread read a port, starting the thread if need be
+//-----------------------------------------------------------------------------
+void SerialControllerImpl::AddSharedPort
+(
+	SerialControllerImpl* _port
+)
+{
+	pthread_mutex_lock( &s_sharedMutex );
+	s_sharedPorts.push_back( _port );
+	if( s_sharedReader == NULL )
+	{
+		SharedReader* reader = new SharedReader();
+		reader->m_exit = false;
+		if( pipe( reader->m_wakeFds ) != 0 )
+		{
+			Log::Write( LogLevel_Error, "ERROR: Cannot create the pipe for the shared serial thread. Error code %d", errno );
+			reader->m_wakeFds[0] = -1;
+			reader->m_wakeFds[1] = -1;
+		}
+		else
+		{
+			fcntl( reader->m_wakeFds[0], F_SETFL, fcntl( reader->m_wakeFds[0], F_GETFL ) | O_NONBLOCK );
+			fcntl( reader->m_wakeFds[1], F_SETFL, fcntl( reader->m_wakeFds[1], F_GETFL ) | O_NONBLOCK );
+		}
+		reader->m_thread = new Thread( "SerialController" );
+		s_sharedReader = reader;
+		reader->m_thread->Start( SharedReadThreadEntryPoint, reader );
+	}
+	else if( s_sharedReader->m_wakeFds[1] >= 0 )
+	{
+		// Have the thread add the port to its select
+		uint8 wake = 0;
+		ssize_t res = write( s_sharedReader->m_wakeFds[1], &wake, 1 );
+		(void)res;
+	}
+	pthread_mutex_unlock( &s_sharedMutex );
+}
+
+//-----------------------------------------------------------------------------
+// <SerialControllerImpl::RemoveSharedPort>
+// Stop reading a port on the shared thread.  The thread is stopped once it has
+// no ports left.
+//-----------------------------------------------------------------------------
+void SerialControllerImpl::RemoveSharedPort
+(
+	SerialControllerImpl* _port
+)
+{
+	pthread_mutex_lock( &s_sharedMutex );
+	s_sharedPorts.remove( _port );
+	SharedReader* reader = s_sharedReader;
+	if( reader == NULL )
+	{
+		pthread_mutex_unlock( &s_sharedMutex );
+		return;
+	}
+	bool stop = s_sharedPorts.empty();
+	if( stop )
+	{
+		// A port added from now on starts a new thread
+		s_sharedReader = NULL;
+		reader->m_exit = true;
+	}
+	if( reader->m_wakeFds[1] >= 0 )
+	{
+		// Have the thread drop the port from its select, or exit
+		uint8 wake = 0;
+		ssize_t res = write( reader->m_wakeFds[1], &wake, 1 );
+		(void)res;
+	}
+	pthread_mutex_unlock( &s_sharedMutex );
+
+	if( stop )
+	{
+		reader->m_thread->Stop();
+		reader->m_thread->Release();
+		if( reader->m_wakeFds[0] >= 0 )
+		{
+			close( reader->m_wakeFds[0] );
+			close( reader->m_wakeFds[1] );
+		}
+		delete reader;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <SerialControllerImpl::SharedReadThreadEntryPoint>
+// Entry point of the thread reading all the shared ports
+//-----------------------------------------------------------------------------
+void SerialControllerImpl::SharedReadThreadEntryPoint
+(
+	Event* _exitEvent,
+	void* _context
+)
+{
+	SharedReader* reader = (SharedReader*)_context;
+	if( reader )
+	{
+		SharedReadThreadProc( reader );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// <SerialControllerImpl::SharedReadThreadProc>
+// Wait for data on any of the shared ports, and pass it to the port's owner
+//-----------------------------------------------------------------------------
+void SerialControllerImpl::SharedReadThreadProc
+(
+	SharedReader* _reader
+)
+{
+	uint8 buffer[256];
+
+	while( true )
+	{
+		fd_set rds;
+		FD_ZERO( &rds );
+		int maxFd = _reader->m_wakeFds[0];
+		if( maxFd >= 0 )
+		{
+			FD_SET( maxFd, &rds );
+		}
+
+		pthread_mutex_lock( &s_sharedMutex );
+		if( _reader->m_exit )
+		{
+			pthread_mutex_unlock( &s_sharedMutex );
+			return;
+		}
+		for( list<SerialControllerImpl*>::iterator it = s_sharedPorts.begin(); it != s_sharedPorts.end(); ++it )
+		{
+			int fd = (*it)->m_hSerialController;
+			if( fd >= 0 )
+			{
+				FD_SET( fd, &rds );
+				if( fd > maxFd )
+				{
+					maxFd = fd;
+				}
+			}
+		}
+		pthread_mutex_unlock( &s_sharedMutex );
+
+		// Without a wake pipe, look for new ports every second
+		struct timeval when;
+		when.tv_sec = 1;
+		when.tv_usec = 0;
+
+		int oldstate;
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &oldstate);
+		int err = select( maxFd + 1, &rds, NULL, NULL, ( _reader->m_wakeFds[0] >= 0 ) ? NULL : &when );
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate);
+		if( err <= 0 )
+		{
+			continue;
+		}
+
+		if( _reader->m_wakeFds[0] >= 0 && FD_ISSET( _reader->m_wakeFds[0], &rds ) )
+		{
+			ssize_t res;
+			do
+			{
+				res = read( _reader->m_wakeFds[0], buffer, sizeof(buffer) );
+			} while( res == (ssize_t)sizeof(buffer) );
+		}
+
+		// The lock keeps a port from being closed while it is read.  Only one
+		// read is made per port, as a read with no data waiting blocks for VTIME.
+		pthread_mutex_lock( &s_sharedMutex );
+		if( _reader->m_exit )
+		{
+			pthread_mutex_unlock( &s_sharedMutex );
+			return;
+		}
+		for( list<SerialControllerImpl*>::iterator it = s_sharedPorts.begin(); it != s_sharedPorts.end(); ++it )
+		{
+			SerialControllerImpl* port = *it;
+			int fd = port->m_hSerialController;
+			if( fd >= 0 && FD_ISSET( fd, &rds ) )
+			{
+				port->m_owner->CountWakeup();
+				int32 bytesRead = read( fd, buffer, sizeof(buffer) );
+				if( bytesRead > 0 )
+				{
+					port->m_owner->Received( buffer, bytesRead );
+				}
+			}
+		}
+		pthread_mutex_unlock( &s_sharedMutex );
+	}
+}
+
 //-----------------------------------------------------------------------------
 // <SerialControllerImpl::Init>
 // Initialize the serial port
@@ -319,11 +535,13 @@ void SerialControllerImpl::Read
 		int32 bytesRead;
 		int err;
 
+		m_owner->CountWakeup();
+
 		do
 		{
 			bytesRead = read( m_hSerialController, buffer, sizeof(buffer) );
 			if( bytesRead > 0 )
-				m_owner->Put( buffer, bytesRead );
+				m_owner->Received( buffer, bytesRead );
 		} while( bytesRead > 0 );
 
 		do
@@ -36,6 +36,7 @@
 #include <sys/file.h>
 #include <sys/ioctl.h>
 #include <arpa/inet.h>
+#include <list>
 
 #include "Defs.h"
 #include "platform/SerialController.h"
@@ -64,8 +65,26 @@ namespace OpenZWave
 		SerialController*	m_owner;
 		int			m_hSerialController;
 		Thread*			m_pThread;
+		bool			m_shared;		// Read by the thread shared by all the serial ports (SharedDriverThread option)
 
 		static void SerialReadThreadEntryPoint( Event* _exitEvent, void* _content );
+
+		// One thread reads every port opened while the SharedDriverThread option is set
+		struct SharedReader
+		{
+			Thread*		m_thread;
+			int		m_wakeFds[2];		// Written to wake the thread from select
+			bool		m_exit;
+		};
+
+		static void AddSharedPort( SerialControllerImpl* _port );
+		static void RemoveSharedPort( SerialControllerImpl* _port );
+		static void SharedReadThreadEntryPoint( Event* _exitEvent, void* _context );
+		static void SharedReadThreadProc( SharedReader* _reader );
+
+		static pthread_mutex_t			s_sharedMutex;		// Guards the statics below
+		static list<SerialControllerImpl*>	s_sharedPorts;
+		static SharedReader*			s_sharedReader;
 	};
 
 } // namespace OpenZWave
@@ -121,6 +121,17 @@ string TimeStampImpl::GetAsString
 	return str;
 }
 
+//-----------------------------------------------------------------------------
+//	<TimeStampImpl::GetAsMilliseconds>
+//	Return milliseconds since the Unix epoch
+//-----------------------------------------------------------------------------
+uint64 TimeStampImpl::GetAsMilliseconds
+(
+)
+{
+	return( ( (uint64)m_stamp.tv_sec * 1000 ) + ( m_stamp.tv_nsec / ( 1000 * 1000 ) ) );
+}
+
 //-----------------------------------------------------------------------------
 //	<TimeStampImpl::operator->
 //	Overload the subtract operator to get the difference between two 
@@ -32,6 +32,14 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#else
+#include <poll.h>
+#endif
 
 using namespace OpenZWave;
 
@@ -158,3 +166,135 @@ void WaitImpl::Notify
 		assert( 0 );
 	}
 }
+
+//-----------------------------------------------------------------------------
+//	<WaitSetImpl::WaitSetImpl>
+//	Constructor
+//-----------------------------------------------------------------------------
+WaitSetImpl::WaitSetImpl
+(
+)
+{
+#ifdef __linux__
+	m_eventFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+	m_epollFd = epoll_create1( EPOLL_CLOEXEC );
+	if( m_eventFd < 0 || m_epollFd < 0 )
+	{
+		fprintf(stderr, "WaitSetImpl::WaitSetImpl eventfd/epoll error %d\n", errno );
+		assert( 0 );
+	}
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.fd = m_eventFd;
+	if( epoll_ctl( m_epollFd, EPOLL_CTL_ADD, m_eventFd, &ev ) != 0 )
+	{
+		fprintf(stderr, "WaitSetImpl::WaitSetImpl epoll_ctl error %d\n", errno );
+		assert( 0 );
+	}
+#else
+	if( pipe( m_pipeFds ) != 0 )
+	{
+		fprintf(stderr, "WaitSetImpl::WaitSetImpl pipe error %d\n", errno );
+		assert( 0 );
+	}
+	for( int i=0; i<2; ++i )
+	{
+		fcntl( m_pipeFds[i], F_SETFL, fcntl( m_pipeFds[i], F_GETFL ) | O_NONBLOCK );
+		fcntl( m_pipeFds[i], F_SETFD, FD_CLOEXEC );
+	}
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSetImpl::~WaitSetImpl>
+//	Destructor
+//-----------------------------------------------------------------------------
+WaitSetImpl::~WaitSetImpl
+(
+)
+{
+#ifdef __linux__
+	close( m_epollFd );
+	close( m_eventFd );
+#else
+	close( m_pipeFds[0] );
+	close( m_pipeFds[1] );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSetImpl::Signal>
+//	Wake the thread waiting on the set.  May be called from any thread.
+//-----------------------------------------------------------------------------
+void WaitSetImpl::Signal
+(
+)
+{
+#ifdef __linux__
+	uint64_t one = 1;
+	ssize_t res = write( m_eventFd, &one, sizeof(one) );
+#else
+	// A full pipe means a wakeup is already pending, so EAGAIN is harmless
+	uint8 one = 1;
+	ssize_t res = write( m_pipeFds[1], &one, sizeof(one) );
+#endif
+	(void)res;
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSetImpl::Wait>
+//	Sleep until Signal is called or the timeout expires, consuming the wakeup.
+//	Returns false if the wait timed out.
+//-----------------------------------------------------------------------------
+bool WaitSetImpl::Wait
+(
+	int32 _timeout /* milliseconds */
+)
+{
+	int err;
+	int oldstate;
+
+	pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &oldstate);
+#ifdef __linux__
+	struct epoll_event ev;
+	do
+	{
+		err = epoll_wait( m_epollFd, &ev, 1, _timeout );
+	} while( err < 0 && errno == EINTR );
+#else
+	struct pollfd pfd;
+	pfd.fd = m_pipeFds[0];
+	pfd.events = POLLIN;
+	do
+	{
+		err = poll( &pfd, 1, _timeout );
+	} while( err < 0 && errno == EINTR );
+#endif
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate);
+
+	if( err < 0 )
+	{
+		fprintf(stderr, "WaitSetImpl::Wait error %d\n", errno );
+		return false;
+	}
+	if( err == 0 )
+	{
+		return false;
+	}
+
+	// Drain the pending wakeups
+#ifdef __linux__
+	uint64_t count;
+	ssize_t res = read( m_eventFd, &count, sizeof(count) );
+#else
+	uint8 buf[64];
+	ssize_t res;
+	do
+	{
+		res = read( m_pipeFds[0], buf, sizeof(buf) );
+	} while( res == (ssize_t)sizeof(buf) );
+#endif
+	(void)res;
+	return true;
+}
@@ -68,6 +68,33 @@ namespace OpenZWave
 		pthread_mutex_t		m_criticalSection;
 	};
 
+	/** \brief POSIX specific wakeup mechanism for WaitSet objects.
+	 *
+	 * On Linux this is an eventfd registered once with an epoll instance.  Other
+	 * platforms fall back to a non-blocking pipe and poll.
+	 */
+	class WaitSetImpl
+	{
+	private:
+		friend class WaitSet;
+
+		WaitSetImpl();
+		~WaitSetImpl();
+
+		void Signal();
+		bool Wait( int32 _timeout );
+
+		WaitSetImpl( WaitSetImpl const& );				// prevent copy
+		WaitSetImpl& operator = ( WaitSetImpl const& );	// prevent assignment
+
+#ifdef __linux__
+		int					m_epollFd;
+		int					m_eventFd;
+#else
+		int					m_pipeFds[2];
+#endif
+	};
+
 } // namespace OpenZWave
 
 #endif //_WaitImpl_H
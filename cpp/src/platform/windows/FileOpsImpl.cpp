@@ -67,3 +67,114 @@ bool FileOpsImpl::FolderExists(
 
 	return false;
 }
+
+//-----------------------------------------------------------------------------
+//	<FileOpsImpl::FileWriteAtomic>
+//	Write to a temporary file, then move it over the original
+//-----------------------------------------------------------------------------
+bool FileOpsImpl::FileWriteAtomic
+(
+	const string &_filename,
+	const string &_contents
+)
+{
+	string tempName = _filename + ".tmp";
+	HANDLE hFile = CreateFileA( tempName.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( hFile == INVALID_HANDLE_VALUE )
+	{
+		return false;
+	}
+
+	DWORD written = 0;
+	BOOL ok = WriteFile( hFile, _contents.data(), (DWORD)_contents.size(), &written, NULL );
+	ok = ok && ( written == (DWORD)_contents.size() );
+
+	// The data must be on disk before the move makes it the live file
+	ok = ok && FlushFileBuffers( hFile );
+	CloseHandle( hFile );
+
+	ok = ok && MoveFileExA( tempName.c_str(), _filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH );
+	if( !ok )
+	{
+		DeleteFileA( tempName.c_str() );
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+//	<FileOpsImpl::FileMap>
+//	Map a whole file into memory, read only
+//-----------------------------------------------------------------------------
+void const* FileOpsImpl::FileMap
+(
+	const string &_filename,
+	size_t* _size
+)
+{
+	HANDLE hFile = CreateFileA( _filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( hFile == INVALID_HANDLE_VALUE )
+	{
+		return NULL;
+	}
+
+	DWORD size = GetFileSize( hFile, NULL );
+	if( size == INVALID_FILE_SIZE || size == 0 )
+	{
+		CloseHandle( hFile );
+		return NULL;
+	}
+
+	HANDLE hMapping = CreateFileMappingA( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+	CloseHandle( hFile );
+	if( hMapping == NULL )
+	{
+		return NULL;
+	}
+
+	// The view keeps the mapping open
+	void const* data = MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle( hMapping );
+	if( data == NULL )
+	{
+		return NULL;
+	}
+
+	*_size = (size_t)size;
+	return data;
+}
+
+//-----------------------------------------------------------------------------
+//	<FileOpsImpl::FileUnmap>
+//	Release a mapped file
+//-----------------------------------------------------------------------------
+void FileOpsImpl::FileUnmap
+(
+	void const* _data,
+	size_t _size
+)
+{
+	UnmapViewOfFile( _data );
+}
+
+//-----------------------------------------------------------------------------
+//	<FileOpsImpl::FileInfo>
+//	Get the size and modification time of a file
+//-----------------------------------------------------------------------------
+bool FileOpsImpl::FileInfo
+(
+	const string &_filename,
+	uint64* _modified,
+	uint64* _size
+)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if( !GetFileAttributesExA( _filename.c_str(), GetFileExInfoStandard, &data ) )
+	{
+		return false;
+	}
+
+	*_modified = ( ( (uint64)data.ftLastWriteTime.dwHighDateTime ) << 32 ) | data.ftLastWriteTime.dwLowDateTime;
+	*_size = ( ( (uint64)data.nFileSizeHigh ) << 32 ) | data.nFileSizeLow;
+	return true;
+}
@@ -72,7 +72,8 @@ LogImpl::LogImpl
 	bool const _bConsoleOutput,
 	LogLevel const _saveLevel,
 	LogLevel const _queueLevel,
-	LogLevel const _dumpTrigger
+	LogLevel const _dumpTrigger,
+	bool const _bAsyncWrite				// not supported on Windows, lines are always written by the caller
 ):
 	m_filename( _filename ),					// name of log file
 	m_bAppendLog( _bAppendLog ),				// true to append (and not overwrite) any existing log
@@ -125,14 +126,12 @@ void LogImpl::Write
 	va_list _args
 )
 {
-	// create a timestamp string
-	string timeStr = GetTimeStampString();
-	string nodeStr = GetNodeString( _nodeId );
-	string logLevelStr = GetLogLevelString(_logLevel);
-
 	// handle this message
 	if( (_logLevel <= m_queueLevel) || (_logLevel == LogLevel_Internal) )	// we're going to do something with this message...
 	{
+		// create a timestamp string
+		string timeStr = GetTimeStampString();
+
 		char lineBuf[1024];
 		if( !_format || ( _format[0] == 0 ) )
 		{
@@ -146,6 +145,9 @@ void LogImpl::Write
 		// should this message be saved to file (and possibly written to console?)
 		if( (_logLevel <= m_saveLevel) || (_logLevel == LogLevel_Internal) )
 		{
+			string nodeStr = GetNodeString( _nodeId );
+			string logLevelStr = GetLogLevelString(_logLevel);
+
 			// save to file
 			FILE* pFile = NULL;
 			if( !fopen_s( &pFile, m_filename.c_str(), "a" ) || m_bConsoleOutput )
@@ -0,0 +1,44 @@
+//-----------------------------------------------------------------------------
+//
+//	MetricsSocketImpl.cpp
+//
+//	Windows implementation of the metrics socket
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#include "Defs.h"
+#include "platform/Log.h"
+#include "MetricsSocketImpl.h"
+
+using namespace OpenZWave;
+
+//-----------------------------------------------------------------------------
+//	<MetricsSocketImpl::MetricsSocketImpl>
+//	Constructor
+//-----------------------------------------------------------------------------
+MetricsSocketImpl::MetricsSocketImpl
+(
+	string const& _path,
+	MetricsSocket::pfnRender_t _render,
+	void* _context
+)
+{
+	Log::Write( LogLevel_Warning, "WARNING: MetricsSocket is not supported on Windows.  Use Manager::GetMetrics instead." );
+}
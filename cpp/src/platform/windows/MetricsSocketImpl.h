@@ -0,0 +1,53 @@
+//-----------------------------------------------------------------------------
+//
+//	MetricsSocketImpl.h
+//
+//	Windows implementation of the metrics socket
+//
+//	SOFTWARE NOTICE AND LICENSE
+//
+//	This file is part of OpenZWave.
+//
+//	OpenZWave is free software: you can redistribute it and/or modify
+//	it under the terms of the GNU Lesser General Public License as published
+//	by the Free Software Foundation, either version 3 of the License,
+//	or (at your option) any later version.
+//
+//	OpenZWave is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU Lesser General Public License for more details.
+//
+//	You should have received a copy of the GNU Lesser General Public License
+//	along with OpenZWave.  If not, see <http://www.gnu.org/licenses/>.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _MetricsSocketImpl_H
+#define _MetricsSocketImpl_H
+
+#include <string>
+#include "Defs.h"
+#include "platform/MetricsSocket.h"
+
+namespace OpenZWave
+{
+	/** \brief Windows-specific implementation of the MetricsSocket class.
+	 *
+	 * Unix domain sockets are not available, so the socket never opens.  The text
+	 * is still available from Manager::GetMetrics.
+	 */
+	class MetricsSocketImpl
+	{
+	private:
+		friend class MetricsSocket;
+
+		MetricsSocketImpl( string const& _path, MetricsSocket::pfnRender_t _render, void* _context );
+		~MetricsSocketImpl(){}
+
+		bool IsOpen()const{ return false; }
+	};
+
+} // namespace OpenZWave
+
+#endif //_MetricsSocketImpl_H
@@ -269,6 +269,8 @@ void SerialControllerImpl::Read
    
 	while( true )
 	{
+		m_owner->CountWakeup();
+
 		// Try to read all available data from the serial port
 		DWORD bytesRead = 0;
 		do
@@ -280,7 +282,7 @@ void SerialControllerImpl::Read
 
 				// Copy to the stream buffer
 				if( bytesRead > 0 )
-					m_owner->Put( buffer, bytesRead );
+					m_owner->Received( buffer, bytesRead );
 			}
 			else
 			{
@@ -311,7 +313,7 @@ void SerialControllerImpl::Read
 
 					// Copy to the stream buffer
 					if( bytesRead > 0 )
-						m_owner->Put( buffer, bytesRead );
+						m_owner->Received( buffer, bytesRead );
 				}
 				else
 				{
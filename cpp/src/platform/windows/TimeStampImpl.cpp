@@ -100,6 +100,18 @@ string TimeStampImpl::GetAsString
 	return str;
 }
 
+//-----------------------------------------------------------------------------
+//	<TimeStampImpl::GetAsMilliseconds>
+//	Return milliseconds since the Unix epoch
+//-----------------------------------------------------------------------------
+uint64 TimeStampImpl::GetAsMilliseconds
+(
+)
+{
+	// m_stamp counts 100ns steps from 1601-01-01
+	return (uint64)( ( m_stamp - 116444736000000000LL ) / 10000LL );
+}
+
 //-----------------------------------------------------------------------------
 //	<TimeStampImpl::operator->
 //	Overload the subtract operator to get the difference between two
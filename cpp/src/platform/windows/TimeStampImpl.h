@@ -69,6 +69,11 @@ namespace OpenZWave
 		 */
 		string GetAsString();
 
+		/**
+		 * Return as milliseconds since the Unix epoch
+		 */
+		uint64 GetAsMilliseconds();
+
 		/**
 		 * Overload the subtract operator to get the difference between
 		 * two timestamps in milliseconds.
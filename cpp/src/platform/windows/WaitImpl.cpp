@@ -132,3 +132,49 @@ void WaitImpl::Notify
 
 	LeaveCriticalSection( &m_criticalSection );
 }
+
+//-----------------------------------------------------------------------------
+//	<WaitSetImpl::WaitSetImpl>
+//	Constructor
+//-----------------------------------------------------------------------------
+WaitSetImpl::WaitSetImpl
+(
+)
+{
+	m_hEvent = ::CreateEvent( NULL, FALSE, FALSE, NULL );
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSetImpl::~WaitSetImpl>
+//	Destructor
+//-----------------------------------------------------------------------------
+WaitSetImpl::~WaitSetImpl
+(
+)
+{
+	::CloseHandle( m_hEvent );
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSetImpl::Signal>
+//	Wake the thread waiting on the set.  May be called from any thread.
+//-----------------------------------------------------------------------------
+void WaitSetImpl::Signal
+(
+)
+{
+	::SetEvent( m_hEvent );
+}
+
+//-----------------------------------------------------------------------------
+//	<WaitSetImpl::Wait>
+//	Sleep until Signal is called or the timeout expires.
+//	Returns false if the wait timed out.
+//-----------------------------------------------------------------------------
+bool WaitSetImpl::Wait
+(
+	int32 _timeout
+)
+{
+	return( WAIT_OBJECT_0 == ::WaitForSingleObject( m_hEvent, ( _timeout < 0 ) ? INFINITE : (DWORD)_timeout ) );
+}
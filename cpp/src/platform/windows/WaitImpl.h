@@ -67,6 +67,25 @@ namespace OpenZWave
 		CRITICAL_SECTION	m_criticalSection;
 	};
 
+	/** \brief Windows specific wakeup mechanism for WaitSet objects.
+	 */
+	class WaitSetImpl
+	{
+	private:
+		friend class WaitSet;
+
+		WaitSetImpl();
+		~WaitSetImpl();
+
+		void Signal();
+		bool Wait( int32 _timeout );
+
+		WaitSetImpl( WaitSetImpl const& );				// prevent copy
+		WaitSetImpl& operator = ( WaitSetImpl const& );	// prevent assignment
+
+		HANDLE				m_hEvent;			// auto-reset event
+	};
+
 } // namespace OpenZWave
 
 #endif //_WaitImpl_H
@@ -97,7 +97,8 @@ Value::Value
 	m_affects(),
 	m_affectsAll( false ),
 	m_checkChange( false ),
-	m_pollIntensity( _pollIntensity )
+	m_pollIntensity( _pollIntensity ),
+	m_pollPeriod( 0 )
 {
 }
 
@@ -119,7 +120,8 @@ Value::Value
 	m_affects(),
 	m_affectsAll( false ),
 	m_checkChange( false ),
-	m_pollIntensity( 0 )
+	m_pollIntensity( 0 ),
+	m_pollPeriod( 0 )
 {
 }
 
@@ -197,6 +199,11 @@ void Value::ReadXML
 		m_pollIntensity = (uint8)intVal;
 	}
 
+	if( TIXML_SUCCESS == _valueElement->QueryIntAttribute( "poll_period", &intVal ) )
+	{
+		m_pollPeriod = (uint32)intVal;
+	}
+
 	char const* affects = _valueElement->Attribute( "affects" );
 	if( affects )
 	{
@@ -305,6 +312,12 @@ void Value::WriteXML
 	snprintf( str, sizeof(str), "%d", m_pollIntensity );
 	_valueElement->SetAttribute( "poll_intensity", str );
 
+	if( m_pollPeriod != 0 )
+	{
+		snprintf( str, sizeof(str), "%u", m_pollPeriod );
+		_valueElement->SetAttribute( "poll_period", str );
+	}
+
 	snprintf( str, sizeof(str), "%d", m_min );
 	_valueElement->SetAttribute( "min", str );
 
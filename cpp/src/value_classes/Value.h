@@ -74,6 +74,9 @@ namespace OpenZWave
 		uint8 const& GetPollIntensity()const{ return m_pollIntensity; }
 		void SetPollIntensity( uint8 const& _intensity ){ m_pollIntensity = _intensity; }
 
+		uint32 GetPollPeriod()const{ return m_pollPeriod; }
+		void SetPollPeriod( uint32 const _milliseconds ){ m_pollPeriod = _milliseconds; }
+
 		int32 GetMin()const{ return m_min; }
 		int32 GetMax()const{ return m_max; }
 
@@ -120,6 +123,7 @@ namespace OpenZWave
 		bool		m_affectsAll;
 		bool		m_checkChange;
 		uint8		m_pollIntensity;
+		uint32		m_pollPeriod;			// milliseconds between polls, or zero if the period comes from the poll intensity
 	};
 
 } // namespace OpenZWave
@@ -41,12 +41,10 @@ ValueStore::~ValueStore
 (
 )
 {
-	map<uint32,Value*>::iterator it = m_values.begin();
 	while( !m_values.empty() )
 	{
-		ValueID const& valueId = it->second->GetID();
+		ValueID const& valueId = m_values.back().second->GetID();
 		RemoveValue( valueId.GetValueStoreKey() );
-		it = m_values.begin();
 	}
 }
 
@@ -65,14 +63,14 @@ bool ValueStore::AddValue
 	}
 
 	uint32 key = _value->GetID().GetValueStoreKey();
-	map<uint32,Value*>::iterator it = m_values.find( key );
-	if( it != m_values.end() )
+	vector< pair<uint32,Value*> >::iterator it = LowerBound( GetSortKey( key ) );
+	if( ( it != m_values.end() ) && ( it->first == key ) )
 	{
 		// There is already a value in the store with this key, so we give up.
 		return false;
 	}
 
-	m_values[key] = _value;
+	m_values.insert( it, pair<uint32,Value*>( key, _value ) );
 	_value->AddRef();
 
 	// Notify the watchers of the new value
@@ -95,8 +93,8 @@ bool ValueStore::RemoveValue
 	uint32 const& _key
 )
 {
-	map<uint32,Value*>::iterator it = m_values.find( _key );
-	if( it != m_values.end() )
+	vector< pair<uint32,Value*> >::iterator it = LowerBound( GetSortKey( _key ) );
+	if( ( it != m_values.end() ) && ( it->first == _key ) )
 	{
 		Value* value = it->second;
 		ValueID const& valueId = value->GetID();
@@ -139,32 +137,28 @@ void ValueStore::RemoveCommandClassValues
 	uint8 const _commandClassId
 )
 {
-	map<uint32,Value*>::iterator it = m_values.begin();
-	while( it != m_values.end() )
+	// The values of the command class are all together in the store
+	vector< pair<uint32,Value*> >::iterator first = LowerBound( ((uint64)_commandClassId)<<24 );
+	vector< pair<uint32,Value*> >::iterator last = LowerBound( ( ((uint64)_commandClassId)+1 )<<24 );
+	for( vector< pair<uint32,Value*> >::iterator it = first; it != last; ++it )
 	{
 		Value* value = it->second;
 		ValueID const& valueId = value->GetID();
-		if( _commandClassId == valueId.GetCommandClassId() )
-		{
-			// The value belongs to the specified command class
-			
-			// First notify the watchers
-			if( Driver* driver = Manager::Get()->GetDriver( valueId.GetHomeId() ) )
-			{
-				Notification* notification = new Notification( Notification::Type_ValueRemoved );
-				notification->SetValueId( valueId );
-				driver->QueueNotification( notification ); 
-			}
-
-			// Now release and remove the value from the store
-			value->Release();
-			m_values.erase( it++ );
-		}
-		else
+
+		// First notify the watchers
+		if( Driver* driver = Manager::Get()->GetDriver( valueId.GetHomeId() ) )
 		{
-			++it;
+			Notification* notification = new Notification( Notification::Type_ValueRemoved );
+			notification->SetValueId( valueId );
+			driver->QueueNotification( notification ); 
 		}
+
+		// Now release the value
+		value->Release();
 	}
+
+	// and remove them from the store in one go
+	m_values.erase( first, last );
 }
 
 //-----------------------------------------------------------------------------
@@ -178,8 +172,8 @@ Value* ValueStore::GetValue
 {
 	Value* value = NULL;
 
-	map<uint32,Value*>::const_iterator it = m_values.find( _key );
-	if( it != m_values.end() )
+	vector< pair<uint32,Value*> >::const_iterator it = LowerBound( GetSortKey( _key ) );
+	if( ( it != m_values.end() ) && ( it->first == _key ) )
 	{
 		value = it->second;
 		if( value )
@@ -202,3 +196,42 @@ Value* ValueStore::GetValue
 //	ValueID const& _id
 //)const
 
+//-----------------------------------------------------------------------------
+// <ValueStore::LowerBound>
+// Find the first value whose sort key is not less than _sortKey
+//-----------------------------------------------------------------------------
+vector< pair<uint32,Value*> >::iterator ValueStore::LowerBound
+(
+	uint64 const _sortKey
+)
+{
+	vector< pair<uint32,Value*> >::iterator first = m_values.begin();
+	size_t count = m_values.size();
+	while( count > 0 )
+	{
+		size_t step = count / 2;
+		vector< pair<uint32,Value*> >::iterator it = first + step;
+		if( GetSortKey( it->first ) < _sortKey )
+		{
+			first = it + 1;
+			count -= step + 1;
+		}
+		else
+		{
+			count = step;
+		}
+	}
+	return first;
+}
+
+//-----------------------------------------------------------------------------
+// <ValueStore::LowerBound>
+// Find the first value whose sort key is not less than _sortKey
+//-----------------------------------------------------------------------------
+vector< pair<uint32,Value*> >::const_iterator ValueStore::LowerBound
+(
+	uint64 const _sortKey
+)const
+{
+	return const_cast<ValueStore*>( this )->LowerBound( _sortKey );
+}
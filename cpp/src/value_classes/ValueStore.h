@@ -28,7 +28,7 @@
 #ifndef _ValueStore_H
 #define _ValueStore_H
 
-#include <map>
+#include <vector>
 #include "Defs.h"
 #include "value_classes/ValueID.h"
 
@@ -39,15 +39,24 @@ namespace OpenZWave
 	class Value;
 
 	/** \brief Container that holds all of the values associated with a given node.
+	 *
+	 * The values are kept in a vector of (ValueStore key, Value) pairs, sorted by command
+	 * class, then instance, then index.  Lookups are a binary search over contiguous memory,
+	 * and the values of a command class sit next to each other, so they can be visited or
+	 * removed without walking the rest of the store.
 	 */
 	class ValueStore
 	{
 	public:
 		
-		typedef map<uint32,Value*>::const_iterator Iterator;
+		typedef vector< pair<uint32,Value*> >::const_iterator Iterator;
 
 		Iterator Begin(){ return m_values.begin(); }
 		Iterator End(){ return m_values.end(); }
+
+		// The range of values that belong to a command class
+		Iterator Begin( uint8 const _commandClassId ){ return LowerBound( ((uint64)_commandClassId)<<24 ); }
+		Iterator End( uint8 const _commandClassId ){ return LowerBound( ( ((uint64)_commandClassId)+1 )<<24 ); }
 		
 		ValueStore(){}
 		~ValueStore();
@@ -59,7 +68,13 @@ namespace OpenZWave
 		void RemoveCommandClassValues( uint8 const _commandClassId );		// Remove all the values associated with a command class
 
 	private:
-		map<uint32,Value*>	m_values;
+		// Reorder the fields of a ValueStore key so that the command class comes first
+		static uint64 GetSortKey( uint32 const _key ){ return( ( ((uint64)(_key & 0x003fc000))<<10 ) | ( (_key>>8) & 0x00ff0000 ) | ( _key & 0x00003fff ) ); }
+
+		vector< pair<uint32,Value*> >::iterator LowerBound( uint64 const _sortKey );
+		vector< pair<uint32,Value*> >::const_iterator LowerBound( uint64 const _sortKey )const;
+
+		vector< pair<uint32,Value*> >	m_values;
 	};
 
 } // namespace OpenZWave